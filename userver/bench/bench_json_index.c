@@ -0,0 +1,172 @@
+/* JSON 解析微基准：对比 json_tokener_parse() 与两阶段解析（http_json_index_*）
+ *
+ * 用法：bench_json_index [每项测试秒数，默认 1]
+ * 负载为 json-buffer 模式下典型的批量上传文档（数 MB）
+ * stage1 只做结构索引与校验；stage1+2 另外构建 json_object 树（含一次 body 拷贝，
+ * 因为 stage 2 会原地改写缓冲区） */
+
+#include "http_json_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct payload {
+    const char *name;
+    char *body;
+    size_t len;
+};
+
+/* ============ 负载生成 ============ */
+
+static void append(struct payload *pl, size_t *cap, const char *s, size_t n)
+{
+    if (pl->len + n + 1 > *cap) {
+        *cap = (*cap + n + 1) * 2;
+        pl->body = realloc(pl->body, *cap);
+    }
+    memcpy(pl->body + pl->len, s, n);
+    pl->len += n;
+    pl->body[pl->len] = '\0';
+}
+
+/* kind 0：ASCII 记录；1：含中文与转义的长字符串；2：数值数组 */
+static void make_payload(struct payload *pl, const char *name, size_t size, int kind)
+{
+    size_t cap = 0;
+    char tmp[256];
+    int n;
+
+    pl->name = name;
+    pl->body = NULL;
+    pl->len = 0;
+
+    append(pl, &cap, "{\"data\":[", 9);
+    for (int i = 0; pl->len < size; i++) {
+        switch (kind) {
+        case 0:
+            n = snprintf(tmp, sizeof(tmp),
+                         "%s{\"id\":%d,\"name\":\"user_%d\",\"email\":\"user%d@example.com\","
+                         "\"active\":%s,\"score\":%d.%02d,\"tags\":[\"a\",\"b\"]}",
+                         i ? "," : "", i, i, i, (i & 1) ? "true" : "false", i % 1000, i % 100);
+            break;
+        case 1:
+            n = snprintf(tmp, sizeof(tmp),
+                         "%s{\"id\":%d,\"text\":\"中文内容 %d，带\\\"转义\\\"和\\n换行\\u00e9 "
+                         "lorem ipsum dolor sit amet 😀\"}",
+                         i ? "," : "", i, i);
+            break;
+        default:
+            n = snprintf(tmp, sizeof(tmp), "%s[%d,%d.%03d,-%de%d]",
+                         i ? "," : "", i, i % 97, i % 1000, i % 13, i % 7);
+            break;
+        }
+        append(pl, &cap, tmp, (size_t)n);
+    }
+    append(pl, &cap, "]}", 2);
+}
+
+/* ============ 计时 ============ */
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static volatile size_t sink;
+
+static double run_tokener(struct payload *pl, double seconds)
+{
+    double start = now_sec(), elapsed;
+    size_t bytes = 0;
+
+    do {
+        json_object *obj = json_tokener_parse(pl->body);
+        sink += obj != NULL;
+        json_object_put(obj);
+        bytes += pl->len;
+        elapsed = now_sec() - start;
+    } while (elapsed < seconds);
+
+    return bytes / elapsed / 1e6;
+}
+
+static double run_stage1(struct payload *pl, http_arena_t *arena, double seconds)
+{
+    double start = now_sec(), elapsed;
+    size_t bytes = 0;
+    http_json_index_t idx;
+
+    do {
+        http_arena_reset(arena);
+        if (http_json_index_build(&idx, arena, pl->body, pl->len) == 0) {
+            sink += idx.count;
+        }
+        bytes += pl->len;
+        elapsed = now_sec() - start;
+    } while (elapsed < seconds);
+
+    return bytes / elapsed / 1e6;
+}
+
+static double run_full(struct payload *pl, http_arena_t *arena, char *work, double seconds)
+{
+    double start = now_sec(), elapsed;
+    size_t bytes = 0;
+    http_json_index_t idx;
+    json_object *obj;
+
+    do {
+        http_arena_reset(arena);
+        memcpy(work, pl->body, pl->len + 1);
+        if (http_json_index_build(&idx, arena, work, pl->len) == 0 &&
+            http_json_index_parse(&idx, work, pl->len, &obj) == 0) {
+            sink += obj != NULL;
+            json_object_put(obj);
+        }
+        bytes += pl->len;
+        elapsed = now_sec() - start;
+    } while (elapsed < seconds);
+
+    return bytes / elapsed / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *impls[] = { "scalar", "sse2", "avx2" };
+    static struct payload payloads[3];
+    double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+    http_arena_t arena = { 0 };
+    char *work;
+
+    make_payload(&payloads[0], "records (ascii)", 4 << 20, 0);
+    make_payload(&payloads[1], "text (utf8, escapes)", 4 << 20, 1);
+    make_payload(&payloads[2], "numbers", 4 << 20, 2);
+
+    work = malloc(payloads[0].len + payloads[1].len + payloads[2].len + 1);
+    if (!work) return 1;
+
+    printf("%-22s %10s %10s %10s %10s %10s\n", "payload (MB/s)",
+           "tokener", "s1-scalar", "s1-sse2", "s1-avx2", "stage1+2");
+    for (int i = 0; i < 3; i++) {
+        struct payload *pl = &payloads[i];
+
+        printf("%-22s %10.1f", pl->name, run_tokener(pl, seconds));
+        for (int k = 0; k < 3; k++) {
+            if (http_json_index_select(impls[k]) < 0) {
+                printf(" %10s", "n/a");
+                continue;
+            }
+            printf(" %10.1f", run_stage1(pl, &arena, seconds));
+        }
+        printf(" %10.1f", run_full(pl, &arena, work, seconds));
+        printf("   (%zu bytes, %s)\n", pl->len, http_json_index_impl());
+    }
+
+    free(work);
+    http_arena_destroy(&arena);
+    for (int i = 0; i < 3; i++) free(payloads[i].body);
+    return 0;
+}
@@ -0,0 +1,46 @@
+#!/bin/bash
+
+# userver 各处理模式的本机压测：依次以 json-stream / json-buffer / json-lazy / form 启动服务器，
+# 用 userver-bench 压测并输出每个模式一行 JSON 结果（可用于流水线中的回归比较）
+#
+# 用法：bench_modes.sh [USERVER] [USERVER_BENCH] [额外的 userver-bench 参数...]
+#   USERVER_PORT  监听端口（默认 18080）
+#   USERVER_ARGS  额外的 userver 参数（如 "-w 4"）
+
+USERVER=${1:-./rootfs/usr/bin/userver}
+BENCH=${2:-./build/bench/userver-bench}
+[ $# -ge 2 ] && shift 2 || shift $#
+PORT=${USERVER_PORT:-18080}
+
+run_mode() {
+    local mode="$1"
+    local kind="$2"
+    local pid
+
+    "${USERVER}" -h 127.0.0.1 -p "${PORT}" -m "${mode}" ${USERVER_ARGS} > /dev/null 2>&1 &
+    pid=$!
+
+    # 等待端口就绪
+    for _ in $(seq 50); do
+        if "${BENCH}" -p "${PORT}" -c 1 -d 1 -W 0 -n 1 -r "${kind}" -j > /dev/null 2>&1; then
+            break
+        fi
+        sleep 0.1
+    done
+
+    echo -n "{\"mode\":\"${mode}\",\"result\":"
+    "${BENCH}" -p "${PORT}" -P "${pid}" -r "${kind}" -j "$@"
+    local rc=$?
+    echo "}"
+
+    kill -TERM "${pid}"
+    wait "${pid}" 2>/dev/null
+    return ${rc}
+}
+
+rc=0
+run_mode json-stream json "$@" || rc=1
+run_mode json-buffer json "$@" || rc=1
+run_mode json-lazy json "$@" || rc=1
+run_mode form form "$@" || rc=1
+exit ${rc}
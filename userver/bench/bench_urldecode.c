@@ -0,0 +1,216 @@
+/* URL 解码微基准：对比原逐字节解码器与 http_url_decode()（scalar/sse2/avx2）
+ *
+ * 用法：bench_urldecode [每项测试秒数，默认 1]
+ * 负载为典型 form-urlencoded body，按 '&' '=' 预先切分为 token 后逐个解码
+ * legacy+malloc 为原 form 解析器的实际开销（每个 token 一次 malloc/free） */
+
+#include "http_urldecode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_TOKENS 4096
+
+struct token {
+    const char *p;
+    size_t len;
+};
+
+struct payload {
+    const char *name;
+    char *body;
+    size_t len;
+    struct token tokens[MAX_TOKENS];
+    int count;
+};
+
+/* ============ 原实现（userver 早期版本的逐字节解码） ============ */
+
+static int legacy_hex_to_int(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 0;
+}
+
+__attribute__((noinline))
+static size_t legacy_url_decode(char *decoded, const char *str, size_t len)
+{
+    size_t i = 0, j = 0;
+    while (i < len) {
+        if (str[i] == '%' && i + 2 < len) {
+            decoded[j++] = (legacy_hex_to_int(str[i + 1]) << 4) | legacy_hex_to_int(str[i + 2]);
+            i += 3;
+        } else if (str[i] == '+') {
+            decoded[j++] = ' ';
+            i++;
+        } else {
+            decoded[j++] = str[i++];
+        }
+    }
+    decoded[j] = '\0';
+    return j;
+}
+
+/* ============ 负载生成 ============ */
+
+static void append(char **buf, size_t *len, size_t *cap, const char *s)
+{
+    size_t n = strlen(s);
+    if (*len + n + 1 > *cap) {
+        *cap = (*cap + n + 1) * 2;
+        *buf = realloc(*buf, *cap);
+    }
+    memcpy(*buf + *len, s, n + 1);
+    *len += n;
+}
+
+/* escape_pct：值中需要转义的字符比例；utf8：值为百分号编码的中文 */
+static void make_payload(struct payload *pl, const char *name, int fields,
+                         int escape_pct, int utf8)
+{
+    static const char alnum[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    size_t cap = 0;
+    char tmp[64];
+
+    pl->name = name;
+    pl->body = NULL;
+    pl->len = 0;
+
+    for (int i = 0; i < fields; i++) {
+        snprintf(tmp, sizeof(tmp), "%sfield_%d=", i ? "&" : "", i);
+        append(&pl->body, &pl->len, &cap, tmp);
+
+        int vlen = 20 + rand() % 60;
+        for (int k = 0; k < vlen; k++) {
+            if (utf8) {
+                append(&pl->body, &pl->len, &cap, (k % 3) ? "%E4%B8%AD" : "+");
+            } else if (rand() % 100 < escape_pct) {
+                append(&pl->body, &pl->len, &cap, (rand() & 1) ? "+" : "%2C");
+            } else {
+                tmp[0] = alnum[rand() % (sizeof(alnum) - 1)];
+                tmp[1] = '\0';
+                append(&pl->body, &pl->len, &cap, tmp);
+            }
+        }
+    }
+
+    /* 切分 token（name 和 value 各一个） */
+    pl->count = 0;
+    const char *p = pl->body, *end = pl->body + pl->len;
+    while (p < end && pl->count < MAX_TOKENS) {
+        const char *q = p;
+        while (q < end && *q != '&' && *q != '=') q++;
+        pl->tokens[pl->count].p = p;
+        pl->tokens[pl->count].len = q - p;
+        pl->count++;
+        p = q + 1;
+    }
+}
+
+/* ============ 计时 ============ */
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static volatile size_t sink;
+
+static double run_legacy(struct payload *pl, char *out, double seconds)
+{
+    double start = now_sec(), elapsed;
+    size_t bytes = 0;
+
+    do {
+        for (int r = 0; r < 16; r++) {
+            for (int i = 0; i < pl->count; i++) {
+                sink += legacy_url_decode(out, pl->tokens[i].p, pl->tokens[i].len);
+            }
+            bytes += pl->len;
+        }
+        elapsed = now_sec() - start;
+    } while (elapsed < seconds);
+
+    return bytes / elapsed / 1e6;
+}
+
+static double run_legacy_malloc(struct payload *pl, double seconds)
+{
+    double start = now_sec(), elapsed;
+    size_t bytes = 0;
+
+    do {
+        for (int r = 0; r < 16; r++) {
+            for (int i = 0; i < pl->count; i++) {
+                char *decoded = malloc(pl->tokens[i].len + 1);
+                sink += legacy_url_decode(decoded, pl->tokens[i].p, pl->tokens[i].len);
+                free(decoded);
+            }
+            bytes += pl->len;
+        }
+        elapsed = now_sec() - start;
+    } while (elapsed < seconds);
+
+    return bytes / elapsed / 1e6;
+}
+
+static double run_new(struct payload *pl, char *out, double seconds)
+{
+    double start = now_sec(), elapsed;
+    size_t bytes = 0;
+
+    do {
+        for (int r = 0; r < 16; r++) {
+            for (int i = 0; i < pl->count; i++) {
+                sink += http_url_decode(out, pl->tokens[i].p, pl->tokens[i].len,
+                                        HTTP_URLDEC_PLUS);
+            }
+            bytes += pl->len;
+        }
+        elapsed = now_sec() - start;
+    } while (elapsed < seconds);
+
+    return bytes / elapsed / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *impls[] = { "scalar", "sse2", "avx2" };
+    static struct payload payloads[3];
+    double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+    char *out;
+
+    srand(42);
+    make_payload(&payloads[0], "plain (1% escapes)", 300, 1, 0);
+    make_payload(&payloads[1], "mixed (15% escapes)", 300, 15, 0);
+    make_payload(&payloads[2], "utf8 (percent-encoded)", 100, 0, 1);
+
+    out = malloc(1 << 20);
+    if (!out) return 1;
+
+    printf("%-24s %14s %10s %10s %10s %10s\n", "payload (MB/s)",
+           "legacy+malloc", "legacy", "scalar", "sse2", "avx2");
+    for (int i = 0; i < 3; i++) {
+        struct payload *pl = &payloads[i];
+
+        printf("%-24s %14.1f", pl->name, run_legacy_malloc(pl, seconds));
+        printf(" %10.1f", run_legacy(pl, out, seconds));
+        for (int k = 0; k < 3; k++) {
+            if (http_url_scan_select(impls[k]) < 0) {
+                printf(" %10s", "n/a");
+                continue;
+            }
+            printf(" %10.1f", run_new(pl, out, seconds));
+        }
+        printf("   (%zu bytes, %d tokens)\n", pl->len, pl->count);
+    }
+
+    free(out);
+    for (int i = 0; i < 3; i++) free(payloads[i].body);
+    return 0;
+}
@@ -0,0 +1,727 @@
+/* userver 压测工具：基于 uloop 的多连接闭环负载生成器
+ *
+ * 每个连接同一时刻只有一个请求在途，收到完整响应（llhttp 解析）后立即发送下一个；
+ * 统计吞吐、延迟分布（p50/p90/p99/p99.9）以及服务端每请求 CPU（-P 指定服务端 pid，
+ * 多进程模式下包含其 worker 子进程）。预热阶段的请求不计入结果。
+ *
+ * 请求类型（-r KIND[:WEIGHT][@PATH]，可重复，按权重随机混合）：
+ *   json  POST application/json，body 为 -b 指定大小的 JSON 对象
+ *   form  POST application/x-www-form-urlencoded，body 含需要解码的字段
+ *   get   GET，无 body
+ *
+ * 示例：
+ *   userver-bench -p 8080 -c 64 -d 10 -r json -b 1024
+ *   userver-bench -s /tmp/userver.sock -r json:3@/api/json -r form:1@/api/form
+ *   userver-bench -S -p 8443 -K -r get@/index.html     # 每个请求新建 HTTPS 连接
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <libubox/uloop.h>
+#include <libubox/ustream.h>
+#include <libubox/ustream-ssl.h>
+#include <libubox/usock.h>
+#include <libubox/utils.h>
+#include <llhttp.h>
+
+#define MAX_KINDS       16
+#define MAX_CONNS       10000
+#define RETRY_MS        10          /* 连接失败后的重试间隔 */
+
+/* 延迟直方图：64ns 以下逐纳秒，其上每个 2 的幂区间 32 个子桶（相对误差 < 3.2%） */
+#define HIST_SUB_BITS   5
+#define HIST_SUB        (1 << HIST_SUB_BITS)
+#define HIST_LINEAR     64
+#define HIST_BUCKETS    (HIST_LINEAR + (64 - 6) * HIST_SUB)
+
+struct bench_kind {
+    const char *name;
+    const char *path;
+    int weight;
+    char *req;                  /* 预先生成的完整请求 */
+    size_t req_len;
+};
+
+struct bench_conn {
+    struct ustream_fd fd;
+    struct ustream_ssl ssl;
+    struct ustream *stream;
+    struct uloop_timeout retry;
+    llhttp_t parser;
+    uint64_t start_ns;
+    int open;
+    int busy;                   /* 请求在途 */
+    int complete;               /* 本次 execute 中收到完整响应 */
+};
+
+/* 配置 */
+static const char *g_host = "127.0.0.1";
+static const char *g_port = "8080";
+static const char *g_socket;
+static int g_ssl;
+static int g_conns = 16;
+static int g_duration = 10;
+static int g_warmup = 1;
+static uint64_t g_max_requests;
+static size_t g_body_size = 128;
+static int g_keep_alive = 1;
+static int g_server_pid;
+static int g_json_output;
+
+static struct bench_kind g_kinds[MAX_KINDS];
+static int g_nkinds;
+static int g_total_weight;
+
+static struct ustream_ssl_ctx *g_ssl_ctx;
+static llhttp_settings_t g_settings;
+static struct bench_conn *g_conn;
+
+/* 运行状态与统计 */
+static int g_running = 1;
+static int g_measuring;
+static uint64_t g_rng = 0x9e3779b97f4a7c15ULL;
+
+static struct {
+    uint64_t requests;
+    uint64_t errors;
+    uint64_t non_2xx;
+    uint64_t bytes;
+    uint64_t connects;
+    uint64_t lat_sum;
+    uint64_t lat_max;
+    uint64_t hist[HIST_BUCKETS];
+} g_stats;
+
+static void conn_open(struct bench_conn *c);
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t rng_next(void)
+{
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+/* ============ 延迟直方图 ============ */
+
+static int hist_index(uint64_t v)
+{
+    int e;
+
+    if (v < HIST_LINEAR) {
+        return (int)v;
+    }
+    e = 63 - __builtin_clzll(v);
+    return HIST_LINEAR + (e - 6) * HIST_SUB + (int)((v >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+/* 桶的上界（报告偏保守） */
+static uint64_t hist_value(int idx)
+{
+    int e, sub;
+
+    if (idx < HIST_LINEAR) {
+        return idx;
+    }
+    e = (idx - HIST_LINEAR) / HIST_SUB + 6;
+    sub = (idx - HIST_LINEAR) % HIST_SUB;
+    return ((uint64_t)(HIST_SUB + sub + 1) << (e - HIST_SUB_BITS)) - 1;
+}
+
+static uint64_t hist_percentile(double p)
+{
+    uint64_t target = (uint64_t)(g_stats.requests * p / 100.0);
+    uint64_t seen = 0;
+
+    if (target >= g_stats.requests && g_stats.requests > 0) {
+        target = g_stats.requests - 1;
+    }
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += g_stats.hist[i];
+        if (seen > target) {
+            uint64_t v = hist_value(i);
+            return v < g_stats.lat_max ? v : g_stats.lat_max;
+        }
+    }
+    return g_stats.lat_max;
+}
+
+static void record(uint64_t lat, int status)
+{
+    if (!g_measuring) return;
+
+    g_stats.requests++;
+    if (status < 200 || status > 299) {
+        g_stats.non_2xx++;
+    }
+    g_stats.lat_sum += lat;
+    if (lat > g_stats.lat_max) {
+        g_stats.lat_max = lat;
+    }
+    g_stats.hist[hist_index(lat)]++;
+
+    if (g_max_requests && g_stats.requests >= g_max_requests) {
+        g_running = 0;
+        uloop_end();
+    }
+}
+
+/* ============ 请求生成 ============ */
+
+static char *build_body(const char *kind, size_t size, size_t *len)
+{
+    char *body = malloc(size + 64);
+    size_t n = 0;
+
+    if (!body) return NULL;
+
+    if (strcmp(kind, "json") == 0) {
+        /* {"id":N,"name":"...","data":"xxx..."} 填充到目标大小 */
+        n = snprintf(body, 64, "{\"id\":12345,\"name\":\"bench\",\"data\":\"");
+        for (; n < size; n++) {
+            body[n] = 'a' + n % 26;
+        }
+        memcpy(body + n, "\"}", 2);
+        n += 2;
+    } else {
+        /* k0=value+with+spaces%21&k1=... 直到目标大小 */
+        for (int i = 0; n < size || i == 0; i++) {
+            n += snprintf(body + n, 64, "%sk%d=value+%d%%21", i ? "&" : "", i, i);
+        }
+    }
+
+    *len = n;
+    return body;
+}
+
+static int build_request(struct bench_kind *k)
+{
+    char *body = NULL;
+    size_t body_len = 0;
+    const char *type = NULL;
+    int n;
+
+    if (strcmp(k->name, "json") == 0) {
+        type = "application/json";
+    } else if (strcmp(k->name, "form") == 0) {
+        type = "application/x-www-form-urlencoded";
+    } else if (strcmp(k->name, "get") != 0) {
+        fprintf(stderr, "Unknown request kind: %s\n", k->name);
+        return -1;
+    }
+
+    if (type) {
+        body = build_body(k->name, g_body_size, &body_len);
+        if (!body) return -1;
+    }
+
+    k->req = malloc(body_len + strlen(k->path) + strlen(g_host) + 256);
+    if (!k->req) {
+        free(body);
+        return -1;
+    }
+
+    if (type) {
+        n = sprintf(k->req, "POST %s HTTP/1.1\r\nHost: %s\r\nConnection: %s\r\n"
+                    "Content-Type: %s\r\nContent-Length: %zu\r\n\r\n",
+                    k->path, g_host, g_keep_alive ? "keep-alive" : "close", type, body_len);
+        memcpy(k->req + n, body, body_len);
+        n += body_len;
+    } else {
+        n = sprintf(k->req, "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: %s\r\n\r\n",
+                    k->path, g_host, g_keep_alive ? "keep-alive" : "close");
+    }
+
+    k->req_len = n;
+    free(body);
+    return 0;
+}
+
+/* KIND[:WEIGHT][@PATH] */
+static int parse_kind(char *spec)
+{
+    struct bench_kind *k;
+    char *at, *colon;
+
+    if (g_nkinds == MAX_KINDS) {
+        return -1;
+    }
+    k = &g_kinds[g_nkinds];
+    k->path = "/";
+    k->weight = 1;
+
+    at = strchr(spec, '@');
+    if (at) {
+        *at = '\0';
+        k->path = at + 1;
+    }
+    colon = strchr(spec, ':');
+    if (colon) {
+        *colon = '\0';
+        k->weight = atoi(colon + 1);
+        if (k->weight < 1) return -1;
+    }
+    k->name = spec;
+
+    g_total_weight += k->weight;
+    g_nkinds++;
+    return 0;
+}
+
+static const struct bench_kind *pick_kind(void)
+{
+    int r;
+
+    if (g_nkinds == 1) {
+        return &g_kinds[0];
+    }
+    r = (int)(rng_next() % g_total_weight);
+    for (int i = 0; i < g_nkinds; i++) {
+        r -= g_kinds[i].weight;
+        if (r < 0) return &g_kinds[i];
+    }
+    return &g_kinds[0];
+}
+
+/* ============ 连接 ============ */
+
+static void conn_send(struct bench_conn *c)
+{
+    const struct bench_kind *k = pick_kind();
+
+    /* 短连接模式下延迟从建立连接开始计算 */
+    if (g_keep_alive || !c->start_ns) {
+        c->start_ns = now_ns();
+    }
+    c->busy = 1;
+    c->complete = 0;
+    llhttp_init(&c->parser, HTTP_RESPONSE, &g_settings);
+    c->parser.data = c;
+    ustream_write(c->stream, k->req, k->req_len, false);
+}
+
+static void conn_close(struct bench_conn *c)
+{
+    if (!c->open) return;
+
+    if (g_ssl) {
+        ustream_free(&c->ssl.stream);
+    }
+    ustream_free(&c->fd.stream);
+    close(c->fd.fd.fd);
+    c->open = 0;
+    c->start_ns = 0;
+}
+
+/* 关闭后按需重连（在 notify_state 或定时器中调用，不在读回调中释放 stream） */
+static void conn_restart(struct bench_conn *c, int error)
+{
+    if (error && c->busy && g_measuring) {
+        g_stats.errors++;
+    }
+    c->busy = 0;
+    conn_close(c);
+    if (g_running) {
+        conn_open(c);
+    }
+}
+
+static int on_message_complete(llhttp_t *parser)
+{
+    struct bench_conn *c = parser->data;
+
+    record(now_ns() - c->start_ns, parser->status_code);
+    c->busy = 0;
+    c->complete = 1;
+    return HPE_PAUSED;
+}
+
+static struct bench_conn *stream_conn(struct ustream *s)
+{
+    return g_ssl ? container_of(s, struct bench_conn, ssl.stream)
+                 : container_of(s, struct bench_conn, fd.stream);
+}
+
+static void conn_notify_read(struct ustream *s, int bytes)
+{
+    struct bench_conn *c = stream_conn(s);
+    char *data;
+    int len;
+
+    while ((data = ustream_get_read_buf(s, &len)) != NULL && len > 0) {
+        enum llhttp_errno err;
+
+        if (!c->busy) {
+            /* 多余数据（服务器不应发送） */
+            ustream_consume(s, len);
+            break;
+        }
+
+        err = llhttp_execute(&c->parser, data, len);
+        if (err != HPE_OK && err != HPE_PAUSED) {
+            fprintf(stderr, "Response parse error: %s\n", llhttp_errno_name(err));
+            ustream_consume(s, len);
+            c->busy = 0;
+            if (g_measuring) g_stats.errors++;
+            ustream_state_change(s);
+            return;
+        }
+        if (err == HPE_PAUSED) {
+            len = llhttp_get_error_pos(&c->parser) - data;
+        }
+        if (g_measuring) g_stats.bytes += len;
+        ustream_consume(s, len);
+
+        if (c->complete) {
+            if (!g_running) {
+                return;
+            }
+            if (g_keep_alive) {
+                conn_send(c);
+            } else {
+                ustream_state_change(s);
+            }
+            return;
+        }
+    }
+}
+
+static void conn_notify_state(struct ustream *s)
+{
+    struct bench_conn *c = stream_conn(s);
+
+    if (!c->open) return;
+
+    /* 响应完成（短连接）、对端关闭或出错：重新建立连接 */
+    if (c->complete && !g_keep_alive) {
+        conn_restart(c, 0);
+    } else if (s->eof || s->write_error || !c->busy) {
+        if (c->busy && s->eof) {
+            /* 以关闭连接表示结束的响应 */
+            llhttp_finish(&c->parser);
+        }
+        conn_restart(c, 1);
+    }
+}
+
+static void conn_retry_cb(struct uloop_timeout *t)
+{
+    struct bench_conn *c = container_of(t, struct bench_conn, retry);
+
+    if (g_running) {
+        conn_open(c);
+    }
+}
+
+static void ssl_notify_error(struct ustream_ssl *ssl, int error, const char *str)
+{
+    fprintf(stderr, "SSL error(%d): %s\n", error, str);
+}
+
+static void conn_open(struct bench_conn *c)
+{
+    int fd, one = 1;
+
+    if (!g_keep_alive) {
+        c->start_ns = now_ns();
+    }
+
+    fd = g_socket ? usock(USOCK_UNIX, g_socket, NULL) : usock(USOCK_TCP, g_host, g_port);
+    if (fd < 0) {
+        if (g_measuring) g_stats.errors++;
+        c->retry.cb = conn_retry_cb;
+        uloop_timeout_set(&c->retry, RETRY_MS);
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    if (!g_socket) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    memset(&c->fd, 0, sizeof(c->fd));
+    c->fd.stream.notify_read = conn_notify_read;
+    c->fd.stream.notify_state = conn_notify_state;
+    ustream_fd_init(&c->fd, fd);
+    c->stream = &c->fd.stream;
+
+    if (g_ssl) {
+        memset(&c->ssl, 0, sizeof(c->ssl));
+        c->ssl.stream.string_data = true;
+        c->ssl.stream.notify_read = conn_notify_read;
+        c->ssl.stream.notify_state = conn_notify_state;
+        c->ssl.notify_error = ssl_notify_error;
+        ustream_ssl_init(&c->ssl, &c->fd.stream, g_ssl_ctx, false);
+        c->stream = &c->ssl.stream;
+    }
+
+    c->open = 1;
+    if (g_measuring) g_stats.connects++;
+
+    /* HTTPS 握手完成前写入的数据由 ustream-ssl 缓存 */
+    conn_send(c);
+}
+
+/* ============ CPU 统计 ============ */
+
+/* 读取 /proc/PID/stat 的 utime + stime（时钟周期），ppid 可为 NULL */
+static int proc_cpu(int pid, uint64_t *ticks, int *ppid)
+{
+    char path[64], buf[1024];
+    unsigned long utime, stime;
+    int parent;
+    FILE *f;
+    char *p;
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    f = fopen(path, "r");
+    if (!f) return -1;
+    if (!fgets(buf, sizeof(buf), f)) {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+
+    /* comm 可能含空格，从最后一个 ')' 之后解析 */
+    p = strrchr(buf, ')');
+    if (!p || sscanf(p + 2, "%*c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                     &parent, &utime, &stime) != 3) {
+        return -1;
+    }
+    *ticks = utime + stime;
+    if (ppid) *ppid = parent;
+    return 0;
+}
+
+/* 服务端进程及其直接子进程（worker）的 CPU 时间（纳秒） */
+static uint64_t server_cpu_ns(void)
+{
+    uint64_t total = 0, ticks;
+    struct dirent *e;
+    DIR *d;
+    int ppid;
+
+    if (proc_cpu(g_server_pid, &ticks, NULL) == 0) {
+        total += ticks;
+    }
+
+    d = opendir("/proc");
+    if (d) {
+        while ((e = readdir(d)) != NULL) {
+            int pid = atoi(e->d_name);
+            if (pid > 0 && pid != g_server_pid &&
+                proc_cpu(pid, &ticks, &ppid) == 0 && ppid == g_server_pid) {
+                total += ticks;
+            }
+        }
+        closedir(d);
+    }
+
+    return total * (1000000000ULL / sysconf(_SC_CLK_TCK));
+}
+
+static uint64_t self_cpu_ns(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL +
+           (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+}
+
+/* ============ 主流程 ============ */
+
+static uint64_t g_start_ns, g_server_cpu0, g_self_cpu0;
+
+static void measure_start(void)
+{
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_measuring = 1;
+    g_start_ns = now_ns();
+    g_self_cpu0 = self_cpu_ns();
+    if (g_server_pid) {
+        g_server_cpu0 = server_cpu_ns();
+    }
+}
+
+static void phase_cb(struct uloop_timeout *t)
+{
+    if (!g_measuring) {
+        measure_start();
+        uloop_timeout_set(t, g_duration * 1000);
+        return;
+    }
+    g_running = 0;
+    uloop_end();
+}
+
+static void report(void)
+{
+    double elapsed = (now_ns() - g_start_ns) / 1e9;
+    double rps = g_stats.requests / elapsed;
+    double avg = g_stats.requests ? (double)g_stats.lat_sum / g_stats.requests / 1e3 : 0;
+    double p50 = hist_percentile(50) / 1e3, p90 = hist_percentile(90) / 1e3;
+    double p99 = hist_percentile(99) / 1e3, p999 = hist_percentile(99.9) / 1e3;
+    double max = g_stats.lat_max / 1e3;
+    double client_cpu = g_stats.requests ?
+                        (self_cpu_ns() - g_self_cpu0) / 1e3 / g_stats.requests : 0;
+    double server_cpu = -1;
+
+    if (g_server_pid && g_stats.requests) {
+        server_cpu = (server_cpu_ns() - g_server_cpu0) / 1e3 / g_stats.requests;
+    }
+
+    if (g_json_output) {
+        printf("{\"requests\":%llu,\"errors\":%llu,\"non_2xx\":%llu,\"connects\":%llu,"
+               "\"seconds\":%.3f,\"rps\":%.1f,\"mb_per_sec\":%.3f,"
+               "\"latency_us\":{\"avg\":%.1f,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,"
+               "\"p999\":%.1f,\"max\":%.1f},\"client_cpu_us_per_req\":%.2f",
+               (unsigned long long)g_stats.requests, (unsigned long long)g_stats.errors,
+               (unsigned long long)g_stats.non_2xx, (unsigned long long)g_stats.connects,
+               elapsed, rps, g_stats.bytes / elapsed / 1e6,
+               avg, p50, p90, p99, p999, max, client_cpu);
+        if (server_cpu >= 0) {
+            printf(",\"server_cpu_us_per_req\":%.2f", server_cpu);
+        }
+        printf("}\n");
+        return;
+    }
+
+    printf("Requests:     %llu in %.2fs (%llu errors, %llu non-2xx, %llu connects)\n",
+           (unsigned long long)g_stats.requests, elapsed, (unsigned long long)g_stats.errors,
+           (unsigned long long)g_stats.non_2xx, (unsigned long long)g_stats.connects);
+    printf("Throughput:   %.1f req/s, %.2f MB/s\n", rps, g_stats.bytes / elapsed / 1e6);
+    printf("Latency (us): avg %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+           avg, p50, p90, p99, p999, max);
+    printf("Client CPU:   %.2f us/req\n", client_cpu);
+    if (server_cpu >= 0) {
+        printf("Server CPU:   %.2f us/req\n", server_cpu);
+    }
+}
+
+static void print_usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -h HOST         Server host (default: 127.0.0.1)\n");
+    fprintf(stderr, "  -p PORT         Server port (default: 8080)\n");
+    fprintf(stderr, "  -s PATH         Connect to Unix socket instead of TCP\n");
+    fprintf(stderr, "  -S              Use HTTPS\n");
+    fprintf(stderr, "  -c N            Concurrent connections (default: 16)\n");
+    fprintf(stderr, "  -d SEC          Measurement duration (default: 10)\n");
+    fprintf(stderr, "  -W SEC          Warmup before measuring (default: 1)\n");
+    fprintf(stderr, "  -n N            Stop after N measured requests\n");
+    fprintf(stderr, "  -r KIND[:W][@PATH]  Request kind json|form|get with weight and path,\n");
+    fprintf(stderr, "                  repeatable (default: json@/)\n");
+    fprintf(stderr, "  -b BYTES        Request body size for json/form (default: 128)\n");
+    fprintf(stderr, "  -K              Disable keep-alive (new connection per request)\n");
+    fprintf(stderr, "  -P PID          Server pid for CPU accounting (includes workers)\n");
+    fprintf(stderr, "  -j              Print result as one JSON line\n");
+}
+
+int main(int argc, char **argv)
+{
+    struct uloop_timeout phase = { .cb = phase_cb };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "h:p:s:Sc:d:W:n:r:b:KP:j")) != -1) {
+        switch (opt) {
+            case 'h': g_host = optarg; break;
+            case 'p': g_port = optarg; break;
+            case 's': g_socket = optarg; break;
+            case 'S': g_ssl = 1; break;
+            case 'c': g_conns = atoi(optarg); break;
+            case 'd': g_duration = atoi(optarg); break;
+            case 'W': g_warmup = atoi(optarg); break;
+            case 'n': g_max_requests = strtoull(optarg, NULL, 10); break;
+            case 'r':
+                if (parse_kind(optarg) < 0) {
+                    fprintf(stderr, "Invalid request spec: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'b': g_body_size = strtoul(optarg, NULL, 10); break;
+            case 'K': g_keep_alive = 0; break;
+            case 'P': g_server_pid = atoi(optarg); break;
+            case 'j': g_json_output = 1; break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (g_conns < 1 || g_conns > MAX_CONNS || g_duration < 1 || g_warmup < 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (g_nkinds == 0) {
+        static char def[] = "json";
+        parse_kind(def);
+    }
+    for (int i = 0; i < g_nkinds; i++) {
+        if (build_request(&g_kinds[i]) < 0) {
+            return 1;
+        }
+    }
+
+    if (g_ssl) {
+        g_ssl_ctx = ustream_ssl_context_new(false);
+        if (!g_ssl_ctx) {
+            fprintf(stderr, "Failed to create SSL context\n");
+            return 1;
+        }
+    }
+
+    llhttp_settings_init(&g_settings);
+    g_settings.on_message_complete = on_message_complete;
+
+    g_conn = calloc(g_conns, sizeof(*g_conn));
+    if (!g_conn) return 1;
+
+    uloop_init();
+
+    if (g_warmup > 0) {
+        uloop_timeout_set(&phase, g_warmup * 1000);
+    } else {
+        measure_start();
+        uloop_timeout_set(&phase, g_duration * 1000);
+    }
+
+    for (int i = 0; i < g_conns; i++) {
+        conn_open(&g_conn[i]);
+    }
+
+    uloop_run();
+
+    report();
+
+    for (int i = 0; i < g_conns; i++) {
+        uloop_timeout_cancel(&g_conn[i].retry);
+        conn_close(&g_conn[i]);
+    }
+    uloop_done();
+
+    if (g_ssl_ctx) {
+        ustream_ssl_context_free(g_ssl_ctx);
+    }
+    free(g_conn);
+    return g_stats.requests > 0 ? 0 : 1;
+}
@@ -1,18 +1,107 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stddef.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
+#include <netdb.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <libubox/utils.h>
 #include <libubox/ustream-ssl.h>
 #include "http.h"
+#include "http_router.h"
+#include "http_tls.h"
+#include "http_compress.h"
+#include "http_metrics.h"
+#include "http_log.h"
+#include "http_uring.h"
+#include "http_h2.h"
+#include "http_hpack.h"
 
 /* 全局 body 处理器 */
 static http_body_handler_t *g_body_handler = NULL;
 
+/* 路由表（可选） */
+static struct http_router *g_router = NULL;
+
+#define ERROR_BAD_REQUEST   "{\"error\":\"Bad Request\"}"
+#define CONN_POOL_MAX       256     /* 连接对象缓存上限 */
+#define HTTP_TX_RECORD_SIZE 16384   /* TLS 记录明文上限 */
+#define HTTP_ACCEPT_BATCH   64      /* 每次可读事件最多 accept 的连接数 */
+#define HTTP_ACCEPT_BACKOFF 100     /* fd 耗尽时暂停 accept 的时间（毫秒） */
+
+/* 活动连接数 */
+static int g_conn_count = 0;
+
+/* HTTPS 连接尝试内核 TLS（配置开启且内核支持，见 http_tls.h） */
+static int g_ktls = 0;
+static int g_uring = 0;               /* HTTP 连接使用 io_uring 后端 */
+static int g_uring_accept = 0;        /* 新连接由 io_uring 多发 accept 接受（否则经 uloop） */
+static int g_h2 = 0;                  /* 接受 HTTP/2 连接 */
+
+static void http_conn_reset_request(struct http_conn *conn);
+static void http_conn_read(struct http_conn *conn, struct ustream *s);
+static void http_stream_schedule(struct http_conn *conn);
+static void http_conn_check_close(struct http_conn *conn);
+static int http_conn_tls_type(struct http_conn *conn);
+static void http_conn_timer_update(struct http_conn *conn, int progress);
+static int http_request_begin(struct http_conn *conn);
+static void http_h2_kick(struct http_conn *conn);
+
+/* 接收缓冲区：所有连接持有的读缓冲区总量受预算限制，
+ * 超出时新的分配失败（ustream 随之停读），连接挂到等待链表，有缓冲区释放后再唤醒 */
+static size_t g_rx_budget = HTTP_RX_BUDGET;
+static size_t g_rx_bytes = 0;
+static size_t g_rx_peak = 0;
+static uint64_t g_rx_waits = 0;
+static LIST_HEAD(g_rx_waiters);
+
+/* ustream 默认的缓冲区分配函数（由它维护缓冲区链表和计数，这里只决定大小） */
+static int (*g_rx_alloc_default)(struct ustream *s, struct ustream_buf_list *l);
+
+static void http_rx_wake_cb(struct uloop_timeout *t);
+static struct uloop_timeout g_rx_wake = { .cb = http_rx_wake_cb };
+
+/* 连接超时阶段 */
+enum {
+    HTTP_PHASE_NONE,                /* 处理器暂停读取 / 即将关闭，不计时 */
+    HTTP_PHASE_HEADER,
+    HTTP_PHASE_BODY,
+    HTTP_PHASE_IDLE,
+    HTTP_PHASE_WRITE,
+    HTTP_PHASE_MAX
+};
+
+/* 连接上限与超时 */
+static struct http_server *g_server = NULL;
+static int g_accept_paused = 0;     /* 监听 fd 已从 uloop 移除 */
+static int g_accept_backoff = 0;    /* fd 或内存耗尽，等待重试 */
+static struct http_accept_stats g_accept_stats;
+
+static void http_accept_retry_cb(struct uloop_timeout *t);
+static struct uloop_timeout g_accept_retry = { .cb = http_accept_retry_cb };
+
+/* /proc/net/netstat 的 accept 队列计数：首次取统计时读一次，之后由定时器刷新，取统计时不读文件 */
+#define HTTP_NETSTAT_INTERVAL   5000        /* 毫秒 */
+static uint64_t g_listen_overflows;
+static uint64_t g_listen_drops;
+static void http_netstat_cb(struct uloop_timeout *t);
+static struct uloop_timeout g_netstat_timer = { .cb = http_netstat_cb };
+static unsigned int g_timeouts[HTTP_PHASE_MAX];
+static struct http_conn_stats g_conn_stats;
+
+int http_conn_count(void)
+{
+    return g_conn_count;
+}
+
 /* 设置/获取全局 body 处理器 */
 void http_set_body_handler(http_body_handler_t *handler) {
     g_body_handler = handler;
@@ -22,197 +111,2347 @@ http_body_handler_t *http_get_body_handler(void) {
     return g_body_handler;
 }
 
-/* HTTP 头部处理 */
+void http_set_router(struct http_router *router)
+{
+    g_router = router;
+}
+
+/* 常用请求头：名称长度互不相同，按长度直接定位候选，再比较一次 */
+static const struct {
+    const char *name;
+    int id;
+} http_known_headers[] = {
+    [4]  = { "Host", HTTP_HDR_HOST },
+    [5]  = { "Range", HTTP_HDR_RANGE },
+    [8]  = { "If-Range", HTTP_HDR_IF_RANGE },
+    [10] = { "Connection", HTTP_HDR_CONNECTION },
+    [12] = { "Content-Type", HTTP_HDR_CONTENT_TYPE },
+    [13] = { "If-None-Match", HTTP_HDR_IF_NONE_MATCH },
+    [14] = { "Content-Length", HTTP_HDR_CONTENT_LENGTH },
+    [15] = { "Accept-Encoding", HTTP_HDR_ACCEPT_ENCODING },
+    [17] = { "If-Modified-Since", HTTP_HDR_IF_MODIFIED_SINCE },
+};
+
+#define HTTP_KNOWN_HEADERS_MAX (sizeof(http_known_headers) / sizeof(http_known_headers[0]))
+
+/* 请求头解析状态 */
+enum {
+    HTTP_HDR_STATE_NONE,            /* 等待下一个 field */
+    HTTP_HDR_STATE_FIELD,           /* field 可能还有后续片段 */
+    HTTP_HDR_STATE_DONE,            /* 请求头结束，忽略 trailer */
+};
+
+/* 追加到 arena 中的字符串（str 须为 arena 中长度 *len + 1 的字符串） */
+static char *http_arena_append(http_arena_t *arena, char *str, size_t *len,
+                               const char *at, size_t length)
+{
+    char *p = http_arena_realloc(arena, str, str ? *len + 1 : 0, *len + length + 1);
+    if (!p) return NULL;
+    
+    memcpy(p + *len, at, length);
+    *len += length;
+    p[*len] = '\0';
+    return p;
+}
+
+/* 追加切片：首个片段直接引用接收缓冲区；同一缓冲区中相邻的片段只延长长度；
+ * 跨读取的片段此时已由 http_conn_spill() 拷贝到 arena，在 arena 中拼接 */
+static int http_slice_append(http_arena_t *arena, const char **str, size_t *len,
+                             const char *at, size_t length)
+{
+    if (*len == 0) {
+        *str = at;
+        *len = length;
+    } else if (*str + *len == at) {
+        *len += length;
+    } else {
+        char *p = http_arena_append(arena, (char *)*str, len, at, length);
+        if (!p) return -1;
+        *str = p;
+    }
+    return 0;
+}
+
+/* 把仍指向 [data, data + len) 的切片拷贝到 arena（该段缓冲区即将被消费） */
+static int http_spill_slice(http_arena_t *arena, const char **str, size_t slen,
+                            const char *data, size_t len)
+{
+    char *p;
+    
+    if (slen == 0 || *str < data || *str >= data + len) {
+        return 0;
+    }
+    
+    p = http_arena_alloc(arena, slen + 1);
+    if (!p) return -1;
+    memcpy(p, *str, slen);
+    p[slen] = '\0';
+    *str = p;
+    return 0;
+}
+
+static int http_conn_spill(struct http_conn *conn, const char *data, size_t len)
+{
+    int ret = http_spill_slice(&conn->arena, (const char **)&conn->url, conn->url_len, data, len);
+    
+    for (int i = 0; i < conn->header_count; i++) {
+        struct http_header *h = &conn->headers[i];
+        ret |= http_spill_slice(&conn->arena, &h->name, h->name_len, data, len);
+        ret |= http_spill_slice(&conn->arena, &h->value, h->value_len, data, len);
+    }
+    
+    return ret;
+}
+
+/* URL 处理 */
+int http_on_url(llhttp_t *parser, const char *at, size_t length)
+{
+    struct http_conn *conn = (struct http_conn *)parser->data;
+    
+    return http_slice_append(&conn->arena, (const char **)&conn->url, &conn->url_len,
+                             at, length);
+}
+
+/* HTTP 头部处理：只记录切片，不拷贝 */
 int http_on_header_field(llhttp_t *parser, const char *at, size_t length) 
 {
     struct http_conn *conn = (struct http_conn *)parser->data;
+    struct http_header *h;
+    size_t len;
+    
+    if (conn->header_state == HTTP_HDR_STATE_DONE) {
+        return 0;
+    }
+    
+    if (conn->header_state != HTTP_HDR_STATE_FIELD) {
+        if (conn->header_count == HTTP_MAX_HEADERS) {
+            return -1;
+        }
+        h = &conn->headers[conn->header_count++];
+        memset(h, 0, sizeof(*h));
+        conn->header_state = HTTP_HDR_STATE_FIELD;
+    } else {
+        h = &conn->headers[conn->header_count - 1];
+    }
+    
+    len = h->name_len;
+    if (http_slice_append(&conn->arena, &h->name, &len, at, length) < 0) {
+        return -1;
+    }
+    h->name_len = len;
+    return 0;
+}
+
+/* 常用请求头记录下标（表中最后一个），重复的以最后一个为准 */
+static void http_header_index(struct http_conn *conn)
+{
+    const struct http_header *h = &conn->headers[conn->header_count - 1];
+    
+    if (h->name_len < HTTP_KNOWN_HEADERS_MAX && http_known_headers[h->name_len].name &&
+        strncasecmp(h->name, http_known_headers[h->name_len].name, h->name_len) == 0) {
+        conn->header_index[http_known_headers[h->name_len].id] = conn->header_count;
+    }
+}
+
+int http_on_header_field_complete(llhttp_t *parser)
+{
+    struct http_conn *conn = (struct http_conn *)parser->data;
+    
+    if (conn->header_state != HTTP_HDR_STATE_FIELD) {
+        return 0;
+    }
+    conn->header_state = HTTP_HDR_STATE_NONE;
+    http_header_index(conn);
+    return 0;
+}
+
+int http_on_header_value(llhttp_t *parser, const char *at, size_t length) 
+{
+    struct http_conn *conn = (struct http_conn *)parser->data;
+    struct http_header *h;
+    size_t len;
+    
+    if (conn->header_state == HTTP_HDR_STATE_DONE || conn->header_count == 0) {
+        return 0;
+    }
+    
+    h = &conn->headers[conn->header_count - 1];
+    len = h->value_len;
+    if (http_slice_append(&conn->arena, &h->value, &len, at, length) < 0) {
+        return -1;
+    }
+    h->value_len = len;
+    return 0;
+}
+
+const char *http_find_header(struct http_conn *conn, const char *name, size_t *len)
+{
+    size_t name_len = strlen(name);
+    
+    for (int i = conn->header_count - 1; i >= 0; i--) {
+        const struct http_header *h = &conn->headers[i];
+        if (h->name_len == name_len && strncasecmp(h->name, name, name_len) == 0) {
+            if (len) *len = h->value_len;
+            return h->value;
+        }
+    }
+    
+    return NULL;
+}
+
+int http_on_message_begin(llhttp_t *parser)
+{
+    struct http_conn *conn = (struct http_conn *)parser->data;
+    
+    /* keep-alive 的后续请求从首字节计时，首个请求从 accept 计时（含 TLS 握手） */
+    if (!conn->in_request) {
+        conn->t_start = http_metrics_now();
+    }
+    conn->in_request = 1;
+    return 0;
+}
+
+int http_on_headers_complete(llhttp_t *parser) 
+{
+    struct http_conn *conn = (struct http_conn *)parser->data;
+    
+    /* 切片之后的字节（' '、':'、CR）已被解析，原地写入 '\0'，
+     * 处理器拿到的 URL 和请求头均可按 C 字符串使用 */
+    conn->header_state = HTTP_HDR_STATE_DONE;
+    if (conn->url_len) {
+        conn->url[conn->url_len] = '\0';
+    }
+    for (int i = 0; i < conn->header_count; i++) {
+        struct http_header *h = &conn->headers[i];
+        if (h->name_len) {
+            ((char *)h->name)[h->name_len] = '\0';
+        } else {
+            h->name = "";
+        }
+        if (h->value_len) {
+            ((char *)h->value)[h->value_len] = '\0';
+        } else {
+            h->value = "";
+        }
+    }
+    
+    /* 按 body 大小放大后续的接收缓冲区；chunked 长度未知，从中间值开始，读满后再增大 */
+    if (parser->flags & F_CHUNKED) {
+        conn->rx_size = HTTP_RX_BUF_MAX / 4;
+    } else if (parser->content_length > 0) {
+        uint32_t size = HTTP_RX_BUF_MIN;
+        while (size < parser->content_length && size < HTTP_RX_BUF_MAX) {
+            size <<= 1;
+        }
+        conn->rx_size = size;
+    }
+
+    /* 不支持协议升级（Upgrade: h2c / websocket）：忽略 Upgrade，按普通请求处理；
+     * 否则 llhttp 在请求结束后返回 HPE_PAUSED_UPGRADE，连接被当作解析错误关闭 */
+    if (parser->method != HTTP_CONNECT) {
+        parser->upgrade = 0;
+    }
+
+    return http_request_begin(conn);
+}
+
+/* 请求头完整（HTTP/1 与 HTTP/2 共用）：选择处理器并初始化 */
+static int http_request_begin(struct http_conn *conn)
+{
+    /* 选择处理器：URL 已完整 */
+    if (g_router) {
+        conn->handler = http_router_match(g_router, conn->parser.method,
+                                          conn->url ? conn->url : "", conn->url_len,
+                                          &conn->route_ctx, &conn->route_allow);
+    } else {
+        conn->handler = g_body_handler;
+    }
+    
+    conn->metrics_mode = http_metrics_mode(conn->handler);
+    conn->t_stage = http_metrics_now();
+    conn->t_handler = 0;
+    http_metrics_observe(conn->metrics_mode, conn->ssl != NULL, HTTP_STAGE_HEADERS,
+                         conn->t_stage - conn->t_start);
+    
+    /* 初始化 body 处理器 */
+    if (conn->handler && conn->handler->on_init) {
+        int ret = conn->handler->on_init(conn, http_get_header(conn, HTTP_HDR_CONTENT_TYPE));
+        conn->t_handler += http_metrics_now() - conn->t_stage;
+        return ret;
+    }
+    
+    return 0;
+}
+
+/* body 片段交给处理器 */
+static int http_request_body(struct http_conn *conn, const char *at, size_t length)
+{
+    uint64_t t0;
+    int ret;
+    
+    if (!conn->handler || !conn->handler->on_data) {
+        return 0;
+    }
+    t0 = http_metrics_now();
+    ret = conn->handler->on_data(conn, at, length);
+    conn->t_handler += http_metrics_now() - t0;
+    return ret;
+}
+
+int http_on_body(llhttp_t *parser, const char *at, size_t length) 
+{
+    struct http_conn *conn = (struct http_conn *)parser->data;
+    int ret = http_request_body(conn, at, length);
+    
+    if (ret != 0) {
+        return ret;
+    }
+
+    /* 处理器调用了 http_pause_read()：停在当前片段之后 */
+    if (conn->rx_paused) {
+        return HPE_PAUSED;
+    }
+
+    return 0;
+}
+
+/* 请求结束（HTTP/1 与 HTTP/2 共用）：完成回调、发送响应、记录访问日志 */
+static void http_request_complete(struct http_conn *conn)
+{
+    int tls = conn->ssl != NULL;
+    uint64_t now = http_metrics_now();
+    
+    /* body 阶段包含其中处理器 on_data 的时间，处理器耗时另行统计 */
+    http_metrics_observe(conn->metrics_mode, tls, HTTP_STAGE_BODY, now - conn->t_stage);
+    
+    /* 调用 body 处理器完成回调 */
+    if (conn->handler && conn->handler->on_complete) {
+        int ret = conn->handler->on_complete(conn);
+        uint64_t done = http_metrics_now();
+        
+        conn->t_handler += done - now;
+        now = done;
+        if (ret < 0) {
+            if (conn->tx_stream != HTTP_STREAM_NONE) {
+                /* 流式响应已发出头部，无法再回复 400：不发结束块，直接关闭（HTTP/2 重置流） */
+                conn->tx_stream = HTTP_STREAM_DONE;
+                conn->keep_alive = 0;
+                if (conn->h2s) {
+                    http_h2_stream_reset(conn->h2s, HTTP_H2_INTERNAL_ERROR);
+                    http_h2_kick(conn);
+                }
+            } else {
+                http_set_response(conn, 400, "application/json",
+                                  HTTP_STATIC_BODY(ERROR_BAD_REQUEST));
+            }
+        }
+    }
+    
+    http_metrics_observe(conn->metrics_mode, tls, HTTP_STAGE_HANDLER, conn->t_handler);
+    http_metrics_request(conn->metrics_mode, tls,
+                         conn->status_code ? conn->status_code : 400);
+    
+    /* 发送响应（流式响应已由处理器发出）；写出阶段到发送队列排空为止（见 http_conn_timer_update） */
+    if (conn->tx_stream == HTTP_STREAM_NONE) {
+        http_send_response(conn);
+        if (!conn->t_write) {
+            conn->t_write = now;
+        }
+    }
+    
+    /* 请求状态（URL 等）在这之后可能失效，流式响应记录到此为止已写出的字节数 */
+    http_log_access(conn, http_conn_tls_type(conn), conn->tx_bytes, now - conn->t_start);
+}
+
+/* 1xx、204 不能带 Content-Length / Transfer-Encoding（RFC 9110 8.6、6.1）；
+ * 304 的 Content-Length 应与完整响应一致，这里不知道，也不带
+ * 这些状态没有 body，头部之后响应即结束 */
+static inline int http_status_no_length(int status)
+{
+    return status < 200 || status == 204 || status == 304;
+}
+
+int http_on_message_complete(llhttp_t *parser) 
+{
+    struct http_conn *conn = (struct http_conn *)parser->data;
+    
+    conn->keep_alive = llhttp_should_keep_alive(parser);
+    conn->requests++;
+    if (conn->tx_stream != HTTP_STREAM_NONE && !conn->tx_chunked &&
+        !http_status_no_length(conn->status_code)) {
+        conn->keep_alive = 0;
+    }
+    
+    http_request_complete(conn);
+    
+    if (conn->tx_stream == HTTP_STREAM_ACTIVE) {
+        /* 流式响应未结束：请求状态保留到 http_stream_end()，暂停解析后续请求 */
+        conn->tx_stream_held = 1;
+        return HPE_PAUSED;
+    }
+    
+    /* 为下一个请求（keep-alive / pipelining）重置状态 */
+    http_conn_reset_request(conn);
+    
+    if (!conn->keep_alive) {
+        /* 不再解析后续数据，响应发送完毕后关闭连接 */
+        conn->closing = 1;
+        return HPE_PAUSED;
+    }
+    
+    if (conn->tx_active) {
+        /* 文件 body 未发完：暂停解析，后续请求的响应必须排在它之后 */
+        return HPE_PAUSED;
+    }
+    
+    return 0;
+}
+
+int http_add_header(struct http_conn *conn, const char *name, const char *value)
+{
+    size_t name_len = strlen(name), value_len = strlen(value);
+    size_t len = conn->response_headers_len;
+    char *p = http_arena_realloc(&conn->arena, conn->response_headers, len,
+                                 len + name_len + value_len + 4);
+    if (!p) return -1;
+    
+    memcpy(p + len, name, name_len);
+    len += name_len;
+    p[len++] = ':';
+    p[len++] = ' ';
+    memcpy(p + len, value, value_len);
+    len += value_len;
+    p[len++] = '\r';
+    p[len++] = '\n';
+    
+    conn->response_headers = p;
+    conn->response_headers_len = len;
+    return 0;
+}
+
+/* 预先生成的状态行，按状态码 - 100 索引 */
+struct http_status_line {
+    const char *line;
+    size_t len;
+};
+
+#define HTTP_STATUS(code, text) \
+    [code - 100] = { "HTTP/1.1 " #code " " text "\r\n", sizeof("HTTP/1.1 " #code " " text "\r\n") - 1 }
+
+static const struct http_status_line g_status_lines[500] = {
+    HTTP_STATUS(100, "Continue"),
+    HTTP_STATUS(101, "Switching Protocols"),
+    HTTP_STATUS(103, "Early Hints"),
+    HTTP_STATUS(200, "OK"),
+    HTTP_STATUS(201, "Created"),
+    HTTP_STATUS(202, "Accepted"),
+    HTTP_STATUS(203, "Non-Authoritative Information"),
+    HTTP_STATUS(204, "No Content"),
+    HTTP_STATUS(205, "Reset Content"),
+    HTTP_STATUS(206, "Partial Content"),
+    HTTP_STATUS(300, "Multiple Choices"),
+    HTTP_STATUS(301, "Moved Permanently"),
+    HTTP_STATUS(302, "Found"),
+    HTTP_STATUS(303, "See Other"),
+    HTTP_STATUS(304, "Not Modified"),
+    HTTP_STATUS(307, "Temporary Redirect"),
+    HTTP_STATUS(308, "Permanent Redirect"),
+    HTTP_STATUS(400, "Bad Request"),
+    HTTP_STATUS(401, "Unauthorized"),
+    HTTP_STATUS(402, "Payment Required"),
+    HTTP_STATUS(403, "Forbidden"),
+    HTTP_STATUS(404, "Not Found"),
+    HTTP_STATUS(405, "Method Not Allowed"),
+    HTTP_STATUS(406, "Not Acceptable"),
+    HTTP_STATUS(407, "Proxy Authentication Required"),
+    HTTP_STATUS(408, "Request Timeout"),
+    HTTP_STATUS(409, "Conflict"),
+    HTTP_STATUS(410, "Gone"),
+    HTTP_STATUS(411, "Length Required"),
+    HTTP_STATUS(412, "Precondition Failed"),
+    HTTP_STATUS(413, "Content Too Large"),
+    HTTP_STATUS(414, "URI Too Long"),
+    HTTP_STATUS(415, "Unsupported Media Type"),
+    HTTP_STATUS(416, "Range Not Satisfiable"),
+    HTTP_STATUS(417, "Expectation Failed"),
+    HTTP_STATUS(421, "Misdirected Request"),
+    HTTP_STATUS(422, "Unprocessable Content"),
+    HTTP_STATUS(425, "Too Early"),
+    HTTP_STATUS(426, "Upgrade Required"),
+    HTTP_STATUS(428, "Precondition Required"),
+    HTTP_STATUS(429, "Too Many Requests"),
+    HTTP_STATUS(431, "Request Header Fields Too Large"),
+    HTTP_STATUS(451, "Unavailable For Legal Reasons"),
+    HTTP_STATUS(500, "Internal Server Error"),
+    HTTP_STATUS(501, "Not Implemented"),
+    HTTP_STATUS(502, "Bad Gateway"),
+    HTTP_STATUS(503, "Service Unavailable"),
+    HTTP_STATUS(504, "Gateway Timeout"),
+    HTTP_STATUS(505, "HTTP Version Not Supported"),
+    HTTP_STATUS(507, "Insufficient Storage"),
+    HTTP_STATUS(511, "Network Authentication Required"),
+};
+
+/* 无符号整数转十进制，返回长度（buf 至少 20 字节） */
+static size_t http_utoa(char *buf, unsigned long long v)
+{
+    char tmp[20];
+    size_t n = 0, len;
+    
+    do {
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    for (len = n; n > 0; n--) {
+        *buf++ = tmp[n - 1];
+    }
+    return len;
+}
+
+/* 缓存的 Date 头：发送响应时若已过期则重新生成，并把 uloop 定时器设到下一秒整点使其过期；
+ * 每秒最多格式化一次，没有响应时定时器不再启动 */
+#define HTTP_DATE_LEN   (sizeof("Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n") - 1)
+
+static char g_date_hdr[HTTP_DATE_LEN + 1];
+static int g_date_valid = 0;
+
+static void http_date_expire_cb(struct uloop_timeout *t)
+{
+    g_date_valid = 0;
+}
+
+static struct uloop_timeout g_date_timer = { .cb = http_date_expire_cb };
+
+static const char *http_date_header(void)
+{
+    struct timespec ts;
+    struct tm tm;
+    
+    if (g_date_valid) {
+        return g_date_hdr;
+    }
+    
+    clock_gettime(CLOCK_REALTIME, &ts);
+    gmtime_r(&ts.tv_sec, &tm);
+    strftime(g_date_hdr, sizeof(g_date_hdr), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+    g_date_valid = 1;
+    uloop_timeout_set(&g_date_timer, 1000 - ts.tv_nsec / 1000000);
+    return g_date_hdr;
+}
+
+/* HTTP 响应发送 */
+/* 明文直接写 socket：HTTP，或发送方向由内核加密的 HTTPS */
+static int http_conn_tx_plain(struct http_conn *conn)
+{
+    return !conn->ssl || conn->ktls_tx;
+}
+
+/* 明文连接：状态行、头部和 body 用一次 sendmsg 发出
+ * 已有待发送数据时保持顺序，全部交给 fd stream 排队；
+ * 未发完的部分（EAGAIN）或出错时也交给 fd stream，由其缓冲或走错误处理 */
+static void http_conn_write_plain(struct http_conn *conn, struct iovec *iov, int iovcnt)
+{
+    struct ustream *s = &conn->fd.stream;
+    ssize_t sent = 0;
+    
+    /* io_uring 连接：写缓冲本轮末尾由一个 sendmsg 提交 */
+    if (!conn->uring && !ustream_pending_data(s, true) && !s->write_error) {
+        struct msghdr msg = { .msg_iov = iov, .msg_iovlen = iovcnt };
+        
+        do {
+            sent = sendmsg(conn->fd.fd.fd, &msg, MSG_NOSIGNAL);
+        } while (sent < 0 && errno == EINTR);
+        if (sent < 0) {
+            sent = 0;
+        }
+    }
+    
+    for (int i = 0; i < iovcnt; i++) {
+        if ((size_t)sent >= iov[i].iov_len) {
+            sent -= iov[i].iov_len;
+            continue;
+        }
+        ustream_write(s, (char *)iov[i].iov_base + sent, iov[i].iov_len - sent, false);
+        sent = 0;
+    }
+}
+
+/* 文件 body 发送结束（完成或连接关闭）：释放文件引用和映射 */
+static void http_conn_tx_end(struct http_conn *conn)
+{
+    if (conn->tx_map) {
+        munmap(conn->tx_map, conn->tx_map_len);
+        conn->tx_map = NULL;
+    }
+    if (conn->tx_file.fd >= 0 && conn->tx_file.release) {
+        conn->tx_file.release(conn->tx_file.ref);
+    }
+    conn->tx_file.fd = -1;
+    conn->tx_active = 0;
+}
+
+/* 明文连接：sendfile 直到发完或 socket 写满；写满时关注可写事件
+ * （内核 TLS 连接同样如此，由内核分成 TLS 记录加密） */
+static int http_conn_tx_sendfile(struct http_conn *conn)
+{
+    struct ustream *s = conn->stream;
+    
+    while (conn->tx_file.len > 0) {
+        ssize_t n = sendfile(conn->fd.fd.fd, conn->tx_file.fd,
+                             &conn->tx_file.offset, conn->tx_file.len);
+        if (n > 0) {
+            conn->tx_file.len -= n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == EAGAIN) {
+            /* 先停读（会重设 uloop 关注事件），再单独关注可写 */
+            ustream_set_read_blocked(s, true);
+            if (conn->uring) {
+                http_uring_poll_out(&conn->fd);
+            } else {
+                uloop_fd_add(&conn->fd.fd, ULOOP_WRITE | ULOOP_EDGE_TRIGGER | ULOOP_ERROR_CB);
+            }
+            return 0;
+        }
+        
+        /* 出错或文件被截断 */
+        s->write_error = true;
+        ustream_state_change(s);
+        return -1;
+    }
+    
+    return 1;
+}
+
+/* 文件 body 映射到内存（用户态加密的 HTTPS、HTTP/2），之后 offset 为映射内偏移 */
+static int http_conn_tx_map(struct http_conn *conn)
+{
+    struct http_file_body *f = &conn->tx_file;
+    long page = sysconf(_SC_PAGESIZE);
+    off_t base = f->offset & ~((off_t)page - 1);
+    
+    conn->tx_map_len = f->len + (f->offset - base);
+    conn->tx_map = mmap(NULL, conn->tx_map_len, PROT_READ, MAP_SHARED, f->fd, base);
+    if (conn->tx_map == MAP_FAILED) {
+        conn->tx_map = NULL;
+        return -1;
+    }
+    f->offset -= base;
+    return 0;
+}
+
+/* HTTPS：从 mmap 映射按 TLS 记录大小写入，底层 fd stream 有积压时等待 notify_write */
+static int http_conn_tx_ssl(struct http_conn *conn)
+{
+    struct http_file_body *f = &conn->tx_file;
+    
+    if (!conn->tx_map && http_conn_tx_map(conn) < 0) {
+        conn->stream->write_error = true;
+        ustream_state_change(conn->stream);
+        return -1;
+    }
+    
+    while (f->len > 0) {
+        if (ustream_pending_data(conn->stream, true) ||
+            ustream_pending_data(&conn->fd.stream, true)) {
+            ustream_set_read_blocked(conn->stream, true);
+            return 0;
+        }
+        
+        size_t n = f->len < HTTP_TX_RECORD_SIZE ? f->len : HTTP_TX_RECORD_SIZE;
+        ustream_write(conn->stream, conn->tx_map + f->offset, n, false);
+        f->offset += n;
+        f->len -= n;
+    }
+    
+    return 1;
+}
+
+/* 继续发送文件 body；发完后恢复解析已缓存的后续请求 */
+static void http_conn_tx_pump(struct http_conn *conn)
+{
+    int ret;
+    
+    if (!conn->tx_active || conn->stream->write_error)
+        return;
     
-    /* 检测 Content-Type 头部 */
-    if (length == 12 && strncasecmp(at, "Content-Type", 12) == 0) {
-        /* 标记下一个 header_value 是 content_type */
-        conn->content_type = (char *)1; // 临时标记
+    /* 头部等已排队数据先发完，保证顺序 */
+    if (http_conn_tx_plain(conn) && ustream_pending_data(&conn->fd.stream, true))
+        return;
+    
+    ret = http_conn_tx_plain(conn) ? http_conn_tx_sendfile(conn) : http_conn_tx_ssl(conn);
+    if (ret <= 0)
+        return;
+    
+    http_conn_tx_end(conn);
+    ustream_set_read_blocked(conn->stream, false);
+    
+    /* 在 on_message_complete 中即发完时解析器未暂停，由调用方继续 */
+    if (llhttp_get_errno(&conn->parser) == HPE_PAUSED) {
+        llhttp_resume(&conn->parser);
+        http_conn_read(conn, conn->stream);
+    }
+}
+
+void http_pause_read(struct http_conn *conn)
+{
+    conn->rx_paused = 1;
+}
+
+/* 恢复读取，并继续解析暂停时留在接收缓冲区中的数据（同 http_conn_tx_pump） */
+void http_resume_read(struct http_conn *conn)
+{
+    if (!conn->rx_paused)
+        return;
+
+    conn->rx_paused = 0;
+    
+    /* HTTP/2：流中缓存的数据在 session 的下一轮 pump 中交付，同时归还流窗口 */
+    if (conn->h2s) {
+        http_h2_stream_resume(conn->h2s);
+        http_h2_kick(conn);
+        return;
+    }
+    
+    ustream_set_read_blocked(conn->stream, false);
+
+    /* 在 on_data 中暂停后立即恢复时解析器未暂停 */
+    if (llhttp_get_errno(&conn->parser) == HPE_PAUSED) {
+        llhttp_resume(&conn->parser);
+        http_conn_read(conn, conn->stream);
+    }
+}
+
+/* 头部写在 TLS 记录大小的缓冲区开头，HTTPS 时后面直接拼接 body */
+static char tx_buf[HTTP_TX_RECORD_SIZE];
+
+/* content_len 为 HTTP_LENGTH_CHUNKED / HTTP_LENGTH_NONE 时为流式响应（见 http_stream_begin） */
+#define HTTP_LENGTH_CHUNKED (-1)
+#define HTTP_LENGTH_NONE    (-2)
+
+/* 附加响应头以外的部分（状态行、Content-Length、Date、Connection 等）的长度上限 */
+#define HTTP_HEAD_FIXED     256
+
+/* 正在生成的头部：通常写在 tx_buf 中，附加响应头放不下时改用 arena 中足够大的缓冲区 */
+struct http_head {
+    char *buf;
+    size_t size;
+    size_t len;
+};
+
+/* need 为头部长度的上限；arena 分配失败时仍用 tx_buf，放不下的附加响应头丢弃并记录错误 */
+static void http_head_init(struct http_conn *conn, struct http_head *h, size_t need)
+{
+    h->buf = tx_buf;
+    h->size = sizeof(tx_buf);
+    h->len = 0;
+    if (need > sizeof(tx_buf)) {
+        char *buf = http_arena_alloc(&conn->arena, need);
+        
+        if (buf) {
+            h->buf = buf;
+            h->size = need;
+        } else {
+            http_log_error("http", "response headers dropped: out of memory");
+        }
+    }
+}
+
+static inline void http_head_append(struct http_head *h, const char *data, size_t n)
+{
+    if (n <= h->size - h->len) {
+        memcpy(h->buf + h->len, data, n);
+        h->len += n;
+    }
+}
+
+#define HTTP_HEAD_APPEND(h, str)    http_head_append(h, str, sizeof(str) - 1)
+
+/* 状态行和响应头写入 tx_buf（附加响应头过长时写入 arena），*head 指向头部，返回长度
+ * 状态行、固定的头部片段和 Date 都是预先生成的，这里只做拷贝 */
+static size_t http_format_head(struct http_conn *conn, const char *content_type,
+                               long long content_len, const char **head)
+{
+    int status = conn->status_code;
+    struct http_head h;
+    
+    if (!content_type) {
+        content_type = "text/plain";
+    }
+    http_head_init(conn, &h, HTTP_HEAD_FIXED + strlen(content_type) + conn->response_headers_len);
+    
+    if (status >= 100 && status < 600 && g_status_lines[status - 100].line) {
+        http_head_append(&h, g_status_lines[status - 100].line, g_status_lines[status - 100].len);
+    } else {
+        /* 表外的状态码（处理器自定义）：按类别给出原因短语 */
+        char code[20];
+        
+        if (status < 100 || status > 999) {
+            status = 500;
+        }
+        HTTP_HEAD_APPEND(&h, "HTTP/1.1 ");
+        http_head_append(&h, code, http_utoa(code, status));
+        HTTP_HEAD_APPEND(&h, " Unknown\r\n");
+    }
+    
+    HTTP_HEAD_APPEND(&h, "Content-Type: ");
+    http_head_append(&h, content_type, strlen(content_type));
+    HTTP_HEAD_APPEND(&h, "\r\n");
+    
+    if (http_status_no_length(status)) {
+        /* 不带长度 */
+    } else if (content_len == HTTP_LENGTH_CHUNKED) {
+        HTTP_HEAD_APPEND(&h, "Transfer-Encoding: chunked\r\n");
+    } else if (content_len >= 0) {
+        char num[20];
+        
+        HTTP_HEAD_APPEND(&h, "Content-Length: ");
+        http_head_append(&h, num, http_utoa(num, content_len));
+        HTTP_HEAD_APPEND(&h, "\r\n");
+    }
+    
+    http_head_append(&h, http_date_header(), HTTP_DATE_LEN);
+    /* 给结尾的 Connection 头留出位置（只在回退到 tx_buf 时可能放不下） */
+    if (conn->response_headers_len > 0 &&
+        conn->response_headers_len + 32 <= h.size - h.len) {
+        http_head_append(&h, conn->response_headers, conn->response_headers_len);
+    }
+    if (conn->keep_alive) {
+        HTTP_HEAD_APPEND(&h, "Connection: keep-alive\r\n\r\n");
+    } else {
+        HTTP_HEAD_APPEND(&h, "Connection: close\r\n\r\n");
+    }
+    
+    *head = h.buf;
+    return h.len;
+}
+
+/* HTTP/2 响应头：内容同 http_format_head，HPACK 编码到 tx_buf 或 arena（见 http_hpack.h）
+ * 附加响应头的名称转为小写；逐跳头部（Connection 等）在 HTTP/2 中不允许，丢弃 */
+static size_t http_h2_format_head(struct http_conn *conn, const char *content_type,
+                                  long long content_len, const char **head)
+{
+    static const char *const hop[] = {
+        "Connection", "Keep-Alive", "Proxy-Connection", "Transfer-Encoding", "Upgrade",
+    };
+    const char *p = conn->response_headers;
+    const char *end = p + conn->response_headers_len;
+    struct http_head h;
+    uint8_t *out;
+    size_t size, len;
+    char num[20];
+    
+    if (!content_type) {
+        content_type = "text/plain";
+    }
+    /* 每个附加头部 "Name: value\r\n" 编码后最多多出 5 字节（长度前缀），两倍足够 */
+    http_head_init(conn, &h, HTTP_HEAD_FIXED + strlen(content_type) +
+                             2 * conn->response_headers_len);
+    out = (uint8_t *)h.buf;
+    size = h.size;
+    
+    len = http_hpack_encode_status(out, size, conn->status_code);
+    len += http_hpack_encode_field(out + len, size - len, "content-type", 12,
+                                   content_type, strlen(content_type));
+    if (content_len >= 0 && !http_status_no_length(conn->status_code)) {
+        len += http_hpack_encode_field(out + len, size - len, "content-length", 14,
+                                       num, http_utoa(num, content_len));
+    }
+    /* 缓存的 Date 头去掉 "Date: " 和 CRLF */
+    len += http_hpack_encode_field(out + len, size - len, "date", 4,
+                                   http_date_header() + 6, HTTP_DATE_LEN - 8);
+    
+    /* 附加响应头逐行为 "Name: value\r\n"（见 http_add_header） */
+    while (p < end) {
+        const char *colon = memchr(p, ':', end - p);
+        const char *eol = memchr(p, '\n', end - p);
+        size_t name_len;
+        size_t i;
+        
+        if (!colon || !eol || colon > eol) {
+            break;
+        }
+        name_len = colon - p;
+        for (i = 0; i < sizeof(hop) / sizeof(hop[0]); i++) {
+            if (strlen(hop[i]) == name_len && strncasecmp(p, hop[i], name_len) == 0) {
+                break;
+            }
+        }
+        if (i == sizeof(hop) / sizeof(hop[0])) {
+            const char *value = colon + 1;
+            
+            while (value < eol && *value == ' ') {
+                value++;
+            }
+            len += http_hpack_encode_field(out + len, size - len, p, name_len,
+                                           value, eol - value - (eol[-1] == '\r'));
+        }
+        p = eol + 1;
+    }
+    
+    *head = h.buf;
+    return len;
+}
+
+/* HTTP/2 响应：头块立即写出，body（arena 或常量中的数据、文件映射）由流引用，
+ * 按流量控制窗口组帧，流关闭时才释放（见 http_h2_close_cb）；
+ * 压缩结果可能在压缩缓存中，只在当前回调内有效（见 http_compress.h），拷贝到流中 */
+static void http_h2_respond(struct http_conn *conn, const char *head, size_t header_len,
+                            const char *body, size_t body_len)
+{
+    struct http_h2_stream *st = conn->h2s;
+    int file = conn->response_file.fd >= 0;
+    int copy = body != conn->response_body;
+    
+    http_h2_stream_headers(st, (const uint8_t *)head, header_len, !file && !body_len);
+    if (file) {
+        conn->tx_file = conn->response_file;
+        conn->response_file.fd = -1;
+        if (conn->tx_file.len && http_conn_tx_map(conn) < 0) {
+            http_h2_stream_reset(st, HTTP_H2_INTERNAL_ERROR);
+        } else {
+            http_h2_stream_data(st, conn->tx_map ? conn->tx_map + conn->tx_file.offset : NULL,
+                                conn->tx_file.len, 0, 1);
+        }
+    } else if (body_len) {
+        http_h2_stream_data(st, body, body_len, copy, 1);
+    }
+    http_h2_kick(conn);
+}
+
+/* 协商响应压缩：类型可压缩时带 Vary（缓存按 Accept-Encoding 区分），
+ * 客户端接受时追加 Content-Encoding，返回选中的编码 */
+static int http_response_encoding(struct http_conn *conn, const char *content_type)
+{
+    int enc;
+    
+    /* 处理器自己编码过的响应（如预压缩数据）原样发送 */
+    if (conn->response_headers &&
+        memmem(conn->response_headers, conn->response_headers_len, "Content-Encoding:", 17)) {
+        return HTTP_ENC_IDENTITY;
+    }
+    
+    enc = http_compress_negotiate(conn, content_type);
+    if (enc < 0) {
+        return HTTP_ENC_IDENTITY;
+    }
+    http_add_header(conn, "Vary", "Accept-Encoding");
+    return enc;
+}
+
+/* 压缩缓冲 body：只处理成功的完整响应（206 的 Range 针对未压缩内容） */
+static void http_response_compress(struct http_conn *conn, const char **body, size_t *body_len)
+{
+    const char *out;
+    size_t out_len;
+    int enc;
+    
+    if (conn->status_code < 200 || conn->status_code >= 300 ||
+        conn->status_code == 204 || conn->status_code == 206) {
+        return;
+    }
+    
+    enc = http_response_encoding(conn, conn->response_content_type);
+    if (enc == HTTP_ENC_IDENTITY ||
+        http_compress_body(conn, enc, *body, *body_len, &out, &out_len) < 0) {
+        return;
+    }
+    http_add_header(conn, "Content-Encoding", http_compress_name(enc));
+    *body = out;
+    *body_len = out_len;
+}
+
+void http_send_response(struct http_conn *conn)
+{
+    const char *body = conn->response_body;
+    size_t body_len = body ? conn->response_body_len : 0;
+    size_t content_len;
+    size_t header_len;
+    const char *head;
+    
+    /* HEAD 同样压缩，Content-Length 与 GET 一致 */
+    if (body_len && conn->response_file.fd < 0) {
+        http_response_compress(conn, &body, &body_len);
+    }
+    content_len = conn->response_file.fd >= 0 ? conn->response_file.len : body_len;
+    if (conn->h2s) {
+        header_len = http_h2_format_head(conn, conn->response_content_type,
+                                         (long long)content_len, &head);
+    } else {
+        header_len = http_format_head(conn, conn->response_content_type,
+                                      (long long)content_len, &head);
+    }
+    
+    /* HEAD 只发头部 */
+    if (conn->parser.method == HTTP_HEAD) {
+        body_len = 0;
+        if (conn->response_file.fd >= 0 && conn->response_file.release) {
+            conn->response_file.release(conn->response_file.ref);
+        }
+        conn->response_file.fd = -1;
+    }
+    
+    conn->tx_bytes = conn->response_file.fd >= 0 ? conn->response_file.len : body_len;
+    
+    if (conn->h2s) {
+        http_h2_respond(conn, head, header_len, body, body_len);
+        return;
+    }
+    
+    /* 文件 body 交给连接，在头部之后发送 */
+    if (conn->response_file.fd >= 0) {
+        conn->tx_file = conn->response_file;
+        conn->tx_active = 1;
+        conn->response_file.fd = -1;
+        body_len = 0;
+    }
+    
+    if (http_conn_tx_plain(conn)) {
+        struct iovec iov[2] = {
+            { .iov_base = (void *)head, .iov_len = header_len },
+            { .iov_base = (void *)body, .iov_len = body_len },
+        };
+        http_conn_write_plain(conn, iov, body_len ? 2 : 1);
+    } else {
+        /* HTTPS：头部和 body 开头拼成一次 SSL_write，即同一个 TLS 记录；
+         * 超出单个记录的部分本来就要分记录，直接写出（头部在 arena 中时已超过一个记录） */
+        size_t first = head == tx_buf ? sizeof(tx_buf) - header_len : 0;
+        if (first > body_len) {
+            first = body_len;
+        }
+        if (first) {
+            memcpy(tx_buf + header_len, body, first);
+        }
+        ustream_write(conn->stream, head, header_len + first, false);
+        if (body_len > first) {
+            ustream_write(conn->stream, body + first, body_len - first, false);
+        }
+    }
+    
+    http_conn_tx_pump(conn);
+}
+
+/* 清理单个请求的状态，连接本身保留 */
+static void http_conn_reset_request(struct http_conn *conn)
+{
+    if (conn->handler && conn->handler->on_cleanup) {
+        conn->handler->on_cleanup(conn);
+    }
+    conn->handler = NULL;
+    conn->route_ctx = NULL;
+    conn->route_allow = 0;
+    
+    /* 未交给连接发送的文件 body（如出错路径）在这里释放 */
+    if (conn->response_file.fd >= 0 && conn->response_file.release) {
+        conn->response_file.release(conn->response_file.ref);
+    }
+    conn->response_file.fd = -1;
+    
+    /* URL、请求头指向接收缓冲区或 arena；body_ctx 和响应 body 在 arena 中，整体回收 */
+    conn->url = NULL;
+    conn->url_len = 0;
+    conn->header_count = 0;
+    conn->header_state = HTTP_HDR_STATE_NONE;
+    memset(conn->header_index, 0, sizeof(conn->header_index));
+    conn->body_ctx = NULL;
+    conn->response_body = NULL;
+    conn->response_body_len = 0;
+    conn->response_content_type = NULL;
+    conn->response_headers = NULL;
+    conn->response_headers_len = 0;
+    conn->status_code = 0;
+    conn->parse_error = 0;
+    conn->in_request = 0;
+    conn->tx_stream = HTTP_STREAM_NONE;
+    conn->tx_chunked = 0;
+    conn->tx_stream_wait = 0;
+    conn->tx_stream_held = 0;
+    conn->tx_bytes = 0;
+    uloop_timeout_cancel(&conn->tx_kick);
+    http_zstream_free(conn->tx_zstream);
+    conn->tx_zstream = NULL;
+    conn->rx_size = HTTP_RX_BUF_MIN;
+    http_arena_reset(&conn->arena);
+}
+
+/* HTTPS stream：ustream_ssl 单独分配，需要回指所属连接 */
+struct http_ssl_stream {
+    struct ustream_ssl ssl;
+    struct http_conn *conn;
+    /* ustream_ssl 安装在底层 fd stream 上的写回调 */
+    void (*notify_write)(struct ustream *s, int bytes);
+};
+
+static int http_conn_tls_type(struct http_conn *conn)
+{
+    struct http_ssl_stream *ss = conn->ssl;
+    
+    if (!ss) {
+        return HTTP_LOG_TLS_NONE;
+    }
+    return http_tls_resumed(ss->ssl.ssl) ? HTTP_LOG_TLS_RESUMED : HTTP_LOG_TLS_FULL;
+}
+
+/* 连接池对象：HTTPS 所需的 ustream_ssl 与连接一起分配 */
+struct http_conn_slot {
+    struct http_conn conn;
+    struct http_ssl_stream ssl;
+    struct http_conn_slot *next_free;
+};
+
+static struct http_conn_slot *g_conn_pool = NULL;
+static int g_conn_pool_size = 0;
+
+/* 从连接池取对象；复用时保留 arena 首块（HTTP/2 请求流也从这里分配，不计入连接数） */
+static struct http_conn *http_conn_slot_alloc(void)
+{
+    struct http_conn_slot *slot = g_conn_pool;
+    
+    if (slot) {
+        http_arena_t arena = slot->conn.arena;
+        
+        g_conn_pool = slot->next_free;
+        g_conn_pool_size--;
+        memset(slot, 0, sizeof(*slot));
+        slot->conn.arena = arena;
+    } else {
+        slot = calloc(1, sizeof(*slot));
+        if (!slot) return NULL;
+    }
+    
+    return &slot->conn;
+}
+
+static void http_conn_slot_free(struct http_conn *conn)
+{
+    struct http_conn_slot *slot = container_of(conn, struct http_conn_slot, conn);
+    
+    if (g_conn_pool_size >= CONN_POOL_MAX) {
+        http_arena_destroy(&conn->arena);
+        free(slot);
+        return;
+    }
+    
+    slot->next_free = g_conn_pool;
+    g_conn_pool = slot;
+    g_conn_pool_size++;
+}
+
+static struct http_conn *http_conn_alloc(void)
+{
+    struct http_conn *conn = http_conn_slot_alloc();
+    
+    if (conn) {
+        g_conn_count++;
+    }
+    return conn;
+}
+
+static void http_uring_accept_cb(int client_fd);
+
+/* 连接数达到上限或 fd 耗尽时暂停 accept（新连接留在内核 backlog 中），条件解除后恢复 */
+static void http_accept_update(void)
+{
+    struct http_server *server = g_server;
+    int full;
+    
+    if (!server || server->server_fd.fd < 0) {
+        return;
+    }
+    
+    full = server->max_conns && g_conn_count >= server->max_conns;
+    if (!g_accept_paused && (full || g_accept_backoff)) {
+        if (g_uring_accept) {
+            http_uring_accept_stop();
+        } else {
+            uloop_fd_delete(&server->server_fd);
+        }
+        g_accept_paused = 1;
+        if (full) {
+            g_conn_stats.accept_paused++;
+        }
+    } else if (g_accept_paused && !full && !g_accept_backoff) {
+        if (g_uring_accept) {
+            http_uring_accept_start(server->server_fd.fd, http_uring_accept_cb);
+        } else {
+            uloop_fd_add(&server->server_fd, ULOOP_READ);
+        }
+        g_accept_paused = 0;
+    }
+}
+
+static void http_accept_retry_cb(struct uloop_timeout *t)
+{
+    g_accept_backoff = 0;
+    http_accept_update();
+}
+
+static void http_conn_release(struct http_conn *conn)
+{
+    g_conn_count--;
+    http_accept_update();
+    http_conn_slot_free(conn);
+}
+
+static int http_conn_write_pending(struct http_conn *conn)
+{
+    return conn->tx_active || conn->tx_stream == HTTP_STREAM_ACTIVE ||
+           ustream_pending_data(conn->stream, true) > 0 ||
+           ustream_pending_data(&conn->fd.stream, true) > 0;
+}
+
+/* 按连接当前状态选择超时阶段，阶段变化或换了请求时重新计时；
+ * 请求头阶段是总时长（防止逐字节发送请求头），body 与写阶段是间隔，有进展时也重新计时 */
+static void http_conn_timer_update(struct http_conn *conn, int progress)
+{
+    int pending;
+    int phase;
+    
+    /* HTTP/2：请求流的进展计入所属连接；有未关闭的流时按写阶段计时 */
+    if (conn->h2s) {
+        conn = conn->h2_conn;
+    }
+    pending = http_conn_write_pending(conn) ||
+              (conn->h2 && !conn->closing && http_h2_active(conn->h2));
+    
+    /* 响应全部写出（流水线请求的多个响应合并计一次） */
+    if (conn->t_write && !pending) {
+        http_metrics_observe(conn->metrics_mode, conn->ssl != NULL, HTTP_STAGE_WRITE,
+                             http_metrics_now() - conn->t_write);
+        conn->t_write = 0;
+    }
+    
+    if (conn->rx_paused || (conn->closing && !pending)) {
+        phase = HTTP_PHASE_NONE;
+    } else if (pending) {
+        phase = HTTP_PHASE_WRITE;
+    } else if (conn->header_state == HTTP_HDR_STATE_DONE) {
+        phase = HTTP_PHASE_BODY;
+    } else if (conn->in_request) {
+        phase = HTTP_PHASE_HEADER;
+    } else {
+        phase = HTTP_PHASE_IDLE;
+    }
+    
+    if (phase == HTTP_PHASE_NONE) {
+        http_timer_cancel(&conn->timer);
+    } else if (phase != conn->timer_phase || conn->requests != conn->timer_seq ||
+               (progress && (phase == HTTP_PHASE_BODY || phase == HTTP_PHASE_WRITE))) {
+        conn->timer_seq = conn->requests;
+        http_timer_set(&conn->timer, g_timeouts[phase]);
+    }
+    conn->timer_phase = phase;
+}
+
+/* 超时：丢弃未发出的数据，由状态回调释放连接 */
+static void http_conn_timeout(http_timer_t *t)
+{
+    struct http_conn *conn = container_of(t, struct http_conn, timer);
+    
+    switch (conn->timer_phase) {
+    case HTTP_PHASE_HEADER: g_conn_stats.header_timeouts++; break;
+    case HTTP_PHASE_BODY:   g_conn_stats.body_timeouts++; break;
+    case HTTP_PHASE_IDLE:   g_conn_stats.idle_timeouts++; break;
+    case HTTP_PHASE_WRITE:  g_conn_stats.write_timeouts++; break;
+    }
+    
+    conn->closing = 1;
+    conn->stream->write_error = true;
+    ustream_state_change(conn->stream);
+}
+
+void http_conn_get_stats(struct http_conn_stats *stats)
+{
+    *stats = g_conn_stats;
+}
+
+/* ============ 流式响应 ============ */
+
+static size_t http_conn_tx_pending(struct http_conn *conn)
+{
+    size_t n;
+    
+    /* HTTP/2 请求流：流中尚未组帧的数据 */
+    if (conn->h2s) {
+        return http_h2_stream_pending(conn->h2s);
+    }
+    
+    n = ustream_pending_data(&conn->fd.stream, true);
+    
+    if (conn->stream != &conn->fd.stream) {
+        n += ustream_pending_data(conn->stream, true);
+    }
+    return n;
+}
+
+/* HTTPS：小片段拼成一次 SSL_write（同一个 TLS 记录），整记录以上的片段直接写出 */
+static void http_conn_write_ssl(struct http_conn *conn, struct iovec *iov, int iovcnt)
+{
+    char buf[HTTP_TX_RECORD_SIZE];
+    size_t len = 0;
+    
+    for (int i = 0; i < iovcnt; i++) {
+        const char *p = iov[i].iov_base;
+        size_t n = iov[i].iov_len;
+        
+        while (n > 0) {
+            size_t k = sizeof(buf) - len;
+            
+            if (len == 0 && n >= sizeof(buf)) {
+                ustream_write(conn->stream, p, n, false);
+                break;
+            }
+            if (k > n) {
+                k = n;
+            }
+            memcpy(buf + len, p, k);
+            len += k;
+            p += k;
+            n -= k;
+            if (len == sizeof(buf)) {
+                ustream_write(conn->stream, buf, len, false);
+                len = 0;
+            }
+        }
+    }
+    
+    if (len) {
+        ustream_write(conn->stream, buf, len, false);
+    }
+}
+
+static void http_conn_send(struct http_conn *conn, struct iovec *iov, int iovcnt)
+{
+    if (http_conn_tx_plain(conn)) {
+        http_conn_write_plain(conn, iov, iovcnt);
+    } else {
+        http_conn_write_ssl(conn, iov, iovcnt);
+    }
+}
+
+/* 安排下一次 on_writable：写缓冲积压时等 notify_write 排空，否则在下一轮事件循环 */
+static void http_stream_schedule(struct http_conn *conn)
+{
+    if (conn->tx_stream != HTTP_STREAM_ACTIVE || !conn->handler || !conn->handler->on_writable) {
+        return;
+    }
+    
+    if (http_conn_tx_pending(conn) > HTTP_STREAM_LOW_WATER) {
+        conn->tx_stream_wait = 1;
+        return;
+    }
+    conn->tx_stream_wait = 0;
+    uloop_timeout_set(&conn->tx_kick, 0);
+}
+
+/* 流式响应结束后继续处理暂停的后续请求（同 http_conn_tx_pump） */
+static void http_stream_finish(struct http_conn *conn)
+{
+    http_conn_reset_request(conn);
+    
+    if (!conn->keep_alive) {
+        conn->closing = 1;
+        http_conn_timer_update(conn, 0);
+        http_conn_check_close(conn);
+        return;
+    }
+    
+    ustream_set_read_blocked(conn->stream, false);
+    if (llhttp_get_errno(&conn->parser) == HPE_PAUSED) {
+        llhttp_resume(&conn->parser);
+    }
+    http_conn_read(conn, conn->stream);
+}
+
+/* 请求状态只在这里（处理器回调之外）重置，处理器可以在 on_writable 中直接 http_stream_end() */
+static void http_stream_kick_cb(struct uloop_timeout *t)
+{
+    struct http_conn *conn = container_of(t, struct http_conn, tx_kick);
+    int ret = 0;
+    
+    if (conn->tx_stream == HTTP_STREAM_ACTIVE && conn->handler && conn->handler->on_writable) {
+        ret = conn->handler->on_writable(conn);
+        if (ret < 0 && conn->tx_stream == HTTP_STREAM_ACTIVE) {
+            /* 中止：不发结束块，客户端据此判断响应不完整；HTTP/2 只重置这个流 */
+            conn->tx_stream = HTTP_STREAM_DONE;
+            if (conn->h2s) {
+                http_h2_stream_reset(conn->h2s, HTTP_H2_INTERNAL_ERROR);
+                http_h2_kick(conn);
+            } else {
+                conn->keep_alive = 0;
+                conn->closing = 1;
+            }
+        }
+    }
+    
+    if (conn->tx_stream == HTTP_STREAM_DONE && conn->tx_stream_held) {
+        http_stream_finish(conn);
+        return;
+    }
+    
+    /* 返回 1：还有数据，写缓冲未积压时下一轮事件循环再回调；返回 0：等 http_stream_write 返回 0 后的排空 */
+    if (ret > 0 || conn->tx_stream_wait) {
+        http_stream_schedule(conn);
+    }
+    http_conn_timer_update(conn, 0);
+    http_conn_check_close(conn);
+}
+
+int http_stream_begin(struct http_conn *conn, int status, const char *content_type)
+{
+    struct iovec iov;
+    int enc;
+    
+    if (conn->tx_stream != HTTP_STREAM_NONE || conn->closing || conn->stream->write_error) {
+        return -1;
+    }
+    
+    /* HTTP/1.0 不支持分块编码：不带长度，以关闭连接结束；HTTP/2 由 DATA 帧分段、END_STREAM 结束；
+     * 1xx / 204 / 304 没有 body，头部之后即结束，不分块 */
+    if (conn->h2s) {
+        conn->tx_chunked = 0;
+        conn->keep_alive = 1;
+    } else if (http_status_no_length(status)) {
+        conn->tx_chunked = 0;
+        conn->keep_alive = llhttp_should_keep_alive(&conn->parser);
+    } else {
+        conn->tx_chunked = conn->parser.http_major > 1 ||
+                           (conn->parser.http_major == 1 && conn->parser.http_minor >= 1);
+        conn->keep_alive = conn->tx_chunked && llhttp_should_keep_alive(&conn->parser);
+    }
+    conn->status_code = status;
+    conn->tx_stream = HTTP_STREAM_ACTIVE;
+    
+    /* 压缩流在头部之前建立，失败则不带 Content-Encoding 原样发送 */
+    enc = http_response_encoding(conn, content_type);
+    if (enc != HTTP_ENC_IDENTITY && status >= 200 && status < 300 && status != 204 && status != 206) {
+        if (conn->parser.method == HTTP_HEAD ||
+            (conn->tx_zstream = http_zstream_new(enc)) != NULL) {
+            http_add_header(conn, "Content-Encoding", http_compress_name(enc));
+        }
+    }
+    
+    if (conn->h2s) {
+        const char *head;
+        size_t len = http_h2_format_head(conn, content_type, HTTP_LENGTH_NONE, &head);
+        
+        http_h2_stream_headers(conn->h2s, (const uint8_t *)head, len, 0);
+        http_h2_kick(conn);
+    } else {
+        const char *head;
+        
+        iov.iov_len = http_format_head(conn, content_type,
+                                       conn->tx_chunked ? HTTP_LENGTH_CHUNKED : HTTP_LENGTH_NONE,
+                                       &head);
+        iov.iov_base = (void *)head;
+        http_conn_send(conn, &iov, 1);
+    }
+    
+    http_stream_schedule(conn);
+    http_conn_timer_update(conn, 1);
+    return 0;
+}
+
+/* 写出一块（分块编码时加上块头尾） */
+static void http_stream_send_chunk(struct http_conn *conn, const char *data, size_t len)
+{
+    char size_line[20];
+    struct iovec iov[3];
+    int n = 0;
+    
+    if (conn->h2s) {
+        conn->tx_bytes += len;
+        http_h2_stream_data(conn->h2s, data, len, 1, 0);
+        http_h2_kick(conn);
+        return;
+    }
+    
+    if (conn->tx_chunked) {
+        iov[n].iov_base = size_line;
+        iov[n++].iov_len = snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+    }
+    iov[n].iov_base = (void *)data;
+    iov[n++].iov_len = len;
+    conn->tx_bytes += len;
+    if (conn->tx_chunked) {
+        iov[n].iov_base = "\r\n";
+        iov[n++].iov_len = 2;
+    }
+    http_conn_send(conn, iov, n);
+}
+
+/* 压缩流的输出回调 */
+static void http_stream_emit(void *ctx, const char *out, size_t n)
+{
+    http_stream_send_chunk(ctx, out, n);
+}
+
+int http_stream_write(struct http_conn *conn, const char *data, size_t len)
+{
+    if (conn->tx_stream != HTTP_STREAM_ACTIVE || conn->stream->write_error) {
+        return -1;
+    }
+    /* 长度为 0 的块是结束块，空写直接忽略 */
+    if (len == 0 || conn->parser.method == HTTP_HEAD) {
+        return 1;
+    }
+    
+    /* 压缩流积累到一定量才有输出，小块写入可能暂时不产生数据 */
+    if (conn->tx_zstream) {
+        if (http_zstream_write(conn->tx_zstream, data, len, 0, http_stream_emit, conn) < 0) {
+            return -1;
+        }
+    } else {
+        http_stream_send_chunk(conn, data, len);
+    }
+    http_conn_timer_update(conn, 1);
+    
+    if (http_conn_tx_pending(conn) > HTTP_STREAM_HIGH_WATER) {
+        conn->tx_stream_wait = 1;
+        return 0;
+    }
+    return 1;
+}
+
+int http_stream_end(struct http_conn *conn)
+{
+    if (conn->tx_stream != HTTP_STREAM_ACTIVE) {
+        return -1;
+    }
+    
+    if (conn->tx_zstream && !conn->stream->write_error) {
+        http_zstream_write(conn->tx_zstream, NULL, 0, 1, http_stream_emit, conn);
+    }
+    http_zstream_free(conn->tx_zstream);
+    conn->tx_zstream = NULL;
+    
+    if (conn->h2s) {
+        http_h2_stream_data(conn->h2s, NULL, 0, 0, 1);
+        http_h2_kick(conn);
+    } else if (conn->tx_chunked && conn->parser.method != HTTP_HEAD && !conn->stream->write_error) {
+        struct iovec iov = { .iov_base = "0\r\n\r\n", .iov_len = 5 };
+        http_conn_send(conn, &iov, 1);
+    }
+    conn->tx_stream = HTTP_STREAM_DONE;
+    conn->tx_stream_wait = 0;
+    if (!conn->t_write) {
+        conn->t_write = http_metrics_now();
+    }
+    
+    /* 请求已结束：回到事件循环后再重置请求、处理后续请求 */
+    if (conn->tx_stream_held) {
+        uloop_timeout_set(&conn->tx_kick, 0);
+    } else {
+        uloop_timeout_cancel(&conn->tx_kick);
+    }
+    http_conn_timer_update(conn, 1);
+    return 0;
+}
+
+/* 需要关闭的连接在写缓冲清空后触发状态回调，由状态回调释放 */
+static void http_conn_check_close(struct http_conn *conn)
+{
+    if (conn->closing && !http_conn_write_pending(conn)) {
+        ustream_state_change(conn->stream);
+    }
+}
+
+static void http_conn_free(struct http_conn *conn)
+{
+    /* HTTP/2：先关闭所有请求流（各自清理处理器和响应） */
+    if (conn->h2) {
+        http_h2_free(conn->h2);
+        conn->h2 = NULL;
+    }
+    
+    /* 清理 body 处理器和未完成请求的资源 */
+    http_conn_reset_request(conn);
+    http_conn_tx_end(conn);
+    http_timer_cancel(&conn->timer);
+    list_del_init(&conn->rx_wait);
+
+    /* 清理 stream */
+    if (conn->ssl) {
+        /* HTTPS: 需要清理 SSL 层（内核解密时 conn->stream 已是 fd stream） */
+        struct http_ssl_stream *ss = conn->ssl;
+        
+        ustream_free(&ss->ssl.stream);
+        ustream_free(&conn->fd.stream);
+        close(conn->fd.fd.fd);
+    } else {
+        /* HTTP: 只清理 fd stream */
+        uloop_fd_delete(&conn->fd.fd);
+        ustream_free(&conn->fd.stream);
+        close(conn->fd.fd.fd);
+    }
+
+    /* 读缓冲区已随 stream 释放 */
+    g_rx_bytes -= conn->rx_held;
+    conn->rx_held = 0;
+    if (!list_empty(&g_rx_waiters)) {
+        uloop_timeout_set(&g_rx_wake, 0);
+    }
+
+    http_conn_release(conn);
+}
+
+static void http_conn_ktls_switch(struct http_conn *conn);
+
+/* SSL 连接通知回调 */
+static void ssl_notify_connected(struct ustream_ssl *ssl)
+{
+    struct http_ssl_stream *ss = container_of(ssl, struct http_ssl_stream, ssl);
+    
+    http_tls_handshake_done(ssl->ssl);
+    if (ss->conn->ktls_hs) {
+        http_conn_ktls_switch(ss->conn);
+    }
+}
+
+static void ssl_notify_error(struct ustream_ssl *ssl, int error, const char *str)
+{
+    struct http_conn *conn = container_of(ssl, struct http_ssl_stream, ssl)->conn;
+    
+    http_metrics_error(HTTP_ERR_TLS);
+    http_log_error("tls", str);
+    
+    /* kTLS 握手失败：fd stream 停读，不会再收到 EOF，直接关闭 */
+    if (conn->ktls_hs) {
+        conn->stream->write_error = true;
+        ustream_state_change(conn->stream);
+    }
+}
+
+/* 连接持有的接收缓冲区从 *cur 变为 held：更新总量，有释放时唤醒等待预算的连接 */
+static void http_rx_account(uint32_t *cur, uint32_t held)
+{
+    g_rx_bytes = g_rx_bytes - *cur + held;
+    if (g_rx_bytes > g_rx_peak) {
+        g_rx_peak = g_rx_bytes;
+    }
+    if (held < *cur && !list_empty(&g_rx_waiters)) {
+        uloop_timeout_set(&g_rx_wake, 0);
+    }
+    *cur = held;
+}
+
+/* 按 stream 实际持有的读缓冲区更新统计：缓冲区在 ustream_consume 中释放，libubox 不回调 */
+static void http_rx_sync(struct http_conn *conn)
+{
+    uint32_t held = 0;
+
+    for (struct ustream_buf *buf = conn->stream->r.head; buf; buf = buf->next) {
+        held += buf->end - buf->head;
+    }
+    http_rx_account(&conn->rx_held, held);
+}
+
+/* 读缓冲区分配：按连接当前的 rx_size；超出预算先降到最小尺寸，仍不够则进入等待 */
+static int http_rx_alloc(struct http_conn *conn, struct ustream *s, struct ustream_buf_list *l)
+{
+    uint32_t size = conn->rx_size ? conn->rx_size : HTTP_RX_BUF_MIN;
+
+    if (g_rx_bytes + size > g_rx_budget) {
+        size = HTTP_RX_BUF_MIN;
+    }
+    if (g_rx_bytes + size > g_rx_budget) {
+        if (list_empty(&conn->rx_wait)) {
+            list_add_tail(&conn->rx_wait, &g_rx_waiters);
+            g_rx_waits++;
+        }
+        return -1;
+    }
+
+    l->buffer_len = size;
+    if (g_rx_alloc_default(s, l) < 0) {
+        return -1;
+    }
+    http_rx_sync(conn);
+    return 0;
+}
+
+static int fd_rx_alloc(struct ustream *s, struct ustream_buf_list *l)
+{
+    return http_rx_alloc(container_of(s, struct http_conn, fd.stream), s, l);
+}
+
+static int ssl_rx_alloc(struct ustream *s, struct ustream_buf_list *l)
+{
+    return http_rx_alloc(container_of(s, struct http_ssl_stream, ssl.stream)->conn, s, l);
+}
+
+/* 预算有空余时依次唤醒等待的连接
+ * libubox 只在 ustream_consume 中清除 READ_BLOCKED_FULL，而等待中的连接没有可消费的数据，
+ * 这里手动清除后重新关注读事件，并立即尝试读取（边沿触发下可读事件不会再次到来）
+ * 用户态解密的 HTTPS 密文留在底层 fd stream 中，由 ustream_ssl 的读回调继续解密 */
+static void http_rx_wake_cb(struct uloop_timeout *t)
+{
+    while (!list_empty(&g_rx_waiters) && g_rx_bytes + HTTP_RX_BUF_MIN <= g_rx_budget) {
+        struct http_conn *conn = list_first_entry(&g_rx_waiters, struct http_conn, rx_wait);
+        struct ustream *s = conn->stream;
+
+        list_del_init(&conn->rx_wait);
+        s->read_blocked &= ~READ_BLOCKED_FULL;
+        if (s->set_read_blocked) {
+            s->set_read_blocked(s);
+        }
+        if (s != &conn->fd.stream) {
+            conn->fd.stream.notify_read(&conn->fd.stream, 0);
+        } else {
+            ustream_poll(s);
+        }
+    }
+}
+
+void http_rx_get_stats(struct http_rx_stats *stats)
+{
+    stats->bytes = g_rx_bytes;
+    stats->peak = g_rx_peak;
+    stats->budget = g_rx_budget;
+    stats->waits = g_rx_waits;
+}
+
+/* ============ HTTP/2 ============ */
+
+/* 请求流调用流接口后（响应排队、恢复读取、重置），在下一轮事件循环中由连接的 session 处理 */
+static void http_h2_kick(struct http_conn *conn)
+{
+    if (conn->h2s) {
+        conn = conn->h2_conn;
+    }
+    uloop_timeout_set(&conn->tx_kick, 0);
+}
+
+static void http_h2_kick_cb(struct uloop_timeout *t)
+{
+    struct http_conn *conn = container_of(t, struct http_conn, tx_kick);
+    
+    http_h2_pump(conn->h2);
+    http_conn_timer_update(conn, 0);
+    http_conn_check_close(conn);
+}
+
+/* 处理器拒绝请求（on_init / on_data 出错）：同 HTTP/1 回复 400，已开始流式响应时重置流；
+ * 只影响这个流，之后的 body 由 session 丢弃 */
+static void http_h2_bad_request(struct http_conn *conn)
+{
+    int streaming = conn->tx_stream != HTTP_STREAM_NONE;
+    
+    http_metrics_error(HTTP_ERR_PARSE);
+    http_log_error("http2", "request rejected");
+    http_conn_reset_request(conn);
+    if (streaming) {
+        http_h2_stream_reset(conn->h2s, HTTP_H2_INTERNAL_ERROR);
+        http_h2_kick(conn);
+    } else {
+        http_set_response(conn, 400, "application/json", HTTP_STATIC_BODY(ERROR_BAD_REQUEST));
+        http_send_response(conn);
+    }
+}
+
+/* 新请求流：从连接池取一个 http_conn，收发经所属连接 */
+static void *http_h2_open_cb(void *ctx, struct http_h2_stream *st)
+{
+    struct http_conn *parent = ctx;
+    struct http_conn *conn = http_conn_slot_alloc();
+    
+    if (!conn) {
+        return NULL;
+    }
+    conn->h2s = st;
+    conn->h2_conn = parent;
+    conn->stream = parent->stream;
+    conn->ssl = parent->ssl;
+    conn->response_file.fd = -1;
+    conn->tx_file.fd = -1;
+    INIT_LIST_HEAD(&conn->rx_wait);
+    conn->tx_kick.cb = http_stream_kick_cb;
+    conn->keep_alive = 1;
+    conn->in_request = 1;
+    conn->t_start = http_metrics_now();
+    conn->parser.data = conn;
+    conn->parser.http_major = 2;
+    /* 收到 :method 之前为 PRI（HTTP/2 中不是合法的请求方法） */
+    conn->parser.method = HTTP_PRI;
+    return conn;
+}
+
+/* 方法名转为 llhttp 的编号（区分大小写），未知返回 -1；
+ * 只查 llhttp 定义的编号，llhttp_method_name() 遇到未定义的编号会 abort */
+static int http_h2_method(const char *name, size_t len)
+{
+    for (int m = 0; m < HTTP_METHOD_COUNT; m++) {
+        const char *s = http_method_name(m);
+        
+        if (strlen(s) == len && memcmp(s, name, len) == 0) {
+            return m;
+        }
+    }
+    return -1;
+}
+
+static char *http_h2_strdup(struct http_conn *conn, const char *s, size_t len)
+{
+    char *p = http_arena_alloc(&conn->arena, len + 1);
+    
+    if (p) {
+        memcpy(p, s, len);
+        p[len] = '\0';
+    }
+    return p;
+}
+
+/* 请求流已收到的请求头（conn->h2_fields） */
+enum {
+    HTTP_H2_F_METHOD    = 1 << 0,
+    HTTP_H2_F_SCHEME    = 1 << 1,
+    HTTP_H2_F_AUTHORITY = 1 << 2,
+    HTTP_H2_F_REGULAR   = 1 << 3,   /* 普通请求头，之后不能再有伪头部 */
+    HTTP_H2_F_LENGTH    = 1 << 4,   /* content-length（值在 parser.content_length 中） */
+};
+
+/* content-length 的值：1 到 19 位十进制数字，否则返回 -1 */
+static int http_h2_parse_length(const char *s, size_t len, uint64_t *out)
+{
+    uint64_t n = 0;
+    
+    if (len == 0 || len > 19) {
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] < '0' || s[i] > '9') {
+            return -1;
+        }
+        n = n * 10 + (s[i] - '0');
+    }
+    *out = n;
+    return 0;
+}
+
+/* 连接级请求头（RFC 9113 8.2.2）：HTTP/2 中出现即格式错误，te 只允许 "trailers" */
+static int http_h2_connection_field(const char *name, size_t name_len,
+                                    const char *value, size_t value_len)
+{
+    static const char *const fields[] = {
+        "connection", "proxy-connection", "keep-alive", "transfer-encoding", "upgrade",
+    };
+    
+    if (name_len == 2 && memcmp(name, "te", 2) == 0) {
+        return value_len != 8 || memcmp(value, "trailers", 8) != 0;
+    }
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        if (strlen(fields[i]) == name_len && memcmp(fields[i], name, name_len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* 伪头部映射到请求行（:method、:path）和 Host（:authority），其余请求头拷贝到 arena；
+ * 请求格式错误（RFC 9113 8.2、8.3）返回 -1 */
+static int http_h2_header(struct http_conn *conn, const char *name, size_t name_len,
+                          const char *value, size_t value_len)
+{
+    struct http_header *h;
+    
+    /* 值中不能有 NUL、CR、LF（RFC 9113 8.2.1），否则转成 HTTP/1 语义时会拆出新的头部 */
+    for (size_t i = 0; i < value_len; i++) {
+        if (value[i] == '\0' || value[i] == '\r' || value[i] == '\n') {
+            return -1;
+        }
+    }
+    
+    if (name_len && name[0] == ':') {
+        /* 伪头部须在普通请求头之前（:authority 存为 host，不算普通请求头），且各只能出现一次 */
+        if (conn->h2_fields & HTTP_H2_F_REGULAR) {
+            return -1;
+        }
+        if (name_len == 7 && memcmp(name, ":method", 7) == 0) {
+            int method = http_h2_method(value, value_len);
+            
+            if (method < 0 || (conn->h2_fields & HTTP_H2_F_METHOD)) {
+                return -1;
+            }
+            conn->h2_fields |= HTTP_H2_F_METHOD;
+            conn->parser.method = method;
+            return 0;
+        }
+        if (name_len == 5 && memcmp(name, ":path", 5) == 0) {
+            if (conn->url || value_len == 0) {
+                return -1;
+            }
+            conn->url = http_h2_strdup(conn, value, value_len);
+            conn->url_len = value_len;
+            return conn->url ? 0 : -1;
+        }
+        if (name_len == 7 && memcmp(name, ":scheme", 7) == 0) {
+            if (conn->h2_fields & HTTP_H2_F_SCHEME) {
+                return -1;
+            }
+            conn->h2_fields |= HTTP_H2_F_SCHEME;
+            return 0;
+        }
+        if (name_len != 10 || memcmp(name, ":authority", 10) != 0 ||
+            (conn->h2_fields & HTTP_H2_F_AUTHORITY)) {
+            return -1;
+        }
+        conn->h2_fields |= HTTP_H2_F_AUTHORITY;
+        name = "host";
+        name_len = 4;
+    } else {
+        conn->h2_fields |= HTTP_H2_F_REGULAR;
+        /* 名称必须是小写 */
+        for (size_t i = 0; i < name_len; i++) {
+            if (name[i] >= 'A' && name[i] <= 'Z') {
+                return -1;
+            }
+        }
+        if (http_h2_connection_field(name, name_len, value, value_len)) {
+            return -1;
+        }
+    }
+    
+    if (conn->header_count == HTTP_MAX_HEADERS) {
+        return -1;
+    }
+    h = &conn->headers[conn->header_count];
+    h->name = http_h2_strdup(conn, name, name_len);
+    h->value = http_h2_strdup(conn, value, value_len);
+    if (!h->name || !h->value) {
+        return -1;
+    }
+    h->name_len = name_len;
+    h->value_len = value_len;
+    conn->header_count++;
+    http_header_index(conn);
+    
+    /* 处理器按 Content-Length 预估 body 大小；与实际收到的 DATA 不符时请求格式错误（RFC 9113 8.1.1），
+     * 重复出现时须相同 */
+    if (name_len == 14 && memcmp(name, "content-length", 14) == 0) {
+        uint64_t length;
+        
+        if (http_h2_parse_length(value, value_len, &length) < 0 ||
+            ((conn->h2_fields & HTTP_H2_F_LENGTH) && length != conn->parser.content_length)) {
+            return -1;
+        }
+        conn->h2_fields |= HTTP_H2_F_LENGTH;
+        conn->parser.content_length = length;
+    }
+    return 0;
+}
+
+static void http_h2_header_cb(void *user, const char *name, size_t name_len,
+                              const char *value, size_t value_len)
+{
+    struct http_conn *conn = user;
+    
+    if (!conn->parse_error && http_h2_header(conn, name, name_len, value, value_len) < 0) {
+        conn->parse_error = 1;
+    }
+}
+
+/* 请求格式错误：重置流（PROTOCOL_ERROR），不再交给处理器 */
+static void http_h2_malformed(struct http_conn *conn)
+{
+    http_metrics_error(HTTP_ERR_PARSE);
+    http_log_error("http2", "malformed request");
+    http_h2_stream_reset(conn->h2s, HTTP_H2_PROTOCOL_ERROR);
+    http_h2_kick(conn);
+}
+
+/* 请求头结束：格式错误（含缺少 :method、:scheme、:path）重置流，否则同 HTTP/1 选择处理器 */
+static int http_h2_headers_done_cb(void *user)
+{
+    struct http_conn *conn = user;
+    
+    if (conn->parse_error || conn->parser.method == HTTP_PRI || !conn->url ||
+        !(conn->h2_fields & HTTP_H2_F_SCHEME)) {
+        http_h2_malformed(conn);
+        return -1;
+    }
+    
+    conn->header_state = HTTP_HDR_STATE_DONE;
+    if (http_request_begin(conn) < 0) {
+        http_h2_bad_request(conn);
+        return -1;
+    }
+    return 0;
+}
+
+/* body：处理器调用了 http_pause_read() 时暂停这个流（session 停止归还流窗口） */
+static int http_h2_data_cb(void *user, const char *data, size_t len)
+{
+    struct http_conn *conn = user;
+    
+    conn->h2_rx_bytes += len;
+    if ((conn->h2_fields & HTTP_H2_F_LENGTH) && conn->h2_rx_bytes > conn->parser.content_length) {
+        http_h2_malformed(conn);
+        return -1;
+    }
+    if (http_request_body(conn, data, len) != 0) {
+        http_h2_bad_request(conn);
+        return -1;
     }
-    
-    return 0;
+    return conn->rx_paused ? 1 : 0;
 }
 
-int http_on_header_value(llhttp_t *parser, const char *at, size_t length) 
+static void http_h2_end_cb(void *user)
 {
-    struct http_conn *conn = (struct http_conn *)parser->data;
+    struct http_conn *conn = user;
     
-    /* 如果是 Content-Type 的值 */
-    if (conn->content_type == (char *)1) {
-        conn->content_type = strndup(at, length);
+    if ((conn->h2_fields & HTTP_H2_F_LENGTH) && conn->h2_rx_bytes != conn->parser.content_length) {
+        http_h2_malformed(conn);
+        return;
     }
-    
-    return 0;
+    conn->h2_conn->requests++;
+    http_request_complete(conn);
 }
 
-int http_on_headers_complete(llhttp_t *parser) 
+static void http_h2_writable_cb(void *user)
 {
-    struct http_conn *conn = (struct http_conn *)parser->data;
+    struct http_conn *conn = user;
     
-    /* 初始化 body 处理器 */
-    if (g_body_handler && g_body_handler->on_init) {
-        return g_body_handler->on_init(conn, conn->content_type);
+    if (conn->tx_stream_wait) {
+        http_stream_schedule(conn);
     }
-    
-    return 0;
 }
 
-int http_on_body(llhttp_t *parser, const char *at, size_t length) 
+/* 流关闭（响应发完、被重置或连接关闭）：清理请求并归还对象，响应引用的 arena / 文件映射到此释放 */
+static void http_h2_close_cb(void *user)
 {
-    struct http_conn *conn = (struct http_conn *)parser->data;
+    struct http_conn *conn = user;
     
-    /* 调用 body 处理器 */
-    if (g_body_handler && g_body_handler->on_data) {
-        return g_body_handler->on_data(conn, at, length);
+    if (conn->t_write) {
+        http_metrics_observe(conn->metrics_mode, conn->ssl != NULL, HTTP_STAGE_WRITE,
+                             http_metrics_now() - conn->t_write);
     }
-    
-    return 0;
+    http_conn_reset_request(conn);
+    http_conn_tx_end(conn);
+    http_conn_slot_free(conn);
 }
 
-int http_on_message_complete(llhttp_t *parser) 
+/* session 中暂停的流缓存的 body 同样计入接收缓冲区预算：超出时各连接停止读 socket */
+static void http_h2_rx_held_cb(void *ctx, size_t held)
 {
-    struct http_conn *conn = (struct http_conn *)parser->data;
-    
-    /* 调用 body 处理器完成回调 */
-    if (g_body_handler && g_body_handler->on_complete) {
-        if (g_body_handler->on_complete(conn) < 0) {
-            conn->status_code = 400;
-            conn->response_body = strdup("{\"error\":\"Bad Request\"}");
-            conn->response_body_len = strlen(conn->response_body);
-            conn->response_content_type = "application/json";
-        }
-    }
+    struct http_conn *conn = ctx;
     
-    /* 发送响应 */
-    http_send_response(conn);
-    
-    return 0;
+    http_rx_account(&conn->h2_rx_held, held);
 }
 
-/* HTTP 响应发送 */
-void http_send_response(struct http_conn *conn)
+static void http_h2_send_cb(void *ctx, struct iovec *iov, int iovcnt)
 {
-    char header[4096];
-    const char *content_type = conn->response_content_type ? 
-                                conn->response_content_type : "text/plain";
-    
-    int header_len = snprintf(header, sizeof(header),
-        "HTTP/1.1 %d %s\r\n"
-        "Content-Type: %s\r\n"
-        "Content-Length: %zu\r\n"
-        "Connection: close\r\n"
-        "\r\n",
-        conn->status_code,
-        conn->status_code == 200 ? "OK" : "Bad Request",
-        content_type,
-        conn->response_body_len);
-    
-    ustream_write(conn->stream, header, header_len, false);
-    
-    if (conn->response_body && conn->response_body_len > 0) {
-        ustream_write(conn->stream, conn->response_body, 
-                     conn->response_body_len, false);
-    }
+    http_conn_send(ctx, iov, iovcnt);
 }
 
-/* SSL 连接通知回调 */
-static void ssl_notify_connected(struct ustream_ssl *ssl)
+static size_t http_h2_tx_pending_cb(void *ctx)
 {
-    fprintf(stderr, "SSL connection established\n");
+    return http_conn_tx_pending(ctx);
 }
 
-static void ssl_notify_error(struct ustream_ssl *ssl, int error, const char *str)
+static const struct http_h2_ops g_h2_ops = {
+    .open = http_h2_open_cb,
+    .header = http_h2_header_cb,
+    .headers_done = http_h2_headers_done_cb,
+    .data = http_h2_data_cb,
+    .end = http_h2_end_cb,
+    .writable = http_h2_writable_cb,
+    .close = http_h2_close_cb,
+    .rx_held = http_h2_rx_held_cb,
+    .send = http_h2_send_cb,
+    .tx_pending = http_h2_tx_pending_cb,
+};
+
+/* 连接以 HTTP/2 序言开头（h2c 直连，或 ALPN 协商了 h2 的 HTTPS）：之后的数据都交给 session */
+static int http_h2_start(struct http_conn *conn)
 {
-    fprintf(stderr, "SSL error(%d): %s\n", error, str);
+    conn->h2 = http_h2_new(&g_h2_ops, conn);
+    if (!conn->h2) {
+        return -1;
+    }
+    conn->in_request = 0;
+    conn->tx_kick.cb = http_h2_kick_cb;
+    return 0;
 }
 
-/* ustream 读取回调（HTTP 和 HTTPS 统一） */
-static void stream_notify_read(struct ustream *s, int bytes) 
+/* 读取处理（HTTP 和 HTTPS 统一）：一次读取中的多个请求按顺序解析 */
+static void http_conn_read(struct http_conn *conn, struct ustream *s)
 {
-    struct http_conn *conn = container_of(s, struct http_conn, stream);
-    if (!conn) return;
-    
     char *data;
     int len;
+    int progress = 0;
     
     while ((data = ustream_get_read_buf(s, &len)) != NULL && len > 0) 
     {
-        enum llhttp_errno err = llhttp_execute(&conn->parser, data, len);
-        if (err != HPE_OK) {
-            fprintf(stderr, "HTTP parse error: %s\n", llhttp_errno_name(err));
+        progress = 1;
+
+        if (conn->closing) {
+            /* 连接即将关闭，丢弃后续数据 */
+            ustream_consume(s, len);
+            continue;
+        }
+        
+        if (conn->tx_active || conn->rx_paused || conn->tx_stream_held) {
+            /* 文件 body / 流式响应发送中，或处理器暂停读取：后续数据留在缓冲区，恢复后再解析 */
+            break;
+        }
+
+        /* 一次读满缓冲区（上传或 pipelining）：下一个缓冲区加倍 */
+        if ((uint32_t)len >= conn->rx_size && conn->rx_size < HTTP_RX_BUF_MAX) {
+            conn->rx_size <<= 1;
+        }
+        
+        /* HTTP/2：数据全部交给 session（不完整的帧由其缓存），协议错误时发完 GOAWAY 后关闭 */
+        if (conn->h2) {
+            if (http_h2_input(conn->h2, data, len) < 0) {
+                http_metrics_error(HTTP_ERR_PARSE);
+                http_log_error("http2", "protocol error");
+                conn->closing = 1;
+            }
             ustream_consume(s, len);
+            continue;
+        }
+        
+        /* 连接的首个请求以 HTTP/2 序言开头时切换（序言不完整时等待后续数据） */
+        if (g_h2 && conn->requests == 0 && conn->url_len == 0 && conn->header_count == 0 &&
+            memcmp(data, HTTP_H2_PREFACE,
+                   len < HTTP_H2_PREFACE_LEN ? len : HTTP_H2_PREFACE_LEN) == 0) {
+            if (len < HTTP_H2_PREFACE_LEN) {
+                break;
+            }
+            if (http_h2_start(conn) < 0) {
+                conn->closing = 1;
+            }
+            continue;
+        }
+
+        enum llhttp_errno err = llhttp_execute(&conn->parser, data, len);
+        
+        /* 请求跨越本段缓冲区：仍引用它的 URL / 请求头切片先拷贝到 arena */
+        if ((conn->url_len || conn->header_count) &&
+            (err == HPE_OK || err == HPE_PAUSED) &&
+            http_conn_spill(conn, data, len) < 0) {
+            err = HPE_USER;
+        }
+        
+        if (err == HPE_PAUSED && (conn->tx_active || conn->rx_paused || conn->tx_stream_held) &&
+            !conn->closing) {
+            /* 只消费到暂停位置（当前请求末尾 / 当前 body 片段之后） */
+            ustream_consume(s, llhttp_get_error_pos(&conn->parser) - data);
+            if (conn->rx_paused || conn->tx_stream_held) {
+                ustream_set_read_blocked(s, true);
+            }
             break;
         }
         ustream_consume(s, len);
+        
+        if (err == HPE_OK || err == HPE_PAUSED) {
+            continue;
+        }
+        
+        http_metrics_error(HTTP_ERR_PARSE);
+        http_log_error("http", llhttp_errno_name(err));
+        
+        /* 解析器已处于错误状态，回复 400 后关闭连接（流式响应已发出头部时直接关闭） */
+        int streaming = conn->tx_stream != HTTP_STREAM_NONE;
+        http_conn_reset_request(conn);
+        conn->keep_alive = 0;
+        conn->closing = 1;
+        if (!streaming) {
+            http_set_response(conn, 400, "application/json",
+                              HTTP_STATIC_BODY(ERROR_BAD_REQUEST));
+            http_send_response(conn);
+            http_conn_reset_request(conn);
+        }
+    }
+
+    if (conn->h2) {
+        http_h2_pump(conn->h2);
+    }
+    http_rx_sync(conn);
+    http_conn_timer_update(conn, progress);
+    http_conn_check_close(conn);
+}
+
+/* 状态处理（HTTP 和 HTTPS 统一） */
+static void http_conn_state(struct http_conn *conn, struct ustream *s)
+{
+    if (!s->write_error) {
+        if (s->eof && http_conn_write_pending(conn)) {
+            /* 对端半关闭：先把已生成的响应发完 */
+            conn->closing = 1;
+            return;
+        }
+        if (!s->eof && !conn->closing)
+            return;
+        if (!s->eof && http_conn_write_pending(conn))
+            return;
     }
+    
+    http_conn_free(conn);
 }
 
-/* ustream 状态回调（HTTP 和 HTTPS 统一） */
-static void stream_notify_state(struct ustream *s) 
+/* HTTP: fd stream 回调 */
+static void fd_notify_read(struct ustream *s, int bytes)
 {
-    struct http_conn *conn = container_of(s, struct http_conn, stream);
-    if (!conn) return;
+    http_conn_read(container_of(s, struct http_conn, fd.stream), s);
+}
+
+static void fd_notify_write(struct ustream *s, int bytes)
+{
+    struct http_conn *conn = container_of(s, struct http_conn, fd.stream);
     
-    if (!s->eof && !s->write_error)
-        return;
+    /* io_uring 连接的发送完成不经过 http_fd_uloop_cb，在这里继续发文件 */
+    if (conn->uring) {
+        http_conn_tx_pump(conn);
+    }
+    /* HTTP/2：写缓冲排空，继续按窗口组帧 */
+    if (conn->h2) {
+        http_h2_pump(conn->h2);
+    }
+    if (conn->tx_stream_wait) {
+        http_stream_schedule(conn);
+    }
+    http_conn_timer_update(conn, 1);
+    http_conn_check_close(conn);
+}
+
+static void fd_notify_state(struct ustream *s)
+{
+    http_conn_state(container_of(s, struct http_conn, fd.stream), s);
+}
+
+/* HTTPS: ssl stream 回调 */
+static struct http_conn *ssl_stream_conn(struct ustream *s)
+{
+    return container_of(s, struct http_ssl_stream, ssl.stream)->conn;
+}
+
+static void ssl_stream_notify_read(struct ustream *s, int bytes)
+{
+    http_conn_read(ssl_stream_conn(s), s);
+}
+
+static void ssl_stream_notify_state(struct ustream *s)
+{
+    http_conn_state(ssl_stream_conn(s), s);
+}
+
+/* HTTPS: 密文最终从 fd stream 发出，先交给 ustream_ssl 再检查是否可关闭 */
+static void ssl_fd_notify_write(struct ustream *s, int bytes)
+{
+    struct http_conn *conn = container_of(s, struct http_conn, fd.stream);
+    struct http_ssl_stream *ss = conn->ssl;
     
-    /* 清理 body 处理器 */
-    http_body_handler_t *handler = http_get_body_handler();
-    if (handler && handler->on_cleanup) {
-        handler->on_cleanup(conn);
+    if (ss->notify_write) {
+        ss->notify_write(s, bytes);
+    }
+    http_conn_tx_pump(conn);
+    if (conn->h2) {
+        http_h2_pump(conn->h2);
+    }
+    if (conn->tx_stream_wait) {
+        http_stream_schedule(conn);
     }
+    http_conn_timer_update(conn, 1);
+    http_conn_check_close(conn);
+}
+
+/* kTLS 握手：SSL 直接读写 socket，经 ustream_ssl 的写回调推进（其中检查连接状态），
+ * 完成时由 ssl_notify_connected 切换收发路径；未完成时按 SSL 的需要关注可读 / 可写 */
+static void http_conn_ktls_handshake(struct http_conn *conn)
+{
+    struct http_ssl_stream *ss = conn->ssl;
     
-    /* 清理连接资源 */
-    if (conn->content_type && conn->content_type != (char *)1) {
-        free(conn->content_type);
+    ss->notify_write(&conn->fd.stream, 0);
+    if (!conn->ktls_hs) {
+        return;
     }
-    if (conn->response_body) {
-        free(conn->response_body);
+    if (ss->ssl.error) {
+        /* 由 ssl_notify_error 关闭连接 */
+        uloop_fd_delete(&conn->fd.fd);
+        return;
     }
+    uloop_fd_add(&conn->fd.fd, ULOOP_READ | (http_tls_want_write(ss->ssl.ssl) ? ULOOP_WRITE : 0));
+}
+
+/* kTLS 握手完成：内核接管的方向改走明文路径，未接管的方向仍经 ustream_ssl；
+ * 握手期间客户端已发出的请求留在 socket 中，恢复 fd stream 读取后处理 */
+static void http_conn_ktls_switch(struct http_conn *conn)
+{
+    struct http_ssl_stream *ss = conn->ssl;
+    int mode = http_tls_ktls_finish(ss->ssl.ssl, &conn->fd.stream);
     
-    /* 清理 stream */
-    if (conn->ssl) {
-        /* HTTPS: 需要清理 SSL 层 */
-        ustream_free(conn->stream);
-        ustream_free(&conn->fd.stream);
-        close(conn->fd.fd.fd);
-    } else {
-        /* HTTP: 只清理 fd stream */
+    conn->ktls_hs = 0;
+    if (mode < 0) {
         uloop_fd_delete(&conn->fd.fd);
-        ustream_free(&conn->fd.stream);
-        close(conn->fd.fd.fd);
+        conn->stream->write_error = true;
+        ustream_state_change(conn->stream);
+        return;
     }
     
-    free(conn);
+    conn->ktls_tx = (mode & HTTP_KTLS_TX) != 0;
+    conn->ktls_rx = (mode & HTTP_KTLS_RX) != 0;
+    if (conn->ktls_rx) {
+        /* fd stream 直接收到明文，读取按 HTTP 连接处理；写回调仍用 ssl_fd_notify_write */
+        conn->fd.stream.notify_read = fd_notify_read;
+        conn->fd.stream.notify_state = fd_notify_state;
+        conn->fd.stream.r.alloc = fd_rx_alloc;
+        conn->stream = &conn->fd.stream;
+    }
+    ustream_set_read_blocked(&conn->fd.stream, false);
 }
 
-/* 服务器接受连接回调（统一处理 HTTP 和 HTTPS） */
-static void server_cb(struct uloop_fd *fd, unsigned int events) 
+/* 包装 ustream_fd 的 uloop 回调，ustream 处理完读写后继续 sendfile
+ * （ustream 在自身写缓冲清空后会取消可写关注，需在其之后重新设置）；
+ * 用于 HTTP 和尝试内核 TLS 的 HTTPS 连接，后者握手期间由这里驱动握手；
+ * io_uring 连接只在等待可写（http_uring_poll_out）就绪时调用 */
+static uloop_fd_handler g_ustream_fd_cb;
+
+static void http_fd_uloop_cb(struct uloop_fd *fd, unsigned int events)
 {
-    struct http_server *server = container_of(fd, struct http_server, server_fd);
-    struct sockaddr_storage client_addr; 
-    socklen_t client_len = sizeof(client_addr);
-    int client_fd;
+    struct http_conn *conn = container_of(fd, struct http_conn, fd.fd);
     
-    client_fd = accept(fd->fd, (struct sockaddr *)&client_addr, &client_len);
-    if (client_fd < 0) {
-        perror("accept");
+    if (conn->ktls_hs) {
+        http_conn_ktls_handshake(conn);
         return;
     }
-    
-    struct http_conn *conn = calloc(1, sizeof(*conn));
+    if (!conn->uring) {
+        g_ustream_fd_cb(fd, events);
+    }
+    if (conn->tx_active) {
+        http_conn_tx_pump(conn);
+        http_conn_timer_update(conn, events & ULOOP_WRITE);
+        http_conn_check_close(conn);
+    }
+}
+
+/* 初始化新连接（统一处理 HTTP 和 HTTPS） */
+static void http_conn_accept(struct http_server *server, int client_fd)
+{
+    struct http_conn *conn = http_conn_alloc();
     if (!conn) {
         close(client_fd);
         return;
     }
     
+    conn->response_file.fd = -1;
+    conn->tx_file.fd = -1;
+    conn->rx_size = HTTP_RX_BUF_MIN;
+    INIT_LIST_HEAD(&conn->rx_wait);
+    conn->timer.cb = http_conn_timeout;
+    conn->tx_kick.cb = http_stream_kick_cb;
+    conn->in_request = 1;
+    conn->t_start = http_metrics_now();
+
     /* 初始化 llhttp */
     llhttp_settings_init(&conn->settings);
+    conn->settings.on_message_begin = http_on_message_begin;
+    conn->settings.on_url = http_on_url;
     conn->settings.on_header_field = http_on_header_field;
     conn->settings.on_header_value = http_on_header_value;
+    conn->settings.on_header_field_complete = http_on_header_field_complete;
     conn->settings.on_headers_complete = http_on_headers_complete;
     conn->settings.on_body = http_on_body;
     conn->settings.on_message_complete = http_on_message_complete;
@@ -223,39 +2462,286 @@ static void server_cb(struct uloop_fd *fd, unsigned int events)
     /* 根据配置初始化 HTTP 或 HTTPS stream */
     if (server->use_ssl && server->ssl_ctx) {
         /* HTTPS: 初始化 SSL 层 */
-        struct ustream_ssl *ssl = calloc(1, sizeof(*ssl));
-        if (!ssl) {
-            close(client_fd);
-            free(conn);
-            return;
-        }
+        struct http_ssl_stream *ss = &container_of(conn, struct http_conn_slot, conn)->ssl;
         
-        conn->ssl = ssl;
-        ssl->stream.string_data = true;
-        ssl->stream.notify_read = stream_notify_read;
-        ssl->stream.notify_state = stream_notify_state;
-        ssl->notify_connected = ssl_notify_connected;
-        ssl->notify_error = ssl_notify_error;
+        conn->ssl = ss;
+        ss->conn = conn;
+        ss->ssl.stream.string_data = true;
+        ss->ssl.stream.notify_read = ssl_stream_notify_read;
+        ss->ssl.stream.notify_state = ssl_stream_notify_state;
+        ss->ssl.notify_connected = ssl_notify_connected;
+        ss->ssl.notify_error = ssl_notify_error;
         
         ustream_fd_init(&conn->fd, client_fd);
-        ustream_ssl_init(ssl, &conn->fd.stream, server->ssl_ctx, true);
+        ustream_ssl_init(&ss->ssl, &conn->fd.stream, server->ssl_ctx, true);
+        http_tls_conn_init(ss->ssl.ssl);
         
-        conn->stream = &ssl->stream;
-    } else {
-        /* HTTP: 直接使用 fd stream */
-        ustream_fd_init(&conn->fd, client_fd);
-        conn->fd.stream.notify_read = stream_notify_read;
-        conn->fd.stream.notify_state = stream_notify_state;
+        /* 接管底层写回调，用于关闭前等待密文发送完毕 */
+        ss->notify_write = conn->fd.stream.notify_write;
+        conn->fd.stream.notify_write = ssl_fd_notify_write;
+
+        /* 明文读缓冲区计入预算；密文缓冲区同样读空即释放 */
+        g_rx_alloc_default = conn->fd.stream.r.alloc;
+        ss->ssl.stream.r.alloc = ssl_rx_alloc;
+        ss->ssl.stream.r.min_buffers = 0;
+        conn->fd.stream.r.min_buffers = 0;
+
+        conn->stream = &ss->ssl.stream;
         
+        /* 内核 TLS：握手期间 fd stream 停读，SSL 直接读写 socket，由 http_fd_uloop_cb 驱动 */
+        if (g_ktls && http_tls_ktls_start(ss->ssl.ssl, client_fd) == 0) {
+            conn->ktls_hs = 1;
+            g_ustream_fd_cb = conn->fd.fd.cb;
+            conn->fd.fd.cb = http_fd_uloop_cb;
+            ustream_set_read_blocked(&conn->fd.stream, true);
+            uloop_fd_add(&conn->fd.fd, ULOOP_READ);
+        }
+    } else {
+        /* HTTP: 直接使用 fd stream（io_uring 后端时收发由 ring 完成，回调相同） */
+        if (g_uring && http_uring_stream_init(&conn->fd, client_fd) == 0) {
+            conn->uring = 1;
+        } else {
+            ustream_fd_init(&conn->fd, client_fd);
+            g_ustream_fd_cb = conn->fd.fd.cb;
+        }
+        conn->fd.stream.notify_read = fd_notify_read;
+        conn->fd.stream.notify_write = fd_notify_write;
+        conn->fd.stream.notify_state = fd_notify_state;
+        conn->fd.fd.cb = http_fd_uloop_cb;
+
+        /* 读缓冲区计入预算，读空即释放：空闲的 keep-alive 连接不占用读缓冲区 */
+        g_rx_alloc_default = conn->fd.stream.r.alloc;
+        conn->fd.stream.r.alloc = fd_rx_alloc;
+        conn->fd.stream.r.min_buffers = 0;
+
         conn->stream = &conn->fd.stream;
     }
+    
+    /* HTTPS 握手也计入请求头超时 */
+    http_conn_timer_update(conn, 0);
+    http_accept_update();
+}
+
+/* accept 出错：fd 或内存耗尽时暂停，连接留在 backlog 中稍后再取 */
+static void http_accept_error(int err)
+{
+    g_accept_stats.errors++;
+    if (err == EMFILE || err == ENFILE || err == ENOBUFS || err == ENOMEM) {
+        /* 监听 fd 一直可读，不暂停会空转 */
+        g_accept_backoff = 1;
+        http_accept_update();
+        uloop_timeout_set(&g_accept_retry, HTTP_ACCEPT_BACKOFF);
+    }
+    errno = err;
+    perror("accept");
+}
+
+/* io_uring 多发 accept 的完成回调：每个新连接一次 */
+static void http_uring_accept_cb(int client_fd)
+{
+    if (client_fd == -EINVAL && g_uring_accept) {
+        /* 内核不支持多发 accept（http_uring.c 已不再重试）：改由 uloop 接受连接，
+         * 连接的收发仍使用 io_uring */
+        fprintf(stderr, "io_uring multishot accept unsupported, accepting via uloop\n");
+        g_uring_accept = 0;
+        if (g_server && g_server->server_fd.fd >= 0 && !g_accept_paused) {
+            uloop_fd_add(&g_server->server_fd, ULOOP_READ);
+        }
+        return;
+    }
+    if (client_fd < 0) {
+        if (client_fd != -EINTR && client_fd != -ECONNABORTED && client_fd != -EAGAIN) {
+            http_accept_error(-client_fd);
+        }
+        return;
+    }
+    if (!g_server || g_server->server_fd.fd < 0) {
+        /* 停止监听后才完成的 accept */
+        close(client_fd);
+        return;
+    }
+    g_accept_stats.accepted++;
+    http_conn_accept(g_server, client_fd);
+}
+
+/* 服务器接受连接回调：一次取出 backlog 中的多个连接（最多 HTTP_ACCEPT_BATCH 个），
+ * accept4 直接得到非阻塞、close-on-exec 的 socket */
+static void server_cb(struct uloop_fd *fd, unsigned int events) 
+{
+    struct http_server *server = container_of(fd, struct http_server, server_fd);
+    int n = 0;
+    
+    g_accept_stats.wakeups++;
+    while (n < HTTP_ACCEPT_BATCH && !g_accept_paused) {
+        int client_fd = accept4(fd->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        
+        if (client_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            
+            http_accept_error(errno);
+            break;
+        }
+        
+        http_conn_accept(server, client_fd);
+        n++;
+    }
+    
+    g_accept_stats.accepted += n;
+    if (n == HTTP_ACCEPT_BATCH) {
+        g_accept_stats.batch_full++;
+    }
+}
+
+static int http_listen_backlog(struct http_server *server)
+{
+    return server->backlog > 0 ? server->backlog : SOMAXCONN;
+}
+
+/* 监听 socket 选项
+ * - TCP_NODELAY：accept 出的 socket 继承该选项（Linux），不必逐个 setsockopt
+ * - TCP_DEFER_ACCEPT：收到首个数据包后内核才把连接放入 accept 队列，
+ *   只建立连接不发数据的客户端不占用连接对象；等待时间与请求头超时一致
+ * - 已在监听的 socket（usock 创建或由主进程传入）再次 listen() 只更新 backlog */
+static void http_listen_setup(struct http_server *server, int fd)
+{
+    int on = 1;
+    int defer = (g_timeouts[HTTP_PHASE_HEADER] + 999) / 1000;
+    
+    if (!(server->type & USOCK_UNIX)) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        setsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &defer, sizeof(defer));
+    }
+    if (listen(fd, http_listen_backlog(server)) < 0) {
+        perror("listen");
+    }
+}
+
+/* 读取 /proc/net/netstat 中 TcpExt 的 ListenOverflows、ListenDrops（整个网络命名空间），失败时不变 */
+static void http_netstat_read(void)
+{
+    char names[4096], values[4096];
+    FILE *fp = fopen("/proc/net/netstat", "r");
+    
+    if (!fp) {
+        return;
+    }
+    
+    /* 成对出现：名称行、数值行 */
+    while (fgets(names, sizeof(names), fp) && fgets(values, sizeof(values), fp)) {
+        char *np, *vp, *n, *v;
+        
+        if (strncmp(names, "TcpExt:", 7) != 0) {
+            continue;
+        }
+        n = strtok_r(names, " \n", &np);
+        v = strtok_r(values, " \n", &vp);
+        while ((n = strtok_r(NULL, " \n", &np)) && (v = strtok_r(NULL, " \n", &vp))) {
+            if (strcmp(n, "ListenOverflows") == 0) {
+                g_listen_overflows = strtoull(v, NULL, 10);
+            } else if (strcmp(n, "ListenDrops") == 0) {
+                g_listen_drops = strtoull(v, NULL, 10);
+            }
+        }
+        break;
+    }
+    
+    fclose(fp);
+}
+
+static void http_netstat_cb(struct uloop_timeout *t)
+{
+    http_netstat_read();
+    uloop_timeout_set(t, HTTP_NETSTAT_INTERVAL);
+}
+
+void http_accept_get_stats(struct http_server *server, struct http_accept_stats *stats)
+{
+    if (!server) {
+        server = g_server;
+    }
+    *stats = g_accept_stats;
+    stats->queue_len = 0;
+    stats->queue_max = 0;
+    
+    /* 监听 socket 的 TCP_INFO：tcpi_unacked 为当前 accept 队列长度，tcpi_sacked 为 backlog */
+    if (server && server->server_fd.fd >= 0 && !(server->type & USOCK_UNIX)) {
+        struct tcp_info info;
+        socklen_t len = sizeof(info);
+        
+        if (getsockopt(server->server_fd.fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0) {
+            stats->queue_len = info.tcpi_unacked;
+            stats->queue_max = info.tcpi_sacked;
+        }
+    }
+    
+    if (!g_netstat_timer.pending) {
+        http_netstat_cb(&g_netstat_timer);
+    }
+    stats->listen_overflows = g_listen_overflows;
+    stats->listen_drops = g_listen_drops;
+}
+
+/* 创建 SO_REUSEPORT 监听 socket：每个 worker 各自绑定同一端口，由内核分发连接 */
+static int http_listen_reuseport(struct http_server *server)
+{
+    struct addrinfo hints, *result, *rp;
+    int fd = -1, on = 1;
+    
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    if (server->type & USOCK_IPV4ONLY)
+        hints.ai_family = AF_INET;
+    else if (server->type & USOCK_IPV6ONLY)
+        hints.ai_family = AF_INET6;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    
+    if (getaddrinfo(server->host, server->service, &hints, &result) != 0)
+        return -1;
+    
+    for (rp = result; rp; rp = rp->ai_next) {
+        fd = socket(rp->ai_family, rp->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            continue;
+        
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0 ||
+            bind(fd, rp->ai_addr, rp->ai_addrlen) < 0 ||
+            listen(fd, http_listen_backlog(server)) < 0) {
+            close(fd);
+            fd = -1;
+            continue;
+        }
+        
+        memcpy(&server->addr, rp->ai_addr, rp->ai_addrlen);
+        break;
+    }
+    
+    freeaddrinfo(result);
+    return fd;
 }
 
 /* HTTP/HTTPS 服务器初始化（统一接口） */
 int http_init(struct http_server *server, http_body_handler_t *handler)
 {
     http_set_body_handler(handler);
+
+    g_server = server;
+    g_timeouts[HTTP_PHASE_HEADER] = server->header_timeout ? server->header_timeout : HTTP_HEADER_TIMEOUT;
+    g_timeouts[HTTP_PHASE_BODY] = server->body_timeout ? server->body_timeout : HTTP_BODY_TIMEOUT;
+    g_timeouts[HTTP_PHASE_IDLE] = server->idle_timeout ? server->idle_timeout : HTTP_IDLE_TIMEOUT;
+    g_timeouts[HTTP_PHASE_WRITE] = server->write_timeout ? server->write_timeout : HTTP_WRITE_TIMEOUT;
+    
+    /* 预算至少容纳一个最大的读缓冲区 */
+    if (server->rx_budget) {
+        g_rx_budget = server->rx_budget < HTTP_RX_BUF_MAX ? HTTP_RX_BUF_MAX : server->rx_budget;
+    }
     
+    http_compress_init(server->compress_level, server->compress_min);
+
     /* 如果启用 SSL，初始化 SSL 上下文 */
     if (server->use_ssl) {
         server->ssl_ctx = ustream_ssl_context_new(true);
@@ -293,10 +2779,32 @@ int http_init(struct http_server *server, http_body_handler_t *handler)
                         server->ssl_config.ca_file);
             }
         }
+        
+        /* 内核 TLS：每个进程探测一次，不支持时所有连接照常由 ustream_ssl 加解密 */
+        g_ktls = server->ktls && http_tls_ktls_supported();
+        
+        /* ALPN：启用 HTTP/2 时优先协商 h2 */
+        http_tls_set_h2(server->h2);
+    }
+    g_h2 = server->h2;
+    
+    /* io_uring 后端只用于明文 HTTP；内核不支持时照常使用 uloop（epoll） */
+    if (server->io_uring && !server->use_ssl) {
+        g_uring = http_uring_init() == 0;
+        if (!g_uring) {
+            fprintf(stderr, "io_uring unavailable, using uloop\n");
+        }
     }
     
     /* 创建监听 socket */
-    int fd = usock_inet(server->type, server->host, server->service, &server->addr);
+    int fd;
+    if (server->listen_fd >= 0) {
+        fd = server->listen_fd;
+    } else if (server->reuseport && !(server->type & USOCK_UNIX)) {
+        fd = http_listen_reuseport(server);
+    } else {
+        fd = usock_inet(server->type, server->host, server->service, &server->addr);
+    }
     if (fd < 0) {
         perror("usock_inet");
         if (server->ssl_ctx) {
@@ -305,24 +2813,77 @@ int http_init(struct http_server *server, http_body_handler_t *handler)
         return -1;
     }
     
+    http_listen_setup(server, fd);
+    
     server->server_fd.fd = fd;
     server->server_fd.cb = server_cb;
-    uloop_fd_add(&server->server_fd, ULOOP_READ);
+    g_uring_accept = g_uring;
+    if (g_uring_accept) {
+        http_uring_accept_start(fd, http_uring_accept_cb);
+    } else {
+        uloop_fd_add(&server->server_fd, ULOOP_READ);
+    }
     return 0;
 }
 
-/* HTTP/HTTPS 服务器清理（统一接口） */
-void http_cleanup(struct http_server *server) 
+/* 停止监听：关闭监听 socket，已建立的连接不受影响 */
+void http_stop_listen(struct http_server *server)
 {
+    uloop_timeout_cancel(&g_accept_retry);
+    uloop_timeout_cancel(&g_netstat_timer);
     if (server->server_fd.fd >= 0) {
+        if (g_uring_accept) {
+            http_uring_accept_stop();
+        }
         uloop_fd_delete(&server->server_fd);
         close(server->server_fd.fd);
         server->server_fd.fd = -1;
     }
-    
+}
+
+/* HTTP/HTTPS 服务器清理（统一接口） */
+void http_cleanup(struct http_server *server) 
+{
+    http_stop_listen(server);
+    uloop_timeout_cancel(&g_date_timer);
+    http_log_flush();
+
+    if (g_rx_waits) {
+        fprintf(stderr, "Receive buffers: peak %zu bytes, %llu waits for budget\n",
+                g_rx_peak, (unsigned long long)g_rx_waits);
+    }
+
     /* 清理 SSL 上下文 */
     if (server->ssl_ctx) {
+        struct http_tls_stats stats;
+        
+        http_tls_get_stats(&stats);
+        fprintf(stderr, "TLS handshakes: %llu full, %llu resumed\n",
+                (unsigned long long)stats.full, (unsigned long long)stats.resumed);
+        http_tls_cleanup();
         ustream_ssl_context_free(server->ssl_ctx);
         server->ssl_ctx = NULL;
     }
+    
+    if (g_h2) {
+        struct http_h2_stats stats;
+        
+        http_h2_get_stats(&stats);
+        if (stats.sessions) {
+            fprintf(stderr, "HTTP/2: %llu connections, %llu streams, %llu resets\n",
+                    (unsigned long long)stats.sessions, (unsigned long long)stats.streams,
+                    (unsigned long long)stats.resets);
+        }
+    }
+    
+    if (g_uring) {
+        struct http_uring_stats stats;
+        
+        http_uring_get_stats(&stats);
+        fprintf(stderr, "io_uring: %llu submits, %llu sqes, %llu cqes\n",
+                (unsigned long long)stats.enters, (unsigned long long)stats.sqes,
+                (unsigned long long)stats.cqes);
+        http_uring_cleanup();
+        g_uring = 0;
+    }
 }
@@ -1,11 +1,16 @@
 #ifndef HTTP_H
 #define HTTP_H
 
+#include <stdint.h>
+#include <sys/types.h>
 #include <sys/socket.h>
+#include <libubox/list.h>
 #include <libubox/uloop.h>
 #include <libubox/ustream.h>
 #include <libubox/usock.h>
 #include <llhttp.h>
+#include "http_arena.h"
+#include "http_timer.h"
 
 /* SSL 配置（可选） */
 struct http_ssl_config {
@@ -23,41 +28,210 @@ struct http_server {
     struct uloop_fd server_fd;
     struct sockaddr_storage addr;
     
+    /* 多进程模式 */
+    int reuseport;                      /* 每个 worker 独立监听（SO_REUSEPORT） */
+    int listen_fd;                      /* 预先创建的监听 socket（>= 0 时直接使用，没有时为 -1） */
+    
     /* SSL 支持（可选） */
     int use_ssl;                        /* 是否启用 SSL */
     struct http_ssl_config ssl_config;  /* SSL 配置 */
     void *ssl_ctx;                      /* SSL 上下文（ustream_ssl_ctx*） */
+    int ktls;                           /* 握手后尝试内核 TLS（见 http_tls.h），内核不支持时无效果 */
+    
+    /* 接收缓冲区总预算（字节，每个进程），0 使用默认值 HTTP_RX_BUDGET */
+    size_t rx_budget;
+    
+    /* 每个进程的并发连接上限，达到时暂停 accept，0 不限 */
+    int max_conns;
+    int backlog;                        /* listen() backlog，0 使用 SOMAXCONN */
+    int io_uring;                       /* HTTP 连接改用 io_uring 后端（见 http_uring.h），不支持时回退 uloop */
+    int h2;                             /* HTTP/2（见 http_h2.h）：HTTPS 经 ALPN 协商 h2，HTTP 接受 h2c 直连 */
+    
+    /* 超时（毫秒），0 使用默认值 */
+    unsigned int header_timeout;        /* 请求行和请求头须在该时间内收完 */
+    unsigned int body_timeout;          /* 读取 body 时两次收到数据的最长间隔 */
+    unsigned int idle_timeout;          /* keep-alive 连接等待下一个请求 */
+    unsigned int write_timeout;         /* 发送响应时两次写出数据的最长间隔 */
+    
+    /* 响应压缩（见 http_compress.h）：压缩级别 1-9，0 关闭；阈值 0 使用默认值 */
+    int compress_level;
+    size_t compress_min;
+};
+
+#define HTTP_HEADER_TIMEOUT 10000
+#define HTTP_BODY_TIMEOUT   30000
+#define HTTP_IDLE_TIMEOUT   60000
+#define HTTP_WRITE_TIMEOUT  30000
+
+/* 超时关闭的连接数（按阶段）及因连接上限暂停 accept 的次数 */
+struct http_conn_stats {
+    uint64_t header_timeouts;
+    uint64_t body_timeouts;
+    uint64_t idle_timeouts;
+    uint64_t write_timeouts;
+    uint64_t accept_paused;
+};
+
+/* 接收缓冲区：按请求自适应大小，读空即释放 */
+#define HTTP_RX_BUF_MIN     2048            /* 新请求 / 小请求 */
+#define HTTP_RX_BUF_MAX     65536           /* 上传时逐步增大到该值 */
+#define HTTP_RX_BUDGET      (32 << 20)      /* 默认总预算 */
+
+struct http_rx_stats {
+    size_t bytes;               /* 当前所有连接持有的接收缓冲区 */
+    size_t peak;
+    size_t budget;
+    uint64_t waits;             /* 因超出预算暂停读取的次数 */
+};
+
+/* 常用请求头：解析时直接记录在请求头表中的下标，按 ID 查找无需比较名称 */
+enum {
+    HTTP_HDR_CONTENT_TYPE,
+    HTTP_HDR_CONTENT_LENGTH,
+    HTTP_HDR_CONNECTION,
+    HTTP_HDR_ACCEPT_ENCODING,
+    HTTP_HDR_HOST,
+    HTTP_HDR_RANGE,
+    HTTP_HDR_IF_RANGE,
+    HTTP_HDR_IF_NONE_MATCH,
+    HTTP_HDR_IF_MODIFIED_SINCE,
+    HTTP_HDR_MAX
+};
+
+#define HTTP_MAX_HEADERS    64      /* 单个请求的请求头上限，超出回复 400 */
+
+/* 请求头表项：name/value 直接指向接收缓冲区，
+ * 仅当请求跨越多次读取时才拷贝到 arena（on_headers_complete 之后均以 '\0' 结尾） */
+struct http_header {
+    const char *name;
+    const char *value;
+    uint32_t name_len;
+    uint32_t value_len;
+};
+
+/* 文件响应 body：由 http.c 用 sendfile（HTTP、内核 TLS）或 mmap（用户态加密的 HTTPS）发出 */
+struct http_file_body {
+    int fd;                         /* -1 表示无文件 body */
+    off_t offset;
+    size_t len;
+    void (*release)(void *ref);     /* 发送完毕或连接关闭时调用 */
+    void *ref;
 };
 
-/* HTTP 连接 - 统一支持 HTTP 和 HTTPS */
+struct http_body_handler;
+struct http_router;
+struct http_zstream;
+struct http_h2;
+struct http_h2_stream;
+
+/* HTTP 连接 - 统一支持 HTTP 和 HTTPS
+ * HTTP/2 连接上的每个请求流也是一个 struct http_conn（h2s 非空，parser.http_major 为 2），
+ * 处理器按同样的接口处理，收发经所属连接的 session */
 struct http_conn {
     /* 底层 stream（HTTP 或 HTTPS） */
     struct ustream *stream;         /* 统一的 stream 接口 */
     struct ustream_fd fd;           /* HTTP: 直接使用 */
     void *ssl;                      /* HTTPS: ustream_ssl* */
+    int ktls_hs;                    /* HTTPS: 内核 TLS 握手进行中（SSL 直接读写 socket） */
+    int ktls_tx;                    /* HTTPS: 发送由内核加密，明文直接写 socket（sendmsg / sendfile） */
+    int ktls_rx;                    /* HTTPS: 接收由内核解密，直接读 fd stream */
+    int uring;                      /* HTTP: fd stream 的收发由 io_uring 完成 */
+    
+    /* HTTP/2：连接上的 session；请求流所属的流和连接（stream、ssl 与连接相同） */
+    struct http_h2 *h2;
+    struct http_h2_stream *h2s;
+    struct http_conn *h2_conn;
+    int h2_fields;                  /* 请求流：已收到的伪头部、是否已有普通请求头（http.c 内部使用） */
+    uint64_t h2_rx_bytes;           /* 请求流：已收到的 body 字节数（与 content-length 核对） */
     
     /* HTTP 解析器 */
     llhttp_t parser;
     llhttp_settings_t settings;
     
-    /* Content-Type 相关 */
-    char *content_type;
+    /* 请求行和请求头（指向接收缓冲区或 arena，见 struct http_header） */
+    char *url;
+    size_t url_len;
+    struct http_header headers[HTTP_MAX_HEADERS];
+    int header_count;
+    int header_state;               /* 请求头解析状态（http.c 内部使用） */
+    uint8_t header_index[HTTP_HDR_MAX]; /* HTTP_HDR_* → 表中下标 + 1，0 未收到 */
+    
+    /* 当前请求的处理器（路由选择）及路由上下文 */
+    struct http_body_handler *handler;
+    void *route_ctx;
+    uint64_t route_allow;           /* 路径上各路由的方法掩码（405 的 Allow） */
     
-    /* Body 处理器上下文（由具体处理器分配） */
+    /* Body 处理器上下文（由具体处理器从 arena 分配） */
     void *body_ctx;
     
+    /* 请求级内存：请求结束时整体回收 */
+    http_arena_t arena;
+    
+    /* 接收缓冲区（见 http.c）：下次分配的大小、当前持有字节数、HTTP/2 session 缓存的 body、
+     * 预算等待链表 */
+    uint32_t rx_size;
+    uint32_t rx_held;
+    uint32_t h2_rx_held;
+    struct list_head rx_wait;
+    int rx_paused;                  /* body 处理器暂停了读取 */
+    
+    /* 超时定时器（见 http.c）：当前阶段、已完成的请求数（阶段内换了请求也要重设） */
+    http_timer_t timer;
+    int timer_phase;
+    uint32_t timer_seq;
+    uint32_t requests;
+    int in_request;                 /* 已收到请求的首字节（新连接视为已开始） */
+    
+    /* 分阶段计时（见 http_metrics.h，单调时钟微秒） */
+    uint64_t t_start;               /* 请求开始：首个请求为 accept，之后为请求首字节 */
+    uint64_t t_stage;               /* 请求头完成 */
+    uint64_t t_write;               /* 响应交给发送队列，0 表示没有待统计的写出 */
+    uint64_t t_handler;             /* 本请求在处理器回调中累计的时间 */
+    int metrics_mode;
+    
     /* 错误标记 */
     int parse_error;
     
-    /* 响应数据 */
+    /* 连接状态：keep-alive 复用 / 响应发送完毕后关闭 */
+    int keep_alive;
+    int closing;
+    
+    /* 响应数据（body 指向常量或 arena 内存，不单独释放） */
     int status_code;
-    char *response_body;
+    const char *response_body;
     size_t response_body_len;
-    char *response_content_type;
+    const char *response_content_type;
+    char *response_headers;         /* 附加响应头（"Name: value\r\n"，arena 中） */
+    size_t response_headers_len;
+    struct http_file_body response_file;
+    
+    /* 正在发送的文件 body（跨多次可写事件） */
+    struct http_file_body tx_file;
+    char *tx_map;                   /* HTTPS: mmap 映射 */
+    size_t tx_map_len;
+    int tx_active;
+    
+    /* 流式响应（见 http_stream_begin） */
+    int tx_stream;                  /* HTTP_STREAM_* */
+    int tx_chunked;                 /* 分块编码（HTTP/1.0 客户端为 0，以关闭连接结束） */
+    int tx_stream_wait;             /* 写缓冲超过高水位，等待排空后回调 on_writable */
+    int tx_stream_held;             /* 请求已结束，后续请求等流式响应结束后再解析 */
+    uint64_t tx_bytes;              /* 当前响应的 body 字节数（访问日志用，流式响应为已写出的部分） */
+    struct uloop_timeout tx_kick;   /* 在事件循环中调度 on_writable / 结束请求 */
+    struct http_zstream *tx_zstream;/* 流式响应的压缩流（客户端接受压缩且类型可压缩时） */
+};
+
+enum {
+    HTTP_STREAM_NONE,
+    HTTP_STREAM_ACTIVE,             /* 已发出头部 */
+    HTTP_STREAM_DONE,               /* 已结束（http_stream_end 或出错） */
 };
 
+#define HTTP_STREAM_HIGH_WATER  65536   /* 待发送数据超过该值时 http_stream_write 返回 0 */
+#define HTTP_STREAM_LOW_WATER   16384   /* 降到该值以下时回调 on_writable */
+
 /* Body 处理器接口 */
-typedef struct {
+typedef struct http_body_handler {
     /* 初始化：解析开始前调用 */
     int (*on_init)(struct http_conn *conn, const char *content_type);
     
@@ -69,18 +243,106 @@ typedef struct {
     
     /* 清理：连接关闭时调用 */
     void (*on_cleanup)(struct http_conn *conn);
+    
+    /* 流式响应可继续写出时调用（可选）：返回 1 还有数据待写，0 等待，-1 中止响应并关闭连接 */
+    int (*on_writable)(struct http_conn *conn);
 } http_body_handler_t;
 
 /* HTTP 服务器接口 */
 int http_init(struct http_server *server, http_body_handler_t *handler);
 void http_cleanup(struct http_server *server);
 
+/* 停止接受新连接（优雅退出），已建立的连接继续处理 */
+void http_stop_listen(struct http_server *server);
+
+/* 当前进程中活动连接数 */
+int http_conn_count(void);
+
+/* body 处理器在 on_data 中调用：当前片段处理完后暂停解析和读取，
+ * 后续数据留在接收缓冲区（socket 积压后由 TCP 流控反压到客户端）；
+ * 下游处理完毕后调用 http_resume_read() 继续解析已缓冲的数据 */
+void http_pause_read(struct http_conn *conn);
+void http_resume_read(struct http_conn *conn);
+
+void http_rx_get_stats(struct http_rx_stats *stats);
+
+void http_conn_get_stats(struct http_conn_stats *stats);
+
+/* accept 统计；queue_* 在调用时读取内核数据，listen_* 为定时器最近一次读取的值
+ * （首次调用时读取并开始每 5 秒刷新）；server 为 NULL 时取 http_init() 的服务器 */
+struct http_accept_stats {
+    uint64_t accepted;
+    uint64_t wakeups;               /* 监听 socket 可读事件次数 */
+    uint64_t batch_full;            /* 一次取满 HTTP_ACCEPT_BATCH，backlog 中可能还有连接 */
+    uint64_t errors;                /* accept 失败（EMFILE 等） */
+    uint32_t queue_len;             /* 当前 accept 队列长度（TCP_INFO） */
+    uint32_t queue_max;             /* 内核实际使用的 backlog */
+    uint64_t listen_overflows;      /* accept 队列溢出（/proc/net/netstat，整个网络命名空间） */
+    uint64_t listen_drops;
+};
+
+void http_accept_get_stats(struct http_server *server, struct http_accept_stats *stats);
+
 /* HTTP 响应辅助函数 */
 void http_send_response(struct http_conn *conn);
 
+/* 常量 body 参数展开：http_set_response(conn, 200, type, HTTP_STATIC_BODY("...")) */
+#define HTTP_STATIC_BODY(str) (str), sizeof(str) - 1
+
+/* 设置响应：body 必须是常量或从 conn->arena 分配的内存 */
+static inline void http_set_response(struct http_conn *conn, int status,
+                                     const char *content_type,
+                                     const char *body, size_t len)
+{
+    conn->status_code = status;
+    conn->response_content_type = content_type;
+    conn->response_body = body;
+    conn->response_body_len = len;
+}
+
+/* 设置文件响应：file->fd 的所有权随 release 回调一起交给连接 */
+static inline void http_set_file_response(struct http_conn *conn, int status,
+                                          const char *content_type,
+                                          const struct http_file_body *file)
+{
+    http_set_response(conn, status, content_type, NULL, 0);
+    conn->response_file = *file;
+}
+
+/* 流式响应：处理器在 on_data / on_complete 等回调中开始，边生成边发送，不需要预先知道长度
+ * - http_stream_begin() 立即发出状态行和响应头（含 http_add_header 追加的），
+ *   HTTP/1.1 使用 Transfer-Encoding: chunked，HTTP/1.0 不分块、发完后关闭连接
+ * - http_stream_write() 写出一段；待发送数据超过高水位时返回 0，处理器应停止生产，
+ *   降到低水位后由 on_writable 回调继续（on_data 中可配合 http_pause_read() 反压上游）
+ * - 处理器提供 on_writable 时，开始后回调一次；之后在写缓冲从高水位排空后，
+ *   或上次回调返回 1（还有数据，让出事件循环）时再次回调，直到 http_stream_end()
+ * - 请求结束时响应尚未结束：保留处理器上下文，后续请求等流式响应结束后再处理
+ * - 启用压缩时，可压缩类型按 Accept-Encoding 压缩后再分块（待发送量按压缩后计算）
+ * 失败（未开始、连接出错）返回 -1 */
+int http_stream_begin(struct http_conn *conn, int status, const char *content_type);
+int http_stream_write(struct http_conn *conn, const char *data, size_t len);
+int http_stream_end(struct http_conn *conn);
+
+/* 追加响应头（拷贝到 conn->arena），失败返回 -1 */
+int http_add_header(struct http_conn *conn, const char *name, const char *value);
+
+/* 常用请求头（未收到返回 NULL），重复出现时取最后一个
+ * 返回的指针只在当前请求的回调中有效，不能跨回调保存 */
+static inline const char *http_get_header(struct http_conn *conn, int id)
+{
+    int i = conn->header_index[id];
+    return i ? conn->headers[i - 1].value : NULL;
+}
+
+/* 按名称查找请求头（不区分大小写），len 可为 NULL */
+const char *http_find_header(struct http_conn *conn, const char *name, size_t *len);
+
 /* HTTP 解析回调（供 SSL 模块使用） */
+int http_on_message_begin(llhttp_t *parser);
+int http_on_url(llhttp_t *parser, const char *at, size_t length);
 int http_on_header_field(llhttp_t *parser, const char *at, size_t length);
 int http_on_header_value(llhttp_t *parser, const char *at, size_t length);
+int http_on_header_field_complete(llhttp_t *parser);
 int http_on_headers_complete(llhttp_t *parser);
 int http_on_body(llhttp_t *parser, const char *at, size_t length);
 int http_on_message_complete(llhttp_t *parser);
@@ -89,4 +351,7 @@ int http_on_message_complete(llhttp_t *parser);
 void http_set_body_handler(http_body_handler_t *handler);
 http_body_handler_t *http_get_body_handler(void);
 
+/* 设置路由表（已编译）：设置后按方法和 URL 为每个请求选择处理器，不再使用全局处理器 */
+void http_set_router(struct http_router *router);
+
 #endif // HTTP_H
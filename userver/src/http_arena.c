@@ -0,0 +1,148 @@
+#include "http_arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_BLOCK_SIZE    4096    /* 首块大小，覆盖绝大多数小请求 */
+#define ARENA_BLOCK_GROW_MAX (64 * 1024)    /* 倍增的上限，更大的块只为单个大对象分配 */
+#define ARENA_ALIGN         sizeof(void *)
+
+static size_t align_up(size_t n)
+{
+    return (n + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+static struct http_arena_block *arena_block_new(size_t size)
+{
+    struct http_arena_block *b = malloc(sizeof(*b) + size);
+    if (!b) return NULL;
+
+    b->next = NULL;
+    b->size = size;
+    b->used = 0;
+    return b;
+}
+
+void *http_arena_alloc(http_arena_t *arena, size_t size)
+{
+    struct http_arena_block *b = arena->head;
+    size_t need = align_up(size ? size : 1);
+
+    if (!b || b->size - b->used < need) {
+        /* 新块：上一块的两倍（不超过 ARENA_BLOCK_GROW_MAX，上一块可能是单独的大缓冲区），
+         * 大对象单独成块 */
+        size_t block_size = ARENA_BLOCK_SIZE;
+        if (b) {
+            block_size = b->size < ARENA_BLOCK_GROW_MAX / 2 ? b->size * 2 : ARENA_BLOCK_GROW_MAX;
+        }
+        while (block_size < need) {
+            block_size *= 2;
+        }
+
+        struct http_arena_block *nb = arena_block_new(block_size);
+        if (!nb) return NULL;
+
+        nb->next = b;
+        arena->head = nb;
+        b = nb;
+    }
+
+    void *p = b->data + b->used;
+    b->used += need;
+    arena->last = p;
+    arena->last_size = need;
+    return p;
+}
+
+void *http_arena_calloc(http_arena_t *arena, size_t size)
+{
+    void *p = http_arena_alloc(arena, size);
+    if (p) memset(p, 0, size);
+    return p;
+}
+
+void *http_arena_realloc(http_arena_t *arena, void *ptr, size_t old_size, size_t new_size)
+{
+    if (!ptr) return http_arena_alloc(arena, new_size);
+    if (new_size <= old_size) return ptr;
+
+    /* 最近一次分配：尝试在当前块内原地扩展 */
+    struct http_arena_block *b = arena->head;
+    if (ptr == arena->last && b) {
+        size_t need = align_up(new_size);
+        size_t start = (char *)ptr - b->data;
+        if (start + need <= b->size) {
+            b->used = start + need;
+            arena->last_size = need;
+            return ptr;
+        }
+
+        /* 块中只有这一个分配（大缓冲区单独成块）：整块 realloc，不留下旧副本；
+         * 块在链表头，没有其它指针指向它 */
+        if (start == 0) {
+            struct http_arena_block *nb = realloc(b, sizeof(*b) + need);
+            if (!nb) return NULL;
+
+            nb->size = need;
+            nb->used = need;
+            arena->head = nb;
+            arena->last = nb->data;
+            arena->last_size = need;
+            return nb->data;
+        }
+    }
+
+    void *p = http_arena_alloc(arena, new_size);
+    if (p) memcpy(p, ptr, old_size);
+    return p;
+}
+
+char *http_arena_strndup(http_arena_t *arena, const char *str, size_t len)
+{
+    char *p = http_arena_alloc(arena, len + 1);
+    if (!p) return NULL;
+
+    memcpy(p, str, len);
+    p[len] = '\0';
+    return p;
+}
+
+void http_arena_reset(http_arena_t *arena)
+{
+    struct http_arena_block *b = arena->head;
+
+    if (!b) return;
+
+    /* 保留最早分配的首块，释放本次请求扩展出的块 */
+    while (b->next) {
+        struct http_arena_block *next = b->next;
+        free(b);
+        b = next;
+    }
+
+    /* 首块本身就是大对象块时不缓存，避免连接池长期占用大内存 */
+    if (b->size > ARENA_BLOCK_SIZE) {
+        free(b);
+        b = NULL;
+    } else {
+        b->used = 0;
+    }
+
+    arena->head = b;
+    arena->last = NULL;
+    arena->last_size = 0;
+}
+
+void http_arena_destroy(http_arena_t *arena)
+{
+    struct http_arena_block *b = arena->head;
+
+    while (b) {
+        struct http_arena_block *next = b->next;
+        free(b);
+        b = next;
+    }
+
+    arena->head = NULL;
+    arena->last = NULL;
+    arena->last_size = 0;
+}
@@ -0,0 +1,41 @@
+#ifndef HTTP_ARENA_H
+#define HTTP_ARENA_H
+
+#include <stddef.h>
+
+/* 请求级 bump 分配器
+ * - 分配只移动指针，不单独释放
+ * - 请求结束时 http_arena_reset() 整体回收，保留首块供下个请求复用
+ * - 首块随连接对象一起缓存在连接池中，稳定负载下不再调用 malloc */
+
+struct http_arena_block {
+    struct http_arena_block *next;
+    size_t size;                /* data 容量 */
+    size_t used;                /* 已分配字节 */
+    char data[];
+};
+
+typedef struct {
+    struct http_arena_block *head;  /* 当前分配块（链表头） */
+    void *last;                     /* 最近一次分配，用于原地扩容 */
+    size_t last_size;
+} http_arena_t;
+
+/* 分配 size 字节（按指针大小对齐），失败返回 NULL */
+void *http_arena_alloc(http_arena_t *arena, size_t size);
+void *http_arena_calloc(http_arena_t *arena, size_t size);
+
+/* 扩容：ptr 为最近一次分配且当前块有空间时原地扩展；独占一块时整块 realloc（旧空间随之释放）；
+ * 否则分配新空间并拷贝，旧空间留到请求结束 */
+void *http_arena_realloc(http_arena_t *arena, void *ptr, size_t old_size, size_t new_size);
+
+/* 拷贝字符串（带结尾 '\0'） */
+char *http_arena_strndup(http_arena_t *arena, const char *str, size_t len);
+
+/* 回收全部分配，只保留首块 */
+void http_arena_reset(http_arena_t *arena);
+
+/* 释放全部内存 */
+void http_arena_destroy(http_arena_t *arena);
+
+#endif // HTTP_ARENA_H
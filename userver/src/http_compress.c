@@ -0,0 +1,440 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <zlib.h>
+#include <libubox/list.h>
+#include "http_compress.h"
+
+#define ZCACHE_BUCKETS  1024        /* 2 的幂 */
+#define ZSEEN_SLOTS     4096        /* 见过一次的 / 不可压缩的 body 哈希，直接映射，2 的幂 */
+#define ZSTREAM_OUT     16384       /* 流式压缩每次输出的块大小 */
+
+static int g_level = 0;             /* 0 关闭 */
+static size_t g_min_size = HTTP_COMPRESS_MIN;
+static struct http_compress_stats g_stats;
+
+/* 编码表：协商时客户端 q 值相同按表中顺序优先 */
+static const struct {
+    const char *name;
+    int window_bits;                /* zlib：31 为 gzip 头，15 为 zlib 头（HTTP 的 deflate） */
+} g_encodings[HTTP_ENC_MAX] = {
+    [HTTP_ENC_IDENTITY] = { "identity", 0 },
+    [HTTP_ENC_GZIP]     = { "gzip", 15 + 16 },
+    [HTTP_ENC_DEFLATE]  = { "deflate", 15 },
+};
+
+/* 缓冲响应复用的压缩流（deflateReset 比每次 deflateInit 少一次大块分配） */
+static z_stream g_zs[HTTP_ENC_MAX];
+static int g_zs_ready[HTTP_ENC_MAX];
+
+/* 压缩结果缓存：按 body 内容哈希，命中后与保存的原文逐字节比较 */
+struct zcache_entry {
+    struct zcache_entry *next;      /* 桶链 */
+    struct list_head lru;
+    uint64_t hash;
+    size_t len;
+    size_t zlen;
+    int enc;
+    char *zdata;                    /* 紧跟原文之后 */
+    char data[];
+};
+
+static struct zcache_entry *g_zcache[ZCACHE_BUCKETS];
+static LIST_HEAD(g_zlru);
+
+/* 只记哈希不存原文：第二次见到的 body 才进缓存，一次性的响应只压缩到 arena；
+ * 压缩后不更小的 body 记下后不再尝试。64 位哈希误判只会多压缩或少压缩一次，不影响正确性 */
+static uint64_t g_zseen[ZSEEN_SLOTS];
+static uint64_t g_znone[ZSEEN_SLOTS];
+
+void http_compress_init(int level, size_t min_size)
+{
+    g_level = level < 0 ? 0 : level > 9 ? 9 : level;
+    g_min_size = min_size ? min_size : HTTP_COMPRESS_MIN;
+}
+
+const char *http_compress_name(int enc)
+{
+    return enc > HTTP_ENC_IDENTITY && enc < HTTP_ENC_MAX ? g_encodings[enc].name : NULL;
+}
+
+/* 值得压缩的类型：文本及常见的文本格式，图片（SVG 除外）、视频、压缩包等已压缩过 */
+static int compress_type_ok(const char *type)
+{
+    static const char *const types[] = {
+        "application/json",
+        "application/javascript",
+        "application/xml",
+        "application/wasm",
+        "image/svg+xml",
+    };
+
+    if (!type) {
+        return 0;
+    }
+    if (strncasecmp(type, "text/", 5) == 0) {
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        size_t n = strlen(types[i]);
+        if (strncasecmp(type, types[i], n) == 0 && (type[n] == '\0' || type[n] == ';')) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* 解析 q 值（"q=0.5"），返回千分制；格式错误按 1 处理 */
+static int parse_qvalue(const char *p, const char *end)
+{
+    int q = 0, scale = 1000;
+
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    if (end - p < 2 || (p[0] != 'q' && p[0] != 'Q') || p[1] != '=') {
+        return 1000;
+    }
+    p += 2;
+    if (p < end && *p == '1') {
+        return 1000;
+    }
+    if (p >= end || *p != '0') {
+        return 1000;
+    }
+    p++;
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9' && scale > 1; p++) {
+            scale /= 10;
+            q += (*p - '0') * scale;
+        }
+    }
+    return q;
+}
+
+/* 按 Accept-Encoding 选择编码：q 值最高者优先，"*" 匹配未列出的编码，q=0 表示拒绝 */
+static int negotiate_encoding(const char *accept)
+{
+    int q[HTTP_ENC_MAX];
+    int star = -1;
+    int best = HTTP_ENC_IDENTITY, best_q = 0;
+    const char *p = accept;
+
+    for (int i = 0; i < HTTP_ENC_MAX; i++) {
+        q[i] = -1;
+    }
+
+    while (*p) {
+        const char *tok, *tok_end, *end;
+
+        while (*p == ' ' || *p == '\t' || *p == ',') {
+            p++;
+        }
+        tok = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ' && *p != '\t') {
+            p++;
+        }
+        tok_end = p;
+        end = strchr(p, ',');
+        if (!end) {
+            end = p + strlen(p);
+        }
+
+        if (tok_end > tok) {
+            int qv = 1000;
+            const char *semi = memchr(tok_end, ';', end - tok_end);
+
+            if (semi) {
+                qv = parse_qvalue(semi + 1, end);
+            }
+            if (tok_end - tok == 1 && *tok == '*') {
+                star = qv;
+            } else {
+                for (int i = HTTP_ENC_GZIP; i < HTTP_ENC_MAX; i++) {
+                    size_t n = strlen(g_encodings[i].name);
+                    if ((size_t)(tok_end - tok) == n && strncasecmp(tok, g_encodings[i].name, n) == 0) {
+                        q[i] = qv;
+                    }
+                }
+            }
+        }
+        p = end;
+    }
+
+    for (int i = HTTP_ENC_GZIP; i < HTTP_ENC_MAX; i++) {
+        int qv = q[i] >= 0 ? q[i] : star;
+        if (qv > best_q) {
+            best = i;
+            best_q = qv;
+        }
+    }
+    return best;
+}
+
+int http_compress_negotiate(struct http_conn *conn, const char *content_type)
+{
+    const char *accept;
+
+    if (!g_level || !compress_type_ok(content_type)) {
+        return -1;
+    }
+
+    accept = http_get_header(conn, HTTP_HDR_ACCEPT_ENCODING);
+    return accept ? negotiate_encoding(accept) : HTTP_ENC_IDENTITY;
+}
+
+static z_stream *compress_stream(int enc)
+{
+    z_stream *zs = &g_zs[enc];
+
+    if (g_zs_ready[enc]) {
+        deflateReset(zs);
+        return zs;
+    }
+    memset(zs, 0, sizeof(*zs));
+    if (deflateInit2(zs, g_level, Z_DEFLATED, g_encodings[enc].window_bits,
+                     8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return NULL;
+    }
+    g_zs_ready[enc] = 1;
+    return zs;
+}
+
+/* 一次性压缩到 out（容量 out_cap 不小于 deflateBound），返回压缩后长度，失败返回 0 */
+static size_t compress_buf(int enc, const char *in, size_t len, char *out, size_t out_cap)
+{
+    z_stream *zs = compress_stream(enc);
+
+    if (!zs) {
+        return 0;
+    }
+    zs->next_in = (Bytef *)in;
+    zs->avail_in = len;
+    zs->next_out = (Bytef *)out;
+    zs->avail_out = out_cap;
+    if (deflate(zs, Z_FINISH) != Z_STREAM_END) {
+        return 0;
+    }
+    g_stats.compressed++;
+    return zs->total_out;
+}
+
+static uint64_t zcache_hash(const char *p, size_t len, int enc)
+{
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ len ^ ((uint64_t)enc << 56);
+
+    while (len >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        h = (h ^ (unsigned char)*p++) * 0x100000001b3ULL;
+    }
+    h ^= h >> 29;
+    return h;
+}
+
+static void zcache_remove(struct zcache_entry *e)
+{
+    struct zcache_entry **pp = &g_zcache[e->hash & (ZCACHE_BUCKETS - 1)];
+
+    while (*pp != e) {
+        pp = &(*pp)->next;
+    }
+    *pp = e->next;
+    list_del(&e->lru);
+    g_stats.cache_bytes -= e->len + e->zlen;
+    free(e);
+}
+
+static struct zcache_entry *zcache_find(uint64_t hash, int enc, const char *body, size_t len)
+{
+    struct zcache_entry *e;
+
+    for (e = g_zcache[hash & (ZCACHE_BUCKETS - 1)]; e; e = e->next) {
+        if (e->hash == hash && e->enc == enc && e->len == len &&
+            memcmp(e->data, body, len) == 0) {
+            list_del(&e->lru);
+            list_add(&e->lru, &g_zlru);
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/* 哈希是否在表中；不在时记入（挤掉同槽的旧值） */
+static int zseen_check(uint64_t *table, uint64_t hash)
+{
+    uint64_t *slot = &table[hash & (ZSEEN_SLOTS - 1)];
+
+    if (*slot == hash) {
+        return 1;
+    }
+    *slot = hash;
+    return 0;
+}
+
+/* 压缩并加入缓存，失败或不值得压缩返回 NULL */
+static struct zcache_entry *zcache_add(uint64_t hash, int enc, const char *body, size_t len)
+{
+    size_t bound = deflateBound(NULL, len) + 32;   /* gzip 头尾比 zlib 多 */
+    struct zcache_entry *e, *shrunk;
+    size_t zlen;
+
+    e = malloc(sizeof(*e) + len + bound);
+    if (!e) {
+        return NULL;
+    }
+    zlen = compress_buf(enc, body, len, e->data + len, bound);
+    if (!zlen || zlen >= len) {
+        if (zlen) {
+            zseen_check(g_znone, hash);
+        }
+        free(e);
+        return NULL;
+    }
+
+    shrunk = realloc(e, sizeof(*e) + len + zlen);
+    if (shrunk) {
+        e = shrunk;
+    }
+    memcpy(e->data, body, len);
+    e->zdata = e->data + len;
+    e->hash = hash;
+    e->len = len;
+    e->zlen = zlen;
+    e->enc = enc;
+
+    while (!list_empty(&g_zlru) && g_stats.cache_bytes + len + zlen > HTTP_COMPRESS_CACHE) {
+        zcache_remove(list_entry(g_zlru.prev, struct zcache_entry, lru));
+    }
+    e->next = g_zcache[hash & (ZCACHE_BUCKETS - 1)];
+    g_zcache[hash & (ZCACHE_BUCKETS - 1)] = e;
+    list_add(&e->lru, &g_zlru);
+    g_stats.cache_bytes += len + zlen;
+    return e;
+}
+
+int http_compress_body(struct http_conn *conn, int enc, const char *body, size_t len,
+                       const char **out, size_t *out_len)
+{
+    struct zcache_entry *e = NULL;
+    uint64_t hash;
+
+    if (!g_level || enc <= HTTP_ENC_IDENTITY || enc >= HTTP_ENC_MAX || len < g_min_size) {
+        return -1;
+    }
+
+    hash = zcache_hash(body, len, enc);
+    if (g_znone[hash & (ZSEEN_SLOTS - 1)] == hash) {
+        g_stats.skipped++;
+        return -1;
+    }
+
+    if (len <= HTTP_COMPRESS_ITEM_MAX) {
+        e = zcache_find(hash, enc, body, len);
+        if (e) {
+            g_stats.cache_hits++;
+        } else if (zseen_check(g_zseen, hash) && !(e = zcache_add(hash, enc, body, len))) {
+            return -1;
+        }
+    }
+
+    if (e) {
+        *out = e->zdata;
+        *out_len = e->zlen;
+    } else {
+        /* 首次出现或超过缓存上限的响应不缓存，压缩到 arena */
+        size_t bound = deflateBound(NULL, len) + 32;
+        char *buf = http_arena_alloc(&conn->arena, bound);
+        size_t zlen;
+
+        if (!buf) {
+            return -1;
+        }
+        zlen = compress_buf(enc, body, len, buf, bound);
+        if (!zlen || zlen >= len) {
+            if (zlen) {
+                zseen_check(g_znone, hash);
+            }
+            return -1;
+        }
+        *out = buf;
+        *out_len = zlen;
+    }
+
+    g_stats.bytes_in += len;
+    g_stats.bytes_out += *out_len;
+    return 0;
+}
+
+struct http_zstream {
+    z_stream z;
+};
+
+http_zstream_t *http_zstream_new(int enc)
+{
+    http_zstream_t *zs;
+
+    if (!g_level || enc <= HTTP_ENC_IDENTITY || enc >= HTTP_ENC_MAX) {
+        return NULL;
+    }
+    zs = calloc(1, sizeof(*zs));
+    if (!zs) {
+        return NULL;
+    }
+    /* 每个流式响应占用一个压缩流，用 4KB 窗口和较低的内存级别，
+     * 每连接约 32KB（默认参数约 256KB） */
+    if (deflateInit2(&zs->z, g_level, Z_DEFLATED, g_encodings[enc].window_bits - 3,
+                     5, Z_DEFAULT_STRATEGY) != Z_OK) {
+        free(zs);
+        return NULL;
+    }
+    g_stats.compressed++;
+    return zs;
+}
+
+int http_zstream_write(http_zstream_t *zs, const char *data, size_t len, int finish,
+                       void (*emit)(void *ctx, const char *out, size_t n), void *ctx)
+{
+    char out[ZSTREAM_OUT];
+    int flush = finish ? Z_FINISH : Z_NO_FLUSH;
+    int ret;
+
+    zs->z.next_in = (Bytef *)data;
+    zs->z.avail_in = len;
+    g_stats.bytes_in += len;
+
+    do {
+        zs->z.next_out = (Bytef *)out;
+        zs->z.avail_out = sizeof(out);
+        ret = deflate(&zs->z, flush);
+        if (ret == Z_STREAM_ERROR) {
+            return -1;
+        }
+        if (sizeof(out) - zs->z.avail_out) {
+            emit(ctx, out, sizeof(out) - zs->z.avail_out);
+            g_stats.bytes_out += sizeof(out) - zs->z.avail_out;
+        }
+    } while (zs->z.avail_out == 0 || (finish && ret != Z_STREAM_END));
+
+    return 0;
+}
+
+void http_zstream_free(http_zstream_t *zs)
+{
+    if (zs) {
+        deflateEnd(&zs->z);
+        free(zs);
+    }
+}
+
+void http_compress_get_stats(struct http_compress_stats *stats)
+{
+    *stats = g_stats;
+}
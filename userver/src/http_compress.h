@@ -0,0 +1,62 @@
+#ifndef HTTP_COMPRESS_H
+#define HTTP_COMPRESS_H
+
+#include "http.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* 响应压缩（zlib）
+ * - 协商：按 Accept-Encoding（含 q 值）选择 gzip / deflate；接入 brotli 时在枚举和编码表中
+ *   增加 HTTP_ENC_BR 一项并实现对应的压缩函数
+ * - 缓冲响应：http_send_response() 压缩超过阈值的文本类响应（text 类型、JSON、JS、XML、SVG），
+ *   同一 body 第二次出现时结果按内容哈希缓存（命中后逐字节比较确认），之后直接复用；
+ *   一次性的 body 压缩到 arena，压缩后不更小的 body 记下哈希不再尝试
+ * - 流式响应：http_stream_write() 的输出经 deflate 流压缩后分块发送
+ * - 静态文件：只发送预先生成的 FILE.gz（见 http_static.h），请求路径上不压缩文件 */
+
+enum {
+    HTTP_ENC_IDENTITY,
+    HTTP_ENC_GZIP,
+    HTTP_ENC_DEFLATE,
+    HTTP_ENC_MAX
+};
+
+#define HTTP_COMPRESS_MIN       1024        /* 默认阈值：更小的响应压缩收益不抵开销 */
+#define HTTP_COMPRESS_CACHE     (8 << 20)   /* 压缩结果缓存总字节（原文 + 压缩结果） */
+#define HTTP_COMPRESS_ITEM_MAX  (1 << 20)   /* 可缓存的单个响应上限 */
+
+struct http_compress_stats {
+    uint64_t compressed;            /* 实际执行压缩的次数 */
+    uint64_t cache_hits;
+    uint64_t skipped;               /* 已知压缩后不更小、直接原样发送的响应 */
+    uint64_t bytes_in;              /* 压缩前 / 后的响应字节（含缓存命中） */
+    uint64_t bytes_out;
+    size_t cache_bytes;
+};
+
+/* level 1-9，0 关闭压缩；min_size 为 0 时使用 HTTP_COMPRESS_MIN */
+void http_compress_init(int level, size_t min_size);
+
+/* Content-Encoding 取值 */
+const char *http_compress_name(int enc);
+
+/* 协商编码：未启用压缩或类型不可压缩返回 -1（响应与 Accept-Encoding 无关）；
+ * 否则返回客户端接受的最优编码，可能为 HTTP_ENC_IDENTITY（此时仍应带 Vary） */
+int http_compress_negotiate(struct http_conn *conn, const char *content_type);
+
+/* 压缩缓冲 body：结果在缓存或 conn->arena 中，只在当前回调内有效；
+ * body 小于阈值或压缩后不更小时返回 -1 */
+int http_compress_body(struct http_conn *conn, int enc, const char *body, size_t len,
+                       const char **out, size_t *out_len);
+
+/* 流式压缩：每产生一段输出调用 emit；finish 非 0 时结束压缩流 */
+typedef struct http_zstream http_zstream_t;
+
+http_zstream_t *http_zstream_new(int enc);
+int http_zstream_write(http_zstream_t *zs, const char *data, size_t len, int finish,
+                       void (*emit)(void *ctx, const char *out, size_t n), void *ctx);
+void http_zstream_free(http_zstream_t *zs);
+
+void http_compress_get_stats(struct http_compress_stats *stats);
+
+#endif // HTTP_COMPRESS_H
@@ -0,0 +1,41 @@
+#include "http_echo.h"
+
+static int echo_init(struct http_conn *conn, const char *content_type)
+{
+    return http_stream_begin(conn, 200,
+                             content_type ? content_type : "application/octet-stream");
+}
+
+static int echo_data(struct http_conn *conn, const char *data, size_t len)
+{
+    int ret = http_stream_write(conn, data, len);
+    
+    /* 客户端读得慢：停止读取请求 body，由 on_writable 恢复 */
+    if (ret == 0) {
+        http_pause_read(conn);
+    }
+    return ret < 0 ? -1 : 0;
+}
+
+static int echo_complete(struct http_conn *conn)
+{
+    return http_stream_end(conn);
+}
+
+static int echo_writable(struct http_conn *conn)
+{
+    http_resume_read(conn);
+    return 0;
+}
+
+static http_body_handler_t echo_stream_handler = {
+    .on_init = echo_init,
+    .on_data = echo_data,
+    .on_complete = echo_complete,
+    .on_writable = echo_writable,
+};
+
+http_body_handler_t *http_echo_handler_stream(void)
+{
+    return &echo_stream_handler;
+}
@@ -0,0 +1,10 @@
+#ifndef HTTP_ECHO_H
+#define HTTP_ECHO_H
+
+#include "http.h"
+
+/* 流式回显：请求 body 边收边以流式响应（chunked）写回，不缓存整个 body
+ * 写缓冲积压时暂停读取请求，排空后继续，内存占用与 body 大小无关 */
+http_body_handler_t *http_echo_handler_stream(void);
+
+#endif // HTTP_ECHO_H
@@ -1,96 +1,265 @@
 #include "http_form.h"
+#include "http_json_writer.h"
+#include "http_urldecode.h"
+#include "http_metrics.h"
+#include "http_log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 
 #define INITIAL_BUFFER_SIZE 4096
 #define MAX_BUFFER_SIZE (1 * 1024 * 1024) /* 1MB */
+#define INITIAL_FIELDS 16
 
-/* URL 解码辅助函数 */
-static int hex_to_int(char c)
+/* 字段名哈希（FNV-1a） */
+static uint32_t form_hash(const char *s, size_t len)
 {
-    if (c >= '0' && c <= '9') return c - '0';
-    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
-    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
-    return 0;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
 }
 
-static char *url_decode(const char *str, size_t len)
+/* 结束当前字段并加入索引 */
+static int form_end_field(http_arena_t *arena, http_form_ctx_t *ctx)
 {
-    char *decoded = malloc(len + 1);
-    if (!decoded) return NULL;
+    form_parser_t *p = &ctx->parser;
     
-    size_t i = 0, j = 0;
-    while (i < len) {
-        if (str[i] == '%' && i + 2 < len) {
-            decoded[j++] = (hex_to_int(str[i + 1]) << 4) | hex_to_int(str[i + 2]);
-            i += 3;
-        } else if (str[i] == '+') {
-            decoded[j++] = ' ';
-            i++;
-        } else {
-            decoded[j++] = str[i++];
+    if (p->in_value) {
+        p->cur.value_len = ctx->len - p->cur.value_off;
+    } else {
+        /* 没有 '=' 的字段（如 "flag"）：值为空 */
+        p->cur.name_off = p->tok_start;
+        p->cur.name_len = ctx->len - p->tok_start;
+        p->cur.value_off = ctx->len;
+        p->cur.value_len = 0;
+    }
+    
+    /* 跳过空字段（"a=1&&b=2"） */
+    if (p->in_value || p->cur.name_len > 0) {
+        if (ctx->count == ctx->fields_cap) {
+            uint32_t new_cap = ctx->fields_cap ? ctx->fields_cap * 2 : INITIAL_FIELDS;
+            form_field_t *fields = http_arena_realloc(arena, ctx->fields,
+                ctx->fields_cap * sizeof(*fields), new_cap * sizeof(*fields));
+            if (!fields) return -1;
+            ctx->fields = fields;
+            ctx->fields_cap = new_cap;
         }
+        ctx->fields[ctx->count++] = p->cur;
     }
-    decoded[j] = '\0';
-    return decoded;
+    
+    p->in_value = 0;
+    p->tok_start = ctx->len;
+    memset(&p->cur, 0, sizeof(p->cur));
+    return 0;
 }
 
-/* 解析 form 数据 */
-static void parse_form_data(http_form_ctx_t *ctx, const char *data, size_t len)
+/* 输出未完成的转义（"%" 或 "%X"）原样保留；严格模式下记为错误 */
+static int form_flush_escape(http_form_ctx_t *ctx)
 {
-    const char *p = data;
+    form_parser_t *p = &ctx->parser;
+    
+    if (!p->esc) return 0;
+    
+    if (ctx->strict) {
+        ctx->bad_escape = 1;
+        return -1;
+    }
+    
+    ctx->base[ctx->len++] = '%';
+    if (p->esc == 2) {
+        ctx->base[ctx->len++] = p->esc_c1;
+    }
+    p->esc = 0;
+    return 0;
+}
+
+/* 增量解析：解码输出写到 ctx->base + ctx->len
+ * 原地模式下 base 与 data 指向同一缓冲区，输出位置始终不超过读取位置
+ * 不含特殊字符的片段由 http_url_scan()（SIMD）定位后整段拷贝 */
+static int form_parse(http_arena_t *arena, http_form_ctx_t *ctx,
+                      const char *data, size_t len)
+{
+    form_parser_t *p = &ctx->parser;
+    char *out = ctx->base;
     const char *end = data + len;
+    size_t i = 0;
     
-    while (p < end) {
-        const char *name_start = p;
-        const char *name_end = strchr(p, '=');
-        if (!name_end || name_end >= end) break;
+    while (i < len) {
+        char c = data[i];
         
-        const char *value_start = name_end + 1;
-        const char *value_end = strchr(value_start, '&');
-        if (!value_end || value_end > end) {
-            value_end = end;
+        if (!p->esc && c != '&' && c != '=' && c != '%' && c != '+') {
+            const char *stop = http_url_scan(data + i + 1, end);
+            size_t run = stop - (data + i);
+            if (out + ctx->len != data + i) {
+                memmove(out + ctx->len, data + i, run);
+            }
+            ctx->len += run;
+            i += run;
+            if (i == len) break;
+            c = data[i];
         }
+        i++;
         
-        /* 创建新字段 */
-        form_field_t *field = calloc(1, sizeof(*field));
-        if (!field) break;
-        
-        field->name = url_decode(name_start, name_end - name_start);
-        field->value = url_decode(value_start, value_end - value_start);
+        if (p->esc) {
+            int v = http_url_hex[(unsigned char)c];
+            if (v >= 0 && p->esc == 1) {
+                p->esc_c1 = c;
+                p->esc = 2;
+                continue;
+            }
+            if (v >= 0) {
+                out[ctx->len++] = (char)((http_url_hex[(unsigned char)p->esc_c1] << 4) | v);
+                p->esc = 0;
+                continue;
+            }
+            /* 非法转义：按原样输出，再正常处理当前字符 */
+            if (form_flush_escape(ctx) < 0) return 0;
+        }
         
-        /* 添加到链表 */
-        field->next = ctx->fields;
-        ctx->fields = field;
+        switch (c) {
+        case '%':
+            p->esc = 1;
+            break;
+        case '+':
+            out[ctx->len++] = ' ';
+            break;
+        case '=':
+            if (!p->in_value) {
+                p->cur.name_off = p->tok_start;
+                p->cur.name_len = ctx->len - p->tok_start;
+                p->cur.value_off = ctx->len;
+                p->in_value = 1;
+            } else {
+                out[ctx->len++] = c;
+            }
+            break;
+        case '&':
+            if (form_end_field(arena, ctx) < 0) return -1;
+            break;
+        default:
+            out[ctx->len++] = c;
+            break;
+        }
+    }
+    
+    return 0;
+}
+
+/* 建立 name → 字段下标的哈希索引；重名字段以第一次出现为准 */
+static int form_build_index(http_arena_t *arena, http_form_ctx_t *ctx)
+{
+    uint32_t size = 8;
+    
+    while (size < ctx->count * 2) {
+        size *= 2;
+    }
+    
+    ctx->slots = http_arena_calloc(arena, size * sizeof(*ctx->slots));
+    if (!ctx->slots) return -1;
+    ctx->slot_mask = size - 1;
+    
+    /* 重复的字段名合并为一项：保留首次出现的位置，取最后一次的值 */
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < ctx->count; i++) {
+        const form_field_t *f = &ctx->fields[i];
+        const char *name = ctx->base + f->name_off;
+        uint32_t slot = form_hash(name, f->name_len) & ctx->slot_mask;
         
-        p = value_end + 1;
+        while (ctx->slots[slot]) {
+            form_field_t *o = &ctx->fields[ctx->slots[slot] - 1];
+            if (o->name_len == f->name_len &&
+                memcmp(ctx->base + o->name_off, name, f->name_len) == 0)
+                break;
+            slot = (slot + 1) & ctx->slot_mask;
+        }
+        if (ctx->slots[slot]) {
+            form_field_t *o = &ctx->fields[ctx->slots[slot] - 1];
+            o->value_off = f->value_off;
+            o->value_len = f->value_len;
+            continue;
+        }
+        ctx->fields[n] = *f;
+        ctx->slots[slot] = ++n;
     }
+    ctx->count = n;
+    
+    return 0;
+}
+
+const char *http_form_get(const http_form_ctx_t *ctx, const char *name,
+                          size_t name_len, size_t *value_len)
+{
+    if (!ctx || !ctx->slots) return NULL;
+    
+    uint32_t slot = form_hash(name, name_len) & ctx->slot_mask;
+    while (ctx->slots[slot]) {
+        const form_field_t *f = &ctx->fields[ctx->slots[slot] - 1];
+        if (f->name_len == name_len &&
+            memcmp(ctx->base + f->name_off, name, name_len) == 0) {
+            if (value_len) *value_len = f->value_len;
+            return ctx->base + f->value_off;
+        }
+        slot = (slot + 1) & ctx->slot_mask;
+    }
+    
+    return NULL;
 }
 
 /* Form 处理器：初始化 */
-static int form_init(struct http_conn *conn, const char *content_type)
+static int form_init_mode(struct http_conn *conn, const char *content_type, int strict)
 {
     if (!content_type || 
         strstr(content_type, "application/x-www-form-urlencoded") == NULL) {
         return 0;
     }
     
-    http_form_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    http_form_ctx_t *ctx = http_arena_calloc(&conn->arena, sizeof(*ctx));
     if (!ctx) return -1;
     
-    ctx->buffer_cap = INITIAL_BUFFER_SIZE;
-    ctx->buffer = malloc(ctx->buffer_cap);
-    if (!ctx->buffer) {
-        free(ctx);
-        return -1;
-    }
+    /* Content-Length 已知时用于判断 body 是否在一次读取中完整到达 */
+    ctx->expected = conn->parser.content_length;
+    ctx->strict = strict;
     
     conn->body_ctx = ctx;
     return 0;
 }
 
+static int form_init(struct http_conn *conn, const char *content_type)
+{
+    return form_init_mode(conn, content_type, 0);
+}
+
+static int form_init_strict(struct http_conn *conn, const char *content_type)
+{
+    return form_init_mode(conn, content_type, 1);
+}
+
+/* 确保 storage 能容纳 extra 字节解码输出 */
+static int form_reserve(http_arena_t *arena, http_form_ctx_t *ctx, size_t extra)
+{
+    size_t need = ctx->len + extra;
+    
+    if (need <= ctx->cap) return 0;
+    
+    size_t new_cap = ctx->cap ? ctx->cap * 2 : INITIAL_BUFFER_SIZE;
+    if (ctx->expected && ctx->expected + 2 > new_cap) {
+        new_cap = ctx->expected + 2;
+    }
+    while (new_cap < need) {
+        new_cap *= 2;
+    }
+    
+    char *buf = http_arena_realloc(arena, ctx->base, ctx->len, new_cap);
+    if (!buf) return -1;
+    
+    ctx->base = buf;
+    ctx->cap = new_cap;
+    return 0;
+}
+
 /* Form 处理器：接收数据 */
 static int form_data(struct http_conn *conn, const char *data, size_t len)
 {
@@ -98,34 +267,42 @@ static int form_data(struct http_conn *conn, const char *data, size_t len)
     if (!ctx) return 0;
     
     /* 如果已经出错，跳过后续数据 */
-    if (conn->parse_error) return 0;
+    if (conn->parse_error || ctx->bad_escape) return 0;
     
     /* 检查容量 */
-    if (ctx->buffer_len + len > MAX_BUFFER_SIZE) {
-        fprintf(stderr, "Form body too large\n");
+    if (ctx->received + len > MAX_BUFFER_SIZE) {
+        http_metrics_error(HTTP_ERR_BODY_SIZE);
+        http_log_error("form", "body too large");
         conn->parse_error = 1;
         return 0; /* 继续解析 HTTP */
     }
     
-    /* 扩容 */
-    if (ctx->buffer_len + len + 1 > ctx->buffer_cap) {
-        size_t new_cap = ctx->buffer_cap * 2;
-        while (new_cap < ctx->buffer_len + len + 1) {
-            new_cap *= 2;
-        }
-        
-        char *new_buf = realloc(ctx->buffer, new_cap);
-        if (!new_buf) return -1;
-        
-        ctx->buffer = new_buf;
-        ctx->buffer_cap = new_cap;
+    if (ctx->received == 0 && ctx->expected == len && !conn->h2s) {
+        /* 完整 body 在同一次 llhttp_execute 中到达，on_complete 返回前
+         * ustream 缓冲区不会被 consume，可直接原地解码；
+         * HTTP/2 的 data 只在回调内有效，END_STREAM 可能在之后的帧中才到达，总是拷贝 */
+        ctx->in_place = 1;
+        ctx->base = (char *)data;
+        ctx->len = 0;
+    } else if (form_reserve(&conn->arena, ctx, len + 2) < 0) {
+        return -1;
     }
     
-    memcpy(ctx->buffer + ctx->buffer_len, data, len);
-    ctx->buffer_len += len;
-    ctx->buffer[ctx->buffer_len] = '\0';
+    ctx->received += len;
+    return form_parse(&conn->arena, ctx, data, len);
+}
+
+/* 结束最后一个字段并建立索引 */
+static int form_finish(struct http_conn *conn, http_form_ctx_t *ctx)
+{
+    form_parser_t *p = &ctx->parser;
+    
+    if (form_flush_escape(ctx) < 0) return 0;
+    if (p->in_value || ctx->len > p->tok_start) {
+        if (form_end_field(&conn->arena, ctx) < 0) return -1;
+    }
     
-    return 0;
+    return form_build_index(&conn->arena, ctx);
 }
 
 /* Form 处理器：完成 */
@@ -135,69 +312,61 @@ static int form_complete(struct http_conn *conn)
     
     /* 检查是否有解析错误 */
     if (conn->parse_error) {
-        conn->status_code = 400;
-        conn->response_body = strdup("{\"error\":\"Form body too large\",\"status\":\"error\"}");
-        conn->response_body_len = strlen(conn->response_body);
-        conn->response_content_type = "application/json";
+        http_set_response(conn, 400, "application/json",
+                          HTTP_STATIC_BODY("{\"error\":\"Form body too large\",\"status\":\"error\"}"));
         return 0;
     }
     
-    if (!ctx || !ctx->buffer || ctx->buffer_len == 0) {
-        conn->status_code = 200;
-        conn->response_body = strdup("{\"status\":\"ok\",\"message\":\"HTTP Form Server\"}");
-        conn->response_body_len = strlen(conn->response_body);
-        conn->response_content_type = "application/json";
+    if (!ctx || ctx->received == 0) {
+        http_set_response(conn, 200, "application/json",
+                          HTTP_STATIC_BODY("{\"status\":\"ok\",\"message\":\"HTTP Form Server\"}"));
         return 0;
     }
     
-    /* 解析 form 数据 */
-    parse_form_data(ctx, ctx->buffer, ctx->buffer_len);
-    
-    /* 构建 JSON 响应 */
-    json_object *response = json_object_new_object();
-    json_object_object_add(response, "status", json_object_new_string("ok"));
-    json_object_object_add(response, "type", json_object_new_string("form-urlencoded"));
+    if (form_finish(conn, ctx) < 0) {
+        return -1;
+    }
     
-    json_object *fields_obj = json_object_new_object();
-    form_field_t *field = ctx->fields;
-    while (field) {
-        json_object_object_add(fields_obj, field->name, 
-                              json_object_new_string(field->value));
-        field = field->next;
+    if (ctx->bad_escape) {
+        http_metrics_error(HTTP_ERR_BODY);
+        http_set_response(conn, 400, "application/json",
+                          HTTP_STATIC_BODY("{\"error\":\"Malformed percent-encoding\",\"status\":\"error\"}"));
+        return 0;
     }
-    json_object_object_add(response, "fields", fields_obj);
     
-    const char *response_str = json_object_to_json_string_ext(
-        response, JSON_C_TO_STRING_PLAIN);
-    conn->response_body = strdup(response_str);
-    conn->response_body_len = strlen(response_str);
-    conn->status_code = 200;
-    conn->response_content_type = "application/json";
+    /* 直接写出 JSON 响应：字段名和值引用解码后的 body，不构建 json_object */
+    http_json_writer_t w;
+    const char *body;
+    size_t body_len;
+    
+    http_jw_init(&w, &conn->arena, ctx->len + ctx->count * 8 + 64);
+    http_jw_object_begin(&w);
+    http_jw_key(&w, HTTP_JW_LIT("status"));
+    http_jw_string(&w, HTTP_JW_LIT("ok"));
+    http_jw_key(&w, HTTP_JW_LIT("type"));
+    http_jw_string(&w, HTTP_JW_LIT("form-urlencoded"));
+    http_jw_key(&w, HTTP_JW_LIT("fields"));
+    http_jw_object_begin(&w);
+    for (uint32_t i = 0; i < ctx->count; i++) {
+        const form_field_t *f = &ctx->fields[i];
+        http_jw_key(&w, ctx->base + f->name_off, f->name_len);
+        http_jw_string(&w, ctx->base + f->value_off, f->value_len);
+    }
+    http_jw_object_end(&w);
+    http_jw_object_end(&w);
     
-    json_object_put(response);
+    if (http_jw_finish(&w, &body, &body_len) < 0) {
+        http_set_response(conn, 500, "application/json",
+                          HTTP_STATIC_BODY("{\"error\":\"Out of memory\",\"status\":\"error\"}"));
+        return 0;
+    }
+    http_set_response(conn, 200, "application/json", body, body_len);
     return 0;
 }
 
-/* Form 处理器：清理 */
+/* Form 处理器：清理（字段、索引、storage 均在请求 arena 中，随请求整体回收） */
 static void form_cleanup(struct http_conn *conn)
 {
-    http_form_ctx_t *ctx = (http_form_ctx_t *)conn->body_ctx;
-    if (!ctx) return;
-    
-    /* 清理字段链表 */
-    form_field_t *field = ctx->fields;
-    while (field) {
-        form_field_t *next = field->next;
-        free(field->name);
-        free(field->value);
-        free(field);
-        field = next;
-    }
-    
-    if (ctx->buffer) {
-        free(ctx->buffer);
-    }
-    free(ctx);
     conn->body_ctx = NULL;
 }
 
@@ -208,8 +377,19 @@ static http_body_handler_t form_urlencoded_handler = {
     .on_cleanup = form_cleanup,
 };
 
+static http_body_handler_t form_urlencoded_strict_handler = {
+    .on_init = form_init_strict,
+    .on_data = form_data,
+    .on_complete = form_complete,
+    .on_cleanup = form_cleanup,
+};
+
 http_body_handler_t *http_form_handler_urlencoded(void)
 {
     return &form_urlencoded_handler;
 }
 
+http_body_handler_t *http_form_handler_urlencoded_strict(void)
+{
+    return &form_urlencoded_strict_handler;
+}
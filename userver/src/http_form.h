@@ -2,25 +2,58 @@
 #define HTTP_FORM_H
 
 #include "http.h"
-#include <json-c/json.h>
+#include <stdint.h>
 
-/* Form 键值对 */
-typedef struct form_field {
-    char *name;
-    char *value;
-    struct form_field *next;
+/* Form 字段：相对 http_form_ctx_t.base 的偏移（已完成 URL 解码，不以 '\0' 结尾） */
+typedef struct {
+    uint32_t name_off;
+    uint32_t name_len;
+    uint32_t value_off;
+    uint32_t value_len;
 } form_field_t;
 
+/* 流式解析状态 */
+typedef struct {
+    int in_value;           /* 0: 正在解析 name；1: 正在解析 value */
+    int esc;                /* 百分号转义进度：0 无，1 已读 '%'，2 已读 '%X' */
+    char esc_c1;            /* 转义的第一个十六进制字符 */
+    uint32_t tok_start;     /* 当前 token 在输出中的起始偏移 */
+    form_field_t cur;       /* 正在解析的字段 */
+} form_parser_t;
+
 /* Form body 上下文 */
 typedef struct {
+    /* 解码后的字段数据：
+     * - 单次读取即收到完整 body 时，直接在 ustream 缓冲区中原地解码（零拷贝）
+     * - body 跨多次读取时，解码到 arena 中的 storage */
+    char *base;
+    size_t len;             /* base 中已解码的字节数 */
+    size_t cap;             /* storage 容量（原地模式为 0） */
+    size_t received;        /* 已接收的原始 body 字节数 */
+    uint64_t expected;      /* Content-Length（未知为 0） */
+    int in_place;
+    int strict;             /* 严格模式：非法转义直接拒绝 */
+    int bad_escape;         /* 严格模式下检测到非法转义 */
+    
+    form_parser_t parser;
+    
+    /* 字段索引：数组 + 开放寻址哈希（name → 下标 + 1） */
     form_field_t *fields;
-    char *buffer;
-    size_t buffer_len;
-    size_t buffer_cap;
+    uint32_t count;
+    uint32_t fields_cap;
+    uint32_t *slots;
+    uint32_t slot_mask;
 } http_form_ctx_t;
 
 /* 获取 Form body 处理器（application/x-www-form-urlencoded） */
 http_body_handler_t *http_form_handler_urlencoded(void);
 
-#endif // HTTP_FORM_H
+/* 严格模式：非法百分号转义返回 400，而不是原样保留 */
+http_body_handler_t *http_form_handler_urlencoded_strict(void);
+
+/* 按名字查找字段（O(1)），未找到返回 NULL；value_len 返回值长度
+ * 重复的字段名只保留一项，值取最后一次出现的 */
+const char *http_form_get(const http_form_ctx_t *ctx, const char *name,
+                          size_t name_len, size_t *value_len);
 
+#endif // HTTP_FORM_H
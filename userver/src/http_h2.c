@@ -0,0 +1,1075 @@
+#include <stdlib.h>
+#include <string.h>
+#include <libubox/list.h>
+#include <libubox/utils.h>
+#include "http_h2.h"
+#include "http_hpack.h"
+
+/* 帧类型 */
+enum {
+    H2_DATA,
+    H2_HEADERS,
+    H2_PRIORITY,
+    H2_RST_STREAM,
+    H2_SETTINGS,
+    H2_PUSH_PROMISE,
+    H2_PING,
+    H2_GOAWAY,
+    H2_WINDOW_UPDATE,
+    H2_CONTINUATION,
+};
+
+#define H2_FLAG_END_STREAM      0x01
+#define H2_FLAG_ACK             0x01
+#define H2_FLAG_END_HEADERS     0x04
+#define H2_FLAG_PADDED          0x08
+#define H2_FLAG_PRIORITY        0x20
+
+#define H2_SETTINGS_HEADER_TABLE_SIZE       1
+#define H2_SETTINGS_ENABLE_PUSH             2
+#define H2_SETTINGS_MAX_CONCURRENT_STREAMS  3
+#define H2_SETTINGS_INITIAL_WINDOW_SIZE     4
+#define H2_SETTINGS_MAX_FRAME_SIZE          5
+
+#define H2_DEFAULT_WINDOW       65535
+#define H2_WINDOW_MAX           0x7fffffff
+#define H2_IOV_MAX              16          /* 一个 DATA 帧最多拼接的发送段数 */
+
+/* 响应 body 的发送段：引用调用方的数据，或拷贝在 buf 中 */
+struct h2_seg {
+    struct h2_seg *next;
+    const char *data;
+    size_t len;
+    char buf[];
+};
+
+struct http_h2_stream {
+    struct list_head list;
+    struct http_h2 *h2;
+    uint32_t id;
+    void *user;
+    int closed;                     /* 正在回调 close，流接口不再生效 */
+
+    /* 接收：rx_window 为我方授予、尚未用掉的窗口，rx_unacked 为已交付未归还的字节 */
+    int64_t rx_window;
+    uint32_t rx_unacked;
+    char *rx_buf;                   /* 暂停期间收到的 body（不超过一个窗口，占着连接窗口） */
+    size_t rx_len;
+    size_t rx_cap;
+    int rx_paused;
+    int rx_resume;                  /* 已恢复，等 pump 交付缓存的数据 */
+    int rx_discard;                 /* 调用方不再接收 body */
+    int rx_end;                     /* 收到 END_STREAM */
+    int rx_end_pending;             /* END_STREAM 排在缓存的数据之后，尚未回调 end */
+
+    /* 发送 */
+    int64_t tx_window;
+    struct h2_seg *tx_head;
+    struct h2_seg *tx_tail;
+    size_t tx_queued;
+    int tx_headers;                 /* 已发出响应头 */
+    int tx_end;                     /* 响应已全部排队 */
+    int tx_closed;                  /* 已发出 END_STREAM */
+    int tx_wrote;                   /* 本轮 pump 有数据发出，结束时回调 writable */
+    int reset;                      /* 待发出的 RST_STREAM */
+    uint32_t reset_code;
+};
+
+struct http_h2 {
+    const struct http_h2_ops *ops;
+    void *ctx;
+    struct list_head streams;
+    int nstreams;
+    uint32_t last_id;               /* 已见过的最大客户端流 ID */
+    int dead;                       /* 已发出 GOAWAY，不再处理输入 */
+    int settings_rx;                /* 收到客户端的首个 SETTINGS */
+
+    /* 输入：连接序言校验进度、不完整的帧 */
+    size_t preface;
+    size_t in_len;
+    uint8_t in_buf[9 + HTTP_H2_FRAME_SIZE];
+
+    /* 请求头块：HEADERS 之后须紧跟同一个流的 CONTINUATION，直到 END_HEADERS */
+    uint8_t *hbuf;
+    size_t hlen;
+    size_t hcap;
+    uint32_t hstream;
+    uint8_t hflags;
+    struct http_hpack hpack;
+
+    /* 流量控制 */
+    int64_t tx_window;
+    uint32_t peer_window;           /* 对端的 SETTINGS_INITIAL_WINDOW_SIZE */
+    int64_t rx_window;              /* 连接级：我方授予、尚未用掉的窗口 */
+    uint32_t rx_unacked;            /* 连接级：已交付或丢弃、尚未归还的字节 */
+    size_t rx_held;                 /* 各流缓存 body 占用的内存（rx_cap 之和） */
+    uint32_t resets_rx;             /* 客户端重置的流，正常完成的流抵消一个 */
+
+    int in_pump;
+    int pump_again;
+};
+
+static struct http_h2_stats g_h2_stats;
+
+static inline uint32_t h2_get24(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+}
+
+static inline uint32_t h2_get32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void h2_put32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static void h2_frame_header(uint8_t *p, size_t len, uint8_t type, uint8_t flags, uint32_t id)
+{
+    p[0] = len >> 16;
+    p[1] = len >> 8;
+    p[2] = len;
+    p[3] = type;
+    p[4] = flags;
+    h2_put32(p + 5, id & H2_WINDOW_MAX);
+}
+
+static void h2_send_frame(struct http_h2 *h2, uint8_t type, uint8_t flags, uint32_t id,
+                          const void *payload, size_t len)
+{
+    uint8_t hdr[9];
+    struct iovec iov[2] = {
+        { .iov_base = hdr, .iov_len = 9 },
+        { .iov_base = (void *)payload, .iov_len = len },
+    };
+
+    h2_frame_header(hdr, len, type, flags, id);
+    h2->ops->send(h2->ctx, iov, len ? 2 : 1);
+}
+
+static void h2_send_u32(struct http_h2 *h2, uint8_t type, uint32_t id, uint32_t v)
+{
+    uint8_t payload[4];
+
+    h2_put32(payload, v);
+    h2_send_frame(h2, type, 0, id, payload, 4);
+}
+
+/* 连接级错误：发出 GOAWAY，之后的输入都丢弃 */
+static int h2_error(struct http_h2 *h2, uint32_t code)
+{
+    uint8_t payload[8];
+
+    if (!h2->dead) {
+        h2_put32(payload, h2->last_id);
+        h2_put32(payload + 4, code);
+        h2_send_frame(h2, H2_GOAWAY, 0, 0, payload, 8);
+        h2->dead = 1;
+        g_h2_stats.errors++;
+    }
+    return -1;
+}
+
+/* ============ 流 ============ */
+
+static struct http_h2_stream *h2_stream_find(struct http_h2 *h2, uint32_t id)
+{
+    struct http_h2_stream *st;
+
+    list_for_each_entry(st, &h2->streams, list) {
+        if (st->id == id) {
+            return st;
+        }
+    }
+    return NULL;
+}
+
+/* 归还连接窗口：body 离开引擎（交付、丢弃或随流释放）后才归还，攒到半个窗口再发；
+ * 暂停的流缓存的 body 一直占着连接窗口，一个连接缓存的数据不超过 HTTP_H2_CONN_WINDOW */
+static void h2_conn_credit(struct http_h2 *h2, size_t len)
+{
+    h2->rx_unacked += len;
+    if (h2->rx_unacked < HTTP_H2_CONN_WINDOW / 2) {
+        return;
+    }
+    if (!h2->dead) {
+        h2_send_u32(h2, H2_WINDOW_UPDATE, 0, h2->rx_unacked);
+    }
+    h2->rx_window += h2->rx_unacked;
+    h2->rx_unacked = 0;
+}
+
+/* 流的缓存换成 cap 字节，把 session 的缓存总量报给调用方（计入接收缓冲区预算） */
+static void h2_rx_held(struct http_h2 *h2, struct http_h2_stream *st, size_t cap)
+{
+    h2->rx_held = h2->rx_held - st->rx_cap + cap;
+    st->rx_cap = cap;
+    h2->ops->rx_held(h2->ctx, h2->rx_held);
+}
+
+static void h2_stream_close(struct http_h2 *h2, struct http_h2_stream *st)
+{
+    struct h2_seg *seg, *next;
+
+    list_del(&st->list);
+    h2->nstreams--;
+
+    /* 引用的数据属于调用方，先于 close 回调丢弃 */
+    for (seg = st->tx_head; seg; seg = next) {
+        next = seg->next;
+        free(seg);
+    }
+    if (st->rx_cap) {
+        h2_conn_credit(h2, st->rx_len);
+        h2_rx_held(h2, st, 0);
+    }
+    free(st->rx_buf);
+
+    st->closed = 1;
+    if (st->user) {
+        h2->ops->close(st->user);
+    }
+    free(st);
+}
+
+static void h2_stream_reset_now(struct http_h2 *h2, struct http_h2_stream *st, uint32_t code)
+{
+    if (!h2->dead) {
+        h2_send_u32(h2, H2_RST_STREAM, st->id, code);
+    }
+    g_h2_stats.resets++;
+    h2_stream_close(h2, st);
+}
+
+/* 已发出 END_STREAM：请求也已结束时正常关闭，否则不再接收剩余的请求 body（RFC 9113 8.1） */
+static void h2_stream_done(struct http_h2 *h2, struct http_h2_stream *st)
+{
+    if (st->rx_end) {
+        if (h2->resets_rx) {
+            h2->resets_rx--;
+        }
+        h2_stream_close(h2, st);
+    } else {
+        h2_stream_reset_now(h2, st, HTTP_H2_NO_ERROR);
+    }
+}
+
+/* 归还已交付数据的流窗口（攒到半个窗口再发，暂停或已结束的流不归还） */
+static void h2_stream_credit(struct http_h2 *h2, struct http_h2_stream *st)
+{
+    if (st->rx_paused || st->rx_end || st->rx_unacked < HTTP_H2_STREAM_WINDOW / 2) {
+        return;
+    }
+    h2_send_u32(h2, H2_WINDOW_UPDATE, st->id, st->rx_unacked);
+    st->rx_window += st->rx_unacked;
+    st->rx_unacked = 0;
+}
+
+/* 交付 body：暂停中或已有缓存的数据时追加到缓存，保持顺序 */
+static void h2_stream_rx(struct http_h2 *h2, struct http_h2_stream *st,
+                         const char *data, size_t len, int end)
+{
+    if (len && st->rx_discard) {
+        st->rx_unacked += len;
+        h2_conn_credit(h2, len);
+    } else if (len && (st->rx_paused || st->rx_len)) {
+        if (st->rx_len + len > st->rx_cap) {
+            size_t cap = st->rx_cap ? st->rx_cap : 4096;
+            char *p;
+
+            while (cap < st->rx_len + len) {
+                cap <<= 1;
+            }
+            p = realloc(st->rx_buf, cap);
+            if (!p) {
+                st->reset = 1;
+                st->reset_code = HTTP_H2_INTERNAL_ERROR;
+                h2_conn_credit(h2, len);
+                return;
+            }
+            st->rx_buf = p;
+            h2_rx_held(h2, st, cap);
+        }
+        memcpy(st->rx_buf + st->rx_len, data, len);
+        st->rx_len += len;
+    } else if (len) {
+        int ret = h2->ops->data(st->user, data, len);
+
+        st->rx_unacked += len;
+        h2_conn_credit(h2, len);
+        if (ret > 0) {
+            st->rx_paused = 1;
+        } else if (ret < 0) {
+            st->rx_discard = 1;
+        }
+    }
+
+    if (end) {
+        st->rx_end = 1;
+        if (st->rx_paused || st->rx_len) {
+            st->rx_end_pending = 1;
+        } else if (!st->rx_discard) {
+            h2->ops->end(st->user);
+        }
+    }
+    h2_stream_credit(h2, st);
+}
+
+/* ============ 输入 ============ */
+
+static void h2_emit(void *ctx, const char *name, size_t name_len,
+                    const char *value, size_t value_len)
+{
+    struct http_h2_stream *st = ctx;
+
+    /* ctx 为 NULL：被拒绝的流或 trailer，只为保持 HPACK 动态表同步 */
+    if (st) {
+        st->h2->ops->header(st->user, name, name_len, value, value_len);
+    }
+}
+
+/* 完整的请求头块：新流或 trailer（须带 END_STREAM） */
+static int h2_headers_complete(struct http_h2 *h2)
+{
+    uint32_t id = h2->hstream;
+    int end = h2->hflags & H2_FLAG_END_STREAM;
+    struct http_h2_stream *st = h2_stream_find(h2, id);
+
+    h2->hstream = 0;
+
+    if (st || id <= h2->last_id) {
+        /* trailer 不交给调用方；已关闭的流只解码 */
+        if (http_hpack_decode(&h2->hpack, h2->hbuf, h2->hlen, h2_emit, NULL) < 0) {
+            return h2_error(h2, HTTP_H2_COMPRESSION_ERROR);
+        }
+        if (!st) {
+            return 0;
+        }
+        if (st->rx_end || !end) {
+            h2_stream_reset_now(h2, st, st->rx_end ? HTTP_H2_STREAM_CLOSED : HTTP_H2_PROTOCOL_ERROR);
+            return 0;
+        }
+        h2_stream_rx(h2, st, NULL, 0, 1);
+        return 0;
+    }
+
+    if (!(id & 1)) {
+        return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+    }
+    h2->last_id = id;
+
+    if (h2->nstreams < HTTP_H2_MAX_STREAMS) {
+        st = calloc(1, sizeof(*st));
+    }
+    if (st) {
+        st->h2 = h2;
+        st->id = id;
+        st->rx_window = HTTP_H2_STREAM_WINDOW;
+        st->tx_window = h2->peer_window;
+        list_add_tail(&st->list, &h2->streams);
+        h2->nstreams++;
+        st->user = h2->ops->open(h2->ctx, st);
+        if (!st->user) {
+            list_del(&st->list);
+            h2->nstreams--;
+            free(st);
+            st = NULL;
+        }
+    }
+
+    if (http_hpack_decode(&h2->hpack, h2->hbuf, h2->hlen, h2_emit, st) < 0) {
+        /* 流在 http_h2_free 中随连接关闭 */
+        return h2_error(h2, HTTP_H2_COMPRESSION_ERROR);
+    }
+    if (!st) {
+        h2_send_u32(h2, H2_RST_STREAM, id, HTTP_H2_REFUSED_STREAM);
+        g_h2_stats.resets++;
+        return 0;
+    }
+
+    g_h2_stats.streams++;
+    if (h2->ops->headers_done(st->user) < 0) {
+        st->rx_discard = 1;
+    }
+    if (end) {
+        h2_stream_rx(h2, st, NULL, 0, 1);
+    }
+    return 0;
+}
+
+static int h2_headers_append(struct http_h2 *h2, const uint8_t *p, size_t len)
+{
+    if (h2->hlen + len > HTTP_H2_HEADERS_MAX) {
+        return h2_error(h2, HTTP_H2_ENHANCE_YOUR_CALM);
+    }
+    if (h2->hlen + len > h2->hcap) {
+        size_t cap = h2->hcap ? h2->hcap : 4096;
+        uint8_t *buf;
+
+        while (cap < h2->hlen + len) {
+            cap <<= 1;
+        }
+        buf = realloc(h2->hbuf, cap);
+        if (!buf) {
+            return h2_error(h2, HTTP_H2_INTERNAL_ERROR);
+        }
+        h2->hbuf = buf;
+        h2->hcap = cap;
+    }
+    memcpy(h2->hbuf + h2->hlen, p, len);
+    h2->hlen += len;
+    return 0;
+}
+
+/* 去掉 PADDED 帧的填充，填充长度非法返回 -1 */
+static int h2_unpad(uint8_t flags, const uint8_t **p, size_t *len)
+{
+    size_t pad;
+
+    if (!(flags & H2_FLAG_PADDED)) {
+        return 0;
+    }
+    if (*len < 1) {
+        return -1;
+    }
+    pad = (*p)[0];
+    if (pad >= *len) {
+        return -1;
+    }
+    (*p)++;
+    *len -= pad + 1;
+    return 0;
+}
+
+static int h2_on_data(struct http_h2 *h2, uint8_t flags, uint32_t id, const uint8_t *p, size_t len)
+{
+    struct http_h2_stream *st;
+    size_t flen = len;
+
+    if (id == 0) {
+        return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+    }
+    if (h2_unpad(flags, &p, &len) < 0) {
+        return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+    }
+
+    /* 连接窗口：整个帧（含填充）计入；丢弃的帧和填充直接归还，body 离开引擎后归还 */
+    if ((int64_t)flen > h2->rx_window) {
+        return h2_error(h2, HTTP_H2_FLOW_CONTROL_ERROR);
+    }
+    h2->rx_window -= flen;
+
+    st = h2_stream_find(h2, id);
+    if (!st) {
+        /* 已重置的流上还在路上的数据直接丢弃 */
+        if (id > h2->last_id) {
+            return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+        }
+        h2_conn_credit(h2, flen);
+        return 0;
+    }
+    if (st->rx_end) {
+        h2_conn_credit(h2, flen);
+        h2_stream_reset_now(h2, st, HTTP_H2_STREAM_CLOSED);
+        return 0;
+    }
+    if ((int64_t)flen > st->rx_window) {
+        h2_conn_credit(h2, flen);
+        h2_stream_reset_now(h2, st, HTTP_H2_FLOW_CONTROL_ERROR);
+        return 0;
+    }
+    st->rx_window -= flen;
+    st->rx_unacked += flen - len;       /* 填充不交付，直接归还 */
+    h2_conn_credit(h2, flen - len);
+
+    h2_stream_rx(h2, st, (const char *)p, len, flags & H2_FLAG_END_STREAM);
+    return 0;
+}
+
+static int h2_on_headers(struct http_h2 *h2, uint8_t flags, uint32_t id, const uint8_t *p, size_t len)
+{
+    if (id == 0) {
+        return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+    }
+    if (h2_unpad(flags, &p, &len) < 0) {
+        return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+    }
+    /* 优先级字段忽略 */
+    if (flags & H2_FLAG_PRIORITY) {
+        if (len < 5) {
+            return h2_error(h2, HTTP_H2_FRAME_SIZE_ERROR);
+        }
+        p += 5;
+        len -= 5;
+    }
+
+    h2->hlen = 0;
+    h2->hstream = id;
+    h2->hflags = flags;
+    if (h2_headers_append(h2, p, len) < 0) {
+        return -1;
+    }
+    return (flags & H2_FLAG_END_HEADERS) ? h2_headers_complete(h2) : 0;
+}
+
+static int h2_on_settings(struct http_h2 *h2, uint8_t flags, uint32_t id, const uint8_t *p, size_t len)
+{
+    struct http_h2_stream *st;
+
+    if (id != 0) {
+        return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+    }
+    if (flags & H2_FLAG_ACK) {
+        return len ? h2_error(h2, HTTP_H2_FRAME_SIZE_ERROR) : 0;
+    }
+    if (len % 6) {
+        return h2_error(h2, HTTP_H2_FRAME_SIZE_ERROR);
+    }
+
+    for (; len; p += 6, len -= 6) {
+        uint32_t v = h2_get32(p + 2);
+
+        switch ((p[0] << 8) | p[1]) {
+        case H2_SETTINGS_ENABLE_PUSH:
+            if (v > 1) {
+                return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+            }
+            break;
+        case H2_SETTINGS_INITIAL_WINDOW_SIZE:
+            if (v > H2_WINDOW_MAX) {
+                return h2_error(h2, HTTP_H2_FLOW_CONTROL_ERROR);
+            }
+            /* 已打开的流按差值调整（可能变为负数） */
+            list_for_each_entry(st, &h2->streams, list) {
+                st->tx_window += (int64_t)v - h2->peer_window;
+            }
+            h2->peer_window = v;
+            break;
+        case H2_SETTINGS_MAX_FRAME_SIZE:
+            /* 发送总是用默认的 16384 */
+            if (v < 16384 || v > 16777215) {
+                return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+            }
+            break;
+        }
+        /* HEADER_TABLE_SIZE：编码端不使用动态表；其余设置与服务端无关 */
+    }
+
+    h2->settings_rx = 1;
+    h2_send_frame(h2, H2_SETTINGS, H2_FLAG_ACK, 0, NULL, 0);
+    return 0;
+}
+
+static int h2_on_window_update(struct http_h2 *h2, uint32_t id, const uint8_t *p, size_t len)
+{
+    struct http_h2_stream *st;
+    uint32_t incr;
+
+    if (len != 4) {
+        return h2_error(h2, HTTP_H2_FRAME_SIZE_ERROR);
+    }
+    incr = h2_get32(p) & H2_WINDOW_MAX;
+
+    if (id == 0) {
+        if (incr == 0 || h2->tx_window + incr > H2_WINDOW_MAX) {
+            return h2_error(h2, incr ? HTTP_H2_FLOW_CONTROL_ERROR : HTTP_H2_PROTOCOL_ERROR);
+        }
+        h2->tx_window += incr;
+        return 0;
+    }
+
+    st = h2_stream_find(h2, id);
+    if (!st) {
+        return id > h2->last_id ? h2_error(h2, HTTP_H2_PROTOCOL_ERROR) : 0;
+    }
+    if (incr == 0 || st->tx_window + incr > H2_WINDOW_MAX) {
+        h2_stream_reset_now(h2, st, incr ? HTTP_H2_FLOW_CONTROL_ERROR : HTTP_H2_PROTOCOL_ERROR);
+        return 0;
+    }
+    st->tx_window += incr;
+    return 0;
+}
+
+/* 处理一个完整的帧 */
+static int h2_frame_in(struct http_h2 *h2, const uint8_t *hdr, const uint8_t *p)
+{
+    size_t len = h2_get24(hdr);
+    uint8_t type = hdr[3];
+    uint8_t flags = hdr[4];
+    uint32_t id = h2_get32(hdr + 5) & H2_WINDOW_MAX;
+    struct http_h2_stream *st;
+
+    /* 序言之后的第一个帧必须是 SETTINGS */
+    if (!h2->settings_rx && type != H2_SETTINGS) {
+        return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+    }
+    /* 请求头块未结束时只能是同一个流的 CONTINUATION */
+    if (h2->hstream && (type != H2_CONTINUATION || id != h2->hstream)) {
+        return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+    }
+
+    switch (type) {
+    case H2_DATA:
+        return h2_on_data(h2, flags, id, p, len);
+
+    case H2_HEADERS:
+        return h2_on_headers(h2, flags, id, p, len);
+
+    case H2_CONTINUATION:
+        if (!h2->hstream) {
+            return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+        }
+        if (h2_headers_append(h2, p, len) < 0) {
+            return -1;
+        }
+        return (flags & H2_FLAG_END_HEADERS) ? h2_headers_complete(h2) : 0;
+
+    case H2_PRIORITY:
+        if (id == 0) {
+            return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+        }
+        return len == 5 ? 0 : h2_error(h2, HTTP_H2_FRAME_SIZE_ERROR);
+
+    case H2_RST_STREAM:
+        if (id == 0 || id > h2->last_id) {
+            return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+        }
+        if (len != 4) {
+            return h2_error(h2, HTTP_H2_FRAME_SIZE_ERROR);
+        }
+        st = h2_stream_find(h2, id);
+        if (st) {
+            g_h2_stats.resets++;
+            h2_stream_close(h2, st);
+            /* 快速重置（打开流后立即重置）：每个流都要走一遍打开和清理，重置过多时关闭连接 */
+            if (++h2->resets_rx > HTTP_H2_MAX_RESETS) {
+                return h2_error(h2, HTTP_H2_ENHANCE_YOUR_CALM);
+            }
+        }
+        return 0;
+
+    case H2_SETTINGS:
+        return h2_on_settings(h2, flags, id, p, len);
+
+    case H2_PING:
+        if (id != 0) {
+            return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+        }
+        if (len != 8) {
+            return h2_error(h2, HTTP_H2_FRAME_SIZE_ERROR);
+        }
+        if (!(flags & H2_FLAG_ACK)) {
+            h2_send_frame(h2, H2_PING, H2_FLAG_ACK, 0, p, 8);
+        }
+        return 0;
+
+    case H2_GOAWAY:
+        /* 客户端不再发起新流，已有的流照常完成 */
+        return id ? h2_error(h2, HTTP_H2_PROTOCOL_ERROR) : 0;
+
+    case H2_WINDOW_UPDATE:
+        return h2_on_window_update(h2, id, p, len);
+
+    case H2_PUSH_PROMISE:
+        /* 客户端不能推送 */
+        return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+    }
+
+    /* 未知类型的帧忽略 */
+    return 0;
+}
+
+int http_h2_input(struct http_h2 *h2, const char *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    if (h2->dead) {
+        return -1;
+    }
+
+    while (len > 0) {
+        size_t need, n;
+
+        if (h2->preface < HTTP_H2_PREFACE_LEN) {
+            n = HTTP_H2_PREFACE_LEN - h2->preface;
+            if (n > len) {
+                n = len;
+            }
+            if (memcmp(p, HTTP_H2_PREFACE + h2->preface, n) != 0) {
+                return h2_error(h2, HTTP_H2_PROTOCOL_ERROR);
+            }
+            h2->preface += n;
+            p += n;
+            len -= n;
+            continue;
+        }
+
+        /* 完整的帧直接在输入中处理 */
+        if (h2->in_len == 0 && len >= 9) {
+            size_t flen = h2_get24(p);
+
+            if (flen > HTTP_H2_FRAME_SIZE) {
+                return h2_error(h2, HTTP_H2_FRAME_SIZE_ERROR);
+            }
+            if (len >= 9 + flen) {
+                if (h2_frame_in(h2, p, p + 9) < 0) {
+                    return -1;
+                }
+                p += 9 + flen;
+                len -= 9 + flen;
+                continue;
+            }
+        }
+
+        /* 不完整的帧：先凑齐帧头，再按长度凑齐负载 */
+        need = h2->in_len < 9 ? 9 : 9 + h2_get24(h2->in_buf);
+        n = need - h2->in_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(h2->in_buf + h2->in_len, p, n);
+        h2->in_len += n;
+        p += n;
+        len -= n;
+
+        if (h2->in_len < 9) {
+            continue;
+        }
+        if (h2_get24(h2->in_buf) > HTTP_H2_FRAME_SIZE) {
+            return h2_error(h2, HTTP_H2_FRAME_SIZE_ERROR);
+        }
+        if (h2->in_len == 9 + h2_get24(h2->in_buf)) {
+            h2->in_len = 0;
+            if (h2_frame_in(h2, h2->in_buf, h2->in_buf + 9) < 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* ============ 输出 ============ */
+
+/* 执行排队的重置、交付恢复读取的流缓存的数据、关闭已发完的流 */
+static void h2_pump_streams(struct http_h2 *h2)
+{
+    struct http_h2_stream *st, *tmp;
+
+    list_for_each_entry_safe(st, tmp, &h2->streams, list) {
+        if (st->reset) {
+            h2_stream_reset_now(h2, st, st->reset_code);
+            continue;
+        }
+        if (st->tx_closed) {
+            h2_stream_done(h2, st);
+            continue;
+        }
+        if (!st->rx_resume) {
+            continue;
+        }
+
+        st->rx_resume = 0;
+        if (st->rx_len) {
+            char *buf = st->rx_buf;
+            size_t len = st->rx_len;
+            int ret;
+
+            st->rx_buf = NULL;
+            st->rx_len = 0;
+            h2_rx_held(h2, st, 0);
+            ret = h2->ops->data(st->user, buf, len);
+            free(buf);
+            st->rx_unacked += len;
+            h2_conn_credit(h2, len);
+            if (ret > 0) {
+                st->rx_paused = 1;
+            } else if (ret < 0) {
+                st->rx_discard = 1;
+            }
+        }
+        if (st->rx_end_pending && !st->rx_paused) {
+            st->rx_end_pending = 0;
+            if (!st->rx_discard) {
+                h2->ops->end(st->user);
+            }
+        }
+        h2_stream_credit(h2, st);
+    }
+}
+
+/* 从流的发送队列组一个 DATA 帧（n 字节），返回是否带 END_STREAM */
+static int h2_send_data(struct http_h2 *h2, struct http_h2_stream *st, size_t n)
+{
+    uint8_t hdr[9];
+    struct iovec iov[1 + H2_IOV_MAX];
+    struct h2_seg *seg = st->tx_head;
+    size_t left = n;
+    int cnt = 1;
+    int end;
+
+    /* 段数超过 H2_IOV_MAX 时本帧少发一些 */
+    for (; seg && left && cnt <= H2_IOV_MAX; seg = seg->next, cnt++) {
+        size_t k = seg->len < left ? seg->len : left;
+
+        iov[cnt].iov_base = (void *)seg->data;
+        iov[cnt].iov_len = k;
+        left -= k;
+    }
+    n -= left;
+
+    end = st->tx_end && n == st->tx_queued;
+    h2_frame_header(hdr, n, H2_DATA, end ? H2_FLAG_END_STREAM : 0, st->id);
+    iov[0].iov_base = hdr;
+    iov[0].iov_len = 9;
+    h2->ops->send(h2->ctx, iov, cnt);
+
+    st->tx_queued -= n;
+    st->tx_window -= n;
+    h2->tx_window -= n;
+    while (n) {
+        seg = st->tx_head;
+        if (seg->len > n) {
+            seg->data += n;
+            seg->len -= n;
+            break;
+        }
+        n -= seg->len;
+        st->tx_head = seg->next;
+        free(seg);
+    }
+    if (!st->tx_head) {
+        st->tx_tail = NULL;
+    }
+    return end;
+}
+
+/* 各流轮流发一个帧，直到窗口用完、没有数据或传输层积压 */
+static void h2_pump_data(struct http_h2 *h2)
+{
+    struct http_h2_stream *st, *tmp;
+    int progress = 1;
+
+    while (progress && !h2->dead) {
+        progress = 0;
+        list_for_each_entry_safe(st, tmp, &h2->streams, list) {
+            int end = 0;
+
+            if (st->tx_closed || !st->tx_headers) {
+                continue;
+            }
+            if (h2->ops->tx_pending(h2->ctx) >= HTTP_H2_TX_HIGH_WATER) {
+                goto out;
+            }
+
+            if (st->tx_queued) {
+                int64_t n = st->tx_queued;
+
+                if (n > HTTP_H2_FRAME_SIZE) {
+                    n = HTTP_H2_FRAME_SIZE;
+                }
+                if (n > st->tx_window) {
+                    n = st->tx_window;
+                }
+                if (n > h2->tx_window) {
+                    n = h2->tx_window;
+                }
+                if (n <= 0) {
+                    continue;
+                }
+                end = h2_send_data(h2, st, n);
+                st->tx_wrote = 1;
+            } else if (st->tx_end) {
+                h2_send_frame(h2, H2_DATA, H2_FLAG_END_STREAM, st->id, NULL, 0);
+                end = 1;
+            } else {
+                continue;
+            }
+
+            progress = 1;
+            if (end) {
+                st->tx_closed = 1;
+                h2_stream_done(h2, st);
+            }
+        }
+    }
+
+out:
+    list_for_each_entry_safe(st, tmp, &h2->streams, list) {
+        if (st->tx_wrote) {
+            st->tx_wrote = 0;
+            h2->ops->writable(st->user);
+        }
+    }
+}
+
+void http_h2_pump(struct http_h2 *h2)
+{
+    if (h2->in_pump) {
+        h2->pump_again = 1;
+        return;
+    }
+
+    h2->in_pump = 1;
+    do {
+        h2->pump_again = 0;
+        h2_pump_streams(h2);
+        h2_pump_data(h2);
+    } while (h2->pump_again);
+    h2->in_pump = 0;
+}
+
+/* ============ 接口 ============ */
+
+struct http_h2 *http_h2_new(const struct http_h2_ops *ops, void *ctx)
+{
+    struct http_h2 *h2 = calloc(1, sizeof(*h2));
+    uint8_t settings[18];
+
+    if (!h2) {
+        return NULL;
+    }
+    h2->ops = ops;
+    h2->ctx = ctx;
+    INIT_LIST_HEAD(&h2->streams);
+    http_hpack_init(&h2->hpack);
+    h2->tx_window = H2_DEFAULT_WINDOW;
+    h2->peer_window = H2_DEFAULT_WINDOW;
+    h2->rx_window = HTTP_H2_CONN_WINDOW;
+
+    settings[0] = 0;
+    settings[1] = H2_SETTINGS_MAX_CONCURRENT_STREAMS;
+    h2_put32(settings + 2, HTTP_H2_MAX_STREAMS);
+    settings[6] = 0;
+    settings[7] = H2_SETTINGS_INITIAL_WINDOW_SIZE;
+    h2_put32(settings + 8, HTTP_H2_STREAM_WINDOW);
+    settings[12] = 0;
+    settings[13] = H2_SETTINGS_ENABLE_PUSH;
+    h2_put32(settings + 14, 0);
+    h2_send_frame(h2, H2_SETTINGS, 0, 0, settings, sizeof(settings));
+    h2_send_u32(h2, H2_WINDOW_UPDATE, 0, HTTP_H2_CONN_WINDOW - H2_DEFAULT_WINDOW);
+
+    g_h2_stats.sessions++;
+    return h2;
+}
+
+void http_h2_free(struct http_h2 *h2)
+{
+    /* 连接正在关闭，释放流时不再发出帧 */
+    h2->dead = 1;
+    while (!list_empty(&h2->streams)) {
+        h2_stream_close(h2, list_first_entry(&h2->streams, struct http_h2_stream, list));
+    }
+    http_hpack_free(&h2->hpack);
+    free(h2->hbuf);
+    free(h2);
+}
+
+int http_h2_active(struct http_h2 *h2)
+{
+    return h2->nstreams;
+}
+
+int http_h2_stream_headers(struct http_h2_stream *st, const uint8_t *block, size_t len, int end)
+{
+    struct http_h2 *h2 = st->h2;
+    uint8_t type = H2_HEADERS;
+    uint8_t flags = end ? H2_FLAG_END_STREAM : 0;
+
+    if (st->closed || st->tx_headers || h2->dead) {
+        return -1;
+    }
+
+    /* 超过一帧的头块拆成 CONTINUATION，中间不能插入其他帧 */
+    do {
+        size_t n = len < HTTP_H2_FRAME_SIZE ? len : HTTP_H2_FRAME_SIZE;
+
+        if (n == len) {
+            flags |= H2_FLAG_END_HEADERS;
+        }
+        h2_send_frame(h2, type, flags, st->id, block, n);
+        block += n;
+        len -= n;
+        type = H2_CONTINUATION;
+        flags = 0;
+    } while (len);
+
+    st->tx_headers = 1;
+    if (end) {
+        st->tx_end = 1;
+        st->tx_closed = 1;
+    }
+    return 0;
+}
+
+int http_h2_stream_data(struct http_h2_stream *st, const char *data, size_t len, int copy, int end)
+{
+    if (st->closed || st->tx_end || !st->tx_headers) {
+        return -1;
+    }
+
+    if (len) {
+        struct h2_seg *seg = malloc(sizeof(*seg) + (copy ? len : 0));
+
+        if (!seg) {
+            return -1;
+        }
+        if (copy) {
+            memcpy(seg->buf, data, len);
+            data = seg->buf;
+        }
+        seg->next = NULL;
+        seg->data = data;
+        seg->len = len;
+        if (st->tx_tail) {
+            st->tx_tail->next = seg;
+        } else {
+            st->tx_head = seg;
+        }
+        st->tx_tail = seg;
+        st->tx_queued += len;
+    }
+    if (end) {
+        st->tx_end = 1;
+    }
+    return 0;
+}
+
+size_t http_h2_stream_pending(struct http_h2_stream *st)
+{
+    return st->tx_queued;
+}
+
+void http_h2_stream_resume(struct http_h2_stream *st)
+{
+    if (st->closed || !st->rx_paused) {
+        return;
+    }
+    st->rx_paused = 0;
+    st->rx_resume = 1;
+    if (st->h2->in_pump) {
+        st->h2->pump_again = 1;
+    }
+}
+
+void http_h2_stream_reset(struct http_h2_stream *st, uint32_t code)
+{
+    if (st->closed) {
+        return;
+    }
+    st->reset = 1;
+    st->reset_code = code;
+    if (st->h2->in_pump) {
+        st->h2->pump_again = 1;
+    }
+}
+
+void http_h2_get_stats(struct http_h2_stats *stats)
+{
+    *stats = g_h2_stats;
+}
@@ -0,0 +1,113 @@
+#ifndef HTTP_H2_H
+#define HTTP_H2_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+/* HTTP/2（RFC 9113）协议引擎：分帧、流状态与流量控制，不涉及 socket 和请求处理
+ * - 一个连接一个 session，收到的字节交给 http_h2_input，要发出的帧经 ops->send 写给传输层
+ * - 每个请求流回调 ops->open 得到调用方的流对象，之后的请求头、body 与结束都按流回调
+ * - 接收方向按流做流量控制：数据交给调用方后才归还流窗口（WINDOW_UPDATE），
+ *   调用方暂停的流不再归还，客户端最多再发一个窗口的数据（缓存在流中），恢复后再交付；
+ *   连接窗口也在数据交付或丢弃后才归还，一个连接缓存的 body 不超过连接窗口（占用经 ops->rx_held 报告）
+ * - 客户端重置的流（扣除正常完成的）超过 HTTP_H2_MAX_RESETS 时按 ENHANCE_YOUR_CALM 关闭连接
+ * - 发送方向按流排队，受连接窗口、流窗口和传输层积压限制，各流轮流组帧（不按优先级）
+ * - 流相关的调用（stream_*）不会回调调用方：body 排队、重置和恢复交付都在 http_h2_pump 中进行，
+ *   调用方可以在任何回调（包括 close）中调用它们
+ * - 不支持服务器推送（SETTINGS_ENABLE_PUSH 置 0），PRIORITY 帧忽略 */
+
+#define HTTP_H2_PREFACE         "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+#define HTTP_H2_PREFACE_LEN     24
+
+#define HTTP_H2_MAX_STREAMS     100             /* SETTINGS_MAX_CONCURRENT_STREAMS */
+#define HTTP_H2_FRAME_SIZE      16384           /* 收发的最大帧负载（协议默认值，不通告更大的） */
+#define HTTP_H2_STREAM_WINDOW   131072          /* 每个流的接收窗口（SETTINGS_INITIAL_WINDOW_SIZE） */
+#define HTTP_H2_CONN_WINDOW     (1 << 20)       /* 连接级接收窗口（也是一个连接缓存 body 的上限） */
+#define HTTP_H2_HEADERS_MAX     65536           /* 请求头块（含 CONTINUATION）上限 */
+#define HTTP_H2_TX_HIGH_WATER   65536           /* 传输层待发送超过该值时暂停组帧 */
+#define HTTP_H2_MAX_RESETS      200             /* 客户端重置的流（扣除正常完成的）上限，超过时 GOAWAY */
+
+/* 错误码 */
+enum {
+    HTTP_H2_NO_ERROR            = 0x0,
+    HTTP_H2_PROTOCOL_ERROR      = 0x1,
+    HTTP_H2_INTERNAL_ERROR      = 0x2,
+    HTTP_H2_FLOW_CONTROL_ERROR  = 0x3,
+    HTTP_H2_STREAM_CLOSED       = 0x5,
+    HTTP_H2_FRAME_SIZE_ERROR    = 0x6,
+    HTTP_H2_REFUSED_STREAM      = 0x7,
+    HTTP_H2_CANCEL              = 0x8,
+    HTTP_H2_COMPRESSION_ERROR   = 0x9,
+    HTTP_H2_ENHANCE_YOUR_CALM   = 0xb,
+};
+
+struct http_h2;
+struct http_h2_stream;
+
+/* ctx 为 http_h2_new 的参数（连接），user 为 open 返回的流对象 */
+struct http_h2_ops {
+    /* 新请求流：返回流对象，NULL 拒绝（REFUSED_STREAM） */
+    void *(*open)(void *ctx, struct http_h2_stream *st);
+    /* 请求头（含伪头部），指针只在回调中有效 */
+    void (*header)(void *user, const char *name, size_t name_len,
+                   const char *value, size_t value_len);
+    /* 请求头结束：返回 -1 不再交付 body 和 end（调用方已回复错误或重置流） */
+    int (*headers_done)(void *user);
+    /* body 数据：返回 0 继续，1 暂停（本段已处理，恢复前不再交付），-1 丢弃之后的 body */
+    int (*data)(void *user, const char *data, size_t len);
+    /* 请求结束（END_STREAM，之前的 body 都已交付） */
+    void (*end)(void *user);
+    /* 流的发送队列有数据发出 */
+    void (*writable)(void *user);
+    /* 流关闭（完成、被重置或连接关闭），返回后 st 即释放 */
+    void (*close)(void *user);
+    /* 暂停的流缓存 body 占用的内存变化，held 为这个 session 当前的总量（计入接收缓冲区预算） */
+    void (*rx_held)(void *ctx, size_t held);
+    /* 写出帧 */
+    void (*send)(void *ctx, struct iovec *iov, int iovcnt);
+    /* 传输层尚未发出的字节数 */
+    size_t (*tx_pending)(void *ctx);
+};
+
+struct http_h2_stats {
+    uint64_t sessions;
+    uint64_t streams;
+    uint64_t resets;            /* 重置的流（双方发出的 RST_STREAM） */
+    uint64_t errors;            /* 因协议错误关闭的连接（GOAWAY） */
+};
+
+/* 新建 session 并排队服务端的 SETTINGS；客户端的连接序言（preface）由 http_h2_input 校验 */
+struct http_h2 *http_h2_new(const struct http_h2_ops *ops, void *ctx);
+
+/* 关闭所有流（回调 close）并释放 */
+void http_h2_free(struct http_h2 *h2);
+
+/* 处理收到的数据（不完整的帧缓存到下次）；连接级错误时排队 GOAWAY 并返回 -1，
+ * 之后调用方应在发完后关闭连接 */
+int http_h2_input(struct http_h2 *h2, const char *data, size_t len);
+
+/* 交付恢复读取的流中缓存的数据，执行排队的重置，按窗口组帧发出；可重入（嵌套调用推迟到外层） */
+void http_h2_pump(struct http_h2 *h2);
+
+/* 未关闭的流数 */
+int http_h2_active(struct http_h2 *h2);
+
+/* 响应头块（HPACK 编码后），拷贝后立即分帧写出；end 表示没有 body */
+int http_h2_stream_headers(struct http_h2_stream *st, const uint8_t *block, size_t len, int end);
+
+/* 响应 body：copy 为 0 时引用 data（须保持有效到流关闭），end 表示响应结束 */
+int http_h2_stream_data(struct http_h2_stream *st, const char *data, size_t len, int copy, int end);
+
+/* 流中尚未组帧的响应字节数 */
+size_t http_h2_stream_pending(struct http_h2_stream *st);
+
+/* 恢复交付请求 body（对应 data 回调返回 1） */
+void http_h2_stream_resume(struct http_h2_stream *st);
+
+/* 重置流（RST_STREAM），在 http_h2_pump 中发出并回调 close */
+void http_h2_stream_reset(struct http_h2_stream *st, uint32_t code);
+
+void http_h2_get_stats(struct http_h2_stats *stats);
+
+#endif // HTTP_H2_H
@@ -0,0 +1,494 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "http_hpack.h"
+
+struct hpack_entry {
+    uint32_t name_len;
+    uint32_t value_len;
+    char data[];                        /* 名称后紧跟值 */
+};
+
+struct hpack_static {
+    const char *name;
+    const char *value;
+    uint32_t name_len;
+    uint32_t value_len;
+};
+
+#define HPACK_ENT(n, v) { n, v, sizeof(n) - 1, sizeof(v) - 1 }
+
+/* RFC 7541 附录 A，下标 0 对应索引 1 */
+static const struct hpack_static hpack_static_table[] = {
+    HPACK_ENT(":authority", ""),
+    HPACK_ENT(":method", "GET"),
+    HPACK_ENT(":method", "POST"),
+    HPACK_ENT(":path", "/"),
+    HPACK_ENT(":path", "/index.html"),
+    HPACK_ENT(":scheme", "http"),
+    HPACK_ENT(":scheme", "https"),
+    HPACK_ENT(":status", "200"),
+    HPACK_ENT(":status", "204"),
+    HPACK_ENT(":status", "206"),
+    HPACK_ENT(":status", "304"),
+    HPACK_ENT(":status", "400"),
+    HPACK_ENT(":status", "404"),
+    HPACK_ENT(":status", "500"),
+    HPACK_ENT("accept-charset", ""),
+    HPACK_ENT("accept-encoding", "gzip, deflate"),
+    HPACK_ENT("accept-language", ""),
+    HPACK_ENT("accept-ranges", ""),
+    HPACK_ENT("accept", ""),
+    HPACK_ENT("access-control-allow-origin", ""),
+    HPACK_ENT("age", ""),
+    HPACK_ENT("allow", ""),
+    HPACK_ENT("authorization", ""),
+    HPACK_ENT("cache-control", ""),
+    HPACK_ENT("content-disposition", ""),
+    HPACK_ENT("content-encoding", ""),
+    HPACK_ENT("content-language", ""),
+    HPACK_ENT("content-length", ""),
+    HPACK_ENT("content-location", ""),
+    HPACK_ENT("content-range", ""),
+    HPACK_ENT("content-type", ""),
+    HPACK_ENT("cookie", ""),
+    HPACK_ENT("date", ""),
+    HPACK_ENT("etag", ""),
+    HPACK_ENT("expect", ""),
+    HPACK_ENT("expires", ""),
+    HPACK_ENT("from", ""),
+    HPACK_ENT("host", ""),
+    HPACK_ENT("if-match", ""),
+    HPACK_ENT("if-modified-since", ""),
+    HPACK_ENT("if-none-match", ""),
+    HPACK_ENT("if-range", ""),
+    HPACK_ENT("if-unmodified-since", ""),
+    HPACK_ENT("last-modified", ""),
+    HPACK_ENT("link", ""),
+    HPACK_ENT("location", ""),
+    HPACK_ENT("max-forwards", ""),
+    HPACK_ENT("proxy-authenticate", ""),
+    HPACK_ENT("proxy-authorization", ""),
+    HPACK_ENT("range", ""),
+    HPACK_ENT("referer", ""),
+    HPACK_ENT("refresh", ""),
+    HPACK_ENT("retry-after", ""),
+    HPACK_ENT("server", ""),
+    HPACK_ENT("set-cookie", ""),
+    HPACK_ENT("strict-transport-security", ""),
+    HPACK_ENT("transfer-encoding", ""),
+    HPACK_ENT("user-agent", ""),
+    HPACK_ENT("vary", ""),
+    HPACK_ENT("via", ""),
+    HPACK_ENT("www-authenticate", ""),
+};
+
+#define HPACK_STATIC_COUNT  (sizeof(hpack_static_table) / sizeof(hpack_static_table[0]))
+#define HPACK_MAX_ENTRIES   (HTTP_HPACK_TABLE_SIZE / 32)
+
+/* RFC 7541 附录 B 的 Huffman 码（规范码）：按（码长, 码）排序的符号，
+ * 以及每个码长的首个码、在符号表中的起始位置和个数 */
+static const uint16_t hpack_huff_sym[257] = {
+    48, 49, 50, 97, 99, 101, 105, 111, 115, 116, 32, 37,
+    45, 46, 47, 51, 52, 53, 54, 55, 56, 57, 61, 65,
+    95, 98, 100, 102, 103, 104, 108, 109, 110, 112, 114, 117,
+    58, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76,
+    77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 89,
+    106, 107, 113, 118, 119, 120, 121, 122, 38, 42, 44, 59,
+    88, 90, 33, 34, 40, 41, 63, 39, 43, 124, 35, 62,
+    0, 36, 64, 91, 93, 126, 94, 125, 60, 96, 123, 92,
+    195, 208, 128, 130, 131, 162, 184, 194, 224, 226, 153, 161,
+    167, 172, 176, 177, 179, 209, 216, 217, 227, 229, 230, 129,
+    132, 133, 134, 136, 146, 154, 156, 160, 163, 164, 169, 170,
+    173, 178, 181, 185, 186, 187, 189, 190, 196, 198, 228, 232,
+    233, 1, 135, 137, 138, 139, 140, 141, 143, 147, 149, 150,
+    151, 152, 155, 157, 158, 165, 166, 168, 174, 175, 180, 182,
+    183, 188, 191, 197, 231, 239, 9, 142, 144, 145, 148, 159,
+    171, 206, 215, 225, 236, 237, 199, 207, 234, 235, 192, 193,
+    200, 201, 202, 205, 210, 213, 218, 219, 238, 240, 242, 243,
+    255, 203, 204, 211, 212, 214, 221, 222, 223, 241, 244, 245,
+    246, 247, 248, 250, 251, 252, 253, 254, 2, 3, 4, 5,
+    6, 7, 8, 11, 12, 14, 15, 16, 17, 18, 19, 20,
+    21, 23, 24, 25, 26, 27, 28, 29, 30, 31, 127, 220,
+    249, 10, 13, 22, 256,
+};
+
+static const uint32_t hpack_huff_first[31] = {
+    0, 0, 0, 0, 0, 0x0, 0x14, 0x5c,
+    0xf8, 0, 0x3f8, 0x7fa, 0xffa, 0x1ff8, 0x3ffc, 0x7ffc,
+    0, 0, 0, 0x7fff0, 0xfffe6, 0x1fffdc, 0x3fffd2, 0x7fffd8,
+    0xffffea, 0x1ffffec, 0x3ffffe0, 0x7ffffde, 0xfffffe2, 0, 0x3ffffffc,
+};
+
+static const uint16_t hpack_huff_offset[31] = {
+    0, 0, 0, 0, 0, 0, 10, 36,
+    68, 0, 74, 79, 82, 84, 90, 92,
+    0, 0, 0, 95, 98, 106, 119, 145,
+    174, 186, 190, 205, 224, 0, 253,
+};
+
+static const uint16_t hpack_huff_count[31] = {
+    0, 0, 0, 0, 0, 10, 26, 32,
+    6, 0, 5, 3, 2, 6, 2, 3,
+    0, 0, 0, 3, 8, 13, 26, 29,
+    12, 4, 15, 19, 29, 0, 4,
+};
+
+/* Huffman 字符串的解码暂存区：名称和值各一个（单线程，回调返回后即可复用） */
+static char g_huff_buf[2][HTTP_HPACK_STRING_MAX];
+
+void http_hpack_init(struct http_hpack *hp)
+{
+    memset(hp, 0, sizeof(*hp));
+    hp->max_size = HTTP_HPACK_TABLE_SIZE;
+}
+
+/* 淘汰最旧的条目 */
+static void hpack_evict(struct http_hpack *hp)
+{
+    unsigned i = (hp->head + HPACK_MAX_ENTRIES - hp->count + 1) % HPACK_MAX_ENTRIES;
+    struct hpack_entry *e = hp->ents[i];
+
+    hp->size -= 32 + e->name_len + e->value_len;
+    free(e);
+    hp->ents[i] = NULL;
+    hp->count--;
+}
+
+void http_hpack_free(struct http_hpack *hp)
+{
+    while (hp->count) {
+        hpack_evict(hp);
+    }
+}
+
+static void hpack_resize(struct http_hpack *hp, size_t max_size)
+{
+    hp->max_size = max_size;
+    while (hp->size > hp->max_size) {
+        hpack_evict(hp);
+    }
+}
+
+/* 插入新条目（名称可能指向即将被淘汰的条目，先拷贝再淘汰）；比整个表还大时清空表 */
+static int hpack_insert(struct http_hpack *hp, const char *name, size_t name_len,
+                        const char *value, size_t value_len)
+{
+    size_t size = 32 + name_len + value_len;
+    struct hpack_entry *e;
+
+    if (size > hp->max_size) {
+        while (hp->count) {
+            hpack_evict(hp);
+        }
+        return 0;
+    }
+
+    e = malloc(sizeof(*e) + name_len + value_len);
+    if (!e) {
+        return -1;
+    }
+    e->name_len = name_len;
+    e->value_len = value_len;
+    memcpy(e->data, name, name_len);
+    memcpy(e->data + name_len, value, value_len);
+
+    while (hp->size + size > hp->max_size || hp->count == HPACK_MAX_ENTRIES) {
+        hpack_evict(hp);
+    }
+    hp->head = (hp->head + 1) % HPACK_MAX_ENTRIES;
+    hp->ents[hp->head] = e;
+    hp->count++;
+    hp->size += size;
+    return 0;
+}
+
+/* 按索引取名称和值：1-61 为静态表，62 起为动态表（最新的在前） */
+static int hpack_lookup(struct http_hpack *hp, uint64_t index,
+                        const char **name, size_t *name_len,
+                        const char **value, size_t *value_len)
+{
+    if (index == 0) {
+        return -1;
+    }
+    if (index <= HPACK_STATIC_COUNT) {
+        const struct hpack_static *s = &hpack_static_table[index - 1];
+
+        *name = s->name;
+        *name_len = s->name_len;
+        *value = s->value;
+        *value_len = s->value_len;
+        return 0;
+    }
+
+    index -= HPACK_STATIC_COUNT + 1;
+    if (index >= hp->count) {
+        return -1;
+    }
+    {
+        struct hpack_entry *e = hp->ents[(hp->head + HPACK_MAX_ENTRIES - index) % HPACK_MAX_ENTRIES];
+
+        *name = e->data;
+        *name_len = e->name_len;
+        *value = e->data + e->name_len;
+        *value_len = e->value_len;
+    }
+    return 0;
+}
+
+/* 前缀整数（prefix 位） */
+static int hpack_int(const uint8_t **p, const uint8_t *end, int prefix, uint64_t *out)
+{
+    uint64_t max = (1u << prefix) - 1;
+    uint64_t v = **p & max;
+    int shift = 0;
+
+    (*p)++;
+    if (v < max) {
+        *out = v;
+        return 0;
+    }
+    while (*p < end) {
+        uint8_t b = *(*p)++;
+
+        v += (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            return 0;
+        }
+        shift += 7;
+        if (shift > 28) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+/* 规范 Huffman 码：逐位累积，在每个码长的码段内即命中 */
+static int hpack_huff_decode(const uint8_t *in, size_t len, char *out, size_t *out_len)
+{
+    uint32_t code = 0;
+    int bits = 0;
+    size_t n = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        for (int b = 7; b >= 0; b--) {
+            uint32_t k;
+
+            code = (code << 1) | ((in[i] >> b) & 1);
+            bits++;
+            k = code - hpack_huff_first[bits];
+            if (hpack_huff_count[bits] && k < hpack_huff_count[bits]) {
+                uint16_t sym = hpack_huff_sym[hpack_huff_offset[bits] + k];
+
+                if (sym == 256 || n == HTTP_HPACK_STRING_MAX) {
+                    return -1;
+                }
+                out[n++] = sym;
+                code = 0;
+                bits = 0;
+            } else if (bits == 30) {
+                return -1;
+            }
+        }
+    }
+
+    /* 结尾的填充须是 EOS 的前缀（全 1），且不超过 7 位 */
+    if (bits > 7 || code != (1u << bits) - 1) {
+        return -1;
+    }
+    *out_len = n;
+    return 0;
+}
+
+static int hpack_string(const uint8_t **p, const uint8_t *end, char *buf,
+                        const char **str, size_t *len)
+{
+    int huff = **p & 0x80;
+    uint64_t n;
+
+    if (hpack_int(p, end, 7, &n) < 0 || n > (uint64_t)(end - *p)) {
+        return -1;
+    }
+    if (huff) {
+        if (hpack_huff_decode(*p, n, buf, len) < 0) {
+            return -1;
+        }
+        *str = buf;
+    } else {
+        *str = (const char *)*p;
+        *len = n;
+    }
+    *p += n;
+    return 0;
+}
+
+int http_hpack_decode(struct http_hpack *hp, const uint8_t *in, size_t len,
+                      http_hpack_emit_t emit, void *ctx)
+{
+    const uint8_t *p = in, *end = in + len;
+    int fields = 0;
+
+    for (; p < end; fields++) {
+        const char *name, *value;
+        size_t name_len, value_len;
+        uint64_t index;
+        uint8_t b = *p;
+
+        if (b & 0x80) {
+            /* 索引字段 */
+            if (hpack_int(&p, end, 7, &index) < 0 ||
+                hpack_lookup(hp, index, &name, &name_len, &value, &value_len) < 0) {
+                return -1;
+            }
+            emit(ctx, name, name_len, value, value_len);
+            continue;
+        }
+
+        if ((b & 0xe0) == 0x20) {
+            /* 动态表大小更新：只能在头块开头（RFC 7541 4.2） */
+            if (fields || hpack_int(&p, end, 5, &index) < 0 || index > HTTP_HPACK_TABLE_SIZE) {
+                return -1;
+            }
+            hpack_resize(hp, index);
+            fields--;
+            continue;
+        }
+
+        /* 字面量：01 增量索引（6 位前缀），0000 不索引 / 0001 永不索引（4 位前缀） */
+        if (hpack_int(&p, end, (b & 0x40) ? 6 : 4, &index) < 0) {
+            return -1;
+        }
+        if (index) {
+            const char *v;
+            size_t vl;
+
+            if (hpack_lookup(hp, index, &name, &name_len, &v, &vl) < 0) {
+                return -1;
+            }
+        } else if (p >= end || hpack_string(&p, end, g_huff_buf[0], &name, &name_len) < 0) {
+            return -1;
+        }
+        if (p >= end || hpack_string(&p, end, g_huff_buf[1], &value, &value_len) < 0) {
+            return -1;
+        }
+
+        emit(ctx, name, name_len, value, value_len);
+        if ((b & 0x40) && hpack_insert(hp, name, name_len, value, value_len) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* ============ 编码 ============ */
+
+static size_t hpack_put_int(uint8_t *out, size_t size, uint8_t first, int prefix, uint64_t v)
+{
+    uint64_t max = (1u << prefix) - 1;
+    size_t n = 0;
+
+    if (size == 0) {
+        return 0;
+    }
+    if (v < max) {
+        out[n++] = first | v;
+        return n;
+    }
+    out[n++] = first | max;
+    v -= max;
+    while (v >= 0x80) {
+        if (n == size) {
+            return 0;
+        }
+        out[n++] = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    if (n == size) {
+        return 0;
+    }
+    out[n++] = v;
+    return n;
+}
+
+/* 字面量字符串（不做 Huffman），lower 时转为小写 */
+static size_t hpack_put_string(uint8_t *out, size_t size, const char *s, size_t len, int lower)
+{
+    size_t n = hpack_put_int(out, size, 0, 7, len);
+
+    if (n == 0 || len > size - n) {
+        return 0;
+    }
+    if (lower) {
+        for (size_t i = 0; i < len; i++) {
+            char c = s[i];
+            out[n + i] = (c >= 'A' && c <= 'Z') ? c + 32 : c;
+        }
+    } else {
+        memcpy(out + n, s, len);
+    }
+    return n + len;
+}
+
+size_t http_hpack_encode_status(uint8_t *out, size_t size, int status)
+{
+    char num[3];
+
+    /* 静态表 8-14 */
+    switch (status) {
+    case 200: return hpack_put_int(out, size, 0x80, 7, 8);
+    case 204: return hpack_put_int(out, size, 0x80, 7, 9);
+    case 206: return hpack_put_int(out, size, 0x80, 7, 10);
+    case 304: return hpack_put_int(out, size, 0x80, 7, 11);
+    case 400: return hpack_put_int(out, size, 0x80, 7, 12);
+    case 404: return hpack_put_int(out, size, 0x80, 7, 13);
+    case 500: return hpack_put_int(out, size, 0x80, 7, 14);
+    }
+
+    if (status < 100 || status > 999) {
+        status = 500;
+    }
+    num[0] = '0' + status / 100;
+    num[1] = '0' + status / 10 % 10;
+    num[2] = '0' + status % 10;
+    return http_hpack_encode_field(out, size, ":status", 7, num, 3);
+}
+
+/* 名称在静态表中的索引（只比较名称），没有返回 0 */
+static unsigned hpack_static_name(const char *name, size_t len)
+{
+    for (unsigned i = 0; i < HPACK_STATIC_COUNT; i++) {
+        const struct hpack_static *s = &hpack_static_table[i];
+
+        if (s->name_len == len && strncasecmp(s->name, name, len) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+size_t http_hpack_encode_field(uint8_t *out, size_t size, const char *name, size_t name_len,
+                               const char *value, size_t value_len)
+{
+    unsigned index = hpack_static_name(name, name_len);
+    size_t n, k;
+
+    /* 不索引的字面量：0000 + 4 位前缀的名称索引，0 表示名称随后给出 */
+    n = hpack_put_int(out, size, 0x00, 4, index);
+    if (n == 0) {
+        return 0;
+    }
+    if (!index) {
+        k = hpack_put_string(out + n, size - n, name, name_len, 1);
+        if (k == 0) {
+            return 0;
+        }
+        n += k;
+    }
+    k = hpack_put_string(out + n, size - n, value, value_len, 0);
+    if (k == 0) {
+        return 0;
+    }
+    return n + k;
+}
@@ -0,0 +1,44 @@
+#ifndef HTTP_HPACK_H
+#define HTTP_HPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* HPACK（RFC 7541）：HTTP/2 请求头解码与响应头编码
+ * - 解码：静态表、动态表（环形数组，按 SETTINGS_HEADER_TABLE_SIZE 默认的 4096 字节）、Huffman；
+ *   未经 Huffman 编码的字符串直接指向输入，Huffman 字符串解码到进程内的暂存区
+ * - 编码：响应头不进动态表、不做 Huffman，常见的 :status 用静态表索引，
+ *   名称在静态表中的用名称索引，其余为字面量（名称转为小写） */
+
+#define HTTP_HPACK_TABLE_SIZE   4096            /* 动态表上限（不通告更大的值） */
+#define HTTP_HPACK_STRING_MAX   8192            /* Huffman 解码后单个名称 / 值的上限 */
+
+struct hpack_entry;
+
+/* 解码器状态（每个连接一个，跨请求头块保留） */
+struct http_hpack {
+    struct hpack_entry *ents[HTTP_HPACK_TABLE_SIZE / 32];  /* 每个条目至少 32 字节 */
+    unsigned head;                      /* 最新条目的位置 */
+    unsigned count;
+    size_t size;
+    size_t max_size;                    /* 编码端通过动态表大小更新设置 */
+};
+
+/* 解出的一个请求头；指针只在回调中有效，不以 '\0' 结尾 */
+typedef void (*http_hpack_emit_t)(void *ctx, const char *name, size_t name_len,
+                                  const char *value, size_t value_len);
+
+void http_hpack_init(struct http_hpack *hp);
+void http_hpack_free(struct http_hpack *hp);
+
+/* 解码一个完整的请求头块，每个字段调用一次 emit；
+ * 格式错误（COMPRESSION_ERROR，须关闭连接）返回 -1 */
+int http_hpack_decode(struct http_hpack *hp, const uint8_t *in, size_t len,
+                      http_hpack_emit_t emit, void *ctx);
+
+/* 编码到 out（剩余 size 字节），返回写入的长度，空间不足返回 0 */
+size_t http_hpack_encode_status(uint8_t *out, size_t size, int status);
+size_t http_hpack_encode_field(uint8_t *out, size_t size, const char *name, size_t name_len,
+                               const char *value, size_t value_len);
+
+#endif // HTTP_HPACK_H
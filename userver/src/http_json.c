@@ -1,10 +1,83 @@
 #include "http_json.h"
+#include "http_json_writer.h"
+#include "http_json_index.h"
+#include "http_metrics.h"
+#include "http_log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define INITIAL_BUFFER_SIZE 4096
 #define MAX_BUFFER_SIZE (10 * 1024 * 1024) /* 10MB */
+#define TOKENER_CACHE_MAX 64
+
+
+/* json_tokener 缓存：tokener 由 json-c 分配，跨请求 reset 复用 */
+static json_tokener *tokener_cache[TOKENER_CACHE_MAX];
+static int tokener_cache_len = 0;
+
+static json_tokener *tokener_get(void)
+{
+    if (tokener_cache_len > 0) {
+        return tokener_cache[--tokener_cache_len];
+    }
+    return json_tokener_new();
+}
+
+static void tokener_put(json_tokener *tok)
+{
+    if (tokener_cache_len < TOKENER_CACHE_MAX) {
+        json_tokener_reset(tok);
+        tokener_cache[tokener_cache_len++] = tok;
+        return;
+    }
+    json_tokener_free(tok);
+}
+
+/* 回显响应：直接写入请求 arena，不构建响应 json_object 树，也不再拷贝
+ * size_hint 为请求 body 大小，用于一次预留输出缓冲区 */
+static void echo_begin(http_json_writer_t *w, struct http_conn *conn, const char *mode,
+                       size_t size_hint)
+{
+    http_jw_init(w, &conn->arena, size_hint + 64);
+    http_jw_object_begin(w);
+    http_jw_key(w, HTTP_JW_LIT("status"));
+    http_jw_string(w, HTTP_JW_LIT("ok"));
+    http_jw_key(w, HTTP_JW_LIT("mode"));
+    http_jw_string(w, mode, strlen(mode));
+}
+
+static void echo_finish(http_json_writer_t *w, struct http_conn *conn)
+{
+    const char *body;
+    size_t len;
+    
+    http_jw_object_end(w);
+    
+    if (http_jw_finish(w, &body, &len) < 0) {
+        http_set_response(conn, 500, "application/json",
+                          HTTP_STATIC_BODY("{\"error\":\"Out of memory\",\"status\":\"error\"}"));
+        return;
+    }
+    http_set_response(conn, 200, "application/json", body, len);
+}
+
+static void set_echo_response(struct http_conn *conn, const char *mode,
+                              json_object *parsed, size_t size_hint)
+{
+    http_json_writer_t w;
+    json_object *data = json_object_object_get(parsed, "data");
+    
+    echo_begin(&w, conn, mode, size_hint);
+    
+    /* 回显接收到的数据 */
+    if (data) {
+        http_jw_key(&w, HTTP_JW_LIT("echo"));
+        http_jw_json(&w, data);
+    }
+    
+    echo_finish(&w, conn);
+}
 
 /* ============ 流式 JSON 解析（零拷贝） ============ */
 
@@ -15,13 +88,12 @@ static int json_stream_init(struct http_conn *conn, const char *content_type)
         return 0; /* 跳过，不是 JSON */
     }
     
-    http_json_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    http_json_ctx_t *ctx = http_arena_calloc(&conn->arena, sizeof(*ctx));
     if (!ctx) return -1;
     
     ctx->mode = JSON_MODE_STREAM;
-    ctx->tokener = json_tokener_new();
+    ctx->tokener = tokener_get();
     if (!ctx->tokener) {
-        free(ctx);
         return -1;
     }
     
@@ -38,11 +110,13 @@ static int json_stream_data(struct http_conn *conn, const char *data, size_t len
     if (conn->parse_error) return 0;
     
     /* 流式解析：直接在 ustream 缓冲区中解析，零拷贝 */
+    ctx->received += len;
     ctx->parsed = json_tokener_parse_ex(ctx->tokener, data, len);
     
     enum json_tokener_error jerr = json_tokener_get_error(ctx->tokener);
     if (jerr != json_tokener_continue && jerr != json_tokener_success) {
-        fprintf(stderr, "JSON parse error: %s\n", json_tokener_error_desc(jerr));
+        http_metrics_error(HTTP_ERR_BODY);
+        http_log_error("json", json_tokener_error_desc(jerr));
         conn->parse_error = 1; /* 标记错误，但继续解析 HTTP */
     }
     
@@ -55,41 +129,19 @@ static int json_stream_complete(struct http_conn *conn)
     
     /* 检查是否有解析错误 */
     if (conn->parse_error) {
-        conn->status_code = 400;
-        conn->response_body = strdup("{\"error\":\"Invalid JSON\",\"status\":\"error\"}");
-        conn->response_body_len = strlen(conn->response_body);
-        conn->response_content_type = "application/json";
+        http_set_response(conn, 400, "application/json",
+                          HTTP_STATIC_BODY("{\"error\":\"Invalid JSON\",\"status\":\"error\"}"));
         return 0;
     }
     
     if (!ctx || !ctx->parsed) {
         /* 没有 JSON 数据，返回默认响应 */
-        conn->status_code = 200;
-        conn->response_body = strdup("{\"status\":\"ok\",\"message\":\"HTTP JSON Server (stream)\"}");
-        conn->response_body_len = strlen(conn->response_body);
-        conn->response_content_type = "application/json";
+        http_set_response(conn, 200, "application/json",
+                          HTTP_STATIC_BODY("{\"status\":\"ok\",\"message\":\"HTTP JSON Server (stream)\"}"));
         return 0;
     }
     
-    /* 构建响应 */
-    json_object *response = json_object_new_object();
-    json_object_object_add(response, "status", json_object_new_string("ok"));
-    json_object_object_add(response, "mode", json_object_new_string("stream"));
-    
-    /* 回显接收到的数据 */
-    json_object *data = json_object_object_get(ctx->parsed, "data");
-    if (data) {
-        json_object_object_add(response, "echo", json_object_get(data));
-    }
-    
-    const char *response_str = json_object_to_json_string_ext(
-        response, JSON_C_TO_STRING_PLAIN);
-    conn->response_body = strdup(response_str);
-    conn->response_body_len = strlen(response_str);
-    conn->status_code = 200;
-    conn->response_content_type = "application/json";
-    
-    json_object_put(response);
+    set_echo_response(conn, "stream", ctx->parsed, ctx->received);
     return 0;
 }
 
@@ -99,12 +151,11 @@ static void json_stream_cleanup(struct http_conn *conn)
     if (!ctx) return;
     
     if (ctx->tokener) {
-        json_tokener_free(ctx->tokener);
+        tokener_put(ctx->tokener);
     }
     if (ctx->parsed) {
         json_object_put(ctx->parsed);
     }
-    free(ctx);
     conn->body_ctx = NULL;
 }
 
@@ -120,7 +171,7 @@ http_body_handler_t *http_json_handler_stream(void)
     return &json_stream_handler;
 }
 
-/* ============ 缓冲 JSON 解析（传统方式） ============ */
+/* ============ 缓冲 JSON 解析（完整 body，两阶段解析） ============ */
 
 static int json_buffer_init(struct http_conn *conn, const char *content_type)
 {
@@ -128,14 +179,18 @@ static int json_buffer_init(struct http_conn *conn, const char *content_type)
         return 0;
     }
     
-    http_json_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    http_json_ctx_t *ctx = http_arena_calloc(&conn->arena, sizeof(*ctx));
     if (!ctx) return -1;
     
     ctx->mode = JSON_MODE_BUFFER;
     ctx->buffer_cap = INITIAL_BUFFER_SIZE;
-    ctx->buffer = malloc(ctx->buffer_cap);
+    /* 有 Content-Length 时一次分配好（超过上限的 body 在 on_data 中拒绝），不逐步倍增 */
+    if (conn->parser.content_length >= INITIAL_BUFFER_SIZE &&
+        conn->parser.content_length < MAX_BUFFER_SIZE) {
+        ctx->buffer_cap = conn->parser.content_length + 1;
+    }
+    ctx->buffer = http_arena_alloc(&conn->arena, ctx->buffer_cap);
     if (!ctx->buffer) {
-        free(ctx);
         return -1;
     }
     
@@ -153,7 +208,8 @@ static int json_buffer_data(struct http_conn *conn, const char *data, size_t len
     
     /* 检查容量 */
     if (ctx->buffer_len + len > MAX_BUFFER_SIZE) {
-        fprintf(stderr, "JSON body too large (max %d bytes)\n", MAX_BUFFER_SIZE);
+        http_metrics_error(HTTP_ERR_BODY_SIZE);
+        http_log_error("json", "body too large");
         conn->parse_error = 1;
         return 0; /* 继续解析 HTTP */
     }
@@ -168,7 +224,8 @@ static int json_buffer_data(struct http_conn *conn, const char *data, size_t len
             new_cap = MAX_BUFFER_SIZE;
         }
         
-        char *new_buf = realloc(ctx->buffer, new_cap);
+        char *new_buf = http_arena_realloc(&conn->arena, ctx->buffer,
+                                           ctx->buffer_len + 1, new_cap);
         if (!new_buf) {
             perror("realloc");
             return -1;
@@ -191,63 +248,46 @@ static int json_buffer_complete(struct http_conn *conn)
     
     /* 检查是否有解析错误 */
     if (conn->parse_error) {
-        conn->status_code = 400;
-        conn->response_body = strdup("{\"error\":\"Invalid JSON or body too large\",\"status\":\"error\"}");
-        conn->response_body_len = strlen(conn->response_body);
-        conn->response_content_type = "application/json";
+        http_set_response(conn, 400, "application/json",
+                          HTTP_STATIC_BODY("{\"error\":\"Invalid JSON or body too large\",\"status\":\"error\"}"));
         return 0;
     }
     
     if (!ctx || !ctx->buffer || ctx->buffer_len == 0) {
-        conn->status_code = 200;
-        conn->response_body = strdup("{\"status\":\"ok\",\"message\":\"HTTP JSON Server (buffer)\"}");
-        conn->response_body_len = strlen(conn->response_body);
-        conn->response_content_type = "application/json";
+        http_set_response(conn, 200, "application/json",
+                          HTTP_STATIC_BODY("{\"status\":\"ok\",\"message\":\"HTTP JSON Server (buffer)\"}"));
         return 0;
     }
     
-    /* 一次性解析完整 JSON */
-    json_object *parsed = json_tokener_parse(ctx->buffer);
-    if (!parsed) {
-        fprintf(stderr, "Failed to parse JSON buffer\n");
-        conn->status_code = 400;
-        conn->response_body = strdup("{\"error\":\"Invalid JSON\",\"status\":\"error\"}");
-        conn->response_body_len = strlen(conn->response_body);
-        conn->response_content_type = "application/json";
+    /* stage 1 一次扫描校验整个 body 并建立结构索引，stage 2 按索引构建 json_object */
+    http_json_index_t idx;
+    json_object *parsed;
+    int ret = http_json_index_build(&idx, &conn->arena, ctx->buffer, ctx->buffer_len);
+    if (ret == 0) {
+        ret = http_json_index_parse(&idx, ctx->buffer, ctx->buffer_len, &parsed);
+    }
+    if (ret == HTTP_JSON_INDEX_ENOMEM) {
+        http_set_response(conn, 500, "application/json",
+                          HTTP_STATIC_BODY("{\"error\":\"Out of memory\",\"status\":\"error\"}"));
         return 0;
     }
-    
-    /* 构建响应 */
-    json_object *response = json_object_new_object();
-    json_object_object_add(response, "status", json_object_new_string("ok"));
-    json_object_object_add(response, "mode", json_object_new_string("buffer"));
-    
-    json_object *data = json_object_object_get(parsed, "data");
-    if (data) {
-        json_object_object_add(response, "echo", json_object_get(data));
+    if (ret < 0) {
+        http_metrics_error(HTTP_ERR_BODY);
+        http_log_error("json", idx.error);
+        http_set_response(conn, 400, "application/json",
+                          HTTP_STATIC_BODY("{\"error\":\"Invalid JSON\",\"status\":\"error\"}"));
+        return 0;
     }
     
-    const char *response_str = json_object_to_json_string_ext(
-        response, JSON_C_TO_STRING_PLAIN);
-    conn->response_body = strdup(response_str);
-    conn->response_body_len = strlen(response_str);
-    conn->status_code = 200;
-    conn->response_content_type = "application/json";
+    set_echo_response(conn, "buffer", parsed, ctx->buffer_len);
     
     json_object_put(parsed);
-    json_object_put(response);
     return 0;
 }
 
 static void json_buffer_cleanup(struct http_conn *conn)
 {
-    http_json_ctx_t *ctx = (http_json_ctx_t *)conn->body_ctx;
-    if (!ctx) return;
-    
-    if (ctx->buffer) {
-        free(ctx->buffer);
-    }
-    free(ctx);
+    /* 上下文和缓冲区都在请求 arena 中，随请求整体回收 */
     conn->body_ctx = NULL;
 }
 
@@ -263,3 +303,103 @@ http_body_handler_t *http_json_handler_buffer(void)
     return &json_buffer_handler;
 }
 
+
+/* ============ tape 解析（不构建 json_object） ============ */
+
+static int json_lazy_init(struct http_conn *conn, const char *content_type)
+{
+    if (!content_type || strstr(content_type, "application/json") == NULL) {
+        return 0;
+    }
+    
+    http_json_ctx_t *ctx = http_arena_calloc(&conn->arena, sizeof(*ctx));
+    if (!ctx) return -1;
+    
+    ctx->mode = JSON_MODE_LAZY;
+    ctx->tape = http_arena_alloc(&conn->arena, sizeof(*ctx->tape));
+    if (!ctx->tape) {
+        return -1;
+    }
+    
+    /* 有 Content-Length 时一次分配好 body 缓冲区 */
+    if (http_tape_init(ctx->tape, &conn->arena, conn->parser.content_length,
+                       MAX_BUFFER_SIZE) < 0) {
+        return -1;
+    }
+    
+    conn->body_ctx = ctx;
+    return 0;
+}
+
+static int json_lazy_data(struct http_conn *conn, const char *data, size_t len)
+{
+    http_json_ctx_t *ctx = (http_json_ctx_t *)conn->body_ctx;
+    if (!ctx) return 0;
+    
+    if (conn->parse_error) return 0;
+    
+    /* 分片到达即校验，语法错误不必等到 body 结束 */
+    if (http_tape_feed(ctx->tape, data, len) < 0) {
+        http_metrics_error(HTTP_ERR_BODY);
+        http_log_error("json", ctx->tape->error);
+        conn->parse_error = 1;
+    }
+    
+    return 0;
+}
+
+static int json_lazy_complete(struct http_conn *conn)
+{
+    http_json_ctx_t *ctx = (http_json_ctx_t *)conn->body_ctx;
+    http_json_writer_t w;
+    int data;
+    
+    if (!conn->parse_error && ctx && http_tape_finish(ctx->tape) < 0) {
+        http_metrics_error(HTTP_ERR_BODY);
+        http_log_error("json", ctx->tape->error);
+        conn->parse_error = 1;
+    }
+    
+    if (conn->parse_error) {
+        http_set_response(conn, 400, "application/json",
+                          HTTP_STATIC_BODY("{\"error\":\"Invalid JSON or body too large\",\"status\":\"error\"}"));
+        return 0;
+    }
+    
+    if (!ctx || ctx->tape->count == 0) {
+        http_set_response(conn, 200, "application/json",
+                          HTTP_STATIC_BODY("{\"status\":\"ok\",\"message\":\"HTTP JSON Server (lazy)\"}"));
+        return 0;
+    }
+    
+    /* "data" 的原文直接拷入响应 */
+    echo_begin(&w, conn, "lazy", ctx->tape->len);
+    data = http_tape_lookup(ctx->tape, "data");
+    if (data >= 0) {
+        size_t len;
+        const char *raw = http_tape_raw(ctx->tape, data, &len);
+        
+        http_jw_key(&w, HTTP_JW_LIT("echo"));
+        http_jw_raw(&w, raw, len);
+    }
+    echo_finish(&w, conn);
+    return 0;
+}
+
+static void json_lazy_cleanup(struct http_conn *conn)
+{
+    /* body 缓冲区和 tape 都在请求 arena 中 */
+    conn->body_ctx = NULL;
+}
+
+static http_body_handler_t json_lazy_handler = {
+    .on_init = json_lazy_init,
+    .on_data = json_lazy_data,
+    .on_complete = json_lazy_complete,
+    .on_cleanup = json_lazy_cleanup,
+};
+
+http_body_handler_t *http_json_handler_lazy(void)
+{
+    return &json_lazy_handler;
+}
@@ -2,12 +2,14 @@
 #define HTTP_JSON_H
 
 #include "http.h"
+#include "http_json_tape.h"
 #include <json-c/json.h>
 
 /* JSON 处理模式 */
 typedef enum {
     JSON_MODE_STREAM,   /* 流式解析（零拷贝，推荐） */
-    JSON_MODE_BUFFER    /* 缓冲解析（兼容模式） */
+    JSON_MODE_BUFFER,   /* 缓冲解析（兼容模式） */
+    JSON_MODE_LAZY      /* tape 解析（不构建 json_object） */
 } json_parse_mode_t;
 
 /* JSON body 上下文 */
@@ -17,11 +19,15 @@ typedef struct {
     /* 流式解析 */
     json_tokener *tokener;
     json_object *parsed;
+    size_t received;        /* 已接收的 body 字节数（预估响应大小） */
     
     /* 缓冲解析 */
     char *buffer;
     size_t buffer_len;
     size_t buffer_cap;
+    
+    /* tape 解析 */
+    http_json_tape_t *tape;
 } http_json_ctx_t;
 
 /* 获取 JSON body 处理器（流式模式） */
@@ -30,5 +36,8 @@ http_body_handler_t *http_json_handler_stream(void);
 /* 获取 JSON body 处理器（缓冲模式） */
 http_body_handler_t *http_json_handler_buffer(void);
 
+/* 获取 JSON body 处理器（tape 模式：流式校验，按 key 取值，原文回显） */
+http_body_handler_t *http_json_handler_lazy(void);
+
 #endif // HTTP_JSON_H
 
@@ -0,0 +1,745 @@
+#include "http_json_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define JSON_INDEX_X86 1
+#endif
+
+#define EVEN_BITS 0x5555555555555555ULL
+
+/* 字符类别：标量分类与 stage 2 共用 */
+enum {
+    C_QUOTE = 0x01,
+    C_BSLASH = 0x02,
+    C_OP = 0x04,        /* { } [ ] : , */
+    C_WS = 0x08,        /* 空格 \t \n \r */
+    C_CTRL = 0x10,      /* 0x00 - 0x1f */
+    C_HIGH = 0x20,      /* 非 ASCII */
+};
+
+static const unsigned char char_class[256] = {
+    [0 ... 8] = C_CTRL,
+    ['\t'] = C_CTRL | C_WS,
+    ['\n'] = C_CTRL | C_WS,
+    [11 ... 12] = C_CTRL,
+    ['\r'] = C_CTRL | C_WS,
+    [14 ... 31] = C_CTRL,
+    [' '] = C_WS,
+    ['"'] = C_QUOTE,
+    ['\\'] = C_BSLASH,
+    ['{'] = C_OP, ['}'] = C_OP, ['['] = C_OP, [']'] = C_OP, [':'] = C_OP, [','] = C_OP,
+    [128 ... 255] = C_HIGH,
+};
+
+/* 反斜杠之后允许出现的字符 */
+static const unsigned char valid_escape[256] = {
+    ['"'] = 1, ['\\'] = 1, ['/'] = 1, ['b'] = 1, ['f'] = 1,
+    ['n'] = 1, ['r'] = 1, ['t'] = 1, ['u'] = 1,
+};
+
+/* 64 字节块的分类位图，第 i 位对应块内第 i 个字节 */
+struct json_block {
+    uint64_t quote;
+    uint64_t bslash;
+    uint64_t op;
+    uint64_t ws;
+    uint64_t ctrl;
+    uint64_t high;
+};
+
+typedef void (*json_classify_fn)(const unsigned char *p, struct json_block *b);
+
+static void classify_scalar(const unsigned char *p, struct json_block *b)
+{
+    memset(b, 0, sizeof(*b));
+    for (int i = 0; i < 64; i++) {
+        unsigned int c = char_class[p[i]];
+        uint64_t bit = 1ULL << i;
+
+        if (!c) continue;
+        if (c & C_QUOTE) b->quote |= bit;
+        if (c & C_BSLASH) b->bslash |= bit;
+        if (c & C_OP) b->op |= bit;
+        if (c & C_WS) b->ws |= bit;
+        if (c & C_CTRL) b->ctrl |= bit;
+        if (c & C_HIGH) b->high |= bit;
+    }
+}
+
+#ifdef JSON_INDEX_X86
+/* '[' ']' 与 '{' '}' 只差 0x20 位，或上 0x20 后两次比较即可 */
+__attribute__((target("sse2")))
+static void classify_sse2(const unsigned char *p, struct json_block *b)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i lbrace = _mm_set1_epi8('{');
+    const __m128i rbrace = _mm_set1_epi8('}');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i ctrl_max = _mm_set1_epi8(0x1f);
+
+    memset(b, 0, sizeof(*b));
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+        __m128i vl = _mm_or_si128(v, lower);
+        __m128i op = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(vl, lbrace), _mm_cmpeq_epi8(vl, rbrace)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+        __m128i ws = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+        __m128i ctrl = _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl_max), v);
+        int shift = 16 * i;
+
+        b->quote |= (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << shift;
+        b->bslash |= (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, bslash)) << shift;
+        b->op |= (uint64_t)(unsigned int)_mm_movemask_epi8(op) << shift;
+        b->ws |= (uint64_t)(unsigned int)_mm_movemask_epi8(ws) << shift;
+        b->ctrl |= (uint64_t)(unsigned int)_mm_movemask_epi8(ctrl) << shift;
+        b->high |= (uint64_t)(unsigned int)_mm_movemask_epi8(v) << shift;
+    }
+}
+
+__attribute__((target("avx2")))
+static void classify_avx2(const unsigned char *p, struct json_block *b)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i bslash = _mm256_set1_epi8('\\');
+    const __m256i lower = _mm256_set1_epi8(0x20);
+    const __m256i lbrace = _mm256_set1_epi8('{');
+    const __m256i rbrace = _mm256_set1_epi8('}');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i ctrl_max = _mm256_set1_epi8(0x1f);
+
+    memset(b, 0, sizeof(*b));
+    for (int i = 0; i < 2; i++) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + 32 * i));
+        __m256i vl = _mm256_or_si256(v, lower);
+        __m256i op = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(vl, lbrace), _mm256_cmpeq_epi8(vl, rbrace)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, colon), _mm256_cmpeq_epi8(v, comma)));
+        __m256i ws = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr)));
+        __m256i ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctrl_max), v);
+        int shift = 32 * i;
+
+        b->quote |= (uint64_t)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)) << shift;
+        b->bslash |= (uint64_t)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, bslash)) << shift;
+        b->op |= (uint64_t)(unsigned int)_mm256_movemask_epi8(op) << shift;
+        b->ws |= (uint64_t)(unsigned int)_mm256_movemask_epi8(ws) << shift;
+        b->ctrl |= (uint64_t)(unsigned int)_mm256_movemask_epi8(ctrl) << shift;
+        b->high |= (uint64_t)(unsigned int)_mm256_movemask_epi8(v) << shift;
+    }
+}
+#endif
+
+static void classify_resolve(const unsigned char *p, struct json_block *b);
+
+static json_classify_fn classify_impl = classify_resolve;
+static const char *classify_name = "scalar";
+
+static void classify_set(const char *name)
+{
+#ifdef JSON_INDEX_X86
+    if (strcmp(name, "avx2") == 0) {
+        classify_impl = classify_avx2;
+        classify_name = "avx2";
+        return;
+    }
+    if (strcmp(name, "sse2") == 0) {
+        classify_impl = classify_sse2;
+        classify_name = "sse2";
+        return;
+    }
+#endif
+    classify_impl = classify_scalar;
+    classify_name = "scalar";
+}
+
+static void classify_auto_select(void)
+{
+#ifdef JSON_INDEX_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        classify_set("avx2");
+        return;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        classify_set("sse2");
+        return;
+    }
+#endif
+    classify_set("scalar");
+}
+
+/* 首次调用时探测 CPU，之后直接走选中的实现 */
+static void classify_resolve(const unsigned char *p, struct json_block *b)
+{
+    classify_auto_select();
+    classify_impl(p, b);
+}
+
+const char *http_json_index_impl(void)
+{
+    if (classify_impl == classify_resolve)
+        classify_auto_select();
+    return classify_name;
+}
+
+int http_json_index_select(const char *name)
+{
+    if (strcmp(name, "scalar") == 0) {
+        classify_set(name);
+        return 0;
+    }
+
+#ifdef JSON_INDEX_X86
+    __builtin_cpu_init();
+    if ((strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) ||
+        (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2"))) {
+        classify_set(name);
+        return 0;
+    }
+#endif
+
+    return -1;
+}
+
+/* ============ stage 1 ============ */
+
+/* 第 i 位为第 0..i 位的异或：引号位图的前缀异或即字符串区间（含起始引号，不含结束引号） */
+static inline uint64_t prefix_xor(uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/* 校验 [i, until) 中开始的 UTF-8 序列（最后一个可以越过 until），
+ * 返回最后一个序列之后的位置，非法返回 -1 */
+static long utf8_check(const unsigned char *s, size_t len, size_t i, size_t until)
+{
+    while (i < until) {
+        unsigned int c = s[i];
+        unsigned int lo = 0x80, hi = 0xbf;
+        size_t n;
+
+        if (c < 0x80) {
+            i++;
+            continue;
+        }
+
+        if (c >= 0xc2 && c <= 0xdf) {
+            n = 1;
+        } else if (c == 0xe0) {
+            n = 2;
+            lo = 0xa0;          /* 超长编码 */
+        } else if (c == 0xed) {
+            n = 2;
+            hi = 0x9f;          /* 代理区 */
+        } else if (c >= 0xe1 && c <= 0xef) {
+            n = 2;
+        } else if (c == 0xf0) {
+            n = 3;
+            lo = 0x90;
+        } else if (c == 0xf4) {
+            n = 3;
+            hi = 0x8f;          /* 超出 U+10FFFF */
+        } else if (c >= 0xf1 && c <= 0xf3) {
+            n = 3;
+        } else {
+            return -1;
+        }
+
+        if (i + n >= len || s[i + 1] < lo || s[i + 1] > hi) {
+            return -1;
+        }
+        for (size_t k = 2; k <= n; k++) {
+            if ((s[i + k] & 0xc0) != 0x80) {
+                return -1;
+            }
+        }
+        i += n + 1;
+    }
+    return (long)i;
+}
+
+static int index_fail(http_json_index_t *idx, const char *error, size_t off)
+{
+    idx->error = error;
+    idx->error_off = off;
+    return HTTP_JSON_INDEX_EINVAL;
+}
+
+static int index_reserve(http_json_index_t *idx, http_arena_t *arena, uint32_t n)
+{
+    uint32_t cap = idx->cap;
+    uint32_t *pos;
+
+    if (idx->count + n <= cap) {
+        return 0;
+    }
+    while (idx->count + n > cap) {
+        cap *= 2;
+    }
+    pos = http_arena_realloc(arena, idx->pos, idx->count * sizeof(*pos), cap * sizeof(*pos));
+    if (!pos) {
+        idx->error = "out of memory";
+        return HTTP_JSON_INDEX_ENOMEM;
+    }
+    idx->pos = pos;
+    idx->cap = cap;
+    return 0;
+}
+
+int http_json_index_build(http_json_index_t *idx, http_arena_t *arena,
+                          const char *buf, size_t len)
+{
+    const unsigned char *s = (const unsigned char *)buf;
+    uint64_t prev_escaped = 0;      /* 下一块首字节被转义 */
+    uint64_t prev_in_string = 0;    /* 全 1：上一块结束时仍在字符串内 */
+    uint64_t prev_scalar = 0;       /* 上一块末字节属于标量 */
+    size_t utf8_pos = 0;            /* 已校验到的 UTF-8 位置 */
+    unsigned char pad[64];
+    struct json_block b;
+
+    memset(idx, 0, sizeof(*idx));
+    if (len >= UINT32_MAX) {
+        return index_fail(idx, "document too large", 0);
+    }
+
+    /* 普通 JSON 每 8 字节左右一个 token，不够时倍增 */
+    idx->cap = (uint32_t)(len / 8) + 64;
+    idx->pos = http_arena_alloc(arena, idx->cap * sizeof(*idx->pos));
+    if (!idx->pos) {
+        idx->error = "out of memory";
+        return HTTP_JSON_INDEX_ENOMEM;
+    }
+
+    for (size_t off = 0; off < len; off += 64) {
+        const unsigned char *p = s + off;
+        size_t until = len - off < 64 ? len : off + 64;
+
+        /* 最后不足 64 字节的块用空格补齐 */
+        if (len - off < 64) {
+            memset(pad, ' ', sizeof(pad));
+            memcpy(pad, p, len - off);
+            p = pad;
+        }
+        classify_impl(p, &b);
+
+        /* 转义：每段连续反斜杠中，与段首奇偶相同的位是转义符，其后一个字节被转义。
+         * 段首在偶数位的段加上段首位后进位清零，据此区分两类段 */
+        uint64_t bs = b.bslash & ~prev_escaped;
+        uint64_t starts = bs & ~(bs << 1);
+        uint64_t even_runs = bs & ~(bs + (starts & EVEN_BITS));
+        uint64_t odd_runs = bs & ~even_runs;
+        uint64_t escape = (even_runs & EVEN_BITS) | (odd_runs & ~EVEN_BITS);
+        uint64_t escaped = (escape << 1) | prev_escaped;
+        prev_escaped = escape >> 63;
+
+        uint64_t quote = b.quote & ~escaped;
+        uint64_t in_string = prefix_xor(quote) ^ prev_in_string;
+        prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+
+        uint64_t err = (b.bslash | b.high) & ~in_string;
+        if (err) {
+            return index_fail(idx, "unexpected character", off + __builtin_ctzll(err));
+        }
+        err = b.ctrl & (in_string | ~b.ws);
+        if (err) {
+            return index_fail(idx, "control character", off + __builtin_ctzll(err));
+        }
+        for (uint64_t m = escaped; m; m &= m - 1) {
+            int i = __builtin_ctzll(m);
+            if (!valid_escape[p[i]]) {
+                return index_fail(idx, "invalid escape", off + i);
+            }
+        }
+        if (b.high) {
+            size_t from = off + __builtin_ctzll(b.high);
+            long end = utf8_check(s, len, from > utf8_pos ? from : utf8_pos, until);
+            if (end < 0) {
+                return index_fail(idx, "invalid UTF-8", from);
+            }
+            utf8_pos = (size_t)end;
+        }
+
+        /* token：字符串外的结构字符、字符串起始引号、标量首字节 */
+        uint64_t op = b.op & ~in_string;
+        uint64_t scalar = ~(in_string | b.op | b.ws | quote);
+        uint64_t tokens = op | (quote & in_string) | (scalar & ~((scalar << 1) | prev_scalar));
+        prev_scalar = scalar >> 63;
+
+        if (index_reserve(idx, arena, 64) < 0) {
+            return HTTP_JSON_INDEX_ENOMEM;
+        }
+        for (; tokens; tokens &= tokens - 1) {
+            idx->pos[idx->count++] = (uint32_t)(off + __builtin_ctzll(tokens));
+        }
+    }
+
+    if (prev_in_string) {
+        return index_fail(idx, "unterminated string", len);
+    }
+    return 0;
+}
+
+/* ============ stage 2 ============ */
+
+enum {
+    ST_VALUE,           /* 根值、':' 或数组 ',' 之后 */
+    ST_ARRAY_FIRST,     /* '[' 之后：值或 ']' */
+    ST_OBJECT_FIRST,    /* '{' 之后：key 或 '}' */
+    ST_KEY,             /* 对象 ',' 之后 */
+    ST_COLON,
+    ST_NEXT,            /* 容器内值之后：',' 或结束括号 */
+    ST_DONE,
+};
+
+static long hex4(const char *p)
+{
+    long v = 0;
+
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= c - '0';
+        else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+        else return -1;
+    }
+    return v;
+}
+
+static char *utf8_put(char *o, long cp)
+{
+    if (cp < 0x80) {
+        *o++ = (char)cp;
+    } else if (cp < 0x800) {
+        *o++ = (char)(0xc0 | (cp >> 6));
+        *o++ = (char)(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        *o++ = (char)(0xe0 | (cp >> 12));
+        *o++ = (char)(0x80 | ((cp >> 6) & 0x3f));
+        *o++ = (char)(0x80 | (cp & 0x3f));
+    } else {
+        *o++ = (char)(0xf0 | (cp >> 18));
+        *o++ = (char)(0x80 | ((cp >> 12) & 0x3f));
+        *o++ = (char)(0x80 | ((cp >> 6) & 0x3f));
+        *o++ = (char)(0x80 | (cp & 0x3f));
+    }
+    return o;
+}
+
+/* 字符串 token（p 指向起始引号）：原地反转义并在结尾写入 '\0'，
+ * 返回内容长度，非法 \u 转义返回 -1。结束引号与转义字符已由 stage 1 保证 */
+static long string_parse(char *p, const char *end, char **out)
+{
+    char *s = p + 1, *q = s, *o, *bs;
+    const char *i;
+
+    for (;;) {
+        char *b;
+
+        q = memchr(q, '"', (size_t)(end - q));
+        if (!q) {
+            return -1;
+        }
+        for (b = q; b > s && b[-1] == '\\'; b--)
+            ;
+        if (((q - b) & 1) == 0) {
+            break;
+        }
+        q++;
+    }
+
+    *out = s;
+    bs = memchr(s, '\\', (size_t)(q - s));
+    if (!bs) {
+        *q = '\0';
+        return q - s;
+    }
+
+    /* 反转义后不会变长：\uXXXX 最多 3 字节，代理对 12 字节变 4 字节 */
+    for (o = bs, i = bs; i < q; ) {
+        long cp, lo;
+
+        if (*i != '\\') {
+            *o++ = *i++;
+            continue;
+        }
+        i++;
+        switch (*i++) {
+        case '"': *o++ = '"'; break;
+        case '\\': *o++ = '\\'; break;
+        case '/': *o++ = '/'; break;
+        case 'b': *o++ = '\b'; break;
+        case 'f': *o++ = '\f'; break;
+        case 'n': *o++ = '\n'; break;
+        case 'r': *o++ = '\r'; break;
+        case 't': *o++ = '\t'; break;
+        case 'u':
+            cp = hex4(i);
+            if (cp < 0) {
+                return -1;
+            }
+            i += 4;
+            if (cp >= 0xd800 && cp <= 0xdbff) {
+                /* 高代理后须紧跟低代理，否则按 json-c 的做法替换为 U+FFFD */
+                if (q - i >= 6 && i[0] == '\\' && i[1] == 'u' &&
+                    (lo = hex4(i + 2)) >= 0xdc00 && lo <= 0xdfff) {
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+                    i += 6;
+                } else {
+                    cp = 0xfffd;
+                }
+            } else if (cp >= 0xdc00 && cp <= 0xdfff) {
+                cp = 0xfffd;
+            }
+            o = utf8_put(o, cp);
+            break;
+        default:
+            return -1;
+        }
+    }
+    *o = '\0';
+    return o - s;
+}
+
+/* -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?，返回 1 浮点、0 整数、-1 非法 */
+static int number_check(const char *p, const char *e)
+{
+    int is_double = 0;
+
+    if (p < e && *p == '-') p++;
+    if (p == e) return -1;
+    if (*p == '0') {
+        p++;
+    } else if (*p >= '1' && *p <= '9') {
+        while (p < e && *p >= '0' && *p <= '9') p++;
+    } else {
+        return -1;
+    }
+    if (p < e && *p == '.') {
+        is_double = 1;
+        if (++p == e || *p < '0' || *p > '9') return -1;
+        while (p < e && *p >= '0' && *p <= '9') p++;
+    }
+    if (p < e && (*p == 'e' || *p == 'E')) {
+        is_double = 1;
+        p++;
+        if (p < e && (*p == '+' || *p == '-')) p++;
+        if (p == e || *p < '0' || *p > '9') return -1;
+        while (p < e && *p >= '0' && *p <= '9') p++;
+    }
+    return p == e ? is_double : -1;
+}
+
+/* 标量 token：true / false / null / 数字；JSON null 对应 *out == NULL */
+static int scalar_parse(char *p, char *end, json_object **out)
+{
+    char *e = p;
+    size_t n;
+    int kind;
+    char saved;
+
+    while (e < end && !(char_class[(unsigned char)*e] & (C_OP | C_WS | C_QUOTE))) {
+        e++;
+    }
+    n = (size_t)(e - p);
+    *out = NULL;
+
+    if (n == 4 && memcmp(p, "true", 4) == 0) {
+        *out = json_object_new_boolean(1);
+    } else if (n == 5 && memcmp(p, "false", 5) == 0) {
+        *out = json_object_new_boolean(0);
+    } else if (n == 4 && memcmp(p, "null", 4) == 0) {
+        return 0;
+    } else {
+        kind = number_check(p, e);
+        if (kind < 0) {
+            return HTTP_JSON_INDEX_EINVAL;
+        }
+
+        /* 与 json-c 一致：整数溢出时饱和，超出 int64 的正整数存为 uint64，浮点保留原文 */
+        saved = *e;
+        *e = '\0';
+        if (kind) {
+            *out = json_object_new_double_s(strtod(p, NULL), p);
+        } else if (*p == '-') {
+            *out = json_object_new_int64(strtoll(p, NULL, 10));
+        } else {
+            unsigned long long v = strtoull(p, NULL, 10);
+            *out = v <= INT64_MAX ? json_object_new_int64((int64_t)v)
+                                  : json_object_new_uint64(v);
+        }
+        *e = saved;
+    }
+
+    return *out ? 0 : HTTP_JSON_INDEX_ENOMEM;
+}
+
+int http_json_index_parse(http_json_index_t *idx, char *buf, size_t len, json_object **out)
+{
+    json_object *stack[HTTP_JSON_INDEX_MAX_DEPTH];
+    json_object *root = NULL, *value;
+    char *end = buf + len;
+    char *key = NULL;
+    int depth = 0;
+    int state = ST_VALUE;
+    int ret;
+
+    *out = NULL;
+    if (idx->count == 0) {
+        return index_fail(idx, "empty document", len);
+    }
+
+    for (uint32_t t = 0; t < idx->count; t++) {
+        char *p = buf + idx->pos[t];
+        json_object *parent = depth ? stack[depth - 1] : NULL;
+        int in_object = parent && json_object_is_type(parent, json_type_object);
+
+        switch (state) {
+        case ST_DONE:
+            ret = index_fail(idx, "trailing characters", idx->pos[t]);
+            goto fail;
+
+        case ST_COLON:
+            if (*p != ':') {
+                ret = index_fail(idx, "expected ':'", idx->pos[t]);
+                goto fail;
+            }
+            state = ST_VALUE;
+            continue;
+
+        case ST_NEXT:
+            if (*p == ',') {
+                state = in_object ? ST_KEY : ST_VALUE;
+                continue;
+            }
+            if (*p != (in_object ? '}' : ']')) {
+                ret = index_fail(idx, "expected ',' or closing bracket", idx->pos[t]);
+                goto fail;
+            }
+            depth--;
+            state = depth ? ST_NEXT : ST_DONE;
+            continue;
+
+        case ST_OBJECT_FIRST:
+            if (*p == '}') {
+                depth--;
+                state = depth ? ST_NEXT : ST_DONE;
+                continue;
+            }
+            /* fall through */
+        case ST_KEY:
+            if (*p != '"') {
+                ret = index_fail(idx, "expected string key", idx->pos[t]);
+                goto fail;
+            }
+            if (string_parse(p, end, &key) < 0) {
+                ret = index_fail(idx, "invalid \\u escape", idx->pos[t]);
+                goto fail;
+            }
+            state = ST_COLON;
+            continue;
+
+        case ST_ARRAY_FIRST:
+            if (*p == ']') {
+                depth--;
+                state = depth ? ST_NEXT : ST_DONE;
+                continue;
+            }
+            break;
+        }
+
+        /* ST_VALUE */
+        if (*p == '{' || *p == '[') {
+            if (depth == HTTP_JSON_INDEX_MAX_DEPTH) {
+                ret = index_fail(idx, "nesting too deep", idx->pos[t]);
+                goto fail;
+            }
+            /* 请求里的数组大多很短，不用 json-c 默认的 32 项初始容量 */
+            value = *p == '{' ? json_object_new_object() : json_object_new_array_ext(4);
+            if (!value) {
+                ret = HTTP_JSON_INDEX_ENOMEM;
+                goto nomem;
+            }
+        } else if (*p == '"') {
+            char *s;
+            long n = string_parse(p, end, &s);
+            if (n < 0) {
+                ret = index_fail(idx, "invalid \\u escape", idx->pos[t]);
+                goto fail;
+            }
+            value = json_object_new_string_len(s, (int)n);
+            if (!value) {
+                ret = HTTP_JSON_INDEX_ENOMEM;
+                goto nomem;
+            }
+        } else if (char_class[(unsigned char)*p] & C_OP) {
+            ret = index_fail(idx, "unexpected character", idx->pos[t]);
+            goto fail;
+        } else {
+            ret = scalar_parse(p, end, &value);
+            if (ret == HTTP_JSON_INDEX_EINVAL) {
+                ret = index_fail(idx, "invalid literal", idx->pos[t]);
+                goto fail;
+            }
+            if (ret < 0) {
+                goto nomem;
+            }
+        }
+
+        /* 先挂到父容器上，出错时随根一起释放；key 直接引用 buf，不再 strdup */
+        if (!parent) {
+            root = value;
+        } else if ((in_object ? json_object_object_add_ex(parent, key, value,
+                                                              JSON_C_OBJECT_ADD_CONSTANT_KEY)
+                              : json_object_array_add(parent, value)) < 0) {
+            json_object_put(value);
+            ret = HTTP_JSON_INDEX_ENOMEM;
+            goto nomem;
+        }
+
+        if (*p == '{' || *p == '[') {
+            stack[depth++] = value;
+            state = *p == '{' ? ST_OBJECT_FIRST : ST_ARRAY_FIRST;
+        } else {
+            state = depth ? ST_NEXT : ST_DONE;
+        }
+    }
+
+    if (state != ST_DONE) {
+        ret = index_fail(idx, "unexpected end of document", len);
+        goto fail;
+    }
+
+    *out = root;
+    return 0;
+
+nomem:
+    idx->error = "out of memory";
+fail:
+    json_object_put(root);
+    return ret;
+}
@@ -0,0 +1,45 @@
+#ifndef HTTP_JSON_INDEX_H
+#define HTTP_JSON_INDEX_H
+
+#include "http_arena.h"
+#include <json-c/json.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* 完整 JSON 文档的两阶段解析（json-buffer 模式）
+ * - stage 1：每次分类 64 字节（AVX2 / SSE2 / 标量，运行时选择），用位运算求出转义、
+ *   字符串区间和结构字符位置；同时校验 UTF-8、转义字符和字符串内的控制字符。
+ *   非法 body 在构建任何对象之前被拒绝
+ * - stage 2：按结构索引逐个 token 校验语法并直接构建 json_object，
+ *   字符串在原缓冲区中反转义，不再经过 json_tokener 的逐字节状态机 */
+
+#define HTTP_JSON_INDEX_MAX_DEPTH 64
+
+/* 返回值 */
+#define HTTP_JSON_INDEX_EINVAL  -1      /* 非法 JSON */
+#define HTTP_JSON_INDEX_ENOMEM  -2      /* 内存不足 */
+
+typedef struct {
+    uint32_t *pos;              /* token 起始偏移：结构字符、字符串起始引号、标量首字节 */
+    uint32_t count;
+    uint32_t cap;
+    const char *error;          /* 出错原因 */
+    size_t error_off;           /* 出错位置（body 偏移） */
+} http_json_index_t;
+
+/* stage 1：扫描 buf[0, len)，token 数组从 arena 分配 */
+int http_json_index_build(http_json_index_t *idx, http_arena_t *arena,
+                          const char *buf, size_t len);
+
+/* stage 2：构建 json_object 树，成功时 *out 为根（JSON null 为 NULL），由调用方 put
+ * buf 会被改写（字符串原地反转义），要求 buf[len] 可写；
+ * 对象的 key 直接引用 buf，树必须在 buf 释放之前 put */
+int http_json_index_parse(http_json_index_t *idx, char *buf, size_t len, json_object **out);
+
+/* 当前 stage 1 实现（"avx2" / "sse2" / "scalar"） */
+const char *http_json_index_impl(void);
+
+/* 强制使用指定实现（基准测试用），CPU 不支持时返回 -1 */
+int http_json_index_select(const char *name);
+
+#endif // HTTP_JSON_INDEX_H
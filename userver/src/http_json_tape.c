@@ -0,0 +1,446 @@
+#include "http_json_tape.h"
+#include <string.h>
+
+#define TAPE_MIN_BUF        1024
+#define TAPE_MAX_PRESIZE    (1024 * 1024)   /* size_hint 来自客户端，预分配不超过 1MB */
+#define TAPE_MIN_ENTRIES    32
+
+/* 解析状态 */
+enum {
+    ST_VALUE,                   /* 期望一个值 */
+    ST_VALUE_OR_END,            /* '[' 之后：值或 ']' */
+    ST_KEY,                     /* ',' 之后：key */
+    ST_KEY_OR_END,              /* '{' 之后：key 或 '}' */
+    ST_COLON,
+    ST_AFTER,                   /* 值之后：',' 或闭合括号 */
+    ST_DONE,                    /* 根值结束，只允许空白 */
+    ST_STRING,
+    ST_ESCAPE,
+    ST_UNICODE,
+    ST_LITERAL,
+    ST_NUM_MINUS,               /* '-' 之后 */
+    ST_NUM_ZERO,                /* 整数部分为 0 */
+    ST_NUM_INT,
+    ST_NUM_DOT,                 /* '.' 之后 */
+    ST_NUM_FRAC,
+    ST_NUM_E,                   /* 'e' 之后 */
+    ST_NUM_ESIGN,               /* 指数符号之后 */
+    ST_NUM_EXP,
+};
+
+static int is_ws(unsigned char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int is_digit(unsigned char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static int is_hex(unsigned char c)
+{
+    return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static int tape_fail(http_json_tape_t *t, const char *error)
+{
+    if (!t->error) {
+        t->error = error;
+    }
+    return -1;
+}
+
+int http_tape_init(http_json_tape_t *t, http_arena_t *arena, size_t size_hint, size_t max)
+{
+    memset(t, 0, sizeof(*t));
+    t->arena = arena;
+    t->max = max;
+    t->state = ST_VALUE;
+
+    t->cap = size_hint < TAPE_MIN_BUF ? TAPE_MIN_BUF : size_hint;
+    if (t->cap > TAPE_MAX_PRESIZE) {
+        t->cap = TAPE_MAX_PRESIZE;
+    }
+    if (t->cap > max) {
+        t->cap = max;
+    }
+    t->buf = http_arena_alloc(arena, t->cap);
+
+    /* 粗略按每 32 字节一个值预留 tape，不足时倍增 */
+    t->tape_cap = t->cap / 32 < TAPE_MIN_ENTRIES ? TAPE_MIN_ENTRIES : (uint32_t)(t->cap / 32);
+    t->tape = http_arena_alloc(arena, t->tape_cap * sizeof(http_tape_entry_t));
+
+    if (!t->buf || !t->tape) {
+        return tape_fail(t, "out of memory");
+    }
+    return 0;
+}
+
+/* ============ tape 条目 ============ */
+
+/* 值开始：新建条目并绑定待定的 key */
+static int tape_begin(http_json_tape_t *t, int type, size_t off)
+{
+    http_tape_entry_t *e;
+
+    if (t->count == t->tape_cap) {
+        uint32_t cap = t->tape_cap * 2;
+        http_tape_entry_t *tape = http_arena_realloc(t->arena, t->tape,
+                                                     t->tape_cap * sizeof(*tape),
+                                                     cap * sizeof(*tape));
+        if (!tape) {
+            return tape_fail(t, "out of memory");
+        }
+        t->tape = tape;
+        t->tape_cap = cap;
+    }
+
+    t->cur = t->count++;
+    e = &t->tape[t->cur];
+    e->type = type;
+    e->depth = t->depth;
+    e->has_key = t->has_key;
+    e->key_off = t->key_off;
+    e->key_len = t->key_len;
+    e->off = off;
+    e->len = 0;
+    e->end = t->count;
+    t->has_key = 0;
+    return 0;
+}
+
+/* 值结束（end 为值之后的偏移）：切换到值之后的状态 */
+static void tape_end(http_json_tape_t *t, uint32_t idx, size_t end)
+{
+    t->tape[idx].len = end - t->tape[idx].off;
+    t->tape[idx].end = t->count;
+    t->state = t->depth == 0 ? ST_DONE : ST_AFTER;
+}
+
+static int tape_open(http_json_tape_t *t, int type, size_t off)
+{
+    if (t->depth == HTTP_TAPE_MAX_DEPTH) {
+        return tape_fail(t, "nesting too deep");
+    }
+    if (tape_begin(t, type, off) < 0) {
+        return -1;
+    }
+    t->stack[t->depth++] = t->cur;
+    t->state = type == HTTP_TAPE_OBJECT ? ST_KEY_OR_END : ST_VALUE_OR_END;
+    return 0;
+}
+
+static int tape_close(http_json_tape_t *t, int type, size_t off)
+{
+    uint32_t idx;
+
+    if (t->depth == 0 || t->tape[t->stack[t->depth - 1]].type != type) {
+        return tape_fail(t, "unbalanced bracket");
+    }
+    idx = t->stack[--t->depth];
+    tape_end(t, idx, off + 1);
+    return 0;
+}
+
+/* ============ 增量扫描 ============ */
+
+/* 以字符 c 开始一个值，失败返回 -1 */
+static int scan_value(http_json_tape_t *t, unsigned char c, size_t i)
+{
+    switch (c) {
+    case '{':
+        return tape_open(t, HTTP_TAPE_OBJECT, i);
+    case '[':
+        return tape_open(t, HTTP_TAPE_ARRAY, i);
+    case '"':
+        t->str_is_key = 0;
+        t->state = ST_STRING;
+        return tape_begin(t, HTTP_TAPE_STRING, i);
+    case '-':
+        t->state = ST_NUM_MINUS;
+        return tape_begin(t, HTTP_TAPE_NUMBER, i);
+    case 't':
+    case 'f':
+    case 'n':
+        t->lit = c == 't' ? "true" : c == 'f' ? "false" : "null";
+        t->aux = 1;
+        t->state = ST_LITERAL;
+        return tape_begin(t, c == 't' ? HTTP_TAPE_TRUE : c == 'f' ? HTTP_TAPE_FALSE : HTTP_TAPE_NULL, i);
+    default:
+        if (is_digit(c)) {
+            t->state = c == '0' ? ST_NUM_ZERO : ST_NUM_INT;
+            return tape_begin(t, HTTP_TAPE_NUMBER, i);
+        }
+        return tape_fail(t, "unexpected character");
+    }
+}
+
+static int tape_scan(http_json_tape_t *t)
+{
+    const unsigned char *buf = (const unsigned char *)t->buf;
+    size_t len = t->len;
+    size_t i = t->pos;
+
+    while (i < len) {
+        unsigned char c = buf[i];
+
+        switch (t->state) {
+        case ST_VALUE:
+        case ST_VALUE_OR_END:
+            if (is_ws(c)) break;
+            if (c == ']' && t->state == ST_VALUE_OR_END) {
+                if (tape_close(t, HTTP_TAPE_ARRAY, i) < 0) return -1;
+                break;
+            }
+            if (scan_value(t, c, i) < 0) return -1;
+            break;
+
+        case ST_KEY:
+        case ST_KEY_OR_END:
+            if (is_ws(c)) break;
+            if (c == '}' && t->state == ST_KEY_OR_END) {
+                if (tape_close(t, HTTP_TAPE_OBJECT, i) < 0) return -1;
+                break;
+            }
+            if (c != '"') return tape_fail(t, "expected object key");
+            t->key_off = i + 1;
+            t->str_is_key = 1;
+            t->state = ST_STRING;
+            break;
+
+        case ST_COLON:
+            if (is_ws(c)) break;
+            if (c != ':') return tape_fail(t, "expected ':'");
+            t->state = ST_VALUE;
+            break;
+
+        case ST_AFTER:
+            if (is_ws(c)) break;
+            if (c == ',') {
+                int type = t->tape[t->stack[t->depth - 1]].type;
+                t->state = type == HTTP_TAPE_OBJECT ? ST_KEY : ST_VALUE;
+            } else if (c == '}' || c == ']') {
+                if (tape_close(t, c == '}' ? HTTP_TAPE_OBJECT : HTTP_TAPE_ARRAY, i) < 0)
+                    return -1;
+            } else {
+                return tape_fail(t, "expected ',' or closing bracket");
+            }
+            break;
+
+        case ST_DONE:
+            if (!is_ws(c)) return tape_fail(t, "trailing data");
+            break;
+
+        case ST_STRING:
+            /* 普通字符成段跳过 */
+            while (c != '"' && c != '\\' && c >= 0x20) {
+                if (++i == len) {
+                    t->pos = i;
+                    return 0;
+                }
+                c = buf[i];
+            }
+            if (c == '\\') {
+                t->state = ST_ESCAPE;
+            } else if (c == '"') {
+                if (t->str_is_key) {
+                    t->key_len = i - t->key_off;
+                    t->has_key = 1;
+                    t->state = ST_COLON;
+                } else {
+                    tape_end(t, t->cur, i + 1);
+                }
+            } else {
+                return tape_fail(t, "control character in string");
+            }
+            break;
+
+        case ST_ESCAPE:
+            if (c == 'u') {
+                t->aux = 4;
+                t->state = ST_UNICODE;
+            } else if (c && strchr("\"\\/bfnrt", c)) {
+                t->state = ST_STRING;
+            } else {
+                return tape_fail(t, "invalid escape");
+            }
+            break;
+
+        case ST_UNICODE:
+            if (!is_hex(c)) return tape_fail(t, "invalid \\u escape");
+            if (--t->aux == 0) {
+                t->state = ST_STRING;
+            }
+            break;
+
+        case ST_LITERAL:
+            if (c != (unsigned char)t->lit[t->aux]) return tape_fail(t, "invalid literal");
+            if (t->lit[++t->aux] == '\0') {
+                tape_end(t, t->cur, i + 1);
+            }
+            break;
+
+        case ST_NUM_MINUS:
+            if (!is_digit(c)) return tape_fail(t, "invalid number");
+            t->state = c == '0' ? ST_NUM_ZERO : ST_NUM_INT;
+            break;
+
+        case ST_NUM_INT:
+            if (is_digit(c)) break;
+            /* fall through */
+        case ST_NUM_ZERO:
+            if (c == '.') {
+                t->state = ST_NUM_DOT;
+            } else if (c == 'e' || c == 'E') {
+                t->state = ST_NUM_E;
+            } else {
+                /* 数字结束：当前字符交给下一个状态 */
+                tape_end(t, t->cur, i);
+                continue;
+            }
+            break;
+
+        case ST_NUM_DOT:
+            if (!is_digit(c)) return tape_fail(t, "invalid number");
+            t->state = ST_NUM_FRAC;
+            break;
+
+        case ST_NUM_FRAC:
+            if (is_digit(c)) break;
+            if (c == 'e' || c == 'E') {
+                t->state = ST_NUM_E;
+                break;
+            }
+            tape_end(t, t->cur, i);
+            continue;
+
+        case ST_NUM_E:
+            if (c == '+' || c == '-') {
+                t->state = ST_NUM_ESIGN;
+                break;
+            }
+            /* fall through */
+        case ST_NUM_ESIGN:
+            if (!is_digit(c)) return tape_fail(t, "invalid number");
+            t->state = ST_NUM_EXP;
+            break;
+
+        case ST_NUM_EXP:
+            if (is_digit(c)) break;
+            tape_end(t, t->cur, i);
+            continue;
+        }
+
+        i++;
+    }
+
+    t->pos = i;
+    return 0;
+}
+
+int http_tape_feed(http_json_tape_t *t, const char *data, size_t len)
+{
+    if (t->error) return -1;
+
+    if (t->len + len > t->max) {
+        return tape_fail(t, "body too large");
+    }
+
+    if (t->len + len > t->cap) {
+        size_t cap = t->cap * 2;
+        while (cap < t->len + len) {
+            cap *= 2;
+        }
+        if (cap > t->max) {
+            cap = t->max;
+        }
+        char *buf = http_arena_realloc(t->arena, t->buf, t->len, cap);
+        if (!buf) {
+            return tape_fail(t, "out of memory");
+        }
+        t->buf = buf;
+        t->cap = cap;
+    }
+
+    memcpy(t->buf + t->len, data, len);
+    t->len += len;
+
+    return tape_scan(t);
+}
+
+int http_tape_finish(http_json_tape_t *t)
+{
+    if (t->error) return -1;
+
+    /* 根为数字时以 body 结束作为数字结束 */
+    if (t->depth == 0 && (t->state == ST_NUM_ZERO || t->state == ST_NUM_INT ||
+                          t->state == ST_NUM_FRAC || t->state == ST_NUM_EXP)) {
+        tape_end(t, t->cur, t->len);
+    }
+
+    if (t->state == ST_DONE || (t->state == ST_VALUE && t->count == 0)) {
+        return 0;
+    }
+    return tape_fail(t, "unexpected end of body");
+}
+
+/* ============ 查找 ============ */
+
+int http_tape_find(const http_json_tape_t *t, int parent, const char *key, size_t key_len)
+{
+    const http_tape_entry_t *p;
+    int found = -1;
+
+    if (parent < 0 || (uint32_t)parent >= t->count) return -1;
+
+    p = &t->tape[parent];
+    if (p->type != HTTP_TAPE_OBJECT) return -1;
+
+    for (uint32_t i = parent + 1; i < p->end; i = t->tape[i].end) {
+        const http_tape_entry_t *e = &t->tape[i];
+        if (e->key_len == key_len && memcmp(t->buf + e->key_off, key, key_len) == 0) {
+            found = i;
+        }
+    }
+    return found;
+}
+
+/* 数组第 n 个元素 */
+static int tape_index(const http_json_tape_t *t, int parent, size_t n)
+{
+    const http_tape_entry_t *p = &t->tape[parent];
+
+    if (p->type != HTTP_TAPE_ARRAY) return -1;
+
+    for (uint32_t i = parent + 1; i < p->end; i = t->tape[i].end) {
+        if (n-- == 0) return i;
+    }
+    return -1;
+}
+
+int http_tape_lookup(const http_json_tape_t *t, const char *path)
+{
+    int idx = 0;
+
+    if (t->count == 0) return -1;
+
+    while (*path && idx >= 0) {
+        size_t n = strcspn(path, ".");
+
+        if (t->tape[idx].type == HTTP_TAPE_ARRAY) {
+            size_t k = 0, j;
+            for (j = 0; j < n && is_digit((unsigned char)path[j]); j++) {
+                k = k * 10 + (path[j] - '0');
+            }
+            idx = (n > 0 && j == n) ? tape_index(t, idx, k) : -1;
+        } else {
+            idx = http_tape_find(t, idx, path, n);
+        }
+
+        path += n;
+        if (*path == '.') path++;
+    }
+
+    return idx;
+}
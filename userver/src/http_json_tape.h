@@ -0,0 +1,89 @@
+#ifndef HTTP_JSON_TAPE_H
+#define HTTP_JSON_TAPE_H
+
+#include "http_arena.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* 流式 JSON tape（json-lazy 模式）
+ * - body 分片到达时追加到 arena 中的连续缓冲区，并由增量状态机立即校验
+ * - 每个值在 tape 中占一个条目：类型、所属成员的 key 与值原文在缓冲区中的区间；
+ *   不构建 json_object 树，整个请求只有 body 缓冲区和 tape 数组两块内存
+ * - 取值时按 key 路径在 tape 上跳跃查找，值原文可直接写入响应（http_jw_raw） */
+
+#define HTTP_TAPE_MAX_DEPTH 64
+
+enum {
+    HTTP_TAPE_OBJECT = 1,
+    HTTP_TAPE_ARRAY,
+    HTTP_TAPE_STRING,
+    HTTP_TAPE_NUMBER,
+    HTTP_TAPE_TRUE,
+    HTTP_TAPE_FALSE,
+    HTTP_TAPE_NULL,
+};
+
+typedef struct {
+    uint8_t type;               /* HTTP_TAPE_* */
+    uint8_t depth;              /* 根为 0 */
+    uint8_t has_key;            /* 对象成员 */
+    uint32_t key_off;           /* key 原文（引号内，未反转义） */
+    uint32_t key_len;
+    uint32_t off;               /* 值原文 [off, off + len)，字符串含引号，容器含括号 */
+    uint32_t len;
+    uint32_t end;               /* 该值子树之后的下一个条目（同层下一个兄弟） */
+} http_tape_entry_t;
+
+typedef struct {
+    http_arena_t *arena;
+
+    /* 已接收的 body */
+    char *buf;
+    size_t len;
+    size_t cap;
+    size_t max;
+
+    /* tape */
+    http_tape_entry_t *tape;
+    uint32_t count;
+    uint32_t tape_cap;
+
+    /* 增量解析状态 */
+    size_t pos;                 /* 下一个待扫描字节 */
+    int state;
+    int depth;
+    uint32_t stack[HTTP_TAPE_MAX_DEPTH];  /* 未闭合容器的条目下标 */
+    uint32_t cur;               /* 正在扫描的标量条目 */
+    uint32_t key_off;           /* 待绑定到下一个值的 key */
+    uint32_t key_len;
+    int has_key;
+    int str_is_key;
+    const char *lit;            /* 正在匹配的 true/false/null */
+    int aux;                    /* 字面量下标 / \u 剩余位数 */
+    const char *error;          /* 出错原因，NULL 表示正常 */
+} http_json_tape_t;
+
+/* 初始化：size_hint 为预估 body 大小（如 Content-Length），max 为 body 上限 */
+int http_tape_init(http_json_tape_t *t, http_arena_t *arena, size_t size_hint, size_t max);
+
+/* 追加 body 分片并继续解析，出错（语法错误、超过上限、内存不足）返回 -1 */
+int http_tape_feed(http_json_tape_t *t, const char *data, size_t len);
+
+/* body 结束：根值完整（或 body 只有空白）返回 0 */
+int http_tape_finish(http_json_tape_t *t);
+
+/* 在对象条目 parent 中查找成员（重复的 key 取最后一个），未找到返回 -1
+ * key 按原文比较：含转义字符的 key 需以相同写法给出 */
+int http_tape_find(const http_json_tape_t *t, int parent, const char *key, size_t key_len);
+
+/* 按路径查找："data"、"user.name"、"items.0"（数字作为数组下标），根为 ""；未找到返回 -1 */
+int http_tape_lookup(const http_json_tape_t *t, const char *path);
+
+/* 值原文（合法 JSON，可直接输出） */
+static inline const char *http_tape_raw(const http_json_tape_t *t, int idx, size_t *len)
+{
+    *len = t->tape[idx].len;
+    return t->buf + t->tape[idx].off;
+}
+
+#endif // HTTP_JSON_TAPE_H
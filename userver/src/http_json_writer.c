@@ -0,0 +1,272 @@
+#include "http_json_writer.h"
+#include <string.h>
+
+#define JW_MIN_CAP 256
+
+/* 需要转义的字符：0 表示原样输出，'u' 表示 \u00XX，其余为 '\' 后的转义字符 */
+static const char jw_escape[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0,
+};
+
+static const char jw_hex_digits[] = "0123456789abcdef";
+
+/* 确保还能写入 n 字节；缓冲区是 arena 中最近一次分配时原地扩展 */
+static int jw_reserve(http_json_writer_t *w, size_t n)
+{
+    if (w->error) return -1;
+    if (w->len + n <= w->cap) return 0;
+
+    size_t new_cap = w->cap ? w->cap * 2 : JW_MIN_CAP;
+    while (new_cap < w->len + n) {
+        new_cap *= 2;
+    }
+
+    char *buf = http_arena_realloc(w->arena, w->buf, w->len, new_cap);
+    if (!buf) {
+        w->error = 1;
+        return -1;
+    }
+    w->buf = buf;
+    w->cap = new_cap;
+    return 0;
+}
+
+static void jw_put(http_json_writer_t *w, const char *data, size_t len)
+{
+    if (jw_reserve(w, len) < 0) return;
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+static void jw_putc(http_json_writer_t *w, char c)
+{
+    if (jw_reserve(w, 1) < 0) return;
+    w->buf[w->len++] = c;
+}
+
+/* 值或 key 之前：同层非首个元素补逗号 */
+static void jw_separator(http_json_writer_t *w)
+{
+    if (w->after_key) {
+        w->after_key = 0;
+        return;
+    }
+    if (w->depth == 0) return;
+
+    uint64_t bit = 1ULL << (w->depth - 1);
+    if (w->has_items & bit) {
+        jw_putc(w, ',');
+    } else {
+        w->has_items |= bit;
+    }
+}
+
+static void jw_open(http_json_writer_t *w, char c)
+{
+    jw_separator(w);
+    if (w->depth >= HTTP_JW_MAX_DEPTH) {
+        w->error = 1;
+        return;
+    }
+    w->depth++;
+    w->has_items &= ~(1ULL << (w->depth - 1));
+    jw_putc(w, c);
+}
+
+static void jw_close(http_json_writer_t *w, char c)
+{
+    if (w->depth == 0 || w->after_key) {
+        w->error = 1;
+        return;
+    }
+    w->depth--;
+    jw_putc(w, c);
+}
+
+/* 带引号的字符串：无需转义的片段整段拷贝 */
+static void jw_quoted(http_json_writer_t *w, const char *str, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)str;
+    const unsigned char *end = p + len;
+
+    /* 多数字符串无需转义，按原长预留一次 */
+    if (jw_reserve(w, len + 2) < 0) return;
+    w->buf[w->len++] = '"';
+
+    while (p < end) {
+        const unsigned char *run = p;
+        while (p < end && !jw_escape[*p]) {
+            p++;
+        }
+        if (p > run) {
+            jw_put(w, (const char *)run, p - run);
+        }
+        if (p == end) break;
+
+        char e = jw_escape[*p];
+        if (e == 'u') {
+            char u[6] = { '\\', 'u', '0', '0',
+                          jw_hex_digits[*p >> 4], jw_hex_digits[*p & 0xf] };
+            jw_put(w, u, sizeof(u));
+        } else {
+            char s[2] = { '\\', e };
+            jw_put(w, s, sizeof(s));
+        }
+        p++;
+    }
+
+    jw_putc(w, '"');
+}
+
+void http_jw_init(http_json_writer_t *w, http_arena_t *arena, size_t size_hint)
+{
+    memset(w, 0, sizeof(*w));
+    w->arena = arena;
+    jw_reserve(w, size_hint > JW_MIN_CAP ? size_hint : JW_MIN_CAP);
+}
+
+void http_jw_object_begin(http_json_writer_t *w)
+{
+    jw_open(w, '{');
+}
+
+void http_jw_object_end(http_json_writer_t *w)
+{
+    jw_close(w, '}');
+}
+
+void http_jw_array_begin(http_json_writer_t *w)
+{
+    jw_open(w, '[');
+}
+
+void http_jw_array_end(http_json_writer_t *w)
+{
+    jw_close(w, ']');
+}
+
+void http_jw_key(http_json_writer_t *w, const char *key, size_t len)
+{
+    jw_separator(w);
+    jw_quoted(w, key, len);
+    jw_putc(w, ':');
+    w->after_key = 1;
+}
+
+void http_jw_string(http_json_writer_t *w, const char *str, size_t len)
+{
+    jw_separator(w);
+    jw_quoted(w, str, len);
+}
+
+void http_jw_int(http_json_writer_t *w, int64_t value)
+{
+    char tmp[24];
+    char *p = tmp + sizeof(tmp);
+    uint64_t u = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+
+    do {
+        *--p = '0' + (char)(u % 10);
+        u /= 10;
+    } while (u);
+    if (value < 0) *--p = '-';
+
+    jw_separator(w);
+    jw_put(w, p, tmp + sizeof(tmp) - p);
+}
+
+void http_jw_bool(http_json_writer_t *w, int value)
+{
+    jw_separator(w);
+    if (value) {
+        jw_put(w, HTTP_JW_LIT("true"));
+    } else {
+        jw_put(w, HTTP_JW_LIT("false"));
+    }
+}
+
+void http_jw_null(http_json_writer_t *w)
+{
+    jw_separator(w);
+    jw_put(w, HTTP_JW_LIT("null"));
+}
+
+void http_jw_json(http_json_writer_t *w, json_object *obj)
+{
+    if (w->error) return;
+
+    switch (json_object_get_type(obj)) {
+    case json_type_null:
+        http_jw_null(w);
+        break;
+    case json_type_boolean:
+        http_jw_bool(w, json_object_get_boolean(obj));
+        break;
+    case json_type_int: {
+        int64_t v = json_object_get_int64(obj);
+        if (v == INT64_MAX && json_object_get_uint64(obj) > (uint64_t)INT64_MAX) {
+            /* 超出 int64 的正整数交给 json-c 输出 */
+            size_t len;
+            const char *s = json_object_to_json_string_length(obj, JSON_C_TO_STRING_PLAIN, &len);
+            jw_separator(w);
+            jw_put(w, s, len);
+        } else {
+            http_jw_int(w, v);
+        }
+        break;
+    }
+    case json_type_double: {
+        /* 浮点保留请求中的原始写法，交给 json-c 输出 */
+        size_t len;
+        const char *s = json_object_to_json_string_length(obj, JSON_C_TO_STRING_PLAIN, &len);
+        jw_separator(w);
+        jw_put(w, s, len);
+        break;
+    }
+    case json_type_string:
+        http_jw_string(w, json_object_get_string(obj),
+                       (size_t)json_object_get_string_len(obj));
+        break;
+    case json_type_array: {
+        size_t n = json_object_array_length(obj);
+        http_jw_array_begin(w);
+        for (size_t i = 0; i < n; i++) {
+            http_jw_json(w, json_object_array_get_idx(obj, i));
+        }
+        http_jw_array_end(w);
+        break;
+    }
+    case json_type_object: {
+        http_jw_object_begin(w);
+        json_object_object_foreach(obj, key, val) {
+            http_jw_key(w, key, strlen(key));
+            http_jw_json(w, val);
+        }
+        http_jw_object_end(w);
+        break;
+    }
+    }
+}
+
+void http_jw_raw(http_json_writer_t *w, const char *json, size_t len)
+{
+    if (w->error) return;
+
+    jw_separator(w);
+    jw_put(w, json, len);
+}
+
+int http_jw_finish(http_json_writer_t *w, const char **body, size_t *len)
+{
+    if (w->error || w->depth != 0 || w->after_key) {
+        return -1;
+    }
+    *body = w->buf;
+    *len = w->len;
+    return 0;
+}
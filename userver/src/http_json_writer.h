@@ -0,0 +1,56 @@
+#ifndef HTTP_JSON_WRITER_H
+#define HTTP_JSON_WRITER_H
+
+#include "http_arena.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <json-c/json.h>
+
+/* 流式 JSON 输出
+ * - 直接写入请求 arena 中的连续缓冲区，不构建 json_object 树
+ * - 生成的缓冲区可直接作为响应 body（http_set_response 不再拷贝）
+ * - 逗号、冒号由 writer 自动插入；任何一步失败后续调用均为空操作，
+ *   最终由 http_jw_finish() 统一报告 */
+
+#define HTTP_JW_MAX_DEPTH 64
+
+/* 字面量字符串参数：http_jw_key(w, HTTP_JW_LIT("status")) */
+#define HTTP_JW_LIT(str) (str), sizeof(str) - 1
+
+typedef struct {
+    http_arena_t *arena;
+    char *buf;
+    size_t len;
+    size_t cap;
+    int error;
+    int depth;
+    int after_key;          /* 刚写完 key，下一个值前不需要逗号 */
+    uint64_t has_items;     /* 每层一位：该层是否已有元素 */
+} http_json_writer_t;
+
+/* 初始化；size_hint 为预估输出大小，可为 0 */
+void http_jw_init(http_json_writer_t *w, http_arena_t *arena, size_t size_hint);
+
+void http_jw_object_begin(http_json_writer_t *w);
+void http_jw_object_end(http_json_writer_t *w);
+void http_jw_array_begin(http_json_writer_t *w);
+void http_jw_array_end(http_json_writer_t *w);
+
+/* 对象 key（按 JSON 规则转义） */
+void http_jw_key(http_json_writer_t *w, const char *key, size_t len);
+
+void http_jw_string(http_json_writer_t *w, const char *str, size_t len);
+void http_jw_int(http_json_writer_t *w, int64_t value);
+void http_jw_bool(http_json_writer_t *w, int value);
+void http_jw_null(http_json_writer_t *w);
+
+/* 把已解析的 json_object 原样写出（回显请求数据用） */
+void http_jw_json(http_json_writer_t *w, json_object *obj);
+
+/* 写入一个已校验过的 JSON 值原文（如 http_tape_raw() 取得的请求片段），不做转义 */
+void http_jw_raw(http_json_writer_t *w, const char *json, size_t len);
+
+/* 结束输出：成功返回 0 并给出 body，失败（内存不足或嵌套不平衡）返回 -1 */
+int http_jw_finish(http_json_writer_t *w, const char **body, size_t *len);
+
+#endif // HTTP_JSON_WRITER_H
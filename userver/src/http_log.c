@@ -0,0 +1,306 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <libubox/uloop.h>
+#include "http_log.h"
+
+/* 环形缓冲区：head / tail 为累计字节数，已用 = head - tail（单线程，不需要原子操作） */
+static char *g_ring = NULL;
+static size_t g_ring_size = 0;
+static uint64_t g_head = 0;
+static uint64_t g_tail = 0;
+
+static int g_fd = STDERR_FILENO;
+static int g_pipe = -1;             /* 写出目标不是普通文件（管道、终端等），-1 未检查 */
+static int g_access = 0;            /* 已打开访问日志 */
+static struct http_log_stats g_stats;
+
+static void http_log_flush_cb(struct uloop_timeout *t);
+static struct uloop_timeout g_flush_timer = { .cb = http_log_flush_cb };
+
+/* 每秒格式化一次的时间戳 */
+static time_t g_ts_sec = -1;
+static char g_ts[24];
+static size_t g_ts_len;
+
+static int log_ring_init(size_t size)
+{
+    g_ring = malloc(size);
+    if (!g_ring) {
+        return -1;
+    }
+    g_ring_size = size;
+    return 0;
+}
+
+int http_log_open(const char *path, size_t ring_size)
+{
+    int fd;
+
+    if (strcmp(path, "-") == 0) {
+        fd = STDOUT_FILENO;
+    } else {
+        fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return -1;
+        }
+    }
+
+    if (!g_ring && log_ring_init(ring_size ? ring_size : HTTP_LOG_RING) < 0) {
+        if (fd != STDOUT_FILENO) {
+            close(fd);
+        }
+        return -1;
+    }
+    g_fd = fd;
+    g_pipe = -1;
+    g_access = 1;
+    return 0;
+}
+
+/* 本次写出的字节数
+ * 普通文件（O_APPEND）的一次 write 在内核中整体追加，成批写出即可；管道只保证不超过
+ * PIPE_BUF 的写入不与其他进程交错，截到 PIPE_BUF 内最后一个 '\n'（单条记录超过 PIPE_BUF 时整条写出） */
+static size_t log_write_len(size_t used)
+{
+    size_t i;
+
+    if (g_pipe < 0) {
+        struct stat st;
+        g_pipe = fstat(g_fd, &st) == 0 && !S_ISREG(st.st_mode);
+    }
+    if (!g_pipe || used <= PIPE_BUF) {
+        return used;
+    }
+
+    for (i = PIPE_BUF; i > 0; i--) {
+        if (g_ring[(g_tail + i - 1) % g_ring_size] == '\n') {
+            return i;
+        }
+    }
+    for (i = PIPE_BUF; i < used; i++) {
+        if (g_ring[(g_tail + i) % g_ring_size] == '\n') {
+            return i + 1;
+        }
+    }
+    return used;
+}
+
+/* 写出已缓冲的记录；drain 为 0 时部分写出或 EAGAIN 留到下次定时器 */
+static void log_write(int drain)
+{
+    while (g_head != g_tail) {
+        size_t used = log_write_len(g_head - g_tail);
+        size_t off = g_tail % g_ring_size;
+        size_t first = used < g_ring_size - off ? used : g_ring_size - off;
+        struct iovec iov[2] = {
+            { .iov_base = g_ring + off, .iov_len = first },
+            { .iov_base = g_ring, .iov_len = used - first },
+        };
+        ssize_t n = writev(g_fd, iov, used > first ? 2 : 1);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN && !drain) {
+                break;
+            }
+            /* 日志目标不可写：丢弃已缓冲的记录，不影响请求处理 */
+            g_stats.write_errors++;
+            g_tail = g_head;
+            break;
+        }
+        g_tail += n;
+        g_stats.flushes++;
+        if ((size_t)n < used && !drain) {
+            break;
+        }
+    }
+
+    if (g_head != g_tail && !drain) {
+        uloop_timeout_set(&g_flush_timer, HTTP_LOG_FLUSH_MS);
+    }
+}
+
+static void http_log_flush_cb(struct uloop_timeout *t)
+{
+    log_write(0);
+}
+
+void http_log_flush(void)
+{
+    uloop_timeout_cancel(&g_flush_timer);
+    if (g_ring) {
+        log_write(1);
+    }
+}
+
+/* 追加一条完整的记录，放不下时整条丢弃 */
+static void log_put(const char *line, size_t len)
+{
+    size_t off, first;
+
+    if (!g_ring && log_ring_init(HTTP_LOG_RING) < 0) {
+        g_stats.dropped++;
+        return;
+    }
+    if (len > g_ring_size - (g_head - g_tail)) {
+        g_stats.dropped++;
+        return;
+    }
+
+    off = g_head % g_ring_size;
+    first = len < g_ring_size - off ? len : g_ring_size - off;
+    memcpy(g_ring + off, line, first);
+    memcpy(g_ring, line + first, len - first);
+    g_head += len;
+    g_stats.records++;
+
+    /* 超过一半时尽快写出，否则等定时器攒一批 */
+    if (g_head - g_tail >= g_ring_size / 2) {
+        uloop_timeout_set(&g_flush_timer, 0);
+    } else if (!g_flush_timer.pending) {
+        uloop_timeout_set(&g_flush_timer, HTTP_LOG_FLUSH_MS);
+    }
+}
+
+/* ============ 记录格式 ============ */
+
+static char *log_str(char *p, const char *s, size_t len)
+{
+    memcpy(p, s, len);
+    return p + len;
+}
+
+#define LOG_LIT(p, str) log_str(p, str, sizeof(str) - 1)
+
+static char *log_num(char *p, uint64_t v)
+{
+    char tmp[20];
+    size_t n = 0;
+
+    do {
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    while (n > 0) {
+        *p++ = tmp[--n];
+    }
+    return p;
+}
+
+/* JSON 字符串内容转义（不含引号），每个输入字节最多输出 6 字节 */
+static char *log_escape(char *p, const char *s, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = s[i];
+
+        if (c == '"' || c == '\\') {
+            *p++ = '\\';
+            *p++ = c;
+        } else if (c < 0x20 || c == 0x7f) {
+            p = LOG_LIT(p, "\\u00");
+            *p++ = hex[c >> 4];
+            *p++ = hex[c & 15];
+        } else {
+            *p++ = c;
+        }
+    }
+    return p;
+}
+
+/* {"time":"...", */
+static char *log_begin(char *p)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    if (ts.tv_sec != g_ts_sec) {
+        struct tm tm;
+
+        gmtime_r(&ts.tv_sec, &tm);
+        g_ts_len = strftime(g_ts, sizeof(g_ts), "%Y-%m-%dT%H:%M:%SZ", &tm);
+        g_ts_sec = ts.tv_sec;
+    }
+    p = LOG_LIT(p, "{\"time\":\"");
+    p = log_str(p, g_ts, g_ts_len);
+    return LOG_LIT(p, "\",");
+}
+
+void http_log_access(struct http_conn *conn, int tls, uint64_t bytes, uint64_t usec)
+{
+    static const char *const tls_names[] = { "none", "full", "resumed" };
+    char line[HTTP_LOG_URL_MAX * 6 + 256];
+    const char *method = llhttp_method_name(conn->parser.method);
+    size_t url_len = conn->url ? conn->url_len : 0;
+    char *p = line;
+
+    if (!g_access) {
+        return;
+    }
+    if (url_len > HTTP_LOG_URL_MAX) {
+        url_len = HTTP_LOG_URL_MAX;
+    }
+
+    p = log_begin(p);
+    p = LOG_LIT(p, "\"method\":\"");
+    p = log_str(p, method, strlen(method));
+    p = LOG_LIT(p, "\",\"path\":\"");
+    p = log_escape(p, conn->url, url_len);
+    p = LOG_LIT(p, "\",\"status\":");
+    p = log_num(p, conn->status_code);
+    p = LOG_LIT(p, ",\"bytes\":");
+    p = log_num(p, bytes);
+    p = LOG_LIT(p, ",\"us\":");
+    p = log_num(p, usec);
+    p = LOG_LIT(p, ",\"tls\":\"");
+    p = log_str(p, tls_names[tls], strlen(tls_names[tls]));
+    p = LOG_LIT(p, "\"}\n");
+
+    log_put(line, p - line);
+}
+
+void http_log_error(const char *kind, const char *msg)
+{
+    char line[1024];
+    size_t kind_len, msg_len;
+    char *p = line;
+
+    if (!msg) {
+        msg = "";
+    }
+    kind_len = strlen(kind);
+    msg_len = strlen(msg);
+
+    /* 截断输入，转义（最多 6 倍）后仍放得进 line */
+    if (kind_len > 16) {
+        kind_len = 16;
+    }
+    if (msg_len > 128) {
+        msg_len = 128;
+    }
+
+    p = log_begin(p);
+    p = LOG_LIT(p, "\"level\":\"error\",\"kind\":\"");
+    p = log_escape(p, kind, kind_len);
+    p = LOG_LIT(p, "\",\"msg\":\"");
+    p = log_escape(p, msg, msg_len);
+    p = LOG_LIT(p, "\"}\n");
+
+    log_put(line, p - line);
+}
+
+void http_log_get_stats(struct http_log_stats *stats)
+{
+    *stats = g_stats;
+}
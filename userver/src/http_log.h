@@ -0,0 +1,46 @@
+#ifndef HTTP_LOG_H
+#define HTTP_LOG_H
+
+#include "http.h"
+#include <stdint.h>
+
+/* 访问日志与诊断信息
+ * - 每条记录是一行 JSON，先写入进程内的环形缓冲区，由 uloop 定时器成批写出（一次 writev），
+ *   请求路径上没有系统调用；环形缓冲区满时丢弃新记录并计数
+ * - 缓冲区超过一半时在下一轮事件循环写出，否则最多延迟 HTTP_LOG_FLUSH_MS；没有记录时定时器不启动
+ * - 只写出完整的行：多个 worker 以 O_APPEND 打开同一文件时行不会交错；
+ *   写到管道时每次最多 PIPE_BUF 字节（截到行尾），超过 PIPE_BUF 的单条记录仍可能被其他进程的写入打断
+ * - 未打开访问日志时只记录诊断信息，写到 stderr */
+
+#define HTTP_LOG_RING       (1 << 20)   /* 默认环形缓冲区大小（每个进程） */
+#define HTTP_LOG_FLUSH_MS   200
+#define HTTP_LOG_URL_MAX    1024        /* 记录的请求目标最长字节数，超出截断 */
+
+enum {
+    HTTP_LOG_TLS_NONE,
+    HTTP_LOG_TLS_FULL,                  /* 完整握手 */
+    HTTP_LOG_TLS_RESUMED,               /* 会话复用 */
+};
+
+struct http_log_stats {
+    uint64_t records;                   /* 写入缓冲区的记录数 */
+    uint64_t dropped;                   /* 缓冲区满丢弃的记录数 */
+    uint64_t flushes;                   /* 写出次数 */
+    uint64_t write_errors;
+};
+
+/* 打开访问日志（追加），path 为 "-" 时写到 stdout；ring_size 为 0 使用默认值 */
+int http_log_open(const char *path, size_t ring_size);
+
+/* 请求结束时记录：方法、请求目标、状态码、响应 body 字节数、耗时、TLS 握手类型 */
+void http_log_access(struct http_conn *conn, int tls, uint64_t bytes, uint64_t usec);
+
+/* 诊断信息（解析错误等）：kind 为类别，msg 为说明 */
+void http_log_error(const char *kind, const char *msg);
+
+/* 立即写出缓冲区中的全部记录（退出前调用，可能阻塞） */
+void http_log_flush(void);
+
+void http_log_get_stats(struct http_log_stats *stats);
+
+#endif // HTTP_LOG_H
@@ -0,0 +1,508 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <libubox/uloop.h>
+#include "http_metrics.h"
+#include "http_compress.h"
+#include "http_tls.h"
+#include "http_worker.h"
+#include "http_log.h"
+#include "http_uring.h"
+#include "http_h2.h"
+
+/* 直方图桶上限（微秒），最后一个桶为 +Inf */
+static const uint64_t g_bucket_us[HTTP_METRICS_BUCKETS - 1] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000,
+};
+
+static const char *const g_bucket_le[HTTP_METRICS_BUCKETS] = {
+    "0.00005", "0.0001", "0.00025", "0.0005", "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05",
+    "0.1", "0.25", "0.5", "1", "2.5", "5", "10", "+Inf",
+};
+
+static const char *const g_stage_names[HTTP_STAGE_MAX] = {
+    [HTTP_STAGE_HEADERS] = "headers",
+    [HTTP_STAGE_BODY]    = "body",
+    [HTTP_STAGE_HANDLER] = "handler",
+    [HTTP_STAGE_WRITE]   = "write",
+};
+
+static const char *const g_error_names[HTTP_ERR_MAX] = {
+    [HTTP_ERR_PARSE]     = "parse",
+    [HTTP_ERR_TLS]       = "tls",
+    [HTTP_ERR_BODY]      = "body",
+    [HTTP_ERR_BODY_SIZE] = "body_size",
+};
+
+static const char *const g_schemes[2] = { "http", "https" };
+
+/* 进程内统计（连接、接收缓冲区、accept、TLS、压缩等）：各 worker 定期写入自己的槽位，
+ * 渲染时与请求计数一样输出所有 worker 的值 */
+enum {
+    PROC_CONNECTIONS,
+    PROC_TIMEOUT_HEADER,
+    PROC_TIMEOUT_BODY,
+    PROC_TIMEOUT_IDLE,
+    PROC_TIMEOUT_WRITE,
+    PROC_RX_BYTES,
+    PROC_RX_BUDGET,
+    PROC_RX_WAITS,
+    PROC_ACCEPTED,
+    PROC_ACCEPT_ERRORS,
+    PROC_ACCEPT_PAUSED,
+    PROC_ACCEPT_QUEUE,
+    PROC_TLS_FULL,
+    PROC_TLS_RESUMED,
+    PROC_KTLS_TX,
+    PROC_KTLS_RX,
+    PROC_COMPRESS_IN,
+    PROC_COMPRESS_OUT,
+    PROC_COMPRESS_HITS,
+    PROC_COMPRESS_SKIPPED,
+    PROC_LOG_RECORDS,
+    PROC_LOG_DROPPED,
+    PROC_URING_ENTERS,          /* io_uring 后端：未启用时均为 0 */
+    PROC_URING_SQES,
+    PROC_URING_CQES,
+    PROC_URING_NOBUFS,
+    PROC_H2_SESSIONS,           /* HTTP/2：连接数、请求流数、重置的流与因协议错误关闭的连接 */
+    PROC_H2_STREAMS,
+    PROC_H2_RESETS,
+    PROC_H2_ERRORS,
+    PROC_MAX
+};
+
+/* 同名的项相邻，共用一行 # TYPE */
+static const struct {
+    const char *name;
+    const char *type;
+    const char *label;          /* worker 之外的标签 */
+} g_proc_metrics[PROC_MAX] = {
+    [PROC_CONNECTIONS]      = { "userver_connections", "gauge", NULL },
+    [PROC_TIMEOUT_HEADER]   = { "userver_timeouts_total", "counter", "phase=\"header\"" },
+    [PROC_TIMEOUT_BODY]     = { "userver_timeouts_total", "counter", "phase=\"body\"" },
+    [PROC_TIMEOUT_IDLE]     = { "userver_timeouts_total", "counter", "phase=\"idle\"" },
+    [PROC_TIMEOUT_WRITE]    = { "userver_timeouts_total", "counter", "phase=\"write\"" },
+    [PROC_RX_BYTES]         = { "userver_rx_buffer_bytes", "gauge", NULL },
+    [PROC_RX_BUDGET]        = { "userver_rx_buffer_budget_bytes", "gauge", NULL },
+    [PROC_RX_WAITS]         = { "userver_rx_budget_waits_total", "counter", NULL },
+    [PROC_ACCEPTED]         = { "userver_accepted_total", "counter", NULL },
+    [PROC_ACCEPT_ERRORS]    = { "userver_accept_errors_total", "counter", NULL },
+    [PROC_ACCEPT_PAUSED]    = { "userver_accept_paused_total", "counter", NULL },
+    [PROC_ACCEPT_QUEUE]     = { "userver_accept_queue", "gauge", NULL },
+    [PROC_TLS_FULL]         = { "userver_tls_handshakes_total", "counter", "type=\"full\"" },
+    [PROC_TLS_RESUMED]      = { "userver_tls_handshakes_total", "counter", "type=\"resumed\"" },
+    [PROC_KTLS_TX]          = { "userver_tls_ktls_total", "counter", "dir=\"tx\"" },
+    [PROC_KTLS_RX]          = { "userver_tls_ktls_total", "counter", "dir=\"rx\"" },
+    [PROC_COMPRESS_IN]      = { "userver_compress_bytes_total", "counter", "dir=\"in\"" },
+    [PROC_COMPRESS_OUT]     = { "userver_compress_bytes_total", "counter", "dir=\"out\"" },
+    [PROC_COMPRESS_HITS]    = { "userver_compress_cache_hits_total", "counter", NULL },
+    [PROC_COMPRESS_SKIPPED] = { "userver_compress_skipped_total", "counter", NULL },
+    [PROC_LOG_RECORDS]      = { "userver_log_records_total", "counter", NULL },
+    [PROC_LOG_DROPPED]      = { "userver_log_dropped_total", "counter", NULL },
+    [PROC_URING_ENTERS]     = { "userver_uring_enters_total", "counter", NULL },
+    [PROC_URING_SQES]       = { "userver_uring_sqes_total", "counter", NULL },
+    [PROC_URING_CQES]       = { "userver_uring_cqes_total", "counter", NULL },
+    [PROC_URING_NOBUFS]     = { "userver_uring_nobufs_total", "counter", NULL },
+    [PROC_H2_SESSIONS]      = { "userver_h2_sessions_total", "counter", NULL },
+    [PROC_H2_STREAMS]       = { "userver_h2_streams_total", "counter", NULL },
+    [PROC_H2_RESETS]        = { "userver_h2_resets_total", "counter", NULL },
+    [PROC_H2_ERRORS]        = { "userver_h2_errors_total", "counter", NULL },
+};
+
+#define METRICS_PUBLISH_INTERVAL    1000    /* 写入进程内统计的间隔（毫秒） */
+
+/* 直方图：各桶分别计数（不累计），渲染时再累加 */
+struct metrics_hist {
+    uint64_t buckets[HTTP_METRICS_BUCKETS];
+    uint64_t sum_us;
+    uint64_t count;
+};
+
+/* 每个 worker 一个槽位，只由该 worker 写入 */
+struct metrics_slot {
+    int used;
+    uint64_t requests[HTTP_METRICS_MODES][2][5];    /* 状态码类别 1xx..5xx */
+    uint64_t errors[HTTP_ERR_MAX];
+    struct metrics_hist hist[HTTP_METRICS_MODES][2][HTTP_STAGE_MAX];
+    uint64_t proc[PROC_MAX];                        /* 最近一次写入的进程内统计 */
+};
+
+static struct metrics_slot *g_slots = NULL;
+static int g_nslots = 0;
+static struct metrics_slot *g_slot = NULL;     /* 当前进程的槽位 */
+
+/* 模式表：fork 前注册，worker 继承 */
+static struct {
+    http_body_handler_t *handler;
+    const char *name;
+} g_modes[HTTP_METRICS_MODES] = {
+    [0] = { NULL, "other" },
+};
+static int g_nmodes = 1;
+
+static void metrics_publish_cb(struct uloop_timeout *t);
+static struct uloop_timeout g_publish = { .cb = metrics_publish_cb };
+
+int http_metrics_init(int workers)
+{
+    size_t size;
+
+    if (g_slots) {
+        return 0;
+    }
+    if (workers < 1) {
+        workers = 1;
+    }
+
+    /* 共享匿名映射：fork 出的 worker 与监督进程看到同一份内存，重启的 worker 接着原槽位计数 */
+    size = sizeof(struct metrics_slot) * workers;
+    g_slots = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (g_slots == MAP_FAILED) {
+        g_slots = NULL;
+        return -1;
+    }
+    g_nslots = workers;
+    return 0;
+}
+
+static struct metrics_slot *metrics_slot(void)
+{
+    int id;
+
+    if (g_slot) {
+        return g_slot;
+    }
+    if (!g_slots && http_metrics_init(1) < 0) {
+        /* 没有共享内存也不影响服务：计入进程私有的槽位 */
+        static struct metrics_slot local;
+        g_slots = &local;
+        g_nslots = 1;
+    }
+
+    id = http_worker_id();
+    g_slot = &g_slots[id >= 0 && id < g_nslots ? id : 0];
+    g_slot->used = 1;
+    /* 有了槽位（开始处理请求）才定期写入进程内统计 */
+    uloop_timeout_set(&g_publish, 0);
+    return g_slot;
+}
+
+void http_metrics_register_mode(http_body_handler_t *handler, const char *name)
+{
+    if (!handler || http_metrics_mode(handler) || g_nmodes >= HTTP_METRICS_MODES) {
+        return;
+    }
+    g_modes[g_nmodes].handler = handler;
+    g_modes[g_nmodes].name = name;
+    g_nmodes++;
+}
+
+int http_metrics_mode(http_body_handler_t *handler)
+{
+    for (int i = 1; i < g_nmodes; i++) {
+        if (g_modes[i].handler == handler) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+uint64_t http_metrics_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void http_metrics_observe(int mode, int tls, int stage, uint64_t usec)
+{
+    struct metrics_hist *h = &metrics_slot()->hist[mode][tls != 0][stage];
+    int i = 0;
+
+    while (i < HTTP_METRICS_BUCKETS - 1 && usec > g_bucket_us[i]) {
+        i++;
+    }
+    h->buckets[i]++;
+    h->sum_us += usec;
+    h->count++;
+}
+
+void http_metrics_request(int mode, int tls, int status)
+{
+    int class = status / 100 - 1;
+
+    if (class < 0 || class > 4) {
+        class = 4;
+    }
+    metrics_slot()->requests[mode][tls != 0][class]++;
+}
+
+void http_metrics_error(int type)
+{
+    metrics_slot()->errors[type]++;
+}
+
+/* ============ 渲染 ============ */
+
+/* 输出缓冲区在 arena 中按需倍增 */
+struct metrics_buf {
+    http_arena_t *arena;
+    char *buf;
+    size_t len;
+    size_t cap;
+    int error;
+};
+
+static void mb_printf(struct metrics_buf *b, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    if (b->error) {
+        return;
+    }
+    for (;;) {
+        va_start(ap, fmt);
+        n = vsnprintf(b->buf + b->len, b->cap - b->len, fmt, ap);
+        va_end(ap);
+        if (n < 0) {
+            b->error = 1;
+            return;
+        }
+        if ((size_t)n < b->cap - b->len) {
+            b->len += n;
+            return;
+        }
+
+        size_t cap = b->cap * 2 > b->len + n + 1 ? b->cap * 2 : b->len + n + 1;
+        char *p = http_arena_realloc(b->arena, b->buf, b->cap, cap);
+        if (!p) {
+            b->error = 1;
+            return;
+        }
+        b->buf = p;
+        b->cap = cap;
+    }
+}
+
+/* 跨进程读取其他 worker 正在更新的计数：64 位对齐的字不会读到一半 */
+static inline uint64_t mv(const uint64_t *p)
+{
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+static void render_slot_requests(struct metrics_buf *b, int w, const struct metrics_slot *s)
+{
+    for (int m = 0; m < g_nmodes; m++) {
+        for (int t = 0; t < 2; t++) {
+            for (int c = 0; c < 5; c++) {
+                uint64_t v = mv(&s->requests[m][t][c]);
+                if (v) {
+                    mb_printf(b, "userver_requests_total{worker=\"%d\",mode=\"%s\",scheme=\"%s\",code=\"%dxx\"} %llu\n",
+                              w, g_modes[m].name, g_schemes[t], c + 1, (unsigned long long)v);
+                }
+            }
+        }
+    }
+}
+
+static void render_slot_hist(struct metrics_buf *b, int w, const struct metrics_slot *s)
+{
+    for (int m = 0; m < g_nmodes; m++) {
+        for (int t = 0; t < 2; t++) {
+            for (int st = 0; st < HTTP_STAGE_MAX; st++) {
+                const struct metrics_hist *h = &s->hist[m][t][st];
+                uint64_t count = mv(&h->count), cum = 0;
+                char labels[128];
+
+                if (!count) {
+                    continue;
+                }
+                snprintf(labels, sizeof(labels), "worker=\"%d\",mode=\"%s\",scheme=\"%s\",stage=\"%s\"",
+                         w, g_modes[m].name, g_schemes[t], g_stage_names[st]);
+                for (int i = 0; i < HTTP_METRICS_BUCKETS; i++) {
+                    cum += mv(&h->buckets[i]);
+                    mb_printf(b, "userver_request_stage_seconds_bucket{%s,le=\"%s\"} %llu\n",
+                              labels, g_bucket_le[i], (unsigned long long)cum);
+                }
+                mb_printf(b, "userver_request_stage_seconds_sum{%s} %.6f\n",
+                          labels, mv(&h->sum_us) / 1e6);
+                /* 用各桶之和，与 +Inf 桶一致（读取期间计数可能在变） */
+                mb_printf(b, "userver_request_stage_seconds_count{%s} %llu\n",
+                          labels, (unsigned long long)cum);
+            }
+        }
+    }
+}
+
+/* 把本进程的统计写入槽位；其他 worker 渲染时逐项读取 */
+static void metrics_publish(struct metrics_slot *slot)
+{
+    struct http_conn_stats cs;
+    struct http_rx_stats rx;
+    struct http_accept_stats as;
+    struct http_tls_stats ts;
+    struct http_compress_stats zs;
+    struct http_log_stats ls;
+    struct http_uring_stats us;
+    struct http_h2_stats hs;
+    uint64_t v[PROC_MAX];
+
+    http_conn_get_stats(&cs);
+    http_rx_get_stats(&rx);
+    http_accept_get_stats(NULL, &as);
+    http_tls_get_stats(&ts);
+    http_compress_get_stats(&zs);
+    http_log_get_stats(&ls);
+    http_uring_get_stats(&us);
+    http_h2_get_stats(&hs);
+
+    v[PROC_CONNECTIONS] = http_conn_count();
+    v[PROC_TIMEOUT_HEADER] = cs.header_timeouts;
+    v[PROC_TIMEOUT_BODY] = cs.body_timeouts;
+    v[PROC_TIMEOUT_IDLE] = cs.idle_timeouts;
+    v[PROC_TIMEOUT_WRITE] = cs.write_timeouts;
+    v[PROC_RX_BYTES] = rx.bytes;
+    v[PROC_RX_BUDGET] = rx.budget;
+    v[PROC_RX_WAITS] = rx.waits;
+    v[PROC_ACCEPTED] = as.accepted;
+    v[PROC_ACCEPT_ERRORS] = as.errors;
+    v[PROC_ACCEPT_PAUSED] = cs.accept_paused;
+    v[PROC_ACCEPT_QUEUE] = as.queue_len;
+    v[PROC_TLS_FULL] = ts.full;
+    v[PROC_TLS_RESUMED] = ts.resumed;
+    v[PROC_KTLS_TX] = ts.ktls_tx;
+    v[PROC_KTLS_RX] = ts.ktls_rx;
+    v[PROC_COMPRESS_IN] = zs.bytes_in;
+    v[PROC_COMPRESS_OUT] = zs.bytes_out;
+    v[PROC_COMPRESS_HITS] = zs.cache_hits;
+    v[PROC_COMPRESS_SKIPPED] = zs.skipped;
+    v[PROC_LOG_RECORDS] = ls.records;
+    v[PROC_LOG_DROPPED] = ls.dropped;
+    v[PROC_URING_ENTERS] = us.enters;
+    v[PROC_URING_SQES] = us.sqes;
+    v[PROC_URING_CQES] = us.cqes;
+    v[PROC_URING_NOBUFS] = us.nobufs;
+    v[PROC_H2_SESSIONS] = hs.sessions;
+    v[PROC_H2_STREAMS] = hs.streams;
+    v[PROC_H2_RESETS] = hs.resets;
+    v[PROC_H2_ERRORS] = hs.errors;
+
+    for (int i = 0; i < PROC_MAX; i++) {
+        __atomic_store_n(&slot->proc[i], v[i], __ATOMIC_RELAXED);
+    }
+}
+
+static void metrics_publish_cb(struct uloop_timeout *t)
+{
+    metrics_publish(metrics_slot());
+    uloop_timeout_set(t, METRICS_PUBLISH_INTERVAL);
+}
+
+/* 各 worker 的进程内统计：本进程的值是现取的，其他 worker 的最多晚 METRICS_PUBLISH_INTERVAL */
+static void render_process(struct metrics_buf *b)
+{
+    struct http_accept_stats as;
+
+    metrics_publish(metrics_slot());
+    for (int i = 0; i < PROC_MAX; i++) {
+        if (i == 0 || strcmp(g_proc_metrics[i].name, g_proc_metrics[i - 1].name) != 0) {
+            mb_printf(b, "# TYPE %s %s\n", g_proc_metrics[i].name, g_proc_metrics[i].type);
+        }
+        for (int w = 0; w < g_nslots; w++) {
+            if (!g_slots[w].used) {
+                continue;
+            }
+            mb_printf(b, "%s{worker=\"%d\"%s%s} %llu\n", g_proc_metrics[i].name, w,
+                      g_proc_metrics[i].label ? "," : "",
+                      g_proc_metrics[i].label ? g_proc_metrics[i].label : "",
+                      (unsigned long long)mv(&g_slots[w].proc[i]));
+        }
+    }
+
+    /* 整个网络命名空间的计数，不分 worker */
+    http_accept_get_stats(NULL, &as);
+    mb_printf(b, "# TYPE userver_listen_overflows_total counter\n"
+                 "userver_listen_overflows_total %llu\n", (unsigned long long)as.listen_overflows);
+}
+
+static int metrics_complete(struct http_conn *conn)
+{
+    struct metrics_buf b = { .arena = &conn->arena, .cap = 16384 };
+
+    if (conn->parser.method != HTTP_GET && conn->parser.method != HTTP_HEAD) {
+        http_add_header(conn, "Allow", "GET, HEAD");
+        http_set_response(conn, 405, "text/plain", HTTP_STATIC_BODY("Method Not Allowed\n"));
+        return 0;
+    }
+
+    metrics_slot();
+    b.buf = http_arena_alloc(b.arena, b.cap);
+    if (!b.buf) {
+        return -1;
+    }
+
+    mb_printf(&b, "# HELP userver_requests_total Completed requests by handler mode and status class.\n"
+                  "# TYPE userver_requests_total counter\n");
+    for (int w = 0; w < g_nslots; w++) {
+        if (g_slots[w].used) {
+            render_slot_requests(&b, w, &g_slots[w]);
+        }
+    }
+
+    mb_printf(&b, "# HELP userver_request_stage_seconds Time spent per request stage.\n"
+                  "# TYPE userver_request_stage_seconds histogram\n");
+    for (int w = 0; w < g_nslots; w++) {
+        if (g_slots[w].used) {
+            render_slot_hist(&b, w, &g_slots[w]);
+        }
+    }
+
+    mb_printf(&b, "# HELP userver_errors_total Protocol and body errors.\n"
+                  "# TYPE userver_errors_total counter\n");
+    for (int w = 0; w < g_nslots; w++) {
+        if (!g_slots[w].used) {
+            continue;
+        }
+        for (int e = 0; e < HTTP_ERR_MAX; e++) {
+            mb_printf(&b, "userver_errors_total{worker=\"%d\",type=\"%s\"} %llu\n",
+                      w, g_error_names[e], (unsigned long long)mv(&g_slots[w].errors[e]));
+        }
+    }
+
+    render_process(&b);
+
+    if (b.error) {
+        return -1;
+    }
+    http_add_header(conn, "Cache-Control", "no-store");
+    http_set_response(conn, 200, "text/plain; version=0.0.4; charset=utf-8", b.buf, b.len);
+    return 0;
+}
+
+static int metrics_init(struct http_conn *conn, const char *content_type)
+{
+    return 0;
+}
+
+static int metrics_data(struct http_conn *conn, const char *data, size_t len)
+{
+    return 0;
+}
+
+static http_body_handler_t metrics_handler = {
+    .on_init = metrics_init,
+    .on_data = metrics_data,
+    .on_complete = metrics_complete,
+};
+
+http_body_handler_t *http_metrics_handler(void)
+{
+    return &metrics_handler;
+}
@@ -0,0 +1,56 @@
+#ifndef HTTP_METRICS_H
+#define HTTP_METRICS_H
+
+#include "http.h"
+#include <stdint.h>
+
+/* 请求计数与分阶段耗时，由 http_metrics_handler()（GET /metrics）以 Prometheus 文本格式输出
+ * - 每个 worker 只写自己的槽位（fork 前分配的共享内存），单写者不加锁；
+ *   渲染时读取所有槽位，按 worker 标签分别输出，任一 worker 都能回答完整的数据
+ * - 阶段：请求开始（首个请求为 accept，keep-alive 时为请求首字节）→ 请求头完成 → body 完成，
+ *   处理器回调累计耗时，响应交给发送队列 → 全部写出
+ * - 按处理器模式（http_metrics_register_mode 注册的名称）和 http / https 区分
+ * - 连接、接收缓冲区、accept、TLS、压缩等进程内统计由各 worker 每秒写入自己的槽位，
+ *   同样按 worker 标签输出所有 worker（回答请求的 worker 输出现取的值） */
+
+enum {
+    HTTP_STAGE_HEADERS,
+    HTTP_STAGE_BODY,
+    HTTP_STAGE_HANDLER,
+    HTTP_STAGE_WRITE,
+    HTTP_STAGE_MAX
+};
+
+/* 错误计数：只计数不打印，恶意流量下不会每个错误一次 write(2) */
+enum {
+    HTTP_ERR_PARSE,             /* HTTP 解析错误 */
+    HTTP_ERR_TLS,               /* TLS 错误（握手失败等） */
+    HTTP_ERR_BODY,              /* body 格式错误（JSON / Form） */
+    HTTP_ERR_BODY_SIZE,         /* body 超过处理器上限 */
+    HTTP_ERR_MAX
+};
+
+#define HTTP_METRICS_MODES      16      /* 可注册的模式数，下标 0 为未注册的处理器（"other"） */
+#define HTTP_METRICS_BUCKETS    18      /* 直方图桶数（含 +Inf） */
+
+/* 分配 workers 个槽位，多进程模式须在 fork 之前调用；
+ * 未调用时首次计数分配一个进程私有的槽位 */
+int http_metrics_init(int workers);
+
+/* 注册处理器的模式名（fork 之前调用），重复注册同一处理器无效果 */
+void http_metrics_register_mode(http_body_handler_t *handler, const char *name);
+
+/* 处理器对应的模式下标 */
+int http_metrics_mode(http_body_handler_t *handler);
+
+/* 单调时钟（微秒） */
+uint64_t http_metrics_now(void);
+
+void http_metrics_observe(int mode, int tls, int stage, uint64_t usec);
+void http_metrics_request(int mode, int tls, int status);
+void http_metrics_error(int type);
+
+/* GET /metrics 处理器：在 arena 中一次渲染，不读写文件（/proc/net/netstat 由定时器读取） */
+http_body_handler_t *http_metrics_handler(void);
+
+#endif // HTTP_METRICS_H
@@ -0,0 +1,312 @@
+#include "http_router.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define ROUTER_MAX_STATES   65535
+#define ROUTER_PREFIX_DEPTH 16          /* 匹配时记录的前缀命中数（保留最深的） */
+
+struct http_route {
+    uint64_t methods;
+    http_body_handler_t *handler;
+    void *ctx;
+    int prefix;
+    char *path;
+    int next;                   /* 同一状态上的下一条路由，-1 结束 */
+};
+
+struct http_router {
+    struct http_route *routes;
+    int count;
+    int cap;
+
+    /* 编译结果：trans[state * nclass + class[byte]] → 下一状态，0 为失败 */
+    uint8_t class[256];
+    int nclass;
+    int nstate;
+    uint16_t *trans;
+    int *exact;                 /* 状态上的精确路由链表头，-1 无 */
+    int *prefix;                /* 状态上的前缀路由链表头，-1 无 */
+};
+
+/* llhttp 8.1.0 的方法编号（llhttp_method_t）对应的名字。llhttp_method_name()
+ * 遇到未定义的编号会 abort，外部输入的方法名只能在这张表里查 */
+static const char *const method_names[HTTP_METHOD_COUNT] = {
+    "DELETE", "GET", "HEAD", "POST", "PUT", "CONNECT", "OPTIONS", "TRACE",
+    "COPY", "LOCK", "MKCOL", "MOVE", "PROPFIND", "PROPPATCH", "SEARCH", "UNLOCK",
+    "BIND", "REBIND", "UNBIND", "ACL", "REPORT", "MKACTIVITY", "CHECKOUT", "MERGE",
+    "M-SEARCH", "NOTIFY", "SUBSCRIBE", "UNSUBSCRIBE", "PATCH", "PURGE", "MKCALENDAR", "LINK",
+    "UNLINK", "SOURCE", "PRI", "DESCRIBE", "ANNOUNCE", "SETUP", "PLAY", "PAUSE",
+    "TEARDOWN", "GET_PARAMETER", "SET_PARAMETER", "REDIRECT", "RECORD", "FLUSH",
+};
+
+const char *http_method_name(int method)
+{
+    if (method < 0 || method >= HTTP_METHOD_COUNT) {
+        return NULL;
+    }
+    return method_names[method];
+}
+
+/* ============ 内置 404 / 405 ============ */
+
+static int router_init(struct http_conn *conn, const char *content_type)
+{
+    return 0;
+}
+
+static int router_data(struct http_conn *conn, const char *data, size_t len)
+{
+    return 0;
+}
+
+static void router_cleanup(struct http_conn *conn)
+{
+}
+
+static int not_found_complete(struct http_conn *conn)
+{
+    http_set_response(conn, 404, "application/json",
+                      HTTP_STATIC_BODY("{\"error\":\"Not Found\",\"status\":\"error\"}"));
+    return 0;
+}
+
+/* 405 须带 Allow（RFC 9110 §15.5.6）：列出路径上各路由允许的方法 */
+static int not_allowed_complete(struct http_conn *conn)
+{
+    char allow[1024];
+    size_t len = 0;
+
+    allow[0] = '\0';
+    for (int m = 0; m < HTTP_METHOD_COUNT; m++) {
+        const char *name;
+
+        if (!(conn->route_allow & HTTP_ROUTE_METHOD(m))) {
+            continue;
+        }
+        name = method_names[m];
+        if (len + strlen(name) + 3 > sizeof(allow)) {
+            break;
+        }
+        len += snprintf(allow + len, sizeof(allow) - len, "%s%s", len ? ", " : "", name);
+    }
+    http_add_header(conn, "Allow", allow);
+    http_set_response(conn, 405, "application/json",
+                      HTTP_STATIC_BODY("{\"error\":\"Method Not Allowed\",\"status\":\"error\"}"));
+    return 0;
+}
+
+static http_body_handler_t not_found_handler = {
+    .on_init = router_init,
+    .on_data = router_data,
+    .on_complete = not_found_complete,
+    .on_cleanup = router_cleanup,
+};
+
+static http_body_handler_t not_allowed_handler = {
+    .on_init = router_init,
+    .on_data = router_data,
+    .on_complete = not_allowed_complete,
+    .on_cleanup = router_cleanup,
+};
+
+/* ============ 构建 ============ */
+
+http_router_t *http_router_new(void)
+{
+    return calloc(1, sizeof(http_router_t));
+}
+
+void http_router_free(http_router_t *router)
+{
+    if (!router) return;
+
+    for (int i = 0; i < router->count; i++) {
+        free(router->routes[i].path);
+    }
+    free(router->routes);
+    free(router->trans);
+    free(router->exact);
+    free(router->prefix);
+    free(router);
+}
+
+int http_router_add(http_router_t *router, uint64_t methods, const char *pattern,
+                    http_body_handler_t *handler, void *ctx)
+{
+    size_t len = strlen(pattern);
+
+    if (len == 0 || pattern[0] != '/' || !handler || router->trans) {
+        return -1;
+    }
+
+    if (router->count == router->cap) {
+        int cap = router->cap ? router->cap * 2 : 8;
+        struct http_route *routes = realloc(router->routes, cap * sizeof(*routes));
+        if (!routes) return -1;
+        router->routes = routes;
+        router->cap = cap;
+    }
+
+    struct http_route *r = &router->routes[router->count];
+    r->prefix = pattern[len - 1] == '*';
+    r->path = strndup(pattern, len - r->prefix);
+    if (!r->path) return -1;
+    r->methods = methods;
+    r->handler = handler;
+    r->ctx = ctx;
+    r->next = -1;
+    router->count++;
+    return 0;
+}
+
+/* 把路由挂到状态链表尾部（保持添加顺序） */
+static void router_link(struct http_router *router, int *head, int idx)
+{
+    while (*head >= 0) {
+        head = &router->routes[*head].next;
+    }
+    *head = idx;
+}
+
+int http_router_compile(http_router_t *router)
+{
+    int nstate = 2;             /* 0: 失败；1: 根 */
+
+    /* 字节类别：出现在路径中的每个字节一个类别，其余字节归入类别 0 */
+    memset(router->class, 0, sizeof(router->class));
+    router->nclass = 1;
+    for (int i = 0; i < router->count; i++) {
+        for (const unsigned char *p = (const unsigned char *)router->routes[i].path; *p; p++) {
+            if (!router->class[*p]) {
+                router->class[*p] = router->nclass++;
+            }
+        }
+        nstate += strlen(router->routes[i].path);
+    }
+    if (nstate > ROUTER_MAX_STATES) {
+        return -1;
+    }
+
+    router->trans = calloc((size_t)nstate * router->nclass, sizeof(*router->trans));
+    router->exact = malloc(nstate * sizeof(int));
+    router->prefix = malloc(nstate * sizeof(int));
+    if (!router->trans || !router->exact || !router->prefix) {
+        return -1;
+    }
+    memset(router->exact, 0xff, nstate * sizeof(int));
+    memset(router->prefix, 0xff, nstate * sizeof(int));
+
+    /* 逐条插入 trie：状态按需分配，转移直接写进最终的表 */
+    router->nstate = 2;
+    for (int i = 0; i < router->count; i++) {
+        struct http_route *r = &router->routes[i];
+        int state = 1;
+
+        for (const unsigned char *p = (const unsigned char *)r->path; *p; p++) {
+            uint16_t *t = &router->trans[state * router->nclass + router->class[*p]];
+            if (!*t) {
+                *t = router->nstate++;
+            }
+            state = *t;
+        }
+        router_link(router, r->prefix ? &router->prefix[state] : &router->exact[state], i);
+    }
+
+    return 0;
+}
+
+/* ============ 匹配 ============ */
+
+/* 在一条路由链表中按方法选择；allow 累计路径上各路由的方法掩码 */
+static const struct http_route *router_pick(const struct http_router *router, int head,
+                                            int method, uint64_t *allow)
+{
+    for (int i = head; i >= 0; i = router->routes[i].next) {
+        const struct http_route *r = &router->routes[i];
+        *allow |= r->methods;
+        if (!r->methods || (r->methods & HTTP_ROUTE_METHOD(method))) {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+http_body_handler_t *http_router_match(const http_router_t *router, int method,
+                                       const char *url, size_t len, void **ctx,
+                                       uint64_t *allow)
+{
+    int prefixes[ROUTER_PREFIX_DEPTH];
+    int nprefix = 0;
+    int state = 1;
+    size_t i;
+    const struct http_route *r = NULL;
+
+    *ctx = NULL;
+    *allow = 0;
+    if (!router->trans) {
+        return &not_found_handler;
+    }
+
+    if (router->prefix[1] >= 0) {
+        prefixes[nprefix++] = 1;
+    }
+
+    for (i = 0; i < len && url[i] != '?' && url[i] != '#'; i++) {
+        state = router->trans[state * router->nclass + router->class[(unsigned char)url[i]]];
+        if (!state) break;
+
+        if (router->prefix[state] >= 0) {
+            /* 只保留最深的若干个前缀命中 */
+            if (nprefix == ROUTER_PREFIX_DEPTH) {
+                memmove(prefixes, prefixes + 1, (ROUTER_PREFIX_DEPTH - 1) * sizeof(int));
+                nprefix--;
+            }
+            prefixes[nprefix++] = state;
+        }
+    }
+
+    /* 精确匹配：URL 路径完整走完 */
+    if (state && (i == len || url[i] == '?' || url[i] == '#')) {
+        r = router_pick(router, router->exact[state], method, allow);
+    }
+
+    /* 最长前缀 */
+    while (!r && nprefix > 0) {
+        r = router_pick(router, router->prefix[prefixes[--nprefix]], method, allow);
+    }
+
+    if (!r) {
+        /* 任意方法的路由总会命中，掩码非 0 即路径命中过 */
+        return *allow ? &not_allowed_handler : &not_found_handler;
+    }
+
+    *ctx = r->ctx;
+    return r->handler;
+}
+
+int http_router_parse_methods(const char *list, uint64_t *methods)
+{
+    *methods = HTTP_ROUTE_ANY;
+
+    while (*list) {
+        size_t n = strcspn(list, ",");
+        int m;
+
+        for (m = 0; m < HTTP_METHOD_COUNT; m++) {
+            if (strlen(method_names[m]) == n && strncasecmp(method_names[m], list, n) == 0)
+                break;
+        }
+        /* 空元素（"GET,,POST"）也落到这里 */
+        if (m == HTTP_METHOD_COUNT) {
+            return -1;
+        }
+
+        *methods |= HTTP_ROUTE_METHOD(m);
+        list += n;
+        if (*list == ',') list++;
+    }
+
+    return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef HTTP_ROUTER_H
+#define HTTP_ROUTER_H
+
+#include "http.h"
+#include <stdint.h>
+
+/* 路由表：方法 + 路径 → body 处理器
+ * - 路径 "/api/json" 精确匹配；以 '*' 结尾的路径为前缀匹配（如 "/static/" 后接 '*'）
+ * - 精确匹配优先，其次最长前缀；路径命中但方法不符返回 405，未命中返回 404
+ * - http_router_compile() 把所有路径编译为按字节类别跳转的状态表，
+ *   匹配时每个 URL 字节一次查表，不做字符串比较 */
+
+/* 方法掩码：HTTP_ROUTE_METHOD(HTTP_GET) | HTTP_ROUTE_METHOD(HTTP_HEAD)，0 表示任意方法 */
+#define HTTP_ROUTE_METHOD(m)    (1ULL << (m))
+#define HTTP_ROUTE_ANY          0
+
+/* llhttp 定义的方法个数（编号 0..HTTP_METHOD_COUNT-1） */
+#define HTTP_METHOD_COUNT       46
+
+typedef struct http_router http_router_t;
+
+http_router_t *http_router_new(void);
+void http_router_free(http_router_t *router);
+
+/* 添加路由：ctx 在处理请求时通过 conn->route_ctx 取得；须在 compile 之前调用 */
+int http_router_add(http_router_t *router, uint64_t methods, const char *pattern,
+                    http_body_handler_t *handler, void *ctx);
+
+/* 编译状态表，成功返回 0 */
+int http_router_compile(http_router_t *router);
+
+/* 按方法和 URL（可带查询串）选择处理器，总是返回非 NULL（404/405 有内置处理器）；
+ * allow 返回路径上各路由的方法掩码，405 处理器据此从 conn->route_allow 生成 Allow */
+http_body_handler_t *http_router_match(const http_router_t *router, int method,
+                                       const char *url, size_t len, void **ctx,
+                                       uint64_t *allow);
+
+/* 解析方法列表 "GET,POST"（不区分大小写），未知方法或空元素返回 -1 */
+int http_router_parse_methods(const char *list, uint64_t *methods);
+
+/* 方法编号转名字，超出 llhttp 定义的范围返回 NULL */
+const char *http_method_name(int method);
+
+#endif // HTTP_ROUTER_H
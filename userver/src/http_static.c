@@ -0,0 +1,667 @@
+#define _GNU_SOURCE
+#include "http_static.h"
+#include "http_urldecode.h"
+#include "http_compress.h"
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/openat2.h>
+#include <libubox/list.h>
+
+#define STATIC_CACHE_BUCKETS    256
+#define STATIC_CACHE_FDS        512     /* 缓存项持有的 fd 总数上限（原文件和 FILE.gz 各占一个） */
+#define STATIC_CHECK_SEC        1       /* stat 校验间隔 */
+#define STATIC_INDEX            "index.html"
+
+/* 缓存的文件：缓存本身持有一个引用，每个正在发送的连接各持有一个 */
+struct static_file {
+    struct static_file *next;       /* 哈希链 */
+    struct list_head lru;
+    uint32_t hash;
+    int root_fd;
+    int refs;
+    int cached;
+
+    int fd;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    time_t checked;
+
+    const char *mime;
+    char etag[48];
+    char last_modified[32];
+
+    /* 预压缩的 FILE.gz（见 static_file_gz）：0 未检查，1 可用，-1 没有 */
+    int gz_state;
+    int gz_fd;
+    off_t gz_size;
+    char etag_gz[52];
+
+    char path[];
+};
+
+/* 文件根目录：路由上下文，或 http_static_handler() 设置的默认目录 */
+struct http_static_root {
+    int fd;
+};
+
+static int g_root_fd = -1;
+static struct static_file *g_buckets[STATIC_CACHE_BUCKETS];
+static LIST_HEAD(g_lru);
+static int g_cached_fds = 0;
+
+static const struct {
+    const char *ext;
+    const char *mime;
+} mime_types[] = {
+    { "html", "text/html; charset=utf-8" },
+    { "htm", "text/html; charset=utf-8" },
+    { "css", "text/css; charset=utf-8" },
+    { "js", "application/javascript; charset=utf-8" },
+    { "json", "application/json" },
+    { "txt", "text/plain; charset=utf-8" },
+    { "xml", "application/xml" },
+    { "svg", "image/svg+xml" },
+    { "png", "image/png" },
+    { "jpg", "image/jpeg" },
+    { "jpeg", "image/jpeg" },
+    { "gif", "image/gif" },
+    { "ico", "image/x-icon" },
+    { "webp", "image/webp" },
+    { "wasm", "application/wasm" },
+    { "pdf", "application/pdf" },
+    { "woff", "font/woff" },
+    { "woff2", "font/woff2" },
+    { "mp4", "video/mp4" },
+    { "gz", "application/gzip" },
+};
+
+static const char *static_mime(const char *path)
+{
+    const char *dot = strrchr(path, '.');
+
+    if (dot && !strchr(dot, '/')) {
+        for (size_t i = 0; i < sizeof(mime_types) / sizeof(mime_types[0]); i++) {
+            if (strcasecmp(dot + 1, mime_types[i].ext) == 0)
+                return mime_types[i].mime;
+        }
+    }
+    return "application/octet-stream";
+}
+
+static uint32_t static_hash(int root_fd, const char *s)
+{
+    uint32_t h = 2166136261u ^ (uint32_t)root_fd;
+
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* ============ 文件缓存 ============ */
+
+static void static_file_put(void *ref)
+{
+    struct static_file *f = ref;
+
+    if (--f->refs > 0)
+        return;
+    close(f->fd);
+    if (f->gz_state > 0)
+        close(f->gz_fd);
+    free(f);
+}
+
+static void static_cache_remove(struct static_file *f)
+{
+    struct static_file **pp = &g_buckets[f->hash % STATIC_CACHE_BUCKETS];
+
+    while (*pp != f) {
+        pp = &(*pp)->next;
+    }
+    *pp = f->next;
+    list_del(&f->lru);
+    f->cached = 0;
+    g_cached_fds -= f->gz_state > 0 ? 2 : 1;
+    static_file_put(f);
+}
+
+/* 淘汰最久未用的缓存项，直到还能再放下 need 个 fd；keep 不淘汰
+ * 正在发送的连接仍持有被淘汰项的引用，fd 在发送完毕后才关闭 */
+static void static_cache_trim(int need, const struct static_file *keep)
+{
+    while (g_cached_fds + need > STATIC_CACHE_FDS && !list_empty(&g_lru)) {
+        struct static_file *victim = list_entry(g_lru.prev, struct static_file, lru);
+
+        if (victim == keep)
+            break;
+        static_cache_remove(victim);
+    }
+}
+
+static int static_stat_same(const struct static_file *f, const struct stat *st)
+{
+    return f->dev == st->st_dev && f->ino == st->st_ino && f->size == st->st_size &&
+           f->mtime.tv_sec == st->st_mtim.tv_sec &&
+           f->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+/* 在根目录之下只读打开 path（已规范化，不含 "." ".." 和空段）
+ * openat2(RESOLVE_BENEATH) 拒绝越出根目录的符号链接（EXDEV）；内核不支持（< 5.6）时
+ * 逐段以 O_NOFOLLOW 打开，路径中的任何符号链接都被拒绝（ELOOP） */
+static int static_openat(int root_fd, const char *path)
+{
+    static int no_openat2;
+    struct open_how how = {
+        .flags = O_RDONLY | O_CLOEXEC,
+        .resolve = RESOLVE_BENEATH,
+    };
+    int dir = root_fd;
+    int fd;
+
+    if (!no_openat2) {
+        fd = syscall(__NR_openat2, root_fd, path, &how, sizeof(how));
+        if (fd >= 0 || (errno != ENOSYS && errno != EPERM))
+            return fd;
+        /* seccomp 过滤时可能是 EPERM */
+        no_openat2 = 1;
+    }
+
+    for (;;) {
+        const char *slash = strchr(path, '/');
+        char name[NAME_MAX + 1];
+        size_t len = slash ? (size_t)(slash - path) : strlen(path);
+
+        if (len > NAME_MAX) {
+            fd = -1;
+            errno = ENAMETOOLONG;
+            break;
+        }
+        memcpy(name, path, len);
+        name[len] = '\0';
+
+        fd = openat(dir, name, O_RDONLY | O_CLOEXEC | O_NOFOLLOW | (slash ? O_DIRECTORY : 0));
+        if (dir != root_fd) {
+            int err = errno;
+            close(dir);
+            errno = err;
+        }
+        if (fd < 0 || !slash)
+            break;
+        dir = fd;
+        path = slash + 1;
+    }
+    return fd;
+}
+
+/* 打开文件并加入缓存；失败返回 NULL 并设置 errno（EISDIR 表示目录） */
+static struct static_file *static_file_open(int root_fd, const char *path,
+                                            uint32_t hash, time_t now)
+{
+    struct stat st;
+    size_t len = strlen(path);
+    int fd = static_openat(root_fd, path);
+
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        close(fd);
+        errno = S_ISDIR(st.st_mode) ? EISDIR : EACCES;
+        return NULL;
+    }
+
+    struct static_file *f = calloc(1, sizeof(*f) + len + 1);
+    if (!f) {
+        close(fd);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memcpy(f->path, path, len + 1);
+    f->hash = hash;
+    f->root_fd = root_fd;
+    f->fd = fd;
+    f->dev = st.st_dev;
+    f->ino = st.st_ino;
+    f->size = st.st_size;
+    f->mtime = st.st_mtim;
+    f->checked = now;
+    f->mime = static_mime(path);
+    snprintf(f->etag, sizeof(f->etag), "\"%llx-%llx\"",
+             (unsigned long long)st.st_mtime, (unsigned long long)st.st_size);
+
+    struct tm tm;
+    gmtime_r(&st.st_mtime, &tm);
+    strftime(f->last_modified, sizeof(f->last_modified),
+             "%a, %d %b %Y %H:%M:%S GMT", &tm);
+
+    /* 缓存满时淘汰最久未用的 */
+    static_cache_trim(1, NULL);
+
+    f->refs = 1;
+    f->cached = 1;
+    f->next = g_buckets[hash % STATIC_CACHE_BUCKETS];
+    g_buckets[hash % STATIC_CACHE_BUCKETS] = f;
+    list_add(&f->lru, &g_lru);
+    g_cached_fds++;
+    return f;
+}
+
+/* 按相对路径取文件（带引用）；缓存项超过校验间隔时重新 stat，文件变化则重新打开 */
+static struct static_file *static_file_get(int root_fd, const char *path)
+{
+    uint32_t hash = static_hash(root_fd, path);
+    time_t now = time(NULL);
+    struct static_file *f;
+
+    for (f = g_buckets[hash % STATIC_CACHE_BUCKETS]; f; f = f->next) {
+        if (f->hash == hash && f->root_fd == root_fd && strcmp(f->path, path) == 0)
+            break;
+    }
+
+    if (f && now - f->checked >= STATIC_CHECK_SEC) {
+        struct stat st;
+        if (fstatat(root_fd, path, &st, 0) == 0 && static_stat_same(f, &st)) {
+            f->checked = now;
+        } else {
+            static_cache_remove(f);
+            f = NULL;
+        }
+    }
+
+    if (f) {
+        list_del(&f->lru);
+        list_add(&f->lru, &g_lru);
+    } else {
+        f = static_file_open(root_fd, path, hash, now);
+        if (!f) return NULL;
+    }
+
+    f->refs++;
+    return f;
+}
+
+/* ============ 请求处理 ============ */
+
+/* URL 路径 → 相对路径：百分号解码，去掉 "."、空段，拒绝 ".." 和 NUL */
+static char *static_map_path(struct http_conn *conn, size_t *path_len)
+{
+    const char *url = conn->url;
+    size_t len = strcspn(url, "?#");
+    char *decoded = http_arena_alloc(&conn->arena, len + 1);
+    char *out = http_arena_alloc(&conn->arena, len + 1);
+
+    if (!decoded || !out || url[0] != '/')
+        return NULL;
+
+    long n = http_url_decode(decoded, url, len, HTTP_URLDEC_STRICT);
+    if (n < 0 || memchr(decoded, '\0', n))
+        return NULL;
+
+    size_t o = 0;
+    for (long i = 0; i < n; ) {
+        long j = i;
+        while (j < n && decoded[j] != '/') {
+            j++;
+        }
+        size_t seg = j - i;
+
+        if (seg == 2 && decoded[i] == '.' && decoded[i + 1] == '.')
+            return NULL;
+        if (seg > 0 && !(seg == 1 && decoded[i] == '.')) {
+            if (o > 0) out[o++] = '/';
+            memcpy(out + o, decoded + i, seg);
+            o += seg;
+        }
+        i = j + 1;
+    }
+    out[o] = '\0';
+    *path_len = o;
+    return out;
+}
+
+/* If-None-Match：逗号分隔的 ETag 列表，弱比较 */
+static int static_etag_match(const char *list, const char *etag)
+{
+    size_t etag_len = strlen(etag);
+    const char *p = list;
+
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') {
+            p++;
+        }
+        if (*p == '*')
+            return 1;
+        if (strncmp(p, "W/", 2) == 0)
+            p += 2;
+
+        size_t n = strcspn(p, ",");
+        while (n > 0 && (p[n - 1] == ' ' || p[n - 1] == '\t')) {
+            n--;
+        }
+        if (n == etag_len && memcmp(p, etag, n) == 0)
+            return 1;
+        p += strcspn(p, ",");
+    }
+    return 0;
+}
+
+static int static_not_modified(struct http_conn *conn, const struct static_file *f,
+                               const char *etag)
+{
+    const char *inm = http_get_header(conn, HTTP_HDR_IF_NONE_MATCH);
+    const char *ims = http_get_header(conn, HTTP_HDR_IF_MODIFIED_SINCE);
+
+    if (inm)
+        return static_etag_match(inm, etag);
+
+    if (ims) {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        if (strptime(ims, "%a, %d %b %Y %H:%M:%S GMT", &tm))
+            return f->mtime.tv_sec <= timegm(&tm);
+    }
+    return 0;
+}
+
+/* 取预压缩的 gzip 变体（首次请求时检查，之后随缓存项复用）：
+ * 只使用同目录下不旧于原文件的 FILE.gz，请求路径上不做压缩；FILE.gz 单独更新不会被发现，
+ * 原文件变化重新打开时才重新检查 */
+static int static_file_gz(struct static_file *f)
+{
+    char gz_path[PATH_MAX];
+    struct stat st;
+    int fd;
+
+    if (f->gz_state)
+        return f->gz_state > 0;
+
+    f->gz_state = -1;
+    if (f->size == 0 ||
+        snprintf(gz_path, sizeof(gz_path), "%s.gz", f->path) >= (int)sizeof(gz_path))
+        return 0;
+
+    fd = static_openat(f->root_fd, gz_path);
+    if (fd < 0)
+        return 0;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) ||
+        st.st_mtim.tv_sec < f->mtime.tv_sec ||
+        (st.st_mtim.tv_sec == f->mtime.tv_sec && st.st_mtim.tv_nsec < f->mtime.tv_nsec)) {
+        close(fd);
+        return 0;
+    }
+
+    /* 第二个 fd 同样计入缓存上限；f 刚被取用，位于 LRU 头部 */
+    static_cache_trim(1, f);
+
+    /* 压缩后的表示是不同的实体，ETag 不能与原文件相同 */
+    snprintf(f->etag_gz, sizeof(f->etag_gz), "%.*s-gz\"", (int)strlen(f->etag) - 1, f->etag);
+    f->gz_fd = fd;
+    f->gz_size = st.st_size;
+    f->gz_state = 1;
+    g_cached_fds++;
+    return 1;
+}
+
+/* 解析单段 "bytes=a-b" / "bytes=a-" / "bytes=-n"
+ * 返回 1 有效，0 忽略（语法不支持，按完整响应处理），-1 无法满足（416）
+ * strtoull 会接受前导空白、'+' 和 '-'（"bytes=--5" 取反成极大值），每个数字须以数字字符开头 */
+static int static_parse_range(const char *range, off_t size, off_t *start, off_t *end)
+{
+    char *ep;
+
+    if (strncmp(range, "bytes=", 6) != 0 || strchr(range, ','))
+        return 0;
+    range += 6;
+
+    if (*range == '-') {
+        if (range[1] < '0' || range[1] > '9')
+            return 0;
+        unsigned long long n = strtoull(range + 1, &ep, 10);
+        if (*ep)
+            return 0;
+        if (n == 0 || size == 0)
+            return -1;
+        *start = n >= (unsigned long long)size ? 0 : size - (off_t)n;
+        *end = size - 1;
+        return 1;
+    }
+
+    if (*range < '0' || *range > '9')
+        return 0;
+    unsigned long long a = strtoull(range, &ep, 10);
+    if (*ep != '-')
+        return 0;
+    range = ep + 1;
+
+    unsigned long long b = size > 0 ? (unsigned long long)size - 1 : 0;
+    if (*range) {
+        if (*range < '0' || *range > '9')
+            return 0;
+        b = strtoull(range, &ep, 10);
+        if (*ep || b < a)
+            return 0;
+        if (b >= (unsigned long long)size)
+            b = size - 1;
+    }
+    if (a >= (unsigned long long)size)
+        return -1;
+
+    *start = a;
+    *end = b;
+    return 1;
+}
+
+static void static_respond_error(struct http_conn *conn, int status)
+{
+    switch (status) {
+    case 403:
+        http_set_response(conn, 403, "text/plain", HTTP_STATIC_BODY("Forbidden\n"));
+        break;
+    case 404:
+        http_set_response(conn, 404, "text/plain", HTTP_STATIC_BODY("Not Found\n"));
+        break;
+    case 405:
+        http_add_header(conn, "Allow", "GET, HEAD");
+        http_set_response(conn, 405, "text/plain", HTTP_STATIC_BODY("Method Not Allowed\n"));
+        break;
+    case 500:
+        http_set_response(conn, 500, "text/plain", HTTP_STATIC_BODY("Internal Server Error\n"));
+        break;
+    default:
+        http_set_response(conn, 400, "text/plain", HTTP_STATIC_BODY("Bad Request\n"));
+        break;
+    }
+}
+
+static int static_complete(struct http_conn *conn)
+{
+    struct http_static_root *root = conn->route_ctx;
+    int root_fd = root ? root->fd : g_root_fd;
+    struct static_file *f;
+    size_t path_len;
+    char *path;
+
+    if (root_fd < 0) {
+        static_respond_error(conn, 500);
+        return 0;
+    }
+
+    if (conn->parser.method != HTTP_GET && conn->parser.method != HTTP_HEAD) {
+        static_respond_error(conn, 405);
+        return 0;
+    }
+
+    path = conn->url ? static_map_path(conn, &path_len) : NULL;
+    if (!path) {
+        static_respond_error(conn, 400);
+        return 0;
+    }
+
+    f = static_file_get(root_fd, path_len ? path : ".");
+    if (!f && errno == EISDIR) {
+        size_t url_path_len = strcspn(conn->url, "?#");
+
+        /* 目录：不以 '/' 结尾时重定向，保证页面中的相对链接正确 */
+        if (conn->url[url_path_len - 1] != '/') {
+            char *location = http_arena_alloc(&conn->arena, url_path_len + 2);
+            if (!location) return -1;
+            memcpy(location, conn->url, url_path_len);
+            memcpy(location + url_path_len, "/", 2);
+            http_add_header(conn, "Location", location);
+            http_set_response(conn, 301, "text/plain", HTTP_STATIC_BODY(""));
+            return 0;
+        }
+
+        char *index = http_arena_alloc(&conn->arena, path_len + sizeof(STATIC_INDEX) + 1);
+        if (!index) return -1;
+        sprintf(index, "%s%s" STATIC_INDEX, path, path_len ? "/" : "");
+        f = static_file_get(root_fd, index);
+    }
+    if (!f) {
+        static_respond_error(conn, errno == ENOENT || errno == ENOTDIR || errno == EISDIR ? 404 :
+                                   errno == EACCES || errno == ELOOP || errno == EXDEV ? 403 : 500);
+        return 0;
+    }
+
+    /* 客户端接受 gzip 且有 FILE.gz 时发送压缩变体；有 Range 时按原文件处理（范围针对未压缩内容） */
+    int enc = http_compress_negotiate(conn, f->mime);
+    int gz = enc == HTTP_ENC_GZIP && !http_get_header(conn, HTTP_HDR_RANGE) && static_file_gz(f);
+    const char *etag = gz ? f->etag_gz : f->etag;
+
+    if (enc >= 0)
+        http_add_header(conn, "Vary", "Accept-Encoding");
+    http_add_header(conn, "ETag", etag);
+    http_add_header(conn, "Last-Modified", f->last_modified);
+
+    if (static_not_modified(conn, f, etag)) {
+        http_set_response(conn, 304, f->mime, HTTP_STATIC_BODY(""));
+        static_file_put(f);
+        return 0;
+    }
+
+    http_add_header(conn, "Accept-Ranges", "bytes");
+
+    if (gz) {
+        struct http_file_body body = {
+            .fd = f->gz_fd,
+            .offset = 0,
+            .len = f->gz_size,
+            .release = static_file_put,
+            .ref = f,
+        };
+        http_add_header(conn, "Content-Encoding", "gzip");
+        http_set_file_response(conn, 200, f->mime, &body);
+        return 0;
+    }
+
+    int status = 200;
+    off_t start = 0, end = f->size - 1;
+    const char *range = http_get_header(conn, HTTP_HDR_RANGE);
+    const char *if_range = http_get_header(conn, HTTP_HDR_IF_RANGE);
+
+    /* If-Range 与当前版本不符时忽略 Range，返回完整文件 */
+    if (range && (!if_range || strcmp(if_range, f->etag) == 0 ||
+                  strcmp(if_range, f->last_modified) == 0)) {
+        char content_range[96];
+        int r = static_parse_range(range, f->size, &start, &end);
+
+        if (r < 0) {
+            snprintf(content_range, sizeof(content_range), "bytes */%llu",
+                     (unsigned long long)f->size);
+            http_add_header(conn, "Content-Range", content_range);
+            http_set_response(conn, 416, "text/plain", HTTP_STATIC_BODY(""));
+            static_file_put(f);
+            return 0;
+        }
+        if (r > 0) {
+            snprintf(content_range, sizeof(content_range), "bytes %llu-%llu/%llu",
+                     (unsigned long long)start, (unsigned long long)end,
+                     (unsigned long long)f->size);
+            http_add_header(conn, "Content-Range", content_range);
+            status = 206;
+        }
+    }
+
+    if (f->size == 0) {
+        http_set_response(conn, status, f->mime, HTTP_STATIC_BODY(""));
+        static_file_put(f);
+        return 0;
+    }
+
+    struct http_file_body body = {
+        .fd = f->fd,
+        .offset = start,
+        .len = end - start + 1,
+        .release = static_file_put,
+        .ref = f,
+    };
+    http_set_file_response(conn, status, f->mime, &body);
+    return 0;
+}
+
+static int static_init(struct http_conn *conn, const char *content_type)
+{
+    return 0;
+}
+
+static int static_data(struct http_conn *conn, const char *data, size_t len)
+{
+    /* GET/HEAD 不处理 body */
+    return 0;
+}
+
+static void static_cleanup(struct http_conn *conn)
+{
+    /* 文件引用由 http.c 在发送完毕后通过 release 回调释放 */
+}
+
+static http_body_handler_t static_handler = {
+    .on_init = static_init,
+    .on_data = static_data,
+    .on_complete = static_complete,
+    .on_cleanup = static_cleanup,
+};
+
+struct http_static_root *http_static_root_new(const char *dir)
+{
+    struct http_static_root *root = malloc(sizeof(*root));
+
+    if (!root) return NULL;
+    root->fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (root->fd < 0) {
+        perror(dir);
+        free(root);
+        return NULL;
+    }
+    return root;
+}
+
+http_body_handler_t *http_static_handler(const char *root)
+{
+    if (root && g_root_fd < 0) {
+        g_root_fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (g_root_fd < 0) {
+            perror(root);
+            return NULL;
+        }
+    }
+    return &static_handler;
+}
@@ -0,0 +1,19 @@
+#ifndef HTTP_STATIC_H
+#define HTTP_STATIC_H
+
+#include "http.h"
+
+/* 静态文件处理器：GET/HEAD 返回 root 目录下的文件
+ * - HTTP 用 sendfile 发送，HTTPS 用 mmap 映射后分记录写入
+ * - 支持单段 Range（206/416）、ETag/If-None-Match 与 If-Modified-Since（304）
+ * - 打开的 fd 和 stat 结果按路径缓存，每秒最多重新 stat 一次
+ * - 启用压缩时，文本类文件有不旧于它的 FILE.gz 就发送该 gzip 变体（预先用 gzip -k 生成，不在请求路径上压缩）
+ * root 目录无法打开时返回 NULL；root 为 NULL 时只返回处理器（根目录由路由上下文提供） */
+http_body_handler_t *http_static_handler(const char *root);
+
+/* 路由模式下每条路由可使用独立的根目录：作为 http_router_add() 的 ctx 传入
+ * URL 路径整体映射到目录下（/assets/a.css → DIR/assets/a.css） */
+struct http_static_root;
+struct http_static_root *http_static_root_new(const char *dir);
+
+#endif // HTTP_STATIC_H
@@ -0,0 +1,108 @@
+#include <time.h>
+#include <libubox/uloop.h>
+#include "http_timer.h"
+
+#define HTTP_TIMER_MASK (HTTP_TIMER_SLOTS - 1)
+
+static struct list_head g_slots[HTTP_TIMER_SLOTS];
+static int g_slots_init = 0;
+static uint64_t g_base_ms;          /* 刻度 0 对应的单调时钟 */
+static uint32_t g_now;              /* 已处理到的刻度 */
+static unsigned int g_count = 0;    /* 已启动的定时器数 */
+
+static void http_timer_tick(struct uloop_timeout *ut);
+static struct uloop_timeout g_tick = { .cb = http_timer_tick };
+
+static uint64_t http_timer_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* 当前时间对应的刻度 */
+static uint32_t http_timer_clock(void)
+{
+    return (uint32_t)((http_timer_now_ms() - g_base_ms) / HTTP_TIMER_TICK_MS);
+}
+
+/* 推进到当前刻度：经过的槽中到期的定时器先移到临时链表再逐个回调，
+ * 回调中可以任意设置或取消定时器（包括临时链表中尚未回调的） */
+static void http_timer_tick(struct uloop_timeout *ut)
+{
+    uint32_t now = http_timer_clock();
+    uint32_t steps = now - g_now;
+    http_timer_t *t, *n;
+    LIST_HEAD(expired);
+
+    /* 落后超过一圈时每个槽只需扫描一次 */
+    if (steps > HTTP_TIMER_SLOTS) {
+        steps = HTTP_TIMER_SLOTS;
+    }
+
+    for (uint32_t tick = now - steps + 1; steps > 0; tick++, steps--) {
+        struct list_head *slot = &g_slots[tick & HTTP_TIMER_MASK];
+
+        list_for_each_entry_safe(t, n, slot, list) {
+            if ((int32_t)(t->expires - now) <= 0) {
+                list_del(&t->list);
+                list_add_tail(&t->list, &expired);
+            }
+        }
+    }
+    g_now = now;
+
+    while (!list_empty(&expired)) {
+        t = list_first_entry(&expired, http_timer_t, list);
+        list_del(&t->list);
+        t->pending = 0;
+        g_count--;
+        t->cb(t);
+    }
+
+    if (g_count) {
+        uloop_timeout_set(ut, HTTP_TIMER_TICK_MS);
+    }
+}
+
+void http_timer_set(http_timer_t *t, unsigned int ms)
+{
+    uint32_t ticks = (ms + HTTP_TIMER_TICK_MS - 1) / HTTP_TIMER_TICK_MS;
+
+    if (!g_slots_init) {
+        for (int i = 0; i < HTTP_TIMER_SLOTS; i++) {
+            INIT_LIST_HEAD(&g_slots[i]);
+        }
+        g_base_ms = http_timer_now_ms();
+        g_slots_init = 1;
+    }
+
+    if (t->pending) {
+        list_del(&t->list);
+    } else {
+        t->pending = 1;
+        if (g_count++ == 0) {
+            /* 时间轮停转期间没有定时器，直接跳到当前刻度 */
+            g_now = http_timer_clock();
+            uloop_timeout_set(&g_tick, HTTP_TIMER_TICK_MS);
+        }
+    }
+
+    /* 按当前时间而不是已处理到的刻度计算，时间轮落后时也不会提前到期 */
+    t->expires = http_timer_clock() + (ticks ? ticks : 1);
+    list_add_tail(&t->list, &g_slots[t->expires & HTTP_TIMER_MASK]);
+}
+
+void http_timer_cancel(http_timer_t *t)
+{
+    if (!t->pending) {
+        return;
+    }
+
+    list_del(&t->list);
+    t->pending = 0;
+    if (--g_count == 0) {
+        uloop_timeout_cancel(&g_tick);
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef HTTP_TIMER_H
+#define HTTP_TIMER_H
+
+#include <stdint.h>
+#include <libubox/list.h>
+
+/* 连接超时用的时间轮
+ * - 每个连接一个定时器，设置 / 重设 / 取消都是 O(1) 的链表操作，
+ *   不像 uloop_timeout 那样按到期时间插入有序链表
+ * - 精度为 HTTP_TIMER_TICK_MS；只有存在定时器时才驱动底层 uloop_timeout，空闲进程不被唤醒
+ * - 结构体清零即为未启动状态（连接池对象可直接使用） */
+
+#define HTTP_TIMER_TICK_MS  100     /* 时间轮刻度 */
+#define HTTP_TIMER_SLOTS    512     /* 槽数（2 的幂），一圈 51.2 秒，更长的定时器多转几圈 */
+
+typedef struct http_timer http_timer_t;
+
+struct http_timer {
+    struct list_head list;
+    uint32_t expires;               /* 到期刻度 */
+    int pending;
+    void (*cb)(http_timer_t *t);
+};
+
+/* 启动或重设：约 ms 毫秒后（误差在一个刻度以内）调用 t->cb，回调前定时器已停止 */
+void http_timer_set(http_timer_t *t, unsigned int ms);
+
+void http_timer_cancel(http_timer_t *t);
+
+#endif // HTTP_TIMER_H
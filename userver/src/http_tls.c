@@ -0,0 +1,405 @@
+#include "http_tls.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <libubox/ustream.h>
+#include <openssl/ssl.h>
+#include <openssl/rand.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+typedef EVP_MAC_CTX tls_mac_ctx_t;
+#else
+typedef HMAC_CTX tls_mac_ctx_t;
+#endif
+
+#define TLS_SECRET_LEN      32
+#define TLS_SESSION_ID_CTX  "userver"
+
+/* 某个周期的 ticket 密钥 */
+struct tls_ticket_key {
+    uint64_t epoch;                 /* 0 表示未派生 */
+    unsigned char name[16];         /* 前 8 字节为周期号（大端），后 8 字节由主密钥派生 */
+    unsigned char aes_key[32];
+    unsigned char hmac_key[32];
+};
+
+static unsigned char g_secret[TLS_SECRET_LEN];
+static int g_secret_ready = 0;
+
+/* 已配置过的 SSL_CTX（ustream-ssl 不直接暴露，从第一个连接取得） */
+static SSL_CTX *g_ctx = NULL;
+
+/* 按周期奇偶缓存当前与前一周期的密钥，握手时不重复派生 */
+static struct tls_ticket_key g_keys[2];
+
+static struct http_tls_stats g_stats;
+
+/* ALPN 协议列表（按优先级）；未启用 HTTP/2 时只协商 http/1.1 */
+static const unsigned char g_alpn_h2[] = "\x02h2\x08http/1.1";
+static const unsigned char g_alpn_h1[] = "\x08http/1.1";
+static int g_h2 = 0;
+
+int http_tls_init(void)
+{
+    if (g_secret_ready) {
+        return 0;
+    }
+    if (RAND_bytes(g_secret, sizeof(g_secret)) != 1) {
+        fprintf(stderr, "Failed to generate TLS ticket secret\n");
+        return -1;
+    }
+    g_secret_ready = 1;
+    return 0;
+}
+
+/* 派生周期 epoch 的密钥：HMAC-SHA512(secret, epoch || 'k') 拆为 AES 与 HMAC 密钥，
+ * HMAC-SHA256(secret, epoch || 'n') 的前 8 字节作为 key name 的校验部分 */
+static int tls_derive_key(uint64_t epoch, struct tls_ticket_key *key)
+{
+    unsigned char msg[9], out[EVP_MAX_MD_SIZE];
+    unsigned int len;
+
+    for (int i = 0; i < 8; i++) {
+        msg[i] = (unsigned char)(epoch >> (56 - 8 * i));
+    }
+
+    msg[8] = 'k';
+    if (!HMAC(EVP_sha512(), g_secret, sizeof(g_secret), msg, sizeof(msg), out, &len)) {
+        return -1;
+    }
+    memcpy(key->aes_key, out, 32);
+    memcpy(key->hmac_key, out + 32, 32);
+
+    msg[8] = 'n';
+    if (!HMAC(EVP_sha256(), g_secret, sizeof(g_secret), msg, sizeof(msg), out, &len)) {
+        return -1;
+    }
+    memcpy(key->name, msg, 8);
+    memcpy(key->name + 8, out, 8);
+
+    key->epoch = epoch;
+    return 0;
+}
+
+static const struct tls_ticket_key *tls_get_key(uint64_t epoch)
+{
+    struct tls_ticket_key *key = &g_keys[epoch & 1];
+
+    if (key->epoch != epoch && tls_derive_key(epoch, key) < 0) {
+        key->epoch = 0;
+        return NULL;
+    }
+    return key;
+}
+
+static int tls_mac_init(tls_mac_ctx_t *hctx, const struct tls_ticket_key *key)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, (void *)key->hmac_key,
+                                          sizeof(key->hmac_key)),
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, "SHA256", 0),
+        OSSL_PARAM_construct_end(),
+    };
+    return EVP_MAC_CTX_set_params(hctx, params) ? 0 : -1;
+#else
+    return HMAC_Init_ex(hctx, key->hmac_key, sizeof(key->hmac_key), EVP_sha256(), NULL) ? 0 : -1;
+#endif
+}
+
+/* ticket 加解密密钥回调
+ * 返回：1 使用该密钥；2 可解密但需换发；0 未知密钥（完整握手）；-1 出错
+ * 前一周期的 ticket 换发；TLS 1.3 客户端每个 ticket 只用一次，复用时总是换发 */
+static int tls_ticket_key_cb(SSL *ssl, unsigned char key_name[16], unsigned char *iv,
+                             EVP_CIPHER_CTX *cctx, tls_mac_ctx_t *hctx, int enc)
+{
+    uint64_t now = (uint64_t)time(NULL) / HTTP_TLS_TICKET_ROTATE;
+    const struct tls_ticket_key *key;
+    uint64_t epoch = 0;
+
+    if (enc) {
+        key = tls_get_key(now);
+        if (!key || RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1) {
+            return -1;
+        }
+        memcpy(key_name, key->name, sizeof(key->name));
+        if (!EVP_EncryptInit_ex(cctx, EVP_aes_256_cbc(), NULL, key->aes_key, iv) ||
+            tls_mac_init(hctx, key) < 0) {
+            return -1;
+        }
+        return 1;
+    }
+
+    for (int i = 0; i < 8; i++) {
+        epoch = (epoch << 8) | key_name[i];
+    }
+    if (epoch != now && epoch + 1 != now) {
+        return 0;
+    }
+
+    key = tls_get_key(epoch);
+    if (!key || memcmp(key_name, key->name, sizeof(key->name)) != 0) {
+        return 0;
+    }
+    if (tls_mac_init(hctx, key) < 0 ||
+        !EVP_DecryptInit_ex(cctx, EVP_aes_256_cbc(), NULL, key->aes_key, iv)) {
+        return -1;
+    }
+    return (epoch == now && SSL_version(ssl) < TLS1_3_VERSION) ? 1 : 2;
+}
+
+void http_tls_set_h2(int enable)
+{
+    g_h2 = enable;
+}
+
+/* 按服务端的优先级选择客户端提供的协议；没有共同协议时不使用 ALPN（按 HTTP/1.1 处理） */
+static int tls_alpn_cb(SSL *ssl, const unsigned char **out, unsigned char *outlen,
+                       const unsigned char *in, unsigned int inlen, void *arg)
+{
+    const unsigned char *prefs = g_h2 ? g_alpn_h2 : g_alpn_h1;
+    unsigned int prefs_len = g_h2 ? sizeof(g_alpn_h2) - 1 : sizeof(g_alpn_h1) - 1;
+    unsigned char *sel;
+
+    (void)ssl;
+    (void)arg;
+    if (SSL_select_next_proto(&sel, outlen, prefs, prefs_len, in, inlen) != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    *out = sel;
+    return SSL_TLSEXT_ERR_OK;
+}
+
+void http_tls_conn_init(void *ssl)
+{
+    SSL *s = ssl;
+    SSL_CTX *ctx;
+
+    if (!s) return;
+
+    ctx = SSL_get_SSL_CTX(s);
+    if (ctx == g_ctx || http_tls_init() < 0) {
+        return;
+    }
+
+    SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(ctx, HTTP_TLS_CACHE_SIZE);
+    SSL_CTX_set_timeout(ctx, HTTP_TLS_TICKET_ROTATE);
+    SSL_CTX_set_session_id_context(ctx, (const unsigned char *)TLS_SESSION_ID_CTX,
+                                   sizeof(TLS_SESSION_ID_CTX) - 1);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, tls_ticket_key_cb);
+#else
+    SSL_CTX_set_tlsext_ticket_key_cb(ctx, tls_ticket_key_cb);
+#endif
+    SSL_CTX_set_alpn_select_cb(ctx, tls_alpn_cb, NULL);
+    g_ctx = ctx;
+
+    /* 当前连接在配置前创建，选项和 session ID 上下文需单独设置 */
+    SSL_clear_options(s, SSL_OP_NO_TICKET);
+    SSL_set_session_id_context(s, (const unsigned char *)TLS_SESSION_ID_CTX,
+                               sizeof(TLS_SESSION_ID_CTX) - 1);
+}
+
+int http_tls_resumed(void *ssl)
+{
+    return ssl && SSL_session_reused((SSL *)ssl);
+}
+
+void http_tls_handshake_done(void *ssl)
+{
+    if (!ssl) return;
+
+    if (SSL_session_reused((SSL *)ssl)) {
+        g_stats.resumed++;
+    } else {
+        g_stats.full++;
+    }
+}
+
+void http_tls_get_stats(struct http_tls_stats *stats)
+{
+    *stats = g_stats;
+}
+
+/* ============ 内核 TLS ============ */
+
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+/* 在 loopback 上建立一个连接并设置 TCP_ULP "tls"：未加载 tls 模块（且无法自动加载）时失败 */
+static int tls_ktls_probe(void)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET };
+    socklen_t len = sizeof(addr);
+    int lfd, cfd = -1, afd = -1, ok = 0;
+
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    lfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (lfd < 0) {
+        return 0;
+    }
+    if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) == 0 && listen(lfd, 1) == 0 &&
+        getsockname(lfd, (struct sockaddr *)&addr, &len) == 0) {
+        cfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (cfd >= 0 && connect(cfd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            afd = accept(lfd, NULL, NULL);
+            ok = afd >= 0 && setsockopt(afd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls")) == 0;
+        }
+    }
+
+    if (afd >= 0) close(afd);
+    if (cfd >= 0) close(cfd);
+    close(lfd);
+    return ok;
+}
+#endif
+
+int http_tls_ktls_supported(void)
+{
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+    static int supported = -1;
+
+    if (supported < 0) {
+        supported = tls_ktls_probe();
+    }
+    return supported;
+#else
+    return 0;
+#endif
+}
+
+int http_tls_ktls_start(void *ssl, int fd)
+{
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+    SSL *s = ssl;
+
+    /* socket BIO 逐个记录读取（未开启 read_ahead），握手完成时不会多读应用数据 */
+    if (!s || !SSL_set_fd(s, fd)) {
+        return -1;
+    }
+    SSL_set_options(s, SSL_OP_ENABLE_KTLS);
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+int http_tls_want_write(void *ssl)
+{
+    return ssl && SSL_want_write((SSL *)ssl);
+}
+
+/* 经 ustream 收发密文的 BIO（与 ustream-ssl 自带的相同）：读取底层 stream 的接收缓冲区，
+ * 写入底层 stream（写不完的部分由 ustream 缓冲） */
+static int tls_bio_read(BIO *b, char *buf, int len)
+{
+    struct ustream *s = BIO_get_data(b);
+    char *data;
+    int n;
+
+    BIO_clear_retry_flags(b);
+    if (!s || !buf || len <= 0) {
+        return 0;
+    }
+    data = ustream_get_read_buf(s, &n);
+    if (!data || n <= 0) {
+        BIO_set_retry_read(b);
+        return -1;
+    }
+    if (n > len) {
+        n = len;
+    }
+    memcpy(buf, data, n);
+    ustream_consume(s, n);
+    return n;
+}
+
+static int tls_bio_write(BIO *b, const char *buf, int len)
+{
+    struct ustream *s = BIO_get_data(b);
+
+    if (!s || !buf || len <= 0) {
+        return 0;
+    }
+    if (s->write_error) {
+        return len;
+    }
+    return ustream_write(s, buf, len, false);
+}
+
+static long tls_bio_ctrl(BIO *b, int cmd, long num, void *ptr)
+{
+    return cmd == BIO_CTRL_FLUSH;
+}
+
+static int tls_bio_create(BIO *b)
+{
+    BIO_set_init(b, 1);
+    return 1;
+}
+
+static BIO *tls_stream_bio(struct ustream *s)
+{
+    static BIO_METHOD *method = NULL;
+    BIO *b;
+
+    if (!method) {
+        method = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK, "userver stream");
+        if (!method) {
+            return NULL;
+        }
+        BIO_meth_set_read(method, tls_bio_read);
+        BIO_meth_set_write(method, tls_bio_write);
+        BIO_meth_set_ctrl(method, tls_bio_ctrl);
+        BIO_meth_set_create(method, tls_bio_create);
+    }
+
+    b = BIO_new(method);
+    if (b) {
+        BIO_set_data(b, s);
+    }
+    return b;
+}
+
+int http_tls_ktls_finish(void *ssl, struct ustream *s)
+{
+    SSL *ss = ssl;
+    int mode = 0;
+
+    if (BIO_get_ktls_send(SSL_get_wbio(ss))) {
+        mode |= HTTP_KTLS_TX;
+        g_stats.ktls_tx++;
+    }
+    if (BIO_get_ktls_recv(SSL_get_rbio(ss))) {
+        mode |= HTTP_KTLS_RX;
+        g_stats.ktls_rx++;
+    }
+
+    /* 接管发送时写方向保留 socket BIO：OpenSSL 之后发出的 alert 等记录也由内核加密 */
+    if (!(mode & HTTP_KTLS_RX)) {
+        BIO *b = tls_stream_bio(s);
+        if (!b) {
+            return -1;
+        }
+        SSL_set0_rbio(ss, b);
+    }
+    if (!(mode & HTTP_KTLS_TX)) {
+        BIO *b = tls_stream_bio(s);
+        if (!b) {
+            return -1;
+        }
+        SSL_set0_wbio(ss, b);
+    }
+    return mode;
+}
+
+void http_tls_cleanup(void)
+{
+    g_ctx = NULL;
+}
@@ -0,0 +1,69 @@
+#ifndef HTTP_TLS_H
+#define HTTP_TLS_H
+
+#include <stdint.h>
+
+/* HTTPS 会话复用（ustream-ssl 的 OpenSSL 后端）
+ * - session ticket：密钥由启动时生成的随机主密钥按周期（HTTP_TLS_TICKET_ROTATE 秒）派生，
+ *   当前周期的密钥签发，前一周期的仍可解密（并换发新 ticket）；
+ *   worker 在 fork 前继承同一主密钥，任一 worker 签发的 ticket 其他 worker 都能解密
+ * - 服务端 session 缓存：进程内缓存，供不支持 ticket 的客户端按 session ID 复用
+ * - 统计完整握手与复用握手次数
+ *
+ * 内核 TLS（kTLS）
+ * - 握手改为直接读写 socket，OpenSSL 在密钥就绪时设置 TCP_ULP "tls" 并把密钥交给内核
+ *   （内核支持的 AEAD 套件，如 AES-GCM）
+ * - 握手完成后，内核接管的方向直接读写明文（发送可以 sendfile），
+ *   未接管的方向换回经 ustream 收发密文的 BIO，仍由 OpenSSL 在用户态加解密
+ *   （如 OpenSSL 3.0 对 TLS 1.3 只支持发送方向） */
+
+#define HTTP_TLS_TICKET_ROTATE  3600    /* ticket 密钥轮换周期（秒） */
+#define HTTP_TLS_CACHE_SIZE     20480   /* 每个 worker 的 session 缓存条目上限 */
+
+struct ustream;
+
+struct http_tls_stats {
+    uint64_t full;              /* 完整握手（私钥运算） */
+    uint64_t resumed;           /* 复用握手（ticket 或 session ID） */
+    uint64_t ktls_tx;           /* 发送方向由内核加密的连接 */
+    uint64_t ktls_rx;           /* 接收方向由内核解密的连接 */
+};
+
+/* http_tls_ktls_finish 的返回值 */
+#define HTTP_KTLS_TX    1
+#define HTTP_KTLS_RX    2
+
+/* 生成 ticket 主密钥：多进程模式须在 fork worker 之前调用；重复调用无效果 */
+int http_tls_init(void);
+
+/* ALPN 是否优先协商 h2（HTTP/2），在第一个连接之前设置 */
+void http_tls_set_h2(int enable);
+
+/* 新连接的 SSL 对象（SSL*）创建后调用：首次遇到其 SSL_CTX 时配置 ticket 与缓存 */
+void http_tls_conn_init(void *ssl);
+
+/* 握手完成时调用，更新统计 */
+void http_tls_handshake_done(void *ssl);
+
+void http_tls_get_stats(struct http_tls_stats *stats);
+
+/* 连接是否复用了会话（握手完成后有效） */
+int http_tls_resumed(void *ssl);
+
+/* OpenSSL 与内核是否支持 kTLS（进程内探测一次） */
+int http_tls_ktls_supported(void);
+
+/* 新连接的 SSL 对象创建后、握手开始前调用：改为直接读写 fd 并启用 kTLS */
+int http_tls_ktls_start(void *ssl, int fd);
+
+/* 握手未完成时是否在等待 socket 可写 */
+int http_tls_want_write(void *ssl);
+
+/* 握手完成时调用：返回内核接管的方向（HTTP_KTLS_TX | HTTP_KTLS_RX），出错返回 -1；
+ * 未接管的方向改为经 s（底层 fd stream）收发密文 */
+int http_tls_ktls_finish(void *ssl, struct ustream *s);
+
+/* 释放 SSL 上下文前调用，之后新建的上下文会重新配置 */
+void http_tls_cleanup(void);
+
+#endif // HTTP_TLS_H
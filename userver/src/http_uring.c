@@ -0,0 +1,843 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <libubox/list.h>
+#include <libubox/uloop.h>
+#include <libubox/utils.h>
+#include "http_uring.h"
+
+#define URING_BGID          0
+#define URING_IOV_MAX       32
+
+/* user_data 低 3 位为请求类型，其余为 struct uring_io 指针（accept / cancel 为 0） */
+enum {
+    URING_OP_ACCEPT = 1,
+    URING_OP_RECV,
+    URING_OP_SEND,
+    URING_OP_POLL,
+    URING_OP_CANCEL,
+};
+#define URING_OP_MASK       7
+
+/* 每个连接的 io_uring 状态；stream 释放后（sf 为 NULL）等所有请求完成再释放 */
+struct uring_io {
+    struct ustream_fd *sf;
+    int fd;
+    int inflight;               /* 已提交未完成的请求数 */
+    int recv_armed;
+    int send_armed;
+    int poll_armed;
+    int poll_want;
+    uint32_t sent;              /* 已发送、尚未从写缓冲移除的字节数 */
+    int held_bid;               /* 未拷完的接收缓冲区，-1 为无 */
+    uint32_t held_off;
+    uint32_t held_len;
+    struct list_head kick;      /* 待处理：投递暂存数据、发起 recv / send / poll */
+    struct list_head nobuf;     /* 等待接收缓冲区 */
+    struct msghdr msg;
+    struct iovec iov[URING_IOV_MAX];
+    struct ustream_buf *wbufs;  /* stream 释放时接管的写缓冲，sendmsg 完成前不能释放 */
+};
+
+struct uring {
+    int fd;
+    unsigned sq_entries;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_flags;
+    unsigned *sq_array;
+    unsigned sq_local;          /* 本地 tail，含尚未发布给内核的 SQE */
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    struct io_uring_sqe *sqes;
+    void *sq_ptr;
+    void *cq_ptr;
+    size_t sq_len;
+    size_t cq_len;
+    size_t sqes_len;
+    struct io_uring_buf_ring *br;
+    size_t br_len;
+    char *bufs;
+    size_t bufs_len;
+    unsigned short br_tail;
+};
+
+static struct uring g_ring = { .fd = -1 };
+static struct uloop_fd g_ring_ufd;
+static void uring_flush_cb(struct uloop_timeout *t);
+static struct uloop_timeout g_flush_timer = { .cb = uring_flush_cb };
+static LIST_HEAD(g_kick_list);
+static LIST_HEAD(g_nobuf_list);
+
+/* fd -> uring_io */
+static struct uring_io **g_ios = NULL;
+static int g_ios_size = 0;
+
+static int g_accept_fd = -1;    /* >= 0：需要 accept */
+static int g_accept_armed = 0;  /* 多发 accept 仍在内核中 */
+static void (*g_accept_cb)(int fd) = NULL;
+
+static struct http_uring_stats g_stats;
+
+static int uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int uring_register(int fd, unsigned op, void *arg, unsigned nr)
+{
+    return syscall(__NR_io_uring_register, fd, op, arg, nr);
+}
+
+/* ============ 提交与收取 ============ */
+
+static void uring_submit(void)
+{
+    struct uring *r = &g_ring;
+    unsigned n;
+
+    __atomic_store_n(r->sq_tail, r->sq_local, __ATOMIC_RELEASE);
+    n = r->sq_local - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+
+    while (n > 0) {
+        int ret = uring_enter(r->fd, n, 0, 0);
+
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        g_stats.enters++;
+        if (ret <= 0) {
+            /* EAGAIN / EBUSY（完成队列积压）：收取完成事件后在下一轮重试 */
+            uloop_timeout_set(&g_flush_timer, 1);
+            break;
+        }
+        n -= ret;
+    }
+}
+
+/* 取一个空闲 SQE，本轮事件循环末尾统一提交；SQ 满时先提交一次 */
+static struct io_uring_sqe *uring_sqe(void)
+{
+    struct uring *r = &g_ring;
+    struct io_uring_sqe *sqe;
+
+    if (r->sq_local - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries) {
+        uring_submit();
+        if (r->sq_local - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries) {
+            return NULL;
+        }
+    }
+
+    sqe = &r->sqes[r->sq_local & *r->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    r->sq_local++;
+    g_stats.sqes++;
+
+    if (!g_flush_timer.pending) {
+        uloop_timeout_set(&g_flush_timer, 0);
+    }
+    return sqe;
+}
+
+static void uring_cancel(struct uring_io *io, int op)
+{
+    struct io_uring_sqe *sqe = uring_sqe();
+
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = (uintptr_t)io | op;
+    sqe->user_data = URING_OP_CANCEL;
+}
+
+static void uring_io_free(struct uring_io *io)
+{
+    while (io->wbufs) {
+        struct ustream_buf *next = io->wbufs->next;
+
+        free(io->wbufs);
+        io->wbufs = next;
+    }
+    free(io);
+}
+
+static void uring_io_schedule(struct uring_io *io)
+{
+    if (list_empty(&io->kick)) {
+        list_add_tail(&io->kick, &g_kick_list);
+    }
+    if (!g_flush_timer.pending) {
+        uloop_timeout_set(&g_flush_timer, 0);
+    }
+}
+
+/* ============ 接收缓冲区 ============ */
+
+static char *uring_buf(int bid)
+{
+    return g_ring.bufs + (size_t)bid * HTTP_URING_BUF_SIZE;
+}
+
+/* 缓冲区还给内核；有连接在等缓冲区时唤醒一个 */
+static void uring_buf_put(int bid)
+{
+    struct uring *r = &g_ring;
+    struct io_uring_buf *b = &r->br->bufs[r->br_tail & (HTTP_URING_BUFS - 1)];
+
+    b->addr = (uintptr_t)uring_buf(bid);
+    b->len = HTTP_URING_BUF_SIZE;
+    b->bid = bid;
+    r->br_tail++;
+    __atomic_store_n(&r->br->tail, r->br_tail, __ATOMIC_RELEASE);
+
+    if (!list_empty(&g_nobuf_list)) {
+        struct uring_io *io = list_first_entry(&g_nobuf_list, struct uring_io, nobuf);
+
+        list_del_init(&io->nobuf);
+        uring_io_schedule(io);
+    }
+}
+
+/* ============ 连接 ============ */
+
+static struct uring_io *uring_io_get(struct ustream *s)
+{
+    struct ustream_fd *sf = container_of(s, struct ustream_fd, stream);
+
+    return g_ios[sf->fd.fd];
+}
+
+/* 暂存的接收数据拷入 ustream 读缓冲区；读缓冲区满或已暂停读取时留到下次 */
+static void uring_io_deliver(struct uring_io *io)
+{
+    while (io->held_bid >= 0 && io->sf && !io->sf->stream.read_blocked) {
+        struct ustream *s = &io->sf->stream;
+        int len;
+        char *buf = ustream_reserve(s, 1, &len);
+
+        if (!buf || len <= 0) {
+            break;
+        }
+        if ((uint32_t)len > io->held_len) {
+            len = io->held_len;
+        }
+        memcpy(buf, uring_buf(io->held_bid) + io->held_off, len);
+        io->held_off += len;
+        io->held_len -= len;
+        if (!io->held_len) {
+            uring_buf_put(io->held_bid);
+            io->held_bid = -1;
+        }
+        ustream_fill_read(s, len);
+    }
+}
+
+static void uring_io_arm_recv(struct uring_io *io)
+{
+    struct ustream *s = &io->sf->stream;
+    struct io_uring_sqe *sqe;
+
+    if (io->recv_armed || io->held_bid >= 0 || s->read_blocked || s->eof ||
+        !list_empty(&io->nobuf)) {
+        return;
+    }
+    sqe = uring_sqe();
+    if (!sqe) {
+        uring_io_schedule(io);
+        return;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = io->fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BGID;
+    sqe->user_data = (uintptr_t)io | URING_OP_RECV;
+    io->recv_armed = 1;
+    io->inflight++;
+}
+
+/* 写缓冲中的数据合成一个 sendmsg；完成前数据留在写缓冲里，之后追加的数据等下一次 */
+static void uring_io_send(struct uring_io *io)
+{
+    struct ustream *s = &io->sf->stream;
+    struct ustream_buf *buf;
+    struct io_uring_sqe *sqe;
+    int n = 0;
+
+    if (io->send_armed || s->write_error || s->w.data_bytes <= 0) {
+        return;
+    }
+    for (buf = s->w.head; buf && n < URING_IOV_MAX; buf = buf->next) {
+        if (buf->tail > buf->data) {
+            io->iov[n].iov_base = buf->data;
+            io->iov[n].iov_len = buf->tail - buf->data;
+            n++;
+        }
+    }
+    if (!n) {
+        return;
+    }
+
+    sqe = uring_sqe();
+    if (!sqe) {
+        uring_io_schedule(io);
+        return;
+    }
+    memset(&io->msg, 0, sizeof(io->msg));
+    io->msg.msg_iov = io->iov;
+    io->msg.msg_iovlen = n;
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = io->fd;
+    sqe->addr = (uintptr_t)&io->msg;
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = (uintptr_t)io | URING_OP_SEND;
+    io->send_armed = 1;
+    io->inflight++;
+}
+
+static void uring_io_arm_poll(struct uring_io *io)
+{
+    struct io_uring_sqe *sqe;
+
+    if (!io->poll_want || io->poll_armed) {
+        return;
+    }
+    sqe = uring_sqe();
+    if (!sqe) {
+        uring_io_schedule(io);
+        return;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = io->fd;
+    sqe->poll32_events = POLLOUT;
+    sqe->user_data = (uintptr_t)io | URING_OP_POLL;
+    io->poll_want = 0;
+    io->poll_armed = 1;
+    io->inflight++;
+}
+
+static void uring_io_kick(struct uring_io *io)
+{
+    uring_io_deliver(io);
+    if (!io->sf) {
+        return;
+    }
+    uring_io_arm_recv(io);
+    uring_io_send(io);
+    uring_io_arm_poll(io);
+}
+
+static void uring_recv_done(struct uring_io *io, struct io_uring_cqe *cqe)
+{
+    struct ustream *s;
+    int res = cqe->res;
+
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        int bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+
+        if (res > 0 && io->sf) {
+            io->held_bid = bid;
+            io->held_off = 0;
+            io->held_len = res;
+        } else {
+            uring_buf_put(bid);
+        }
+    }
+    if (!io->sf) {
+        return;
+    }
+
+    s = &io->sf->stream;
+    if (res == -ENOBUFS) {
+        g_stats.nobufs++;
+        if (list_empty(&io->nobuf)) {
+            list_add_tail(&io->nobuf, &g_nobuf_list);
+        }
+        return;
+    }
+    if (res == -EINTR || res == -EAGAIN || res == -ECANCELED) {
+        uring_io_schedule(io);
+        return;
+    }
+    if (res <= 0) {
+        s->eof = true;
+        ustream_state_change(s);
+        return;
+    }
+
+    uring_io_deliver(io);
+    if (io->sf) {
+        uring_io_arm_recv(io);
+    }
+}
+
+static void uring_send_done(struct uring_io *io, int res)
+{
+    struct ustream *s;
+
+    if (!io->sf) {
+        return;
+    }
+    s = &io->sf->stream;
+    if (res < 0) {
+        if (res == -EINTR || res == -EAGAIN) {
+            uring_io_schedule(io);
+            return;
+        }
+        s->write_error = true;
+        ustream_state_change(s);
+        return;
+    }
+
+    /* 已发送的字节由 write 回调交给 ustream 移除，剩余的数据再次提交 */
+    io->sent += res;
+    ustream_write_pending(s);
+    if (io->sf) {
+        uring_io_send(io);
+    }
+}
+
+static void uring_accept_arm(void);
+
+static void uring_accept_done(struct io_uring_cqe *cqe)
+{
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        g_accept_armed = 0;
+    }
+    if (cqe->res == -EINVAL) {
+        /* 内核不支持多发 accept：不再重试，回调收到 -EINVAL 后改用 uloop 接受连接 */
+        g_accept_fd = -1;
+    }
+    if (cqe->res != -ECANCELED && g_accept_cb) {
+        g_accept_cb(cqe->res);
+    }
+    if (!g_accept_armed && g_accept_fd >= 0) {
+        uring_accept_arm();
+    }
+}
+
+static void uring_complete(struct io_uring_cqe *cqe)
+{
+    int op = cqe->user_data & URING_OP_MASK;
+    struct uring_io *io = (struct uring_io *)(uintptr_t)(cqe->user_data & ~(uint64_t)URING_OP_MASK);
+
+    switch (op) {
+    case URING_OP_ACCEPT:
+        uring_accept_done(cqe);
+        return;
+    case URING_OP_RECV:
+        io->recv_armed = 0;
+        uring_recv_done(io, cqe);
+        break;
+    case URING_OP_SEND:
+        io->send_armed = 0;
+        uring_send_done(io, cqe->res);
+        break;
+    case URING_OP_POLL:
+        io->poll_armed = 0;
+        if (io->sf && io->sf->fd.cb) {
+            io->sf->fd.cb(&io->sf->fd, ULOOP_WRITE);
+        }
+        break;
+    default:
+        return;
+    }
+
+    /* 回调中 stream 可能已释放，完成计数放在最后 */
+    io->inflight--;
+    if (!io->sf && !io->inflight) {
+        uring_io_free(io);
+    }
+}
+
+static void uring_reap(void)
+{
+    struct uring *r = &g_ring;
+    unsigned head = *r->cq_head;
+
+    for (;;) {
+        struct io_uring_cqe cqe;
+
+        if (head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+            /* 完成队列曾经溢出：让内核把积压的事件搬进来 */
+            if (__atomic_load_n(r->sq_flags, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW) {
+                uring_enter(r->fd, 0, 0, IORING_ENTER_GETEVENTS);
+                g_stats.enters++;
+                if (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+                    continue;
+                }
+            }
+            break;
+        }
+        cqe = r->cqes[head & *r->cq_mask];
+        head++;
+        __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+        g_stats.cqes++;
+        uring_complete(&cqe);
+    }
+}
+
+static void uring_flush(void)
+{
+    struct list_head pending;
+
+    /* 只处理当前排队的连接，处理中重新排队的留到下一轮 */
+    if (!list_empty(&g_kick_list)) {
+        list_add(&pending, &g_kick_list);
+        list_del_init(&g_kick_list);
+        while (!list_empty(&pending)) {
+            struct uring_io *io = list_first_entry(&pending, struct uring_io, kick);
+
+            list_del_init(&io->kick);
+            uring_io_kick(io);
+        }
+    }
+    uring_submit();
+}
+
+static void uring_flush_cb(struct uloop_timeout *t)
+{
+    uring_flush();
+}
+
+static void uring_ring_cb(struct uloop_fd *fd, unsigned int events)
+{
+    uring_reap();
+    uring_flush();
+}
+
+/* ============ ustream 回调 ============ */
+
+static int uring_stream_write(struct ustream *s, const char *buf, int len, bool more)
+{
+    struct uring_io *io = uring_io_get(s);
+
+    /* 发送完成后由 ustream_write_pending 调用：报告已发送的部分 */
+    if (io->sent) {
+        uint32_t n = io->sent < (uint32_t)len ? io->sent : (uint32_t)len;
+
+        io->sent -= n;
+        return n;
+    }
+    /* 新数据：先进写缓冲，本轮末尾提交 */
+    uring_io_schedule(io);
+    return 0;
+}
+
+static void uring_stream_set_read_blocked(struct ustream *s)
+{
+    uring_io_schedule(uring_io_get(s));
+}
+
+static bool uring_stream_poll(struct ustream *s)
+{
+    struct uring_io *io = uring_io_get(s);
+    bool more = io->held_bid >= 0;
+
+    uring_io_deliver(io);
+    if (io->sf) {
+        uring_io_arm_recv(io);
+    }
+    return more;
+}
+
+static void uring_stream_free(struct ustream *s)
+{
+    struct uring_io *io = uring_io_get(s);
+
+    g_ios[io->fd] = NULL;
+    io->sf = NULL;
+    list_del_init(&io->kick);
+    list_del_init(&io->nobuf);
+    if (io->held_bid >= 0) {
+        uring_buf_put(io->held_bid);
+        io->held_bid = -1;
+    }
+    if (io->recv_armed) {
+        uring_cancel(io, URING_OP_RECV);
+    }
+    if (io->poll_armed) {
+        uring_cancel(io, URING_OP_POLL);
+    }
+    if (io->send_armed) {
+        /*
+         * iov 指向写缓冲，取消也可能晚于发送开始：把写缓冲从 stream 摘下交给 io，
+         * ustream_free 随后就不会释放它们，等所有请求完成后在 uring_io_free 中释放
+         */
+        io->wbufs = s->w.head;
+        s->w.head = NULL;
+        s->w.tail = NULL;
+        s->w.data_tail = NULL;
+        s->w.data_bytes = 0;
+        uring_cancel(io, URING_OP_SEND);
+    }
+    if (!io->inflight) {
+        uring_io_free(io);
+    }
+}
+
+int http_uring_stream_init(struct ustream_fd *sf, int fd)
+{
+    struct ustream *s = &sf->stream;
+    struct uring_io *io;
+
+    if (g_ring.fd < 0) {
+        return -1;
+    }
+    if (fd >= g_ios_size) {
+        int size = g_ios_size ? g_ios_size : 1024;
+        struct uring_io **ios;
+
+        while (size <= fd) {
+            size *= 2;
+        }
+        ios = realloc(g_ios, size * sizeof(*ios));
+        if (!ios) {
+            return -1;
+        }
+        memset(ios + g_ios_size, 0, (size - g_ios_size) * sizeof(*ios));
+        g_ios = ios;
+        g_ios_size = size;
+    }
+
+    io = calloc(1, sizeof(*io));
+    if (!io) {
+        return -1;
+    }
+    io->sf = sf;
+    io->fd = fd;
+    io->held_bid = -1;
+    INIT_LIST_HEAD(&io->kick);
+    INIT_LIST_HEAD(&io->nobuf);
+    g_ios[fd] = io;
+
+    sf->fd.fd = fd;
+    s->write = uring_stream_write;
+    s->free = uring_stream_free;
+    s->set_read_blocked = uring_stream_set_read_blocked;
+    s->poll = uring_stream_poll;
+    ustream_init_defaults(s);
+
+    /* 第一个 recv 在本轮末尾提交，调用方此前可以替换 notify / alloc 回调 */
+    uring_io_schedule(io);
+    return 0;
+}
+
+void http_uring_poll_out(struct ustream_fd *sf)
+{
+    struct uring_io *io = sf->fd.fd >= 0 && sf->fd.fd < g_ios_size ? g_ios[sf->fd.fd] : NULL;
+
+    if (!io || io->poll_armed) {
+        return;
+    }
+    io->poll_want = 1;
+    uring_io_schedule(io);
+}
+
+/* ============ accept ============ */
+
+static void uring_accept_arm(void)
+{
+    struct io_uring_sqe *sqe = uring_sqe();
+
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = g_accept_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = URING_OP_ACCEPT;
+    g_accept_armed = 1;
+}
+
+int http_uring_accept_start(int listen_fd, void (*cb)(int fd))
+{
+    g_accept_fd = listen_fd;
+    g_accept_cb = cb;
+    /* 之前的 accept 还在取消中：取消完成时按 g_accept_fd 重新发起 */
+    if (!g_accept_armed) {
+        uring_accept_arm();
+    }
+    return g_accept_armed ? 0 : -1;
+}
+
+void http_uring_accept_stop(void)
+{
+    struct io_uring_sqe *sqe;
+
+    g_accept_fd = -1;
+    if (!g_accept_armed || !(sqe = uring_sqe())) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = URING_OP_ACCEPT;
+    sqe->user_data = URING_OP_CANCEL;
+}
+
+/* ============ 初始化 ============ */
+
+int http_uring_init(void)
+{
+    struct uring *r = &g_ring;
+    struct io_uring_params p;
+    struct io_uring_buf_reg reg;
+
+    if (r->fd >= 0) {
+        return 0;
+    }
+
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_SUBMIT_ALL;
+    r->fd = uring_setup(HTTP_URING_ENTRIES, &p);
+    if (r->fd < 0 && errno == EINVAL) {
+        memset(&p, 0, sizeof(p));
+        r->fd = uring_setup(HTTP_URING_ENTRIES, &p);
+    }
+    if (r->fd < 0) {
+        return -1;
+    }
+    if (!(p.features & IORING_FEAT_NODROP)) {
+        goto fail;
+    }
+
+    r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_len > r->sq_len) {
+            r->sq_len = r->cq_len;
+        }
+        r->cq_len = r->sq_len;
+    }
+    r->sq_ptr = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ptr == MAP_FAILED) {
+        r->sq_ptr = NULL;
+        goto fail;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ptr = r->sq_ptr;
+    } else {
+        r->cq_ptr = mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ptr == MAP_FAILED) {
+            r->cq_ptr = NULL;
+            goto fail;
+        }
+    }
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        goto fail;
+    }
+
+    r->sq_entries = p.sq_entries;
+    r->sq_head = (unsigned *)((char *)r->sq_ptr + p.sq_off.head);
+    r->sq_tail = (unsigned *)((char *)r->sq_ptr + p.sq_off.tail);
+    r->sq_mask = (unsigned *)((char *)r->sq_ptr + p.sq_off.ring_mask);
+    r->sq_flags = (unsigned *)((char *)r->sq_ptr + p.sq_off.flags);
+    r->sq_array = (unsigned *)((char *)r->sq_ptr + p.sq_off.array);
+    r->cq_head = (unsigned *)((char *)r->cq_ptr + p.cq_off.head);
+    r->cq_tail = (unsigned *)((char *)r->cq_ptr + p.cq_off.tail);
+    r->cq_mask = (unsigned *)((char *)r->cq_ptr + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)((char *)r->cq_ptr + p.cq_off.cqes);
+    for (unsigned i = 0; i < p.sq_entries; i++) {
+        r->sq_array[i] = i;
+    }
+    r->sq_local = *r->sq_tail;
+
+    /* 接收缓冲区：页对齐的 ring + 数据区（按需分配物理页） */
+    r->br_len = HTTP_URING_BUFS * sizeof(struct io_uring_buf);
+    r->br = mmap(NULL, r->br_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (r->br == MAP_FAILED) {
+        r->br = NULL;
+        goto fail;
+    }
+    r->bufs_len = (size_t)HTTP_URING_BUFS * HTTP_URING_BUF_SIZE;
+    r->bufs = mmap(NULL, r->bufs_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (r->bufs == MAP_FAILED) {
+        r->bufs = NULL;
+        goto fail;
+    }
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uintptr_t)r->br;
+    reg.ring_entries = HTTP_URING_BUFS;
+    reg.bgid = URING_BGID;
+    if (uring_register(r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        goto fail;
+    }
+    r->br_tail = 0;
+    for (int i = 0; i < HTTP_URING_BUFS; i++) {
+        uring_buf_put(i);
+    }
+
+    g_ring_ufd.fd = r->fd;
+    g_ring_ufd.cb = uring_ring_cb;
+    uloop_fd_add(&g_ring_ufd, ULOOP_READ);
+    return 0;
+
+fail:
+    http_uring_cleanup();
+    return -1;
+}
+
+void http_uring_cleanup(void)
+{
+    struct uring *r = &g_ring;
+
+    if (r->fd < 0) {
+        return;
+    }
+    if (g_ring_ufd.registered) {
+        uloop_fd_delete(&g_ring_ufd);
+    }
+    uloop_timeout_cancel(&g_flush_timer);
+    close(r->fd);
+    r->fd = -1;
+
+    if (r->sqes) {
+        munmap(r->sqes, r->sqes_len);
+    }
+    if (r->cq_ptr && r->cq_ptr != r->sq_ptr) {
+        munmap(r->cq_ptr, r->cq_len);
+    }
+    if (r->sq_ptr) {
+        munmap(r->sq_ptr, r->sq_len);
+    }
+    if (r->br) {
+        munmap(r->br, r->br_len);
+    }
+    if (r->bufs) {
+        munmap(r->bufs, r->bufs_len);
+    }
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+
+    g_accept_fd = -1;
+    g_accept_armed = 0;
+}
+
+void http_uring_get_stats(struct http_uring_stats *stats)
+{
+    *stats = g_stats;
+}
@@ -0,0 +1,44 @@
+#ifndef HTTP_URING_H
+#define HTTP_URING_H
+
+#include <stdint.h>
+#include <libubox/ustream.h>
+
+/* io_uring 后端（可选，HTTP 明文连接）
+ * - 多发 accept（IORING_ACCEPT_MULTISHOT）：一个请求持续返回新连接
+ * - 接收使用注册给内核的缓冲区（provided buffer ring），每个连接同一时间一个 recv，
+ *   完成后拷入 ustream 读缓冲区；之后的解析、预算、超时与 uloop 后端完全相同
+ * - 发送：ustream 写缓冲中的数据合成一个 sendmsg 提交，完成后再从写缓冲移除
+ * - 一轮事件循环中排队的请求由一次 io_uring_enter 提交；ring fd 注册在 uloop 中，
+ *   有完成事件时可读，定时器等仍由 uloop 处理
+ * - 不依赖 liburing；内核不支持（< 5.19 或被禁用）时 http_uring_init 失败，调用方回退到 ustream_fd */
+
+#define HTTP_URING_ENTRIES      1024    /* SQ 大小（CQ 为两倍） */
+#define HTTP_URING_BUFS         512     /* 接收缓冲区个数（2 的幂） */
+#define HTTP_URING_BUF_SIZE     16384
+
+struct http_uring_stats {
+    uint64_t enters;            /* io_uring_enter 次数 */
+    uint64_t sqes;              /* 提交的请求数 */
+    uint64_t cqes;              /* 收取的完成事件数 */
+    uint64_t nobufs;            /* recv 时接收缓冲区耗尽 */
+};
+
+/* 创建 ring 并注册接收缓冲区（每个进程一次，fork 之后调用） */
+int http_uring_init(void);
+void http_uring_cleanup(void);
+
+/* 多发 accept：每个新连接（非阻塞、close-on-exec）调用一次 cb，出错时参数为 -errno；
+ * 内核不支持多发 accept 时 cb 收到 -EINVAL，之后不再发起，调用方应改用其他方式 accept */
+int http_uring_accept_start(int listen_fd, void (*cb)(int fd));
+void http_uring_accept_stop(void);
+
+/* 代替 ustream_fd_init：sf 的收发改由 io_uring 完成（sf->fd 不注册到 uloop） */
+int http_uring_stream_init(struct ustream_fd *sf, int fd);
+
+/* 等待 socket 可写（一次性 POLLOUT），就绪时调用 sf->fd.cb(&sf->fd, ULOOP_WRITE) */
+void http_uring_poll_out(struct ustream_fd *sf);
+
+void http_uring_get_stats(struct http_uring_stats *stats);
+
+#endif // HTTP_URING_H
@@ -0,0 +1,354 @@
+#include "http_urldecode.h"
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define URL_SCAN_X86 1
+#endif
+
+/* 每个向量块中特殊字符超过该数量时改走标量路径 */
+#define DENSE_SPECIALS_16   3
+#define DENSE_SPECIALS_32   5
+
+const signed char http_url_hex[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+static const unsigned char url_special[256] = {
+    ['&'] = 1, ['='] = 1, ['%'] = 1, ['+'] = 1,
+};
+
+typedef const char *(*url_scan_fn)(const char *p, const char *end);
+typedef long (*url_decode_fn)(char *dst, const char *src, size_t len, int flags);
+
+static const char *scan_scalar(const char *p, const char *end)
+{
+    while (p < end) {
+        if (url_special[(unsigned char)*p])
+            return p;
+        p++;
+    }
+    return end;
+}
+
+/* 处理 *pp 处的 '%' 或 '+'，推进输入/输出位置；严格模式下非法转义返回 -1 */
+static inline int decode_special(char **po, const char **pp, const char *end, int flags)
+{
+    const char *p = *pp;
+    char *o = *po;
+
+    if (*p == '%') {
+        int hi, lo;
+        if (end - p >= 3 &&
+            (hi = http_url_hex[(unsigned char)p[1]]) >= 0 &&
+            (lo = http_url_hex[(unsigned char)p[2]]) >= 0) {
+            *o++ = (char)((hi << 4) | lo);
+            p += 3;
+        } else {
+            if (flags & HTTP_URLDEC_STRICT)
+                return -1;
+            *o++ = '%';
+            p++;
+        }
+    } else if (*p == '+' && (flags & HTTP_URLDEC_PLUS)) {
+        *o++ = ' ';
+        p++;
+    } else {
+        *o++ = *p++;
+    }
+
+    *po = o;
+    *pp = p;
+    return 0;
+}
+
+static long decode_scalar_tail(char *dst, char *o, const char *p, const char *end, int flags)
+{
+    size_t n = end - p, i = 0, j = 0;
+    int plus = flags & HTTP_URLDEC_PLUS;
+
+    while (i < n) {
+        char c = p[i];
+        if (c == '%') {
+            int hi, lo;
+            if (n - i >= 3 &&
+                (hi = http_url_hex[(unsigned char)p[i + 1]]) >= 0 &&
+                (lo = http_url_hex[(unsigned char)p[i + 2]]) >= 0) {
+                o[j++] = (char)((hi << 4) | lo);
+                i += 3;
+                continue;
+            }
+            if (flags & HTTP_URLDEC_STRICT)
+                return -1;
+        } else if (c == '+' && plus) {
+            c = ' ';
+        }
+        o[j++] = c;
+        i++;
+    }
+    return (o - dst) + j;
+}
+
+static long decode_scalar(char *dst, const char *src, size_t len, int flags)
+{
+    return decode_scalar_tail(dst, dst, src, src + len, flags);
+}
+
+/* 处理一个向量块中的全部特殊字符：mask 为相对 base 的特殊字符位图
+ * 转义可能越过块尾，越过的位（已被消费）直接跳过 */
+static inline int decode_block(char **po, const char **pp, const char *base,
+                               unsigned int mask, const char *end, int flags)
+{
+    const char *p = *pp;
+    char *o = *po;
+
+    while (mask) {
+        const char *pos = base + __builtin_ctz(mask);
+        mask &= mask - 1;
+        if (pos < p)
+            continue;
+        while (p < pos)
+            *o++ = *p++;
+        if (decode_special(&o, &p, end, flags) < 0)
+            return -1;
+    }
+
+    *po = o;
+    *pp = p;
+    return 0;
+}
+
+#ifdef URL_SCAN_X86
+__attribute__((target("sse2")))
+static const char *scan_sse2(const char *p, const char *end)
+{
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i eq = _mm_set1_epi8('=');
+    const __m128i pct = _mm_set1_epi8('%');
+    const __m128i plus = _mm_set1_epi8('+');
+
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, amp), _mm_cmpeq_epi8(v, eq)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, pct), _mm_cmpeq_epi8(v, plus)));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(m);
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 16;
+    }
+
+    return scan_scalar(p, end);
+}
+
+/* 每次取 16 字节：无特殊字符时整块写出，否则拷贝干净前缀后处理一个特殊字符
+ * 原地解码（dst == src）时只能写已消费的字节，不能整块写出 */
+__attribute__((target("sse2")))
+static long decode_sse2_tail(char *dst, char *o, const char *p, const char *end,
+                             int flags, int in_place)
+{
+    const __m128i pct = _mm_set1_epi8('%');
+    const __m128i plus = _mm_set1_epi8((flags & HTTP_URLDEC_PLUS) ? '+' : '%');
+
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, pct), _mm_cmpeq_epi8(v, plus)));
+
+        if (!mask) {
+            if (o != p) {
+                if (!in_place) {
+                    _mm_storeu_si128((__m128i *)o, v);
+                } else {
+                    for (int i = 0; i < 16; i++) o[i] = p[i];
+                }
+            }
+            o += 16;
+            p += 16;
+            continue;
+        }
+
+        /* 转义密集（如百分号编码的中文）时向量化没有收益，剩余部分走标量 */
+        if (__builtin_popcount(mask) > DENSE_SPECIALS_16)
+            break;
+
+        if (decode_block(&o, &p, p, mask, end, flags) < 0)
+            return -1;
+    }
+
+    return decode_scalar_tail(dst, o, p, end, flags);
+}
+
+__attribute__((target("sse2")))
+static long decode_sse2(char *dst, const char *src, size_t len, int flags)
+{
+    return decode_sse2_tail(dst, dst, src, src + len, flags, dst == src);
+}
+
+__attribute__((target("avx2")))
+static const char *scan_avx2(const char *p, const char *end)
+{
+    const __m256i amp = _mm256_set1_epi8('&');
+    const __m256i eq = _mm256_set1_epi8('=');
+    const __m256i pct = _mm256_set1_epi8('%');
+    const __m256i plus = _mm256_set1_epi8('+');
+
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        __m256i m = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, amp), _mm256_cmpeq_epi8(v, eq)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, pct), _mm256_cmpeq_epi8(v, plus)));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(m);
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 32;
+    }
+
+    return scan_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static long decode_avx2(char *dst, const char *src, size_t len, int flags)
+{
+    const __m256i pct = _mm256_set1_epi8('%');
+    const __m256i plus = _mm256_set1_epi8((flags & HTTP_URLDEC_PLUS) ? '+' : '%');
+    const char *p = src, *end = src + len;
+    char *o = dst;
+    int in_place = (dst == src);
+
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, pct), _mm256_cmpeq_epi8(v, plus)));
+
+        if (!mask) {
+            if (o != p) {
+                if (!in_place) {
+                    _mm256_storeu_si256((__m256i *)o, v);
+                } else {
+                    for (int i = 0; i < 32; i++) o[i] = p[i];
+                }
+            }
+            o += 32;
+            p += 32;
+            continue;
+        }
+
+        if (__builtin_popcount(mask) > DENSE_SPECIALS_32)
+            break;
+
+        if (decode_block(&o, &p, p, mask, end, flags) < 0)
+            return -1;
+    }
+
+    return decode_scalar_tail(dst, o, p, end, flags);
+}
+#endif
+
+static const char *scan_resolve(const char *p, const char *end);
+static long decode_resolve(char *dst, const char *src, size_t len, int flags);
+
+static url_scan_fn scan_impl = scan_resolve;
+static url_decode_fn decode_impl = decode_resolve;
+static const char *scan_name = "scalar";
+
+static void scan_set(const char *name)
+{
+#ifdef URL_SCAN_X86
+    if (strcmp(name, "avx2") == 0) {
+        scan_impl = scan_avx2;
+        decode_impl = decode_avx2;
+        scan_name = "avx2";
+        return;
+    }
+    if (strcmp(name, "sse2") == 0) {
+        scan_impl = scan_sse2;
+        decode_impl = decode_sse2;
+        scan_name = "sse2";
+        return;
+    }
+#endif
+    scan_impl = scan_scalar;
+    decode_impl = decode_scalar;
+    scan_name = "scalar";
+}
+
+static void scan_auto_select(void)
+{
+#ifdef URL_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        scan_set("avx2");
+        return;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        scan_set("sse2");
+        return;
+    }
+#endif
+    scan_set("scalar");
+}
+
+/* 首次调用时探测 CPU，之后直接走选中的实现 */
+static const char *scan_resolve(const char *p, const char *end)
+{
+    scan_auto_select();
+    return scan_impl(p, end);
+}
+
+static long decode_resolve(char *dst, const char *src, size_t len, int flags)
+{
+    scan_auto_select();
+    return decode_impl(dst, src, len, flags);
+}
+
+const char *http_url_scan(const char *p, const char *end)
+{
+    return scan_impl(p, end);
+}
+
+long http_url_decode(char *dst, const char *src, size_t len, int flags)
+{
+    return decode_impl(dst, src, len, flags);
+}
+
+const char *http_url_scan_impl(void)
+{
+    if (scan_impl == scan_resolve)
+        scan_auto_select();
+    return scan_name;
+}
+
+int http_url_scan_select(const char *name)
+{
+    if (strcmp(name, "scalar") == 0) {
+        scan_set(name);
+        return 0;
+    }
+
+#ifdef URL_SCAN_X86
+    __builtin_cpu_init();
+    if ((strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) ||
+        (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2"))) {
+        scan_set(name);
+        return 0;
+    }
+#endif
+
+    return -1;
+}
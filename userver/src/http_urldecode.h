@@ -0,0 +1,28 @@
+#ifndef HTTP_URLDECODE_H
+#define HTTP_URLDECODE_H
+
+#include <stddef.h>
+
+/* 解码选项 */
+#define HTTP_URLDEC_STRICT  0x1     /* 非法转义（"%G1"、结尾 "%4"）返回错误，而不是原样保留 */
+#define HTTP_URLDEC_PLUS    0x2     /* '+' 解码为空格（application/x-www-form-urlencoded） */
+
+/* 十六进制字符值表，非十六进制字符为 -1 */
+extern const signed char http_url_hex[256];
+
+/* 查找 [p, end) 中第一个 '&' '=' '%' '+'，没有则返回 end
+ * 按 CPU 能力在运行时选择 AVX2（32 字节）/ SSE2（16 字节）/ 标量实现 */
+const char *http_url_scan(const char *p, const char *end);
+
+/* URL 解码 src[0, len) 到 dst，dst 可以与 src 相同（原地解码）
+ * 干净片段整段拷贝，只在特殊字符处逐字节处理
+ * 返回解码后的长度；HTTP_URLDEC_STRICT 下遇到非法转义返回 -1 */
+long http_url_decode(char *dst, const char *src, size_t len, int flags);
+
+/* 当前扫描实现（"avx2" / "sse2" / "scalar"） */
+const char *http_url_scan_impl(void);
+
+/* 强制使用指定实现（基准测试用），CPU 不支持时返回 -1 */
+int http_url_scan_select(const char *name);
+
+#endif // HTTP_URLDECODE_H
@@ -0,0 +1,262 @@
+#include "http_worker.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define MAX_WORKERS         256
+#define SHUTDOWN_GRACE_SEC  10     /* 优雅退出等待时间，超时后 SIGKILL */
+#define RESPAWN_MIN_UPTIME  1      /* 存活不足 1 秒即退出视为崩溃 */
+#define RESPAWN_BACKOFF_MAX 8      /* 连续崩溃时的最大重启间隔（秒） */
+#define RESPAWN_INIT_MAX    5      /* 连续初始化失败这么多次后放弃，监督进程以非 0 退出 */
+
+struct worker_slot {
+    pid_t pid;
+    time_t started;
+    unsigned int backoff;
+    int init_failures;          /* 连续以 HTTP_WORKER_INIT_FAILED 退出的次数 */
+};
+
+static struct worker_slot workers[MAX_WORKERS];
+static int worker_count;
+static int worker_index = -1;
+static volatile sig_atomic_t stopping;
+static volatile sig_atomic_t stop_signal;
+static volatile sig_atomic_t alarmed;
+static sigset_t orig_mask;      /* 监督进程阻塞信号之前的掩码，sigsuspend 与子进程使用 */
+
+int http_worker_id(void)
+{
+    return worker_index;
+}
+
+static void supervisor_signal(int sig)
+{
+    stopping = 1;
+    stop_signal = sig;
+}
+
+static void supervisor_alarm(int sig)
+{
+    (void)sig;
+    alarmed = 1;
+}
+
+/* SIGCHLD：只用于唤醒 sigsuspend（默认处理是忽略，不会打断等待） */
+static void supervisor_child(int sig)
+{
+    (void)sig;
+}
+
+static void set_signal(int sig, void (*handler)(int))
+{
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(sig, &sa, NULL);
+}
+
+/* 等待下一个信号：信号在其余时间保持阻塞，检查 stopping 与开始等待之间不会丢失信号 */
+static void wait_signal(void)
+{
+    sigsuspend(&orig_mask);
+}
+
+static pid_t spawn_worker(int index, http_worker_main_t worker_main, void *arg)
+{
+    pid_t pid = fork();
+
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+
+    if (pid == 0) {
+        /* 子进程：恢复默认信号处理，由 worker 自行安装 */
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGALRM, SIG_DFL);
+        signal(SIGCHLD, SIG_DFL);
+        sigprocmask(SIG_SETMASK, &orig_mask, NULL);
+        worker_index = index;
+        int ret = worker_main(arg);
+        _exit(ret == 0 || ret == HTTP_WORKER_INIT_FAILED ? ret : 1);
+    }
+
+    workers[index].pid = pid;
+    workers[index].started = time(NULL);
+    return pid;
+}
+
+static int find_worker(pid_t pid)
+{
+    for (int i = 0; i < worker_count; i++) {
+        if (workers[i].pid == pid)
+            return i;
+    }
+    return -1;
+}
+
+static int alive_workers(void)
+{
+    int n = 0;
+
+    for (int i = 0; i < worker_count; i++) {
+        if (workers[i].pid > 0)
+            n++;
+    }
+    return n;
+}
+
+static void signal_workers(int sig)
+{
+    for (int i = 0; i < worker_count; i++) {
+        if (workers[i].pid > 0)
+            kill(workers[i].pid, sig);
+    }
+}
+
+/* 重启退出的 worker，连续崩溃时指数退避；初始化连续失败（配置、端口等确定性错误）
+ * 重启也无济于事，返回 -1 */
+static int respawn_worker(int index, int status, http_worker_main_t worker_main, void *arg)
+{
+    struct worker_slot *w = &workers[index];
+    time_t uptime = time(NULL) - w->started;
+
+    if (WIFSIGNALED(status)) {
+        fprintf(stderr, "worker %d (pid %d) killed by signal %d\n",
+                index, (int)w->pid, WTERMSIG(status));
+    } else {
+        fprintf(stderr, "worker %d (pid %d) exited with status %d\n",
+                index, (int)w->pid, WEXITSTATUS(status));
+    }
+    w->pid = 0;
+
+    if (WIFEXITED(status) && WEXITSTATUS(status) == HTTP_WORKER_INIT_FAILED) {
+        if (++w->init_failures >= RESPAWN_INIT_MAX) {
+            fprintf(stderr, "worker %d failed to initialize %d times, giving up\n",
+                    index, w->init_failures);
+            return -1;
+        }
+    } else {
+        w->init_failures = 0;
+    }
+
+    if (uptime < RESPAWN_MIN_UPTIME) {
+        w->backoff = w->backoff ? w->backoff * 2 : 1;
+        if (w->backoff > RESPAWN_BACKOFF_MAX)
+            w->backoff = RESPAWN_BACKOFF_MAX;
+        alarmed = 0;
+        alarm(w->backoff);
+        while (!alarmed && !stopping)
+            wait_signal();
+        alarm(0);
+        if (stopping)
+            return 0;
+    } else {
+        w->backoff = 0;
+    }
+
+    spawn_worker(index, worker_main, arg);
+    return 0;
+}
+
+int http_worker_run(int count, http_worker_main_t worker_main, void *arg)
+{
+    sigset_t mask;
+    int status;
+    int ret = 0;
+    pid_t pid;
+
+    if (count < 1 || count > MAX_WORKERS) {
+        fprintf(stderr, "Invalid worker count: %d (1-%d)\n", count, MAX_WORKERS);
+        return 1;
+    }
+    worker_count = count;
+
+    set_signal(SIGTERM, supervisor_signal);
+    set_signal(SIGINT, supervisor_signal);
+    set_signal(SIGALRM, supervisor_alarm);
+    set_signal(SIGCHLD, supervisor_child);
+
+    /* 信号只在 wait_signal() 中递送：先 WNOHANG 回收，没有可回收的再等待 */
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGALRM);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &orig_mask);
+
+    for (int i = 0; i < count; i++) {
+        if (spawn_worker(i, worker_main, arg) < 0) {
+            stopping = 1;
+            stop_signal = SIGTERM;
+            ret = 1;
+            break;
+        }
+    }
+
+    /* 监督循环：回收并重启 worker */
+    while (!stopping) {
+        pid = waitpid(-1, &status, WNOHANG);
+        if (pid == 0) {
+            wait_signal();
+            continue;
+        }
+        if (pid < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        int index = find_worker(pid);
+        if (index >= 0 && !stopping) {
+            if (respawn_worker(index, status, worker_main, arg) < 0) {
+                stopping = 1;
+                stop_signal = SIGTERM;
+                ret = 1;
+            }
+        } else if (index >= 0) {
+            workers[index].pid = 0;
+        }
+    }
+
+    /* 转发退出信号，等待 worker 处理完在途连接 */
+    signal_workers(stop_signal ? stop_signal : SIGTERM);
+    alarmed = 0;
+    alarm(SHUTDOWN_GRACE_SEC);
+
+    while (alive_workers() > 0) {
+        pid = waitpid(-1, &status, WNOHANG);
+        if (pid == 0) {
+            if (alarmed) {
+                /* 超时：强制结束剩余 worker */
+                alarmed = 0;
+                signal_workers(SIGKILL);
+                continue;
+            }
+            wait_signal();
+            continue;
+        }
+        if (pid < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        int index = find_worker(pid);
+        if (index >= 0)
+            workers[index].pid = 0;
+    }
+
+    alarm(0);
+    sigprocmask(SIG_SETMASK, &orig_mask, NULL);
+    return ret;
+}
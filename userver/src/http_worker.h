@@ -0,0 +1,19 @@
+#ifndef HTTP_WORKER_H
+#define HTTP_WORKER_H
+
+/* worker 入口：在子进程中运行，拥有独立的 uloop 和监听 socket；
+ * 初始化失败时返回 HTTP_WORKER_INIT_FAILED，其余非 0 返回值按崩溃处理 */
+typedef int (*http_worker_main_t)(void *arg);
+
+#define HTTP_WORKER_INIT_FAILED 2
+
+/* 启动 count 个 worker 并进入监督循环：
+ * - worker 异常退出时自动重启（频繁崩溃时退避）；连续初始化失败时放弃，返回 1
+ * - 收到 SIGTERM/SIGINT 时转发给所有 worker 并等待其优雅退出
+ * 返回值：监督进程的退出码 */
+int http_worker_run(int count, http_worker_main_t worker_main, void *arg);
+
+/* 当前进程的 worker 编号（0..count-1），单进程模式或监督进程返回 -1 */
+int http_worker_id(void);
+
+#endif // HTTP_WORKER_H
@@ -1,41 +1,286 @@
 #include "http.h"
 #include "http_json.h"
 #include "http_form.h"
+#include "http_echo.h"
+#include "http_static.h"
+#include "http_router.h"
+#include "http_worker.h"
+#include "http_tls.h"
+#include "http_metrics.h"
+#include "http_log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <signal.h>
 #include <unistd.h>
 
+#define DRAIN_TIMEOUT_MS    5000    /* SIGTERM 后等待在途连接完成的最长时间 */
+#define DRAIN_POLL_MS       100
+#define MAX_ROUTES          32
+
 static struct http_server server;
+static http_body_handler_t *handler;
 static int running = 1;
+static int graceful = 0;
+static int drain_left_ms;
 
 static void signal_handler(int sig) {
-    (void)sig;
+    /* SIGTERM: 停止接受新连接，等待在途请求完成；SIGINT: 立即退出 */
+    graceful = (sig == SIGTERM);
     running = 0;
     uloop_end();
 }
 
+static void drain_timeout_cb(struct uloop_timeout *t) {
+    drain_left_ms -= DRAIN_POLL_MS;
+    if (http_conn_count() == 0 || drain_left_ms <= 0) {
+        uloop_end();
+        return;
+    }
+    uloop_timeout_set(t, DRAIN_POLL_MS);
+}
+
+static void print_server_info(void) {
+    const char *protocol = server.use_ssl ? "HTTPS" : "HTTP";
+    
+    if (server.type & USOCK_UNIX) {
+        printf("%s Server listening on Unix socket: %s\n", protocol, server.host);
+    } else if (server.host) {
+        printf("%s Server listening on %s:%s\n", protocol, server.host, server.service);
+    } else {
+        printf("%s Server listening on port %s (all interfaces)\n", protocol, server.service);
+    }
+    
+    if (server.use_ssl) {
+        printf("SSL certificate: %s\n", server.ssl_config.cert_file);
+        printf("SSL private key: %s\n", server.ssl_config.key_file);
+        if (server.ssl_config.ca_file) {
+            printf("SSL CA file: %s\n", server.ssl_config.ca_file);
+        }
+    }
+    fflush(stdout);
+}
+
+/* 运行服务器事件循环（单进程模式或 worker 子进程） */
+static int run_server(void *arg) {
+    (void)arg;
+    
+    uloop_init();
+    
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    
+    if (http_init(&server, handler) < 0) {
+        fprintf(stderr, "Failed to initialize %s server\n", server.use_ssl ? "HTTPS" : "HTTP");
+        uloop_done();
+        return HTTP_WORKER_INIT_FAILED;
+    }
+    
+    /* 多进程模式下只由第一个 worker 打印 */
+    if (http_worker_id() <= 0) {
+        print_server_info();
+    }
+    
+    uloop_run();
+    
+    if (graceful && http_conn_count() > 0) {
+        struct uloop_timeout drain = { .cb = drain_timeout_cb };
+        
+        http_stop_listen(&server);
+        drain_left_ms = DRAIN_TIMEOUT_MS;
+        uloop_timeout_set(&drain, DRAIN_POLL_MS);
+        uloop_run();
+        uloop_timeout_cancel(&drain);
+    }
+    
+    http_cleanup(&server);
+    uloop_done();
+    return 0;
+}
+
+/* 可选的处理器模式（-m 与 -r 共用） */
+static const struct {
+    const char *name;
+    http_body_handler_t *(*get)(void);
+    const char *desc;
+} modes[] = {
+    { "json-stream", http_json_handler_stream, "JSON stream mode (zero-copy)" },
+    { "json-buffer", http_json_handler_buffer, "JSON buffer mode (traditional)" },
+    { "json-lazy", http_json_handler_lazy, "JSON lazy mode (tape, no DOM)" },
+    { "form", http_form_handler_urlencoded, "Form URL-encoded mode" },
+    { "form-strict", http_form_handler_urlencoded_strict, "Form URL-encoded mode (strict)" },
+    { "echo-stream", http_echo_handler_stream, "Streaming echo mode (chunked response)" },
+    { "metrics", http_metrics_handler, "Prometheus metrics" },
+};
+
+/* 按模式名取处理器；"static:DIR" 使用独立根目录（作为路由上下文返回） */
+static http_body_handler_t *mode_handler(const char *mode, const char *doc_root,
+                                         void **ctx, const char **desc)
+{
+    *ctx = NULL;
+    *desc = NULL;
+    
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (strcmp(mode, modes[i].name) == 0) {
+            http_body_handler_t *h = modes[i].get();
+            *desc = modes[i].desc;
+            http_metrics_register_mode(h, modes[i].name);
+            return h;
+        }
+    }
+    
+    if (strncmp(mode, "static:", 7) == 0) {
+        *ctx = http_static_root_new(mode + 7);
+        if (!*ctx) return NULL;
+        http_metrics_register_mode(http_static_handler(NULL), "static");
+        return http_static_handler(NULL);
+    }
+    if (strcmp(mode, "static") == 0) {
+        http_body_handler_t *h;
+        
+        if (!doc_root) {
+            fprintf(stderr, "Error: static mode requires -d DIR\n");
+            return NULL;
+        }
+        h = http_static_handler(doc_root);
+        http_metrics_register_mode(h, "static");
+        return h;
+    }
+    
+    fprintf(stderr, "Unknown mode: %s\n", mode);
+    return NULL;
+}
+
+/* 路由规则 "[METHODS:]PATTERN=MODE"，如 "POST:/api/json=json-stream" */
+static int add_route(http_router_t *router, const char *spec, const char *doc_root)
+{
+    const char *path = strchr(spec, '/');
+    const char *eq = path ? strchr(path, '=') : NULL;
+    uint64_t methods = HTTP_ROUTE_ANY;
+    const char *desc;
+    void *ctx;
+    
+    if (!path || !eq || (path > spec && path[-1] != ':')) {
+        fprintf(stderr, "Invalid route: %s\n", spec);
+        return -1;
+    }
+    
+    if (path > spec) {
+        char list[128];
+        size_t n = path - spec - 1;
+        
+        if (n >= sizeof(list)) n = sizeof(list) - 1;
+        memcpy(list, spec, n);
+        list[n] = '\0';
+        if (http_router_parse_methods(list, &methods) < 0) {
+            fprintf(stderr, "Invalid route methods: %s\n", spec);
+            return -1;
+        }
+    }
+    
+    http_body_handler_t *h = mode_handler(eq + 1, doc_root, &ctx, &desc);
+    if (!h) return -1;
+    
+    char *pattern = strndup(path, eq - path);
+    int ret = pattern ? http_router_add(router, methods, pattern, h, ctx) : -1;
+    if (ret < 0) {
+        fprintf(stderr, "Invalid route: %s\n", spec);
+    }
+    free(pattern);
+    return ret;
+}
+
+/* 解析带 K/M/G 后缀的字节数，非法返回 0 */
+static size_t parse_size(const char *str)
+{
+    char *end;
+    unsigned long long n = strtoull(str, &end, 10);
+    
+    switch (*end) {
+        case 'k': case 'K': n <<= 10; end++; break;
+        case 'm': case 'M': n <<= 20; end++; break;
+        case 'g': case 'G': n <<= 30; end++; break;
+    }
+    return (end == str || *end) ? 0 : (size_t)n;
+}
+
+/* 解析 "HEADER,BODY,IDLE,WRITE" 超时（秒），空项保持默认值 */
+static int parse_timeouts(const char *spec)
+{
+    unsigned int *fields[] = {
+        &server.header_timeout, &server.body_timeout,
+        &server.idle_timeout, &server.write_timeout,
+    };
+    const char *p = spec;
+    
+    for (int i = 0; i < 4; i++) {
+        char *end;
+        
+        if (*p != ',' && *p != '\0') {
+            unsigned long sec = strtoul(p, &end, 10);
+            if (end == p || sec == 0 || sec > 86400) {
+                return -1;
+            }
+            *fields[i] = sec * 1000;
+            p = end;
+        }
+        if (*p == '\0') {
+            return 0;
+        }
+        if (*p++ != ',') {
+            return -1;
+        }
+    }
+    return *p ? -1 : 0;
+}
+
 static void print_usage(const char *prog) {
     fprintf(stderr, "Usage: %s [OPTIONS]\n", prog);
     fprintf(stderr, "Options:\n");
     fprintf(stderr, "  -p PORT         Listen on TCP port (default: 8080)\n");
     fprintf(stderr, "  -h HOST         Bind to specific host (default: all interfaces)\n");
     fprintf(stderr, "  -s SOCKET       Listen on Unix socket path\n");
+    fprintf(stderr, "  -w N            Run N worker processes (one uloop per worker)\n");
     fprintf(stderr, "  -m MODE         Body handler mode:\n");
     fprintf(stderr, "                    json-stream  - JSON 流式解析（零拷贝，默认）\n");
     fprintf(stderr, "                    json-buffer  - JSON 缓冲解析（传统）\n");
+    fprintf(stderr, "                    json-lazy    - JSON tape 解析（不构建对象树，原文回显）\n");
     fprintf(stderr, "                    form         - Form URL 编码解析\n");
+    fprintf(stderr, "                    form-strict  - Form URL 编码解析（非法转义返回 400）\n");
+    fprintf(stderr, "                    echo-stream  - 流式回显（chunked 响应）\n");
+    fprintf(stderr, "                    metrics      - Prometheus 指标（配合 -r 'GET:/metrics=metrics'）\n");
+    fprintf(stderr, "                    static       - 静态文件（需 -d）\n");
+    fprintf(stderr, "  -d DIR          Document root for static mode\n");
+    fprintf(stderr, "  -r ROUTE        Add route [METHODS:]PATTERN=MODE (repeatable)\n");
+    fprintf(stderr, "                    PATTERN 以 '*' 结尾为前缀匹配；MODE 可为 static:DIR\n");
+    fprintf(stderr, "  -b SIZE         Receive buffer budget per worker, K/M/G suffix (default: 32M)\n");
+    fprintf(stderr, "  -n N            Max concurrent connections per worker (default: unlimited)\n");
+    fprintf(stderr, "  -q N            Listen backlog (default: SOMAXCONN)\n");
+    fprintf(stderr, "  -t H,B,I,W      Header, body, idle and write timeouts in seconds\n");
+    fprintf(stderr, "                    (default: 10,30,60,30; empty field keeps default)\n");
+    fprintf(stderr, "  -l FILE         Access log (JSON lines, '-' for stdout), buffered and flushed in batches\n");
+    fprintf(stderr, "  -z LEVEL        Compress text responses with gzip/deflate, level 1-9 (default: off)\n");
+    fprintf(stderr, "  -E BACKEND      Event backend for HTTP: uloop (epoll, default) or io_uring\n");
+    fprintf(stderr, "                    io_uring 不可用时回退 uloop；HTTPS 始终使用 uloop\n");
+    fprintf(stderr, "  -H              Disable HTTP/2 (h2 via ALPN, h2c prior knowledge; default: on)\n");
     fprintf(stderr, "\n  SSL/TLS 选项:\n");
     fprintf(stderr, "  -S              Enable HTTPS (SSL/TLS)\n");
     fprintf(stderr, "  -c CERT         SSL certificate file (PEM format)\n");
     fprintf(stderr, "  -k KEY          SSL private key file (PEM format)\n");
     fprintf(stderr, "  -C CA           CA certificate file for client verification\n");
+    fprintf(stderr, "  -K              Disable kernel TLS offload (default: on when supported)\n");
     fprintf(stderr, "\nExamples:\n");
     fprintf(stderr, "  HTTP:\n");
     fprintf(stderr, "    %s -p 8080                    # JSON 流式模式\n", prog);
     fprintf(stderr, "    %s -p 8080 -m json-buffer    # JSON 缓冲模式\n", prog);
+    fprintf(stderr, "    %s -p 8080 -m json-lazy      # JSON tape 模式\n", prog);
     fprintf(stderr, "    %s -p 8080 -m form           # Form 解析模式\n", prog);
+    fprintf(stderr, "    %s -p 8080 -w 4              # 4 个 worker 进程\n", prog);
+    fprintf(stderr, "    %s -p 8080 -m static -d /www # 静态文件\n", prog);
+    fprintf(stderr, "    %s -p 8080 -m static -d /www -z 6  # 静态文件 + gzip 压缩\n", prog);
+    fprintf(stderr, "    %s -p 8080 -w 4 -E io_uring  # io_uring 后端\n", prog);
+    fprintf(stderr, "    %s -p 8080 -r 'POST:/api/json=json-stream' -r 'GET,HEAD:/*=static:/www'\n", prog);
+    fprintf(stderr, "    %s -p 8080 -w 4 -r 'GET:/metrics=metrics' -m json-stream  # 指标 + 兜底路由\n", prog);
     fprintf(stderr, "\n  HTTPS:\n");
     fprintf(stderr, "    %s -S -p 8443 -c server.crt -k server.key\n", prog);
     fprintf(stderr, "    %s -S -p 8443 -c server.crt -k server.key -C ca.crt\n", prog);
@@ -53,6 +298,15 @@ int main(int argc, char *argv[]) {
     char *port = "8080";
     char *socket_path = NULL;
     char *mode = "json-stream";
+    char *doc_root = NULL;
+    int mode_set = 0;
+    char *routes[MAX_ROUTES];
+    int nroutes = 0;
+    int workers = 0;
+    size_t rx_budget = 0;
+    const char *access_log = NULL;
+    int io_uring = 0;
+    int no_h2 = 0;
     int opt;
     int type = USOCK_TCP | USOCK_SERVER | USOCK_NONBLOCK;
     
@@ -61,8 +315,9 @@ int main(int argc, char *argv[]) {
     char *cert_file = NULL;
     char *key_file = NULL;
     char *ca_file = NULL;
+    int no_ktls = 0;
     
-    while ((opt = getopt(argc, argv, "h:p:s:m:Sc:k:C:")) != -1) {
+    while ((opt = getopt(argc, argv, "h:p:s:m:w:d:r:b:n:q:t:z:l:E:Sc:k:C:KH")) != -1) {
         switch (opt) {
             case 'h':
                 host = optarg;
@@ -76,6 +331,72 @@ int main(int argc, char *argv[]) {
                 break;
             case 'm':
                 mode = optarg;
+                mode_set = 1;
+                break;
+            case 'r':
+                if (nroutes == MAX_ROUTES) {
+                    fprintf(stderr, "Too many routes (max %d)\n", MAX_ROUTES);
+                    return 1;
+                }
+                routes[nroutes++] = optarg;
+                break;
+            case 'd':
+                doc_root = optarg;
+                break;
+            case 'w':
+                workers = atoi(optarg);
+                if (workers < 1) {
+                    fprintf(stderr, "Invalid worker count: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'b':
+                rx_budget = parse_size(optarg);
+                if (rx_budget == 0) {
+                    fprintf(stderr, "Invalid buffer budget: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'n':
+                server.max_conns = atoi(optarg);
+                if (server.max_conns < 1) {
+                    fprintf(stderr, "Invalid connection limit: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'q':
+                server.backlog = atoi(optarg);
+                if (server.backlog < 1) {
+                    fprintf(stderr, "Invalid listen backlog: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 't':
+                if (parse_timeouts(optarg) < 0) {
+                    fprintf(stderr, "Invalid timeouts: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'z':
+                server.compress_level = atoi(optarg);
+                if (server.compress_level < 1 || server.compress_level > 9) {
+                    fprintf(stderr, "Invalid compression level: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'l':
+                access_log = optarg;
+                break;
+            case 'E':
+                if (strcmp(optarg, "io_uring") == 0) {
+                    io_uring = 1;
+                } else if (strcmp(optarg, "uloop") == 0) {
+                    io_uring = 0;
+                } else {
+                    fprintf(stderr, "Unknown event backend: %s\n", optarg);
+                    print_usage(argv[0]);
+                    return 1;
+                }
                 break;
             case 'S':
                 use_ssl = 1;
@@ -89,6 +410,12 @@ int main(int argc, char *argv[]) {
             case 'C':
                 ca_file = optarg;
                 break;
+            case 'K':
+                no_ktls = 1;
+                break;
+            case 'H':
+                no_h2 = 1;
+                break;
             default:
                 print_usage(argv[0]);
                 return 1;
@@ -110,66 +437,106 @@ int main(int argc, char *argv[]) {
     }
     
     /* 选择 body 处理器 */
-    http_body_handler_t *handler;
-    if (strcmp(mode, "json-stream") == 0) {
-        handler = http_json_handler_stream();
-        printf("Using JSON stream mode (zero-copy)\n");
-    } else if (strcmp(mode, "json-buffer") == 0) {
-        handler = http_json_handler_buffer();
-        printf("Using JSON buffer mode (traditional)\n");
-    } else if (strcmp(mode, "form") == 0) {
-        handler = http_form_handler_urlencoded();
-        printf("Using Form URL-encoded mode\n");
+    if (nroutes > 0) {
+        http_router_t *router = http_router_new();
+        void *ctx;
+        const char *desc;
+        
+        if (!router) return 1;
+        for (int i = 0; i < nroutes; i++) {
+            if (add_route(router, routes[i], doc_root) < 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        
+        /* 显式指定的 -m 作为兜底路由 */
+        if (mode_set) {
+            http_body_handler_t *h = mode_handler(mode, doc_root, &ctx, &desc);
+            if (!h || http_router_add(router, HTTP_ROUTE_ANY, "/*", h, ctx) < 0) {
+                return 1;
+            }
+        }
+        
+        if (http_router_compile(router) < 0) {
+            fprintf(stderr, "Failed to compile routes\n");
+            return 1;
+        }
+        http_set_router(router);
+        printf("Using router with %d routes\n", nroutes + mode_set);
     } else {
-        fprintf(stderr, "Unknown mode: %s\n", mode);
-        print_usage(argv[0]);
-        return 1;
+        void *ctx;
+        const char *desc;
+        
+        /* 单处理器模式下 static:DIR 等同于 -m static -d DIR */
+        if (strncmp(mode, "static:", 7) == 0) {
+            doc_root = mode + 7;
+            mode = "static";
+        }
+        handler = mode_handler(mode, doc_root, &ctx, &desc);
+        if (!handler) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (desc) {
+            printf("Using %s\n", desc);
+        } else {
+            printf("Using static file mode: %s\n", doc_root);
+        }
     }
     
-    uloop_init();
-    
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
+    /* 访问日志在 fork 前打开，各 worker 以 O_APPEND 共享同一文件 */
+    if (access_log && http_log_open(access_log, 0) < 0) {
+        perror(access_log);
+        return 1;
+    }
     
     /* 配置服务器 */
+    server.listen_fd = -1;
     server.type = type;
     server.host = socket_path ? socket_path : host;
     server.service = socket_path ? NULL : port;
     server.use_ssl = use_ssl;
+    server.rx_budget = rx_budget;
+    server.io_uring = io_uring;
+    server.h2 = !no_h2;
     
     if (use_ssl) {
         server.ssl_config.cert_file = cert_file;
         server.ssl_config.key_file = key_file;
         server.ssl_config.ca_file = ca_file;
         server.ssl_config.verify_client = 0;
+        server.ktls = !no_ktls;
     }
     
-    if (http_init(&server, handler) < 0) {
-        fprintf(stderr, "Failed to initialize %s server\n", use_ssl ? "HTTPS" : "HTTP");
-        uloop_done();
-        return 1;
+    if (workers == 0) {
+        return run_server(NULL);
     }
     
-    /* 打印服务器信息 */
-    const char *protocol = use_ssl ? "HTTPS" : "HTTP";
+    /* 多进程模式：TCP 由每个 worker 独立 SO_REUSEPORT 监听；
+     * Unix socket 无法重复绑定，由监督进程创建后共享给所有 worker */
     if (socket_path) {
-        printf("%s Server listening on Unix socket: %s\n", protocol, socket_path);
-    } else if (host) {
-        printf("%s Server listening on %s:%s\n", protocol, host, port);
+        server.listen_fd = usock(type, socket_path, NULL);
+        if (server.listen_fd < 0) {
+            perror("usock");
+            return 1;
+        }
     } else {
-        printf("%s Server listening on port %s (all interfaces)\n", protocol, port);
+        server.reuseport = 1;
     }
     
-    if (use_ssl) {
-        printf("SSL certificate: %s\n", cert_file);
-        printf("SSL private key: %s\n", key_file);
-        if (ca_file) {
-            printf("SSL CA file: %s\n", ca_file);
-        }
+    /* TLS ticket 主密钥在 fork 前生成，所有 worker 可以互相解密对方签发的 ticket */
+    if (use_ssl && http_tls_init() < 0) {
+        return 1;
     }
     
-    uloop_run();
-    http_cleanup(&server);
-    uloop_done();
-    return 0;
+    /* 各 worker 的计数槽位在共享内存中，任一 worker 都能输出全部数据 */
+    if (http_metrics_init(workers) < 0) {
+        perror("http_metrics_init");
+    }
+    
+    printf("Starting %d worker processes\n", workers);
+    fflush(stdout);
+    
+    return http_worker_run(workers, run_server, NULL);
 }
@@ -2,9 +2,26 @@
 
 # HTTP JSON Server 测试脚本
 # 使用 curl 测试 userver 的功能
+#
+# 用法：test_curl.sh [PORT] [TESTS] [DOCROOT]
+#   TESTS  逗号分隔的测试组（默认 json），各组需要的服务器启动参数：
+#     json         -m json-stream / json-buffer / json-lazy（默认 -m json-stream）
+#     form         -m form
+#     form-strict  -m form-strict
+#     static       -m static -d DOCROOT（脚本在 DOCROOT 中创建并删除 test_curl* 测试文件）
+#     routes       -r 'POST,PUT:/api/*=json-stream' -r 'GET,POST:/api/form=form'（不带 -m）
+#     json-lazy    -m json-lazy
+#     echo-stream  -m echo-stream
+#     gzip         -z 6（默认的 -m json-stream）
+#     metrics      -r 'GET:/metrics=metrics' -m json-stream
+#     h2c          默认参数（未加 -H），需要支持 HTTP/2 的 curl
+# 有失败的检查时退出码为 1
 
 PORT=${1:-8080}
+TESTS=${2:-json}
+DOCROOT=${3:-}
 SERVER_URL="http://localhost:${PORT}"
+FAILED=0
 
 # 颜色输出
 GREEN='\033[0;32m'
@@ -28,23 +45,31 @@ check_server() {
     fi
 }
 
-# 测试函数
+# 是否运行某个测试组
+has_test() {
+    [[ ",${TESTS}," == *",$1,"* ]]
+}
+
+# 测试函数：test_case 名称 方法 URL 请求体 期望状态码 [额外的 curl 参数...]
+#   请求体的 Content-Type 由 CONTENT_TYPE 指定（默认 application/json）
+#   响应内容保存在 body 中，供 check_body 检查
 test_case() {
     local name="$1"
     local method="$2"
     local url="$3"
     local data="$4"
     local expected_status="$5"
+    shift 5
     
     echo -e "${BLUE}测试: ${name}${NC}"
     
     if [ -n "$data" ]; then
         response=$(curl -s -w "\n%{http_code}" -X "${method}" \
-            -H "Content-Type: application/json" \
+            -H "Content-Type: ${CONTENT_TYPE:-application/json}" \
             -d "${data}" \
-            "${url}")
+            "$@" "${url}")
     else
-        response=$(curl -s -w "\n%{http_code}" -X "${method}" "${url}")
+        response=$(curl -s -w "\n%{http_code}" -X "${method}" "$@" "${url}")
     fi
     
     http_code=$(echo "$response" | tail -n1)
@@ -54,6 +79,7 @@ test_case() {
         echo -e "${GREEN}✓ HTTP 状态码: ${http_code} (期望: ${expected_status})${NC}"
     else
         echo -e "${RED}✗ HTTP 状态码: ${http_code} (期望: ${expected_status})${NC}"
+        FAILED=$((FAILED + 1))
     fi
     
     echo -e "${YELLOW}响应内容:${NC}"
@@ -61,57 +87,623 @@ test_case() {
     echo ""
 }
 
+# 检查上一次 test_case 的响应内容包含指定字符串
+check_body() {
+    local expected="$1"
+    
+    if [[ "$body" == *"${expected}"* ]]; then
+        printf "${GREEN}✓ 响应内容包含: %s${NC}\n" "${expected}"
+    else
+        printf "${RED}✗ 响应内容不包含: %s${NC}\n" "${expected}"
+        FAILED=$((FAILED + 1))
+    fi
+    echo ""
+}
+
+# 检查响应头：test_header 名称 URL 头名 期望值 [额外的 curl 参数...]
+#   期望值为 grep -E 模式，为空表示该头不应出现；头的值保存在 header_value 中
+test_header() {
+    local name="$1"
+    local url="$2"
+    local header="$3"
+    local pattern="$4"
+    shift 4
+    
+    echo -e "${BLUE}测试: ${name}${NC}"
+    
+    header_value=$(curl -s -D - -o /dev/null "$@" "${url}" | tr -d '\r' | \
+        grep -i "^${header}:" | head -n1 | cut -d' ' -f2-)
+    
+    if [ -z "$pattern" ] && [ -z "$header_value" ]; then
+        echo -e "${GREEN}✓ ${header}: (无)${NC}"
+    elif [ -n "$pattern" ] && echo "$header_value" | grep -Eq "$pattern"; then
+        echo -e "${GREEN}✓ ${header}: ${header_value}${NC}"
+    else
+        echo -e "${RED}✗ ${header}: ${header_value:-(无)} (期望: ${pattern:-(无)})${NC}"
+        FAILED=$((FAILED + 1))
+    fi
+    echo ""
+}
+
+# JSON 请求
+test_json() {
+    # 测试 1: GET 请求（无请求体）
+    test_case "GET 请求 - 无请求体" \
+        "GET" \
+        "${SERVER_URL}" \
+        "" \
+        "200"
+
+    # 测试 2: POST 请求 - 简单 JSON
+    test_case "POST 请求 - 简单 JSON" \
+        "POST" \
+        "${SERVER_URL}" \
+        '{"message": "Hello, Server!"}' \
+        "200"
+
+    # 测试 3: POST 请求 - 带 data 字段（应该回显）
+    test_case "POST 请求 - 带 data 字段（回显测试）" \
+        "POST" \
+        "${SERVER_URL}" \
+        '{"data": {"name": "test", "value": 123}}' \
+        "200"
+    check_body '"echo"'
+
+    # 测试 4: POST 请求 - 复杂 JSON
+    test_case "POST 请求 - 复杂 JSON" \
+        "POST" \
+        "${SERVER_URL}" \
+        '{"data": {"users": [{"id": 1, "name": "Alice"}, {"id": 2, "name": "Bob"}]}}' \
+        "200"
+
+    # 测试 5: 无效 JSON（应该返回 400）
+    test_case "POST 请求 - 无效 JSON" \
+        "POST" \
+        "${SERVER_URL}" \
+        '{"invalid": json}' \
+        "400"
+
+    # 测试 6: 空请求体
+    test_case "POST 请求 - 空请求体" \
+        "POST" \
+        "${SERVER_URL}" \
+        "" \
+        "200"
+
+    # 测试 7: 大 JSON 数据
+    test_case "POST 请求 - 大 JSON 数据" \
+        "POST" \
+        "${SERVER_URL}" \
+        "{\"data\": {\"array\": [$(seq -s ',' 1 100)]}}" \
+        "200"
+}
+
+# Form 请求：字段按首次出现的顺序输出，重名取最后一次的值，非法转义原样保留
+test_form() {
+    local tmp
+    
+    CONTENT_TYPE="application/x-www-form-urlencoded"
+    
+    test_case "Form - 解码 '+' 与 %XX" \
+        "POST" \
+        "${SERVER_URL}" \
+        'name=John+Doe&email=john%40example.com' \
+        "200"
+    check_body '"fields":{"name":"John Doe","email":"john@example.com"}'
+    
+    test_case "Form - 重名字段与空字段" \
+        "POST" \
+        "${SERVER_URL}" \
+        'k=1&&j=2&k=3&' \
+        "200"
+    check_body '"fields":{"k":"3","j":"2"}'
+    
+    test_case "Form - 编码后的分隔符" \
+        "POST" \
+        "${SERVER_URL}" \
+        '%3D=%26&x=a%3Db' \
+        "200"
+    check_body '"fields":{"=":"&","x":"a=b"}'
+    
+    test_case "Form - 非法转义原样保留" \
+        "POST" \
+        "${SERVER_URL}" \
+        'a=%4&b=%G1' \
+        "200"
+    check_body '"fields":{"a":"%4","b":"%G1"}'
+    
+    # 较大的 body 通常分多次到达，走拷贝模式
+    tmp=$(mktemp)
+    { printf 'big='; head -c 20000 /dev/zero | tr '\0' 'x'; printf '&last=%%41'; } > "$tmp"
+    test_case "Form - 20KB body" \
+        "POST" \
+        "${SERVER_URL}" \
+        "" \
+        "200" \
+        -H "Content-Type: ${CONTENT_TYPE}" --data-binary @"$tmp"
+    check_body '"last":"A"'
+    
+    # 超过 1MB 返回 400
+    head -c 1100000 /dev/zero | tr '\0' 'x' > "$tmp"
+    test_case "Form - 超过 1MB" \
+        "POST" \
+        "${SERVER_URL}" \
+        "" \
+        "400" \
+        -H "Content-Type: ${CONTENT_TYPE}" --data-binary @"$tmp"
+    rm -f "$tmp"
+    
+    unset CONTENT_TYPE
+}
+
+# 严格模式的 Form 请求：非法转义返回 400，合法的与宽松模式相同
+test_form_strict() {
+    CONTENT_TYPE="application/x-www-form-urlencoded"
+    
+    test_case "Form strict - 合法转义" \
+        "POST" \
+        "${SERVER_URL}" \
+        'name=John+Doe&email=john%40example.com&k=1&k=2' \
+        "200"
+    check_body '"fields":{"name":"John Doe","email":"john@example.com","k":"2"}'
+    
+    test_case "Form strict - 值末尾 '%'" \
+        "POST" \
+        "${SERVER_URL}" \
+        'a=1&b=%' \
+        "400"
+    
+    test_case "Form strict - 不完整转义 '%4'" \
+        "POST" \
+        "${SERVER_URL}" \
+        'a=%4&b=1' \
+        "400"
+    
+    test_case "Form strict - 非十六进制 '%G1'" \
+        "POST" \
+        "${SERVER_URL}" \
+        'a=%G1' \
+        "400"
+    
+    test_case "Form strict - 字段名中的非法转义" \
+        "POST" \
+        "${SERVER_URL}" \
+        '%zz=1' \
+        "400"
+    
+    unset CONTENT_TYPE
+}
+
+# 静态文件：Range、条件请求、目录与路径检查
+test_static() {
+    local url="${SERVER_URL}/test_curl.txt"
+    local etag last_modified
+    
+    if [ -z "$DOCROOT" ] || [ ! -d "$DOCROOT" ]; then
+        echo -e "${RED}错误: static 测试组需要 DOCROOT 参数（与服务器的 -d 相同）${NC}"
+        FAILED=$((FAILED + 1))
+        return
+    fi
+    
+    # 100 字节："0123456789" 重复 10 次
+    for _ in $(seq 10); do printf '0123456789'; done > "${DOCROOT}/test_curl.txt"
+    mkdir -p "${DOCROOT}/test_curl_dir"
+    echo '<html>test_curl</html>' > "${DOCROOT}/test_curl_dir/index.html"
+    ln -sf /etc/passwd "${DOCROOT}/test_curl_link"
+    
+    test_case "Static - 完整文件" "GET" "${url}" "" "200"
+    check_body "0123456789012345678901234567890123456789"
+    test_header "Static - Content-Length" "${url}" "Content-Length" "^100$"
+    test_header "Static - Accept-Ranges" "${url}" "Accept-Ranges" "^bytes$"
+    test_header "Static - Last-Modified" "${url}" "Last-Modified" "GMT$"
+    last_modified="$header_value"
+    test_header "Static - ETag" "${url}" "ETag" '^"[^"]+"$'
+    etag="$header_value"
+    
+    test_case "Static - HEAD 不返回 body" "HEAD" "${url}" "" "200" -I
+    check_body "Content-Length: 100"
+    
+    test_case "Static - POST 返回 405" "POST" "${url}" "" "405"
+    test_header "Static - 405 的 Allow" "${url}" "Allow" "^GET, HEAD$" -X POST
+    
+    # Range
+    test_case "Static - Range bytes=0-9" "GET" "${url}" "" "206" -H "Range: bytes=0-9"
+    check_body "0123456789"
+    test_header "Static - Content-Range 0-9" "${url}" "Content-Range" "^bytes 0-9/100$" \
+        -H "Range: bytes=0-9"
+    test_header "Static - Content-Range 90-" "${url}" "Content-Range" "^bytes 90-99/100$" \
+        -H "Range: bytes=90-"
+    test_header "Static - Content-Range -5" "${url}" "Content-Range" "^bytes 95-99/100$" \
+        -H "Range: bytes=-5"
+    test_header "Static - 结束位置超出文件" "${url}" "Content-Range" "^bytes 50-99/100$" \
+        -H "Range: bytes=50-1000"
+    test_case "Static - 起始位置超出文件返回 416" "GET" "${url}" "" "416" -H "Range: bytes=100-"
+    test_header "Static - 416 的 Content-Range" "${url}" "Content-Range" '^bytes \*/100$' \
+        -H "Range: bytes=100-"
+    test_case "Static - bytes=-0 返回 416" "GET" "${url}" "" "416" -H "Range: bytes=-0"
+    
+    # 不支持的语法忽略 Range，返回完整文件
+    test_case "Static - 多段 Range 返回完整文件" "GET" "${url}" "" "200" -H "Range: bytes=0-1,5-6"
+    test_case "Static - bytes=--5 返回完整文件" "GET" "${url}" "" "200" -H "Range: bytes=--5"
+    test_case "Static - bytes=0--5 返回完整文件" "GET" "${url}" "" "200" -H "Range: bytes=0--5"
+    test_case "Static - bytes=+0-9 返回完整文件" "GET" "${url}" "" "200" -H "Range: bytes=+0-9"
+    test_case "Static - 结束位置小于起始位置" "GET" "${url}" "" "200" -H "Range: bytes=9-0"
+    
+    # 条件请求
+    test_case "Static - If-None-Match 命中返回 304" "GET" "${url}" "" "304" \
+        -H "If-None-Match: ${etag}"
+    test_case "Static - If-None-Match 列表" "GET" "${url}" "" "304" \
+        -H "If-None-Match: \"other\", W/${etag}"
+    test_case "Static - If-None-Match 不匹配" "GET" "${url}" "" "200" \
+        -H "If-None-Match: \"other\""
+    test_case "Static - If-Modified-Since 返回 304" "GET" "${url}" "" "304" \
+        -H "If-Modified-Since: ${last_modified}"
+    test_case "Static - If-Range 匹配时按 Range 返回" "GET" "${url}" "" "206" \
+        -H "Range: bytes=0-9" -H "If-Range: ${etag}"
+    test_case "Static - If-Range 不匹配时返回完整文件" "GET" "${url}" "" "200" \
+        -H "Range: bytes=0-9" -H "If-Range: \"other\""
+    
+    # 目录与路径
+    test_case "Static - 目录不以 '/' 结尾时重定向" "GET" "${SERVER_URL}/test_curl_dir" "" "301"
+    test_header "Static - 重定向的 Location" "${SERVER_URL}/test_curl_dir" "Location" \
+        "^/test_curl_dir/$"
+    test_case "Static - 目录的 index.html" "GET" "${SERVER_URL}/test_curl_dir/" "" "200"
+    check_body "<html>test_curl</html>"
+    test_case "Static - 不存在的文件" "GET" "${SERVER_URL}/test_curl_missing" "" "404"
+    test_case "Static - '..' 返回 400" "GET" "${SERVER_URL}/test_curl_dir/../test_curl.txt" "" "400" \
+        --path-as-is
+    test_case "Static - 编码的 '..' 返回 400" "GET" "${SERVER_URL}/%2e%2e/test_curl.txt" "" "400" \
+        --path-as-is
+    test_case "Static - 指向根目录之外的符号链接返回 403" "GET" "${SERVER_URL}/test_curl_link" "" "403"
+    
+    rm -rf "${DOCROOT}/test_curl.txt" "${DOCROOT}/test_curl_dir" "${DOCROOT}/test_curl_link"
+}
+
+# JSON tape 模式：data 的原文原样回显，严格按 RFC 8259 校验
+test_json_lazy() {
+    local tmp
+    
+    test_case "JSON lazy - 原文回显（保留空白、数字与转义的写法）" \
+        "POST" \
+        "${SERVER_URL}" \
+        '{"data": {"b": 1.50, "a": [1e2, "x\u0041"]}}' \
+        "200"
+    check_body '"mode":"lazy"'
+    check_body '"echo":{"b": 1.50, "a": [1e2, "x\u0041"]}'
+    
+    test_case "JSON lazy - 重复 key 取最后一次" \
+        "POST" \
+        "${SERVER_URL}" \
+        '{"data": 1, "data": [2]}' \
+        "200"
+    check_body '"echo":[2]'
+    
+    test_case "JSON lazy - 没有 data 字段" "POST" "${SERVER_URL}" '{"other": 1}' "200"
+    check_body '"mode":"lazy"}'
+    
+    test_case "JSON lazy - 只有空白" "POST" "${SERVER_URL}" ' ' "200"
+    check_body "HTTP JSON Server (lazy)"
+    
+    # json-c 容忍、RFC 8259 不允许的写法
+    test_case "JSON lazy - 小数点后没有数字" "POST" "${SERVER_URL}" '{"data": 1.}' "400"
+    test_case "JSON lazy - 前导零" "POST" "${SERVER_URL}" '[01]' "400"
+    test_case "JSON lazy - 末尾逗号" "POST" "${SERVER_URL}" '[1,]' "400"
+    test_case "JSON lazy - 字符串内的控制字符" "POST" "${SERVER_URL}" $'["a\tb"]' "400"
+    test_case "JSON lazy - 两个文档" "POST" "${SERVER_URL}" '{} {}' "400"
+    test_case "JSON lazy - 单引号" "POST" "${SERVER_URL}" "{'data': 1}" "400"
+    
+    # 嵌套上限 64 层
+    test_case "JSON lazy - 嵌套 64 层" "POST" "${SERVER_URL}" \
+        "$(printf '[%.0s' $(seq 64))$(printf ']%.0s' $(seq 64))" "200"
+    test_case "JSON lazy - 嵌套 65 层" "POST" "${SERVER_URL}" \
+        "$(printf '[%.0s' $(seq 65))$(printf ']%.0s' $(seq 65))" "400"
+    
+    # 较大的 body 通常分多次到达，tape 随分片增量构建
+    tmp=$(mktemp)
+    { printf '{"pad": ['; seq -s ',' 1 50000; printf '], "data": "end"}'; } > "$tmp"
+    test_case "JSON lazy - 分片到达的 body" \
+        "POST" \
+        "${SERVER_URL}" \
+        "" \
+        "200" \
+        -H "Content-Type: application/json" --data-binary @"$tmp"
+    check_body '"echo":"end"'
+    rm -f "$tmp"
+}
+
+# 流式回显：curl 上传 FILE，比较收到的响应；额外参数传给 curl
+check_echo_file() {
+    local name="$1"
+    local file="$2"
+    shift 2
+    local out
+    
+    echo -e "${BLUE}测试: ${name}${NC}"
+    
+    out=$(mktemp)
+    curl -s -X POST -H "Content-Type: application/octet-stream" \
+        --data-binary @"$file" -o "$out" "$@" "${SERVER_URL}"
+    
+    if cmp -s "$file" "$out"; then
+        echo -e "${GREEN}✓ 回显与请求 body 一致 ($(wc -c < "$file") 字节)${NC}"
+    else
+        echo -e "${RED}✗ 回显与请求 body 不一致 (发送 $(wc -c < "$file") 字节，收到 $(wc -c < "$out") 字节)${NC}"
+        FAILED=$((FAILED + 1))
+    fi
+    rm -f "$out"
+    echo ""
+}
+
+# 流式回显：请求 body 边收边以 chunked 响应写回
+test_echo_stream() {
+    local tmp
+    
+    CONTENT_TYPE="text/plain"
+    test_case "Echo stream - 小 body" "POST" "${SERVER_URL}" 'hello, stream' "200"
+    check_body "hello, stream"
+    unset CONTENT_TYPE
+    test_header "Echo stream - 分块编码" "${SERVER_URL}" "Transfer-Encoding" "^chunked$" \
+        -d 'x'
+    test_header "Echo stream - 沿用请求的 Content-Type" "${SERVER_URL}" "Content-Type" "^text/plain$" \
+        -H "Content-Type: text/plain" -d 'x'
+    test_header "Echo stream - 没有 Content-Type 时" "${SERVER_URL}" "Content-Type" \
+        "^application/octet-stream$" -X POST
+    test_header "Echo stream - HTTP/1.0 不使用分块编码" "${SERVER_URL}" "Transfer-Encoding" "" \
+        -0 -d 'x'
+    
+    test_case "Echo stream - 空 body" "POST" "${SERVER_URL}" "" "200"
+    
+    tmp=$(mktemp)
+    head -c 1048576 /dev/urandom > "$tmp"
+    check_echo_file "Echo stream - 1MB 二进制 body" "$tmp"
+    check_echo_file "Echo stream - HTTP/1.0 以关闭连接结束" "$tmp" -0
+    
+    # 客户端读得慢：写缓冲积压时暂停读取请求 body，恢复后回显仍完整
+    head -c 262144 /dev/urandom > "$tmp"
+    check_echo_file "Echo stream - 慢速读取的客户端" "$tmp" --limit-rate 100k
+    rm -f "$tmp"
+    
+    # 同一连接上的两个请求：前一个流式响应结束后再处理下一个，第二个请求不新建连接
+    echo -e "${BLUE}测试: Echo stream - 同一连接上的连续请求${NC}"
+    body=$(curl -s -H "Content-Type: text/plain" -d 'first;' "${SERVER_URL}" \
+        --next -H "Content-Type: text/plain" -d 'second' -w '%{num_connects}' "${SERVER_URL}")
+    check_body "first;second0"
+}
+
+# 响应压缩：按 Accept-Encoding 的 q 值选择 gzip / deflate，超过 1KB 的 JSON 响应才压缩
+test_gzip() {
+    local data="{\"data\": {\"array\": [$(seq -s ',' 1 1000)]}}"
+    local plain compressed
+    
+    test_header "Gzip - Accept-Encoding: gzip" "${SERVER_URL}" "Content-Encoding" "^gzip$" \
+        -H "Content-Type: application/json" -H "Accept-Encoding: gzip" -d "$data"
+    test_header "Gzip - Vary" "${SERVER_URL}" "Vary" "^Accept-Encoding$" \
+        -H "Content-Type: application/json" -H "Accept-Encoding: gzip" -d "$data"
+    test_header "Gzip - 没有 Accept-Encoding 时不压缩" "${SERVER_URL}" "Content-Encoding" "" \
+        -H "Content-Type: application/json" -d "$data"
+    test_header "Gzip - 不压缩时也带 Vary" "${SERVER_URL}" "Vary" "^Accept-Encoding$" \
+        -H "Content-Type: application/json" -d "$data"
+    test_header "Gzip - Accept-Encoding: deflate" "${SERVER_URL}" "Content-Encoding" "^deflate$" \
+        -H "Content-Type: application/json" -H "Accept-Encoding: deflate" -d "$data"
+    test_header "Gzip - q 值高者优先" "${SERVER_URL}" "Content-Encoding" "^deflate$" \
+        -H "Content-Type: application/json" -H "Accept-Encoding: gzip;q=0.5, deflate" -d "$data"
+    test_header "Gzip - q=0 表示拒绝" "${SERVER_URL}" "Content-Encoding" "" \
+        -H "Content-Type: application/json" -H "Accept-Encoding: gzip;q=0" -d "$data"
+    test_header "Gzip - '*' 匹配未列出的编码" "${SERVER_URL}" "Content-Encoding" "^gzip$" \
+        -H "Content-Type: application/json" -H "Accept-Encoding: *" -d "$data"
+    test_header "Gzip - 不支持的编码" "${SERVER_URL}" "Content-Encoding" "" \
+        -H "Content-Type: application/json" -H "Accept-Encoding: br" -d "$data"
+    test_header "Gzip - 1KB 以下的响应不压缩" "${SERVER_URL}" "Content-Encoding" "" \
+        -H "Content-Type: application/json" -H "Accept-Encoding: gzip" -d '{"data": 1}'
+    
+    # 解压后与未压缩的响应一致
+    plain=$(curl -s -H "Content-Type: application/json" -d "$data" "${SERVER_URL}")
+    for enc in gzip deflate; do
+        echo -e "${BLUE}测试: Gzip - ${enc} 解压后与原文一致${NC}"
+        compressed=$(curl -s --compressed -H "Accept-Encoding: ${enc}" \
+            -H "Content-Type: application/json" -d "$data" "${SERVER_URL}")
+        if [ -n "$plain" ] && [ "$compressed" = "$plain" ]; then
+            echo -e "${GREEN}✓ 解压后 ${#compressed} 字节，与原文一致${NC}"
+        else
+            echo -e "${RED}✗ 解压后 ${#compressed} 字节，原文 ${#plain} 字节${NC}"
+            FAILED=$((FAILED + 1))
+        fi
+        echo ""
+    done
+}
+
+# 指标中包含 PATTERN（固定字符串）的样本值之和：多个 worker 各有一行
+metric_sum() {
+    curl -s "${SERVER_URL}/metrics" | grep -F "$1" | awk '{ s += $NF } END { print s + 0 }'
+}
+
+# 检查指标的增量：check_metric 名称 PATTERN 增量前的值 期望的最小增量
+check_metric() {
+    local name="$1"
+    local pattern="$2"
+    local before="$3"
+    local expected="$4"
+    local after
+    
+    echo -e "${BLUE}测试: ${name}${NC}"
+    after=$(metric_sum "$pattern")
+    if [ $((after - before)) -ge "$expected" ]; then
+        echo -e "${GREEN}✓ ${before} -> ${after} (期望增加至少 ${expected})${NC}"
+    else
+        echo -e "${RED}✗ ${before} -> ${after} (期望增加至少 ${expected})${NC}"
+        FAILED=$((FAILED + 1))
+    fi
+    echo ""
+}
+
+# 指标：Prometheus 文本格式，请求数按模式和状态码类别计数，各阶段耗时直方图
+test_metrics() {
+    local ok_line='mode="json-stream",scheme="http",code="2xx"}'
+    local bad_line='mode="json-stream",scheme="http",code="4xx"}'
+    local ok_before bad_before err_before
+    
+    test_case "Metrics - GET /metrics" "GET" "${SERVER_URL}/metrics" "" "200"
+    check_body "# TYPE userver_requests_total counter"
+    check_body "# TYPE userver_request_stage_seconds histogram"
+    test_header "Metrics - Content-Type" "${SERVER_URL}/metrics" "Content-Type" \
+        "^text/plain; version=0.0.4"
+    
+    ok_before=$(metric_sum "$ok_line")
+    bad_before=$(metric_sum "$bad_line")
+    err_before=$(metric_sum 'userver_errors_total{')
+    
+    for i in 1 2 3; do
+        curl -s -o /dev/null -H "Content-Type: application/json" -d "{\"data\": $i}" "${SERVER_URL}/"
+    done
+    curl -s -o /dev/null -H "Content-Type: application/json" -d '{"invalid": json}' "${SERVER_URL}/"
+    
+    check_metric "Metrics - 2xx 请求计数" "$ok_line" "$ok_before" 3
+    check_metric "Metrics - 4xx 请求计数" "$bad_line" "$bad_before" 1
+    check_metric "Metrics - body 格式错误计数" 'userver_errors_total{' "$err_before" 1
+    
+    test_case "Metrics - 各阶段的直方图" "GET" "${SERVER_URL}/metrics" "" "200"
+    for stage in headers body handler write; do
+        check_body "mode=\"json-stream\",scheme=\"http\",stage=\"${stage}\",le=\"+Inf\"}"
+    done
+}
+
+# 检查协商出的 HTTP 版本：check_version 名称 期望版本 [额外的 curl 参数...]
+check_version() {
+    local name="$1"
+    local expected="$2"
+    shift 2
+    local version
+    
+    echo -e "${BLUE}测试: ${name}${NC}"
+    version=$(curl -s -o /dev/null -w '%{http_version}' "$@" "${SERVER_URL}")
+    if [ "$version" = "$expected" ]; then
+        echo -e "${GREEN}✓ HTTP 版本: ${version}${NC}"
+    else
+        echo -e "${RED}✗ HTTP 版本: ${version} (期望: ${expected})${NC}"
+        FAILED=$((FAILED + 1))
+    fi
+    echo ""
+}
+
+# HTTP/2 明文（prior knowledge）：同一套处理器，多个流复用一个连接
+test_h2c() {
+    local tmp result
+    
+    if ! curl -V | grep -qw HTTP2; then
+        echo -e "${YELLOW}跳过 h2c 测试: curl 不支持 HTTP/2${NC}"
+        echo ""
+        return
+    fi
+    
+    test_case "H2c - GET" "GET" "${SERVER_URL}" "" "200" --http2-prior-knowledge
+    check_version "H2c - 协议版本" "2" --http2-prior-knowledge
+    
+    test_case "H2c - POST JSON" \
+        "POST" \
+        "${SERVER_URL}" \
+        '{"data": {"proto": "h2c"}}' \
+        "200" \
+        --http2-prior-knowledge
+    check_body '"echo":{"proto":"h2c"}'
+    
+    test_case "H2c - 无效 JSON" "POST" "${SERVER_URL}" '{"invalid": json}' "400" \
+        --http2-prior-knowledge
+    
+    # 超过每个流 128KB 的接收窗口：body 交给处理器后才归还窗口
+    tmp=$(mktemp)
+    { printf '{"pad": ['; seq -s ',' 1 150000; printf '], "data": "end"}'; } > "$tmp"
+    test_case "H2c - 1MB body（超过流的接收窗口）" \
+        "POST" \
+        "${SERVER_URL}" \
+        "" \
+        "200" \
+        --http2-prior-knowledge -H "Content-Type: application/json" --data-binary @"$tmp"
+    check_body '"echo":"end"'
+    rm -f "$tmp"
+    
+    # 一个连接上并发 5 个流（curl 7.88 复用 h2c 连接有问题，用 nghttp）
+    echo -e "${BLUE}测试: H2c - 一个连接上的并发流${NC}"
+    if command -v nghttp > /dev/null; then
+        result=$(nghttp -ns "${SERVER_URL}/?s=1" "${SERVER_URL}/?s=2" "${SERVER_URL}/?s=3" \
+            "${SERVER_URL}/?s=4" "${SERVER_URL}/?s=5")
+        if [ "$(echo "$result" | grep -cE '^ *[0-9]+ .* 200 +[0-9]+ /\?s=[1-5]$')" = "5" ]; then
+            echo -e "${GREEN}✓ 5 个流都返回 200${NC}"
+        else
+            echo -e "${RED}✗ 各流的结果:${NC}"
+            echo "$result"
+            FAILED=$((FAILED + 1))
+        fi
+    else
+        echo -e "${YELLOW}跳过: 没有 nghttp${NC}"
+    fi
+    echo ""
+    
+    check_version "H2c - 忽略 Upgrade: h2c，按 HTTP/1.1 响应" "1.1" --http2
+}
+
+# 路由：精确匹配优先于前缀，方法不符回落到前缀路由，都不符时返回 405 和 Allow
+test_routes() {
+    test_case "Routes - 前缀路由 POST" \
+        "POST" \
+        "${SERVER_URL}/api/echo" \
+        '{"data": {"route": "prefix"}}' \
+        "200"
+    check_body '"echo":{"route":"prefix"}'
+    
+    test_case "Routes - 前缀路由 PUT（带查询串）" \
+        "PUT" \
+        "${SERVER_URL}/api/echo?x=1" \
+        '{"data": 1}' \
+        "200"
+    
+    test_case "Routes - 前缀路由方法不符返回 405" "GET" "${SERVER_URL}/api/echo" "" "405"
+    test_header "Routes - 405 的 Allow" "${SERVER_URL}/api/echo" "Allow" "^POST, PUT$"
+    
+    CONTENT_TYPE="application/x-www-form-urlencoded"
+    test_case "Routes - 精确匹配优先于前缀" \
+        "POST" \
+        "${SERVER_URL}/api/form" \
+        'a=1' \
+        "200"
+    check_body '"type":"form-urlencoded"'
+    unset CONTENT_TYPE
+    
+    test_case "Routes - 精确路由 GET" "GET" "${SERVER_URL}/api/form" "" "200"
+    check_body "HTTP Form Server"
+    
+    test_case "Routes - 精确路由方法不符时回落到前缀路由" \
+        "PUT" \
+        "${SERVER_URL}/api/form" \
+        '{"data": "fallback"}' \
+        "200"
+    check_body '"echo":"fallback"'
+    
+    test_case "Routes - 两条路由都不允许的方法" "DELETE" "${SERVER_URL}/api/form" "" "405"
+    test_header "Routes - Allow 合并两条路由的方法" "${SERVER_URL}/api/form" "Allow" \
+        "^GET, POST, PUT$" -X DELETE
+    
+    test_case "Routes - 未命中返回 404" "GET" "${SERVER_URL}/other" "" "404"
+    test_header "Routes - 404 不带 Allow" "${SERVER_URL}/other" "Allow" ""
+    test_case "Routes - 前缀不含末尾 '/'" "POST" "${SERVER_URL}/api" '{}' "404"
+    test_case "Routes - 路径的一部分" "POST" "${SERVER_URL}/ap" '{}' "404"
+}
+
 # 检查服务器
 check_server
 
-# 测试 1: GET 请求（无请求体）
-test_case "GET 请求 - 无请求体" \
-    "GET" \
-    "${SERVER_URL}" \
-    "" \
-    "200"
-
-# 测试 2: POST 请求 - 简单 JSON
-test_case "POST 请求 - 简单 JSON" \
-    "POST" \
-    "${SERVER_URL}" \
-    '{"message": "Hello, Server!"}' \
-    "200"
-
-# 测试 3: POST 请求 - 带 data 字段（应该回显）
-test_case "POST 请求 - 带 data 字段（回显测试）" \
-    "POST" \
-    "${SERVER_URL}" \
-    '{"data": {"name": "test", "value": 123}}' \
-    "200"
-
-# 测试 4: POST 请求 - 复杂 JSON
-test_case "POST 请求 - 复杂 JSON" \
-    "POST" \
-    "${SERVER_URL}" \
-    '{"data": {"users": [{"id": 1, "name": "Alice"}, {"id": 2, "name": "Bob"}]}}' \
-    "200"
-
-# 测试 5: 无效 JSON（应该返回 400）
-test_case "POST 请求 - 无效 JSON" \
-    "POST" \
-    "${SERVER_URL}" \
-    '{"invalid": json}' \
-    "400"
-
-# 测试 6: 空请求体
-test_case "POST 请求 - 空请求体" \
-    "POST" \
-    "${SERVER_URL}" \
-    "" \
-    "200"
-
-# 测试 7: 大 JSON 数据
-test_case "POST 请求 - 大 JSON 数据" \
-    "POST" \
-    "${SERVER_URL}" \
-    "{\"data\": {\"array\": [$(seq -s ',' 1 100)]}}" \
-    "200"
+has_test json && test_json
+has_test form && test_form
+has_test form-strict && test_form_strict
+has_test static && test_static
+has_test routes && test_routes
+has_test json-lazy && test_json_lazy
+has_test echo-stream && test_echo_stream
+has_test gzip && test_gzip
+has_test metrics && test_metrics
+has_test h2c && test_h2c
 
+if [ "$FAILED" -gt 0 ]; then
+    echo -e "${RED}=== ${FAILED} 项检查失败 ===${NC}"
+    exit 1
+fi
 echo -e "${GREEN}=== 所有测试完成 ===${NC}"
-
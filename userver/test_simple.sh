@@ -2,34 +2,131 @@
 
 # 简单的 curl 测试脚本
 # 快速测试 HTTP JSON Server
+#
+# 用法：test_simple.sh [PORT] [TESTS] [FILE]
+#   TESTS  逗号分隔的测试组（默认 json），与 test_curl.sh 相同
+#   FILE   static 组请求的文件（相对文档根目录，默认 index.html）
 
 PORT=${1:-8080}
+TESTS=${2:-json}
+FILE=${3:-index.html}
 URL="http://localhost:${PORT}"
 
+has_test() {
+    [[ ",${TESTS}," == *",$1,"* ]]
+}
+
 echo "=== 快速测试 HTTP JSON Server ==="
 echo "服务器: ${URL}"
 echo ""
 
-# 测试 1: 基本 GET
-echo "1. GET 请求:"
-curl -s "${URL}" | python3 -m json.tool 2>/dev/null || curl -s "${URL}"
-echo -e "\n"
-
-# 测试 2: POST with JSON
-echo "2. POST 请求 (带 JSON):"
-curl -s -X POST \
-    -H "Content-Type: application/json" \
-    -d '{"data": {"test": "value"}}' \
-    "${URL}" | python3 -m json.tool 2>/dev/null || curl -s -X POST -H "Content-Type: application/json" -d '{"data": {"test": "value"}}' "${URL}"
-echo -e "\n"
-
-# 测试 3: 无效 JSON
-echo "3. POST 请求 (无效 JSON):"
-curl -s -X POST \
-    -H "Content-Type: application/json" \
-    -d '{"invalid": json}' \
-    "${URL}" | python3 -m json.tool 2>/dev/null || curl -s -X POST -H "Content-Type: application/json" -d '{"invalid": json}' "${URL}"
-echo -e "\n"
+if has_test json; then
+    # 测试 1: 基本 GET
+    echo "1. GET 请求:"
+    curl -s "${URL}" | python3 -m json.tool 2>/dev/null || curl -s "${URL}"
+    echo -e "\n"
+
+    # 测试 2: POST with JSON
+    echo "2. POST 请求 (带 JSON):"
+    curl -s -X POST \
+        -H "Content-Type: application/json" \
+        -d '{"data": {"test": "value"}}' \
+        "${URL}" | python3 -m json.tool 2>/dev/null || curl -s -X POST -H "Content-Type: application/json" -d '{"data": {"test": "value"}}' "${URL}"
+    echo -e "\n"
+
+    # 测试 3: 无效 JSON
+    echo "3. POST 请求 (无效 JSON):"
+    curl -s -X POST \
+        -H "Content-Type: application/json" \
+        -d '{"invalid": json}' \
+        "${URL}" | python3 -m json.tool 2>/dev/null || curl -s -X POST -H "Content-Type: application/json" -d '{"invalid": json}' "${URL}"
+    echo -e "\n"
+fi
+
+if has_test form; then
+    echo "Form 请求 (重名字段取最后一次的值，非法转义原样保留):"
+    curl -s -X POST \
+        -H "Content-Type: application/x-www-form-urlencoded" \
+        -d 'name=John+Doe&k=1&k=2&bad=%4' \
+        "${URL}"
+    echo -e "\n"
+fi
+
+if has_test form-strict; then
+    echo "Form 请求 (严格模式，非法转义返回 400):"
+    curl -s -w "\nHTTP %{http_code}" -X POST \
+        -H "Content-Type: application/x-www-form-urlencoded" \
+        -d 'a=%4&b=1' \
+        "${URL}"
+    echo -e "\n"
+fi
+
+if has_test json-lazy; then
+    echo "JSON lazy (data 原文回显，保留数字写法):"
+    curl -s -X POST \
+        -H "Content-Type: application/json" \
+        -d '{"data": {"price": 1.50, "tags": ["a", "b"]}}' \
+        "${URL}"
+    echo -e "\n"
+
+    echo "JSON lazy (小数点后没有数字，返回 400):"
+    curl -s -w "\nHTTP %{http_code}" -X POST \
+        -H "Content-Type: application/json" \
+        -d '{"data": 1.}' \
+        "${URL}"
+    echo -e "\n"
+fi
+
+if has_test echo-stream; then
+    echo "流式回显 (Transfer-Encoding: chunked):"
+    curl -si -X POST -H "Content-Type: text/plain" -d 'hello, stream' "${URL}"
+    echo -e "\n"
+fi
+
+if has_test gzip; then
+    echo "响应压缩 (Accept-Encoding: gzip，只看响应头):"
+    curl -s -D - -o /dev/null -X POST \
+        -H "Content-Type: application/json" -H "Accept-Encoding: gzip" \
+        -d "{\"data\": [$(seq -s ',' 1 1000)]}" \
+        "${URL}"
+    echo ""
+fi
+
+if has_test metrics; then
+    echo "指标 (请求计数):"
+    curl -s "${URL}/metrics" | grep '^userver_requests_total'
+    echo ""
+fi
+
+if has_test h2c; then
+    echo "HTTP/2 明文 (--http2-prior-knowledge):"
+    curl -s -w "\nHTTP/%{http_version} %{http_code}" --http2-prior-knowledge -X POST \
+        -H "Content-Type: application/json" \
+        -d '{"data": {"proto": "h2c"}}' \
+        "${URL}"
+    echo -e "\n"
+fi
+
+if has_test static; then
+    echo "静态文件 (Range: bytes=0-9):"
+    curl -si -H "Range: bytes=0-9" "${URL}/${FILE}"
+    echo -e "\n"
+
+    echo "静态文件 (If-None-Match 为上一次的 ETag，应返回 304):"
+    etag=$(curl -sI "${URL}/${FILE}" | tr -d '\r' | grep -i '^ETag:' | cut -d' ' -f2-)
+    curl -si -H "If-None-Match: ${etag}" "${URL}/${FILE}"
+    echo -e "\n"
+fi
+
+if has_test routes; then
+    echo "路由 (方法不符返回 405 和 Allow):"
+    curl -si -X DELETE "${URL}/api/form"
+    echo -e "\n"
+
+    echo "路由 (未命中返回 404):"
+    curl -si "${URL}/other"
+    echo -e "\n"
+fi
 
 echo "测试完成！"
 
@@ -0,0 +1,200 @@
+#ifndef JSON_CORPUS_H
+#define JSON_CORPUS_H
+
+#include <stddef.h>
+
+/* JSON 测试语料（命名沿用 JSONTestSuite）：
+ * - y_ 必须接受，n_ 必须拒绝（RFC 8259）
+ * - i_ 由实现决定（非法 UTF-8、孤立代理项等），只要求不崩溃
+ * len 为 0 时按 strlen 计算；含 '\0' 的用例显式给出长度 */
+
+struct json_case {
+    const char *name;
+    const char *text;
+    size_t len;
+};
+
+static const struct json_case g_json_corpus[] = {
+    /* ---- y_ ---- */
+    { "y_array_empty", "[]", 0 },
+    { "y_array_empty_string", "[\"\"]", 0 },
+    { "y_array_arraysWithSpaces", "[[]   ]", 0 },
+    { "y_array_false", "[false]", 0 },
+    { "y_array_heterogeneous", "[null, 1, \"1\", {}]", 0 },
+    { "y_array_null", "[null]", 0 },
+    { "y_array_with_leading_space", " [1]", 0 },
+    { "y_array_with_several_null", "[1,null,null,null,2]", 0 },
+    { "y_array_with_trailing_space", "[2] ", 0 },
+    { "y_array_ending_with_newline", "[\"a\"]\n", 0 },
+    { "y_number", "[123e65]", 0 },
+    { "y_number_0e+1", "[0e+1]", 0 },
+    { "y_number_0e1", "[0e1]", 0 },
+    { "y_number_after_space", "[ 4]", 0 },
+    { "y_number_double_close_to_zero", "[-0.000000000000000000000000000000000000000000000000000000000000000000000000000001]", 0 },
+    { "y_number_int_with_exp", "[20e1]", 0 },
+    { "y_number_minus_zero", "[-0]", 0 },
+    { "y_number_negative_int", "[-123]", 0 },
+    { "y_number_negative_one", "[-1]", 0 },
+    { "y_number_real_capital_e", "[1E22]", 0 },
+    { "y_number_real_capital_e_neg_exp", "[1E-2]", 0 },
+    { "y_number_real_capital_e_pos_exp", "[1E+2]", 0 },
+    { "y_number_real_exponent", "[123e45]", 0 },
+    { "y_number_real_fraction_exponent", "[123.456e78]", 0 },
+    { "y_number_simple_int", "[123]", 0 },
+    { "y_number_simple_real", "[123.456789]", 0 },
+    { "y_object", "{\"asd\":\"sdf\", \"dfg\":\"fgh\"}", 0 },
+    { "y_object_basic", "{\"asd\":\"sdf\"}", 0 },
+    { "y_object_duplicated_key", "{\"a\":\"b\",\"a\":\"c\"}", 0 },
+    { "y_object_duplicated_key_and_value", "{\"a\":\"b\",\"a\":\"b\"}", 0 },
+    { "y_object_empty", "{}", 0 },
+    { "y_object_empty_key", "{\"\":0}", 0 },
+    { "y_object_escaped_null_in_key", "{\"foo\\u0000bar\": 42}", 0 },
+    { "y_object_extreme_numbers", "{ \"min\": -1.0e+28, \"max\": 1.0e+28 }", 0 },
+    { "y_object_long_strings", "{\"x\":[{\"id\": \"xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\"}], \"id\": \"xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\"}", 0 },
+    { "y_object_simple", "{\"a\":[]}", 0 },
+    { "y_object_string_unicode", "{\"title\":\"\\u041f\\u043e\\u043b\\u0442\\u043e\\u0440\\u0430 \\u0417\\u0435\\u043c\\u043b\\u0435\\u043a\\u043e\\u043f\\u0430\" }", 0 },
+    { "y_object_with_newlines", "{\n\"a\": \"b\"\n}", 0 },
+    { "y_string_1_2_3_bytes_UTF-8_sequences", "[\"\\u0060\\u012a\\u12AB\"]", 0 },
+    { "y_string_accepted_surrogate_pair", "[\"\\uD801\\udc37\"]", 0 },
+    { "y_string_allowed_escapes", "[\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"]", 0 },
+    { "y_string_backslash_and_u_escaped_zero", "[\"\\\\u0000\"]", 0 },
+    { "y_string_backslash_doublequotes", "[\"\\\"\"]", 0 },
+    { "y_string_comments", "[\"a/*b*/c/*d//e\"]", 0 },
+    { "y_string_double_escape_a", "[\"\\\\a\"]", 0 },
+    { "y_string_in_array_with_leading_space", "[ \"asd\"]", 0 },
+    { "y_string_nonCharacterInUTF-8_U+FFFF", "[\"\xef\xbf\xbf\"]", 0 },
+    { "y_string_utf8", "[\"\xe2\x82\xac\xf0\x9d\x84\x9e\"]", 0 },
+    { "y_string_null_escape", "[\"\\u0000\"]", 0 },
+    { "y_string_space", "\" \"", 0 },
+    { "y_string_unicode_2", "[\"\xe2\x8d\x82\xe3\x88\xb4\xe2\x8d\x82\"]", 0 },
+    { "y_string_with_del_character", "[\"a\x7f" "a\"]", 0 },
+    { "y_structure_lonely_false", "false", 0 },
+    { "y_structure_lonely_int", "42", 0 },
+    { "y_structure_lonely_negative_real", "-0.1", 0 },
+    { "y_structure_lonely_null", "null", 0 },
+    { "y_structure_lonely_string", "\"asd\"", 0 },
+    { "y_structure_lonely_true", "true", 0 },
+    { "y_structure_string_empty", "\"\"", 0 },
+    { "y_structure_trailing_newline", "[\"a\"]\n", 0 },
+    { "y_structure_true_in_array", "[true]", 0 },
+    { "y_structure_whitespace_array", " [] ", 0 },
+    { "y_nested_objects", "{\"user\":{\"name\":\"a\",\"tags\":[\"x\",\"y\",{\"k\":[1,2,[3]]}]},\"n\":-1.5e3}", 0 },
+    { "y_long_string_with_escapes", "[\"0123456789abcdef0123456789abcdef0123456789abcdef012345678\\\"9abc\\\\\\\\\\\"def0123456789abcdef0123456789abcdef\\n\"]", 0 },
+
+    /* ---- n_ ---- */
+    { "n_array_1_true_without_comma", "[1 true]", 0 },
+    { "n_array_colon_instead_of_comma", "[\"\": 1]", 0 },
+    { "n_array_comma_after_close", "[\"\"],", 0 },
+    { "n_array_comma_and_number", "[,1]", 0 },
+    { "n_array_double_comma", "[1,,2]", 0 },
+    { "n_array_extra_close", "[\"x\"]]", 0 },
+    { "n_array_extra_comma", "[\"\",]", 0 },
+    { "n_array_incomplete", "[\"x\"", 0 },
+    { "n_array_incomplete_invalid_value", "[x", 0 },
+    { "n_array_inner_array_no_comma", "[3[4]]", 0 },
+    { "n_array_just_comma", "[,]", 0 },
+    { "n_array_just_minus", "[-]", 0 },
+    { "n_array_missing_value", "[   , \"\"]", 0 },
+    { "n_array_number_and_comma", "[1,]", 0 },
+    { "n_array_star_inside", "[*]", 0 },
+    { "n_array_unclosed", "[\"\"", 0 },
+    { "n_array_unclosed_trailing_comma", "[1,", 0 },
+    { "n_array_unclosed_with_new_lines", "[1,\n1\n,1", 0 },
+    { "n_incomplete_false", "[fals]", 0 },
+    { "n_incomplete_null", "[nul]", 0 },
+    { "n_incomplete_true", "[tru]", 0 },
+    { "n_number_++", "[++1234]", 0 },
+    { "n_number_+1", "[+1]", 0 },
+    { "n_number_-01", "[-01]", 0 },
+    { "n_number_-1.0.", "[-1.0.]", 0 },
+    { "n_number_-2.", "[-2.]", 0 },
+    { "n_number_.-1", "[.-1]", 0 },
+    { "n_number_.2e-3", "[.2e-3]", 0 },
+    { "n_number_0.1.2", "[0.1.2]", 0 },
+    { "n_number_0.3e+", "[0.3e+]", 0 },
+    { "n_number_0.e1", "[0.e1]", 0 },
+    { "n_number_0e", "[0e]", 0 },
+    { "n_number_1.0e-", "[1.0e-]", 0 },
+    { "n_number_1eE2", "[1eE2]", 0 },
+    { "n_number_2.e3", "[2.e3]", 0 },
+    { "n_number_9.e+", "[9.e+]", 0 },
+    { "n_number_Inf", "[Inf]", 0 },
+    { "n_number_NaN", "[NaN]", 0 },
+    { "n_number_hex_1_digit", "[0x1]", 0 },
+    { "n_number_leading_zero", "[012]", 0 },
+    { "n_number_minus_infinity", "[-Infinity]", 0 },
+    { "n_number_neg_int_starting_with_zero", "[-012]", 0 },
+    { "n_number_real_without_fractional_part", "[1.]", 0 },
+    { "n_object_bad_value", "[\"x\", truth]", 0 },
+    { "n_object_comma_instead_of_colon", "{\"x\", null}", 0 },
+    { "n_object_double_colon", "{\"x\"::\"b\"}", 0 },
+    { "n_object_garbage_at_end", "{\"a\":\"a\" 123}", 0 },
+    { "n_object_missing_colon", "{\"a\" b}", 0 },
+    { "n_object_missing_key", "{:\"b\"}", 0 },
+    { "n_object_missing_semicolon", "{\"a\" \"b\"}", 0 },
+    { "n_object_missing_value", "{\"a\":", 0 },
+    { "n_object_no-colon", "{\"a\"", 0 },
+    { "n_object_non_string_key", "{1:1}", 0 },
+    { "n_object_single_quote", "{'a':0}", 0 },
+    { "n_object_trailing_comma", "{\"id\":0,}", 0 },
+    { "n_object_trailing_comment", "{\"a\":\"b\"}/**/", 0 },
+    { "n_object_two_commas_in_a_row", "{\"a\":\"b\",,\"c\":\"d\"}", 0 },
+    { "n_object_unquoted_key", "{a: \"b\"}", 0 },
+    { "n_object_unterminated-value", "{\"a\":\"a", 0 },
+    { "n_object_with_trailing_garbage", "{\"a\": true} \"x\"", 0 },
+    { "n_string_1_surrogate_then_escape_u", "[\"\\uD800\\u\"]", 0 },
+    { "n_string_escape_x", "[\"\\x00\"]", 0 },
+    { "n_string_escaped_backslash_bad", "[\"\\\\\\\"]", 0 },
+    { "n_string_escaped_ctrl_char_tab", "[\"\\\t\"]", 0 },
+    { "n_string_incomplete_escape", "[\"\\\"]", 0 },
+    { "n_string_incomplete_escaped_character", "[\"\\u00A\"]", 0 },
+    { "n_string_invalid_backslash_esc", "[\"\\a\"]", 0 },
+    { "n_string_invalid_unicode_escape", "[\"\\uqqqq\"]", 0 },
+    { "n_string_no_quotes_with_bad_escape", "[\\n]", 0 },
+    { "n_string_single_doublequote", "\"", 0 },
+    { "n_string_single_quote", "['single quote']", 0 },
+    { "n_string_unescaped_ctrl_char", "[\"a\0a\"]", 7 },
+    { "n_string_unescaped_newline", "[\"new\nline\"]", 0 },
+    { "n_string_unescaped_tab", "[\"\t\"]", 0 },
+    { "n_structure_array_with_extra_array_close", "[1]]", 0 },
+    { "n_structure_close_unopened_array", "1]", 0 },
+    { "n_structure_double_array", "[][]", 0 },
+    { "n_structure_end_array", "]", 0 },
+    { "n_structure_lone-open-bracket", "[", 0 },
+    { "n_structure_null-byte-outside-string", "[\0]", 3 },
+    { "n_structure_object_followed_by_closing_object", "{}}", 0 },
+    { "n_structure_object_unclosed_no_value", "{\"\":", 0 },
+    { "n_structure_open_object", "{", 0 },
+    { "n_structure_open_object_close_array", "{]", 0 },
+    { "n_structure_trailing_#", "{\"a\":\"b\"}#{}", 0 },
+    { "n_structure_unclosed_array", "[1", 0 },
+    { "n_structure_unclosed_object", "{\"asd\":\"asd\"", 0 },
+    { "n_structure_whitespace_formfeed", "[\f]", 0 },
+    { "n_long_string_with_bad_escape", "[\"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef\\q\"]", 0 },
+
+    /* ---- i_ ---- */
+    { "i_string_1st_surrogate_but_2nd_missing", "[\"\\uDADA\"]", 0 },
+    { "i_string_incomplete_surrogate_pair", "[\"\\uDd1ea\"]", 0 },
+    { "i_string_invalid_lonely_surrogate", "[\"\\ud800\"]", 0 },
+    { "i_string_inverted_surrogates_U+1D11E", "[\"\\uDd1e\\uD834\"]", 0 },
+    { "i_string_UTF-8_invalid_sequence", "[\"\xe6\x97\xa5\xd1\x88\xfa\"]", 0 },
+    { "i_string_lone_continuation_byte", "[\"\x81\"]", 0 },
+    { "i_string_overlong_sequence_2_bytes", "[\"\xc0\xaf\"]", 0 },
+    { "i_string_truncated-utf-8", "[\"\xe0\xff\"]", 0 },
+    { "i_string_UTF-16LE_with_BOM", "\xff\xfe[\0\"\0\xe9\0\"\0]\0", 12 },
+    { "i_structure_UTF-8_BOM_empty_object", "\xef\xbb\xbf{}", 0 },
+};
+
+#define JSON_CORPUS_COUNT (sizeof(g_json_corpus) / sizeof(g_json_corpus[0]))
+
+/* 嵌套深度恰好为 depth 的数组 "[[...]]" 写入 buf（至少 2 * depth 字节），返回长度 */
+static inline size_t json_corpus_nested(char *buf, int depth)
+{
+    for (int i = 0; i < depth; i++) {
+        buf[i] = '[';
+        buf[2 * depth - 1 - i] = ']';
+    }
+    return (size_t)depth * 2;
+}
+
+#endif // JSON_CORPUS_H
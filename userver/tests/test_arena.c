@@ -0,0 +1,79 @@
+/* 请求 arena：原地扩展、独占一块的大缓冲区整块 realloc、其余情况拷贝到新空间 */
+
+#include "test_util.h"
+#include "http_arena.h"
+
+static int block_count(const http_arena_t *a)
+{
+    int n = 0;
+
+    for (const struct http_arena_block *b = a->head; b; b = b->next) {
+        n++;
+    }
+    return n;
+}
+
+/* 模拟缓冲 JSON 的累积：上下文之后跟一个不断倍增的缓冲区 */
+static void test_grow(void)
+{
+    http_arena_t a = {0};
+    char *ctx = http_arena_alloc(&a, 64);
+    size_t cap = 4096;
+    char *buf = http_arena_alloc(&a, cap);
+    size_t total = 0;
+
+    CHECK(ctx && buf);
+    memset(buf, 'a', cap);
+    while (cap < (10 << 20)) {
+        buf = http_arena_realloc(&a, buf, cap, cap * 2);
+        CHECK(buf != NULL);
+        if (!buf) break;
+        CHECK(buf[0] == 'a' && buf[cap - 1] == 'a');
+        memset(buf + cap, 'a', cap);
+        cap *= 2;
+    }
+
+    /* 首块（上下文 + 最初的缓冲区）之外只有缓冲区所在的一块，大小与缓冲区相同 */
+    CHECK(block_count(&a) == 2);
+    for (const struct http_arena_block *b = a.head; b; b = b->next) {
+        total += b->size;
+    }
+    CHECK(total < cap + cap / 2);
+    CHECK(a.head->data == buf);
+
+    /* 之后的分配另起一块（不按缓冲区的大小倍增），不破坏缓冲区 */
+    char *p = http_arena_strndup(&a, "tail", 4);
+    CHECK_STR(p, "tail");
+    CHECK(buf[cap - 1] == 'a');
+    CHECK(a.head->size <= 64 * 1024);
+
+    http_arena_reset(&a);
+    CHECK(block_count(&a) <= 1);
+    http_arena_destroy(&a);
+}
+
+static void test_inplace(void)
+{
+    http_arena_t a = {0};
+    char *p = http_arena_alloc(&a, 16);
+    char *q;
+
+    memcpy(p, "0123456789abcdef", 16);
+    q = http_arena_realloc(&a, p, 16, 256);
+    CHECK(q == p && memcmp(q, "0123456789abcdef", 16) == 0);
+    CHECK(http_arena_realloc(&a, q, 256, 8) == q);
+
+    /* 不是最近一次分配：拷贝到新空间 */
+    char *r = http_arena_alloc(&a, 8);
+    char *s = http_arena_realloc(&a, q, 256, 512);
+    CHECK(r && s && s != q && memcmp(s, "0123456789abcdef", 16) == 0);
+    CHECK(block_count(&a) == 1);
+    http_arena_destroy(&a);
+}
+
+int main(void)
+{
+    test_inplace();
+    test_grow();
+    TEST_DONE();
+}
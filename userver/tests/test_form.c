@@ -0,0 +1,278 @@
+/* Form 解析器差分测试：同一 body 按标量参考实现与 http_form 的结果比对
+ * - 扫描实现 scalar / sse2 / avx2 各跑一遍（CPU 不支持的跳过）
+ * - 原地模式（一次到达、Content-Length 已知）与拷贝模式（任意分片，含转义跨片、"%X" 落在片尾）
+ * - 宽松模式非法转义原样保留，严格模式返回 400；重复字段保留首次位置、取最后一次的值 */
+#include "test_util.h"
+#include "http_form.h"
+#include "http_urldecode.h"
+
+/* 被测模块引用的日志与指标接口：测试中不需要 */
+void http_metrics_error(int type)
+{
+    (void)type;
+}
+
+void http_log_error(const char *kind, const char *msg)
+{
+    (void)kind;
+    (void)msg;
+}
+
+#define REF_MAX_FIELDS 256
+
+struct ref_field {
+    char name[256];
+    size_t name_len;
+    char value[256];
+    size_t value_len;
+};
+
+struct ref_form {
+    struct ref_field fields[REF_MAX_FIELDS];
+    int count;
+    int bad;                    /* 严格模式下的非法转义 */
+};
+
+/* 参考实现：逐字节解码，'%' 后不是两个十六进制字符时原样输出 '%' */
+static int ref_decode(const char *s, size_t len, char *out, size_t *out_len, int strict)
+{
+    size_t i = 0, n = 0;
+
+    while (i < len) {
+        if (s[i] == '%') {
+            if (i + 2 < len &&
+                http_url_hex[(unsigned char)s[i + 1]] >= 0 &&
+                http_url_hex[(unsigned char)s[i + 2]] >= 0) {
+                out[n++] = (char)(http_url_hex[(unsigned char)s[i + 1]] << 4 |
+                                  http_url_hex[(unsigned char)s[i + 2]]);
+                i += 3;
+                continue;
+            }
+            if (strict) {
+                return -1;
+            }
+            out[n++] = '%';
+        } else if (s[i] == '+') {
+            out[n++] = ' ';
+        } else {
+            out[n++] = s[i];
+        }
+        i++;
+    }
+    *out_len = n;
+    return 0;
+}
+
+/* 参考实现：先按原始的 '&' / '=' 切分，再解码；空字段跳过，重名字段覆盖值 */
+static void ref_parse(const char *body, size_t len, int strict, struct ref_form *ref)
+{
+    size_t start = 0;
+
+    memset(ref, 0, sizeof(*ref));
+    while (start <= len) {
+        const char *part = body + start;
+        const char *amp = memchr(part, '&', len - start);
+        size_t part_len = amp ? (size_t)(amp - part) : len - start;
+        const char *eq = memchr(part, '=', part_len);
+        struct ref_field f;
+
+        start += part_len + 1;
+        if (!part_len) {
+            continue;
+        }
+        if (ref_decode(part, eq ? (size_t)(eq - part) : part_len, f.name, &f.name_len, strict) < 0 ||
+            ref_decode(eq ? eq + 1 : part, eq ? part_len - (eq - part) - 1 : 0,
+                       f.value, &f.value_len, strict) < 0) {
+            ref->bad = 1;
+            return;
+        }
+
+        int i;
+        for (i = 0; i < ref->count; i++) {
+            if (ref->fields[i].name_len == f.name_len &&
+                memcmp(ref->fields[i].name, f.name, f.name_len) == 0)
+                break;
+        }
+        if (i < ref->count) {
+            memcpy(ref->fields[i].value, f.value, f.value_len);
+            ref->fields[i].value_len = f.value_len;
+        } else if (ref->count < REF_MAX_FIELDS) {
+            ref->fields[ref->count++] = f;
+        }
+    }
+}
+
+/* 按 chunks[] 分片（和为 len）交给处理器；in_place 时 Content-Length 已知且一次到达 */
+static void run_case(const char *body, size_t len, int strict, const struct ref_form *ref,
+                     const size_t *chunks, int nchunks, int in_place, const char *what)
+{
+    struct http_conn *conn = calloc(1, sizeof(*conn));
+    http_body_handler_t *h = strict ? http_form_handler_urlencoded_strict()
+                                    : http_form_handler_urlencoded();
+    char *buf = malloc(len ? len : 1);
+    http_form_ctx_t *ctx;
+    size_t off = 0;
+    int ok = 1;
+
+    memcpy(buf, body, len);
+    conn->parser.content_length = in_place ? len : 0;
+
+    CHECK(h->on_init(conn, "application/x-www-form-urlencoded") == 0);
+    ctx = conn->body_ctx;
+    for (int i = 0; i < nchunks; i++) {
+        CHECK(h->on_data(conn, buf + off, chunks[i]) == 0);
+        off += chunks[i];
+    }
+    CHECK(off == len);
+    CHECK(h->on_complete(conn) == 0);
+    CHECK(ctx && ctx->in_place == (in_place && len > 0));
+
+    if (ref->bad) {
+        ok = conn->status_code == 400;
+    } else if (conn->status_code != 200) {
+        ok = 0;
+    } else if (len > 0) {
+        ok = (int)ctx->count == ref->count;
+        for (int i = 0; ok && i < ref->count; i++) {
+            const struct ref_field *rf = &ref->fields[i];
+            const form_field_t *f = &ctx->fields[i];
+            const char *v;
+            size_t vlen;
+
+            ok = f->name_len == rf->name_len &&
+                 memcmp(ctx->base + f->name_off, rf->name, rf->name_len) == 0 &&
+                 f->value_len == rf->value_len &&
+                 memcmp(ctx->base + f->value_off, rf->value, rf->value_len) == 0;
+            v = http_form_get(ctx, rf->name, rf->name_len, &vlen);
+            ok = ok && v && vlen == rf->value_len && memcmp(v, rf->value, vlen) == 0;
+        }
+    }
+    g_test_checks++;
+    if (!ok) {
+        fprintf(stderr, "%s [%s%s, %d chunks]: \"%.*s\" status=%d count=%u want=%d%s\n",
+                what, http_url_scan_impl(), strict ? ", strict" : "", nchunks,
+                (int)len, body, conn->status_code, ctx ? ctx->count : 0, ref->count,
+                ref->bad ? " (bad escape)" : "");
+        g_test_failures++;
+    }
+
+    h->on_cleanup(conn);
+    http_arena_destroy(&conn->arena);
+    free(conn);
+    free(buf);
+}
+
+static const char *g_cases[] = {
+    "",
+    "a=1&b=2",
+    "name=John+Doe&email=john%40example.com",
+    "a=1&&b=2&",
+    "&&&",
+    "flag",
+    "flag&x=1",
+    "=v",
+    "a=b=c",
+    "k=1&k=2&j=3&k=4",
+    "dup&dup=x&dup",
+    "%3D=%26&%26=%3D",
+    "x=%e4%bd%a0%E5%A5%BD",
+    "a=%",
+    "a=%4",
+    "a=%4&b=1",
+    "a=%G1",
+    "a=%4G",
+    "a=%%41",
+    "a=%4%41",
+    "%=%&%4=%",
+    "a+b=c+d++",
+    "text=the+quick+brown+fox+jumps+over+the+lazy+dog+0123456789abcdef0123456789",
+    "long=aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa%41aaaaaaaaaaaaaaaaaaaaaa",
+    "p=%20%21%22%23%24%25%26%27%28%29%2A%2B%2C%2D%2E%2F&q=%7e%7E%7f",
+};
+
+/* 线性同余随机数，结果可复现 */
+static uint32_t g_rand = 12345;
+
+static uint32_t rnd(void)
+{
+    g_rand = g_rand * 1103515245u + 12345u;
+    return g_rand >> 16;
+}
+
+static void run_body(const char *body, size_t len, const char *what)
+{
+    static struct ref_form ref;
+    size_t chunks[512];
+
+    for (int strict = 0; strict <= 1; strict++) {
+        ref_parse(body, len, strict, &ref);
+
+        /* 原地与整段拷贝 */
+        chunks[0] = len;
+        run_case(body, len, strict, &ref, chunks, len ? 1 : 0, 1, what);
+        run_case(body, len, strict, &ref, chunks, len ? 1 : 0, 0, what);
+
+        /* 两片：覆盖每个切分点（含 '%' 与 "%X" 落在片尾） */
+        for (size_t cut = 1; cut < len; cut++) {
+            chunks[0] = cut;
+            chunks[1] = len - cut;
+            run_case(body, len, strict, &ref, chunks, 2, 0, what);
+        }
+
+        /* 逐字节 */
+        if (len > 1) {
+            for (size_t i = 0; i < len; i++) {
+                chunks[i] = 1;
+            }
+            run_case(body, len, strict, &ref, chunks, (int)len, 0, what);
+        }
+
+        /* 随机分片 */
+        if (len > 2) {
+            size_t off = 0;
+            int n = 0;
+
+            while (off < len && n < 512) {
+                size_t c = 1 + rnd() % 17;
+
+                if (c > len - off) c = len - off;
+                chunks[n++] = c;
+                off += c;
+            }
+            if (off == len) {
+                run_case(body, len, strict, &ref, chunks, n, 0, what);
+            }
+        }
+    }
+}
+
+int main(void)
+{
+    static const char *impls[] = { "scalar", "sse2", "avx2" };
+    static const char alphabet[] = "ab=&%+4Fg=&%\x80 ";
+    char body[240];
+
+    for (size_t k = 0; k < sizeof(impls) / sizeof(impls[0]); k++) {
+        if (http_url_scan_select(impls[k]) < 0) {
+            printf("%s: not supported, skipped\n", impls[k]);
+            continue;
+        }
+
+        for (size_t i = 0; i < sizeof(g_cases) / sizeof(g_cases[0]); i++) {
+            run_body(g_cases[i], strlen(g_cases[i]), "case");
+        }
+
+        g_rand = 12345;
+        for (int i = 0; i < 200; i++) {
+            size_t len = rnd() % sizeof(body);
+
+            for (size_t j = 0; j < len; j++) {
+                /* 多数为普通字符，留出整段拷贝的机会 */
+                body[j] = rnd() % 4 ? (char)('a' + rnd() % 26) : alphabet[rnd() % (sizeof(alphabet) - 1)];
+            }
+            run_body(body, len, "random");
+        }
+    }
+
+    TEST_DONE();
+}
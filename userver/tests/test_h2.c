@@ -0,0 +1,690 @@
+/* HTTP/2 协议引擎：用内存中的 ops 驱动 session，检查发出的帧与流回调 */
+
+#include "test_util.h"
+#include "http_h2.h"
+#include "http_hpack.h"
+
+/* 发出的帧（解析 ops->send 写出的字节） */
+struct frame {
+    int type;
+    int flags;
+    uint32_t id;
+    size_t len;
+    unsigned char data[32];     /* 负载的前 32 字节 */
+};
+
+static unsigned char g_out[1 << 20];
+static size_t g_out_len;
+static size_t g_out_pos;
+
+/* 流对象：记录回调 */
+struct req {
+    struct http_h2_stream *st;
+    char path[64];
+    size_t body;
+    int pause;                  /* data 回调返回 1 */
+    int ended;
+    int closed;
+};
+
+static struct req g_reqs[256];
+static int g_nreqs;
+static int g_refuse;
+
+static void *t_open(void *ctx, struct http_h2_stream *st)
+{
+    struct req *r;
+
+    if (g_refuse || g_nreqs == 256) {
+        return NULL;
+    }
+    r = &g_reqs[g_nreqs++];
+    memset(r, 0, sizeof(*r));
+    r->st = st;
+    return r;
+}
+
+static void t_header(void *user, const char *name, size_t name_len,
+                     const char *value, size_t value_len)
+{
+    struct req *r = user;
+
+    if (name_len == 5 && memcmp(name, ":path", 5) == 0) {
+        snprintf(r->path, sizeof(r->path), "%.*s", (int)value_len, value);
+    }
+}
+
+static int t_headers_done(void *user)
+{
+    return 0;
+}
+
+static int t_data(void *user, const char *data, size_t len)
+{
+    struct req *r = user;
+
+    r->body += len;
+    return r->pause ? 1 : 0;
+}
+
+static void t_end(void *user)
+{
+    struct req *r = user;
+
+    r->ended = 1;
+}
+
+static void t_writable(void *user)
+{
+}
+
+static void t_close(void *user)
+{
+    struct req *r = user;
+
+    r->closed = 1;
+    r->st = NULL;
+}
+
+/* session 报告的缓存 body 总量 */
+static size_t g_rx_held;
+
+static void t_rx_held(void *ctx, size_t held)
+{
+    g_rx_held = held;
+}
+
+static void t_send(void *ctx, struct iovec *iov, int iovcnt)
+{
+    for (int i = 0; i < iovcnt; i++) {
+        memcpy(g_out + g_out_len, iov[i].iov_base, iov[i].iov_len);
+        g_out_len += iov[i].iov_len;
+    }
+}
+
+static size_t t_tx_pending(void *ctx)
+{
+    return 0;
+}
+
+static const struct http_h2_ops g_ops = {
+    .open = t_open,
+    .header = t_header,
+    .headers_done = t_headers_done,
+    .data = t_data,
+    .end = t_end,
+    .writable = t_writable,
+    .close = t_close,
+    .rx_held = t_rx_held,
+    .send = t_send,
+    .tx_pending = t_tx_pending,
+};
+
+/* 取下一个发出的帧，没有时返回 0 */
+static int next_frame(struct frame *f)
+{
+    const unsigned char *p = g_out + g_out_pos;
+
+    if (g_out_len - g_out_pos < 9) {
+        return 0;
+    }
+    f->len = (size_t)p[0] << 16 | p[1] << 8 | p[2];
+    f->type = p[3];
+    f->flags = p[4];
+    f->id = ((uint32_t)p[5] << 24 | p[6] << 16 | p[7] << 8 | p[8]) & 0x7fffffff;
+    memcpy(f->data, p + 9, f->len < sizeof(f->data) ? f->len : sizeof(f->data));
+    g_out_pos += 9 + f->len;
+    return 1;
+}
+
+static void drain(void)
+{
+    g_out_len = g_out_pos = 0;
+}
+
+/* 丢弃已发出的帧，统计其中某类帧的 DATA 字节数 */
+static size_t data_bytes(uint32_t id, int *end)
+{
+    struct frame f;
+    size_t n = 0;
+
+    while (next_frame(&f)) {
+        if (f.type == 0 && f.id == id) {
+            n += f.len;
+            if (end && (f.flags & 1)) {
+                *end = 1;
+            }
+        }
+    }
+    drain();
+    return n;
+}
+
+static uint32_t get32(const unsigned char *p)
+{
+    return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+/* 构造客户端帧 */
+static unsigned char g_in[1 << 18];
+static size_t g_in_len;
+
+static void put_frame(int type, int flags, uint32_t id, const void *payload, size_t len)
+{
+    unsigned char *p = g_in + g_in_len;
+
+    p[0] = len >> 16;
+    p[1] = len >> 8;
+    p[2] = len;
+    p[3] = type;
+    p[4] = flags;
+    p[5] = id >> 24;
+    p[6] = id >> 16;
+    p[7] = id >> 8;
+    p[8] = id;
+    if (len) {
+        memcpy(p + 9, payload, len);
+    }
+    g_in_len += 9 + len;
+}
+
+static void put_u32(int type, uint32_t id, uint32_t v)
+{
+    unsigned char b[4] = { v >> 24, v >> 16, v >> 8, v };
+
+    put_frame(type, 0, id, b, 4);
+}
+
+static void put_request(uint32_t id, const char *method, const char *path, int end)
+{
+    uint8_t blk[256];
+    size_t n = 0;
+
+    n += http_hpack_encode_field(blk + n, sizeof(blk) - n, ":method", 7, method, strlen(method));
+    n += http_hpack_encode_field(blk + n, sizeof(blk) - n, ":scheme", 7, "http", 4);
+    n += http_hpack_encode_field(blk + n, sizeof(blk) - n, ":path", 5, path, strlen(path));
+    put_frame(1, 0x04 | (end ? 0x01 : 0), id, blk, n);
+}
+
+/* 送入构造好的帧 */
+static int feed(struct http_h2 *h2)
+{
+    int ret = http_h2_input(h2, (const char *)g_in, g_in_len);
+
+    g_in_len = 0;
+    http_h2_pump(h2);
+    return ret;
+}
+
+/* 新 session：送入序言和空 SETTINGS，丢弃服务端的 SETTINGS 等 */
+static struct http_h2 *session(void)
+{
+    struct http_h2 *h2 = http_h2_new(&g_ops, NULL);
+
+    g_nreqs = 0;
+    g_refuse = 0;
+    memcpy(g_in, HTTP_H2_PREFACE, HTTP_H2_PREFACE_LEN);
+    g_in_len = HTTP_H2_PREFACE_LEN;
+    put_frame(4, 0, 0, NULL, 0);
+    CHECK(feed(h2) == 0);
+    drain();
+    return h2;
+}
+
+static void respond(struct req *r, const char *body, size_t len, int copy)
+{
+    uint8_t blk[16];
+    size_t n = http_hpack_encode_status(blk, sizeof(blk), 200);
+
+    CHECK(http_h2_stream_headers(r->st, blk, n, len == 0) == 0);
+    if (len) {
+        CHECK(http_h2_stream_data(r->st, body, len, copy, 1) == 0);
+    }
+}
+
+/* 连接建立：服务端 SETTINGS、连接窗口扩大、对客户端 SETTINGS 的 ACK */
+static void test_handshake(void)
+{
+    struct http_h2 *h2 = http_h2_new(&g_ops, NULL);
+    struct frame f;
+
+    memcpy(g_in, HTTP_H2_PREFACE, HTTP_H2_PREFACE_LEN);
+    g_in_len = HTTP_H2_PREFACE_LEN;
+    put_frame(4, 0, 0, NULL, 0);
+    CHECK(feed(h2) == 0);
+
+    CHECK(next_frame(&f) && f.type == 4 && f.flags == 0 && f.len == 18);
+    CHECK(get32(f.data + 8) == HTTP_H2_STREAM_WINDOW);
+    CHECK(next_frame(&f) && f.type == 8 && f.id == 0 &&
+          get32(f.data) == HTTP_H2_CONN_WINDOW - 65535);
+    CHECK(next_frame(&f) && f.type == 4 && f.flags == 1 && f.len == 0);
+    CHECK(!next_frame(&f));
+    drain();
+
+    /* PING 原样回复 ACK */
+    put_frame(6, 0, 0, "12345678", 8);
+    CHECK(feed(h2) == 0);
+    CHECK(next_frame(&f) && f.type == 6 && f.flags == 1 && memcmp(f.data, "12345678", 8) == 0);
+    drain();
+    http_h2_free(h2);
+}
+
+/* 同一连接上的并发请求，各自的响应都完整发出后关闭流 */
+static void test_streams(void)
+{
+    struct http_h2 *h2 = session();
+    struct frame f;
+    int headers = 0, ends = 0;
+
+    put_request(1, "GET", "/a", 1);
+    put_request(3, "GET", "/b", 1);
+    put_request(5, "POST", "/c", 0);
+    put_frame(0, 0, 5, "hello", 5);
+    put_frame(0, 1, 5, "", 0);
+    CHECK(feed(h2) == 0);
+    CHECK(g_nreqs == 3 && http_h2_active(h2) == 3);
+    CHECK_STR(g_reqs[0].path, "/a");
+    CHECK_STR(g_reqs[2].path, "/c");
+    CHECK(g_reqs[0].ended && g_reqs[1].ended && g_reqs[2].ended && g_reqs[2].body == 5);
+
+    respond(&g_reqs[1], "bbb", 3, 1);
+    respond(&g_reqs[0], "aa", 2, 0);
+    respond(&g_reqs[2], NULL, 0, 0);
+    http_h2_pump(h2);
+    while (next_frame(&f)) {
+        headers += f.type == 1;
+        ends += (f.type == 0 || f.type == 1) && (f.flags & 1);
+    }
+    drain();
+    CHECK(headers == 3 && ends == 3);
+    CHECK(g_reqs[0].closed && g_reqs[1].closed && g_reqs[2].closed);
+    CHECK(http_h2_active(h2) == 0);
+    http_h2_free(h2);
+}
+
+/* 发送受对端窗口限制，WINDOW_UPDATE 后继续 */
+static void test_send_window(void)
+{
+    static char body[200000];
+    struct http_h2 *h2 = session();
+    int end = 0;
+
+    put_request(1, "GET", "/big", 1);
+    CHECK(feed(h2) == 0);
+    respond(&g_reqs[0], body, sizeof(body), 0);
+    http_h2_pump(h2);
+    CHECK(data_bytes(1, &end) == 65535 && !end);
+    CHECK(http_h2_stream_pending(g_reqs[0].st) == sizeof(body) - 65535);
+
+    /* 只有流窗口没有连接窗口：仍不能发送 */
+    put_u32(8, 1, 100000);
+    CHECK(feed(h2) == 0);
+    CHECK(data_bytes(1, NULL) == 0);
+
+    put_u32(8, 0, 200000);
+    CHECK(feed(h2) == 0);
+    CHECK(data_bytes(1, &end) == 100000 && !end);
+
+    /* SETTINGS_INITIAL_WINDOW_SIZE 的增量作用于已打开的流 */
+    {
+        unsigned char s[6] = { 0, 4, 0, 1, 0, 0 };     /* 65536 */
+
+        put_frame(4, 0, 0, s, 6);
+        CHECK(feed(h2) == 0);
+        CHECK(data_bytes(1, &end) == 1 && !end);
+    }
+    put_u32(8, 1, 100000);
+    CHECK(feed(h2) == 0);
+    CHECK(data_bytes(1, &end) == sizeof(body) - 65536 - 100000 && end);
+    CHECK(g_reqs[0].closed);
+    http_h2_free(h2);
+}
+
+/* 接收：暂停的流不归还窗口，恢复后交付缓存的数据并归还 */
+static void test_recv_pause(void)
+{
+    static char chunk[16384];
+    struct http_h2 *h2 = session();
+    struct frame f;
+    int updates = 0;
+
+    put_request(1, "POST", "/up", 0);
+    CHECK(feed(h2) == 0);
+    g_reqs[0].pause = 1;
+    for (int i = 0; i < 6; i++) {
+        put_frame(0, 0, 1, chunk, sizeof(chunk));
+    }
+    CHECK(feed(h2) == 0);
+    CHECK(g_reqs[0].body == sizeof(chunk));
+    CHECK(g_rx_held >= 5 * sizeof(chunk));
+    while (next_frame(&f)) {
+        updates += f.type == 8 && f.id == 1;
+    }
+    drain();
+    CHECK(updates == 0);
+
+    /* 恢复：一次交付缓存的 5 段，已交付超过半个窗口，归还流窗口 */
+    g_reqs[0].pause = 0;
+    http_h2_stream_resume(g_reqs[0].st);
+    http_h2_pump(h2);
+    CHECK(g_reqs[0].body == 6 * sizeof(chunk) && !g_reqs[0].ended);
+    CHECK(g_rx_held == 0);
+    while (next_frame(&f)) {
+        if (f.type == 8 && f.id == 1) {
+            updates++;
+            CHECK(get32(f.data) == 6 * sizeof(chunk));
+        }
+    }
+    drain();
+    CHECK(updates == 1);
+
+    /* 暂停期间超出流窗口（128KB）：流错误（FLOW_CONTROL_ERROR），连接不受影响 */
+    g_reqs[0].pause = 1;
+    for (int i = 0; i < 9; i++) {
+        put_frame(0, 0, 1, chunk, sizeof(chunk));
+    }
+    CHECK(feed(h2) == 0);
+    CHECK(next_frame(&f) && f.type == 3 && f.id == 1 && get32(f.data) == HTTP_H2_FLOW_CONTROL_ERROR);
+    drain();
+    CHECK(g_reqs[0].closed);
+    CHECK(g_rx_held == 0);
+    http_h2_free(h2);
+}
+
+/* 快速重置：客户端重置的流超过上限时 GOAWAY(ENHANCE_YOUR_CALM)，正常完成的流抵消重置 */
+static void test_rapid_reset(void)
+{
+    struct http_h2 *h2 = session();
+    uint32_t id = 1;
+    struct frame f;
+    int goaway = 0;
+
+    /* 重置与正常完成交替，不触发 */
+    for (int i = 0; i < 2 * HTTP_H2_MAX_RESETS; i++) {
+        g_nreqs = 0;
+        put_request(id, "GET", "/", 1);
+        put_u32(3, id, HTTP_H2_CANCEL);
+        put_request(id + 2, "GET", "/", 1);
+        CHECK(feed(h2) == 0);
+        respond(&g_reqs[1], NULL, 0, 0);
+        http_h2_pump(h2);
+        id += 4;
+    }
+    drain();
+
+    for (int i = 0; i < HTTP_H2_MAX_RESETS; i++) {
+        g_nreqs = 0;
+        put_request(id, "GET", "/", 0);
+        put_u32(3, id, HTTP_H2_CANCEL);
+        CHECK(feed(h2) == 0);
+        id += 2;
+    }
+    drain();
+    g_nreqs = 0;
+    put_request(id, "GET", "/", 0);
+    put_u32(3, id, HTTP_H2_CANCEL);
+    CHECK(feed(h2) < 0);
+    while (next_frame(&f)) {
+        goaway |= f.type == 7 && get32(f.data + 4) == HTTP_H2_ENHANCE_YOUR_CALM;
+    }
+    drain();
+    CHECK(goaway);
+    http_h2_free(h2);
+}
+
+/* 并发流上限与调用方拒绝：REFUSED_STREAM，连接不受影响 */
+static void test_refuse(void)
+{
+    struct http_h2 *h2 = session();
+    struct frame f;
+    int refused = 0;
+
+    for (uint32_t i = 0; i <= HTTP_H2_MAX_STREAMS; i++) {
+        put_request(2 * i + 1, "GET", "/", 0);
+    }
+    CHECK(feed(h2) == 0);
+    CHECK(http_h2_active(h2) == HTTP_H2_MAX_STREAMS);
+    while (next_frame(&f)) {
+        if (f.type == 3 && get32(f.data) == HTTP_H2_REFUSED_STREAM) {
+            refused++;
+            CHECK(f.id == 2 * HTTP_H2_MAX_STREAMS + 1);
+        }
+    }
+    drain();
+    CHECK(refused == 1);
+    http_h2_free(h2);
+
+    h2 = session();
+    g_refuse = 1;
+    put_request(1, "GET", "/", 1);
+    CHECK(feed(h2) == 0);
+    CHECK(next_frame(&f) && f.type == 3 && get32(f.data) == HTTP_H2_REFUSED_STREAM);
+    drain();
+    http_h2_free(h2);
+}
+
+/* 连接级错误：GOAWAY 后 http_h2_input 返回 -1 */
+static void expect_goaway(const char *what, uint32_t code)
+{
+    struct frame f;
+    int found = 0;
+
+    while (next_frame(&f)) {
+        if (f.type == 7) {
+            found = get32(f.data + 4) == code;
+        }
+    }
+    drain();
+    if (!found) {
+        fprintf(stderr, "no GOAWAY(%u) for %s\n", code, what);
+    }
+    CHECK(found);
+}
+
+static void test_errors(void)
+{
+    struct http_h2 *h2;
+    unsigned char junk[4] = { 0 };
+
+    /* 错误的序言 */
+    h2 = http_h2_new(&g_ops, NULL);
+    CHECK(http_h2_input(h2, "GET / HTTP/1.1\r\n\r\n", 18) < 0);
+    drain();
+    http_h2_free(h2);
+
+    /* 序言后首帧不是 SETTINGS */
+    h2 = http_h2_new(&g_ops, NULL);
+    memcpy(g_in, HTTP_H2_PREFACE, HTTP_H2_PREFACE_LEN);
+    g_in_len = HTTP_H2_PREFACE_LEN;
+    put_frame(6, 0, 0, "12345678", 8);
+    CHECK(feed(h2) < 0);
+    expect_goaway("PING before SETTINGS", HTTP_H2_PROTOCOL_ERROR);
+    http_h2_free(h2);
+
+    /* 空闲流上的 DATA */
+    h2 = session();
+    put_frame(0, 1, 9, "x", 1);
+    CHECK(feed(h2) < 0);
+    expect_goaway("DATA on idle stream", HTTP_H2_PROTOCOL_ERROR);
+    http_h2_free(h2);
+
+    /* 偶数流 ID */
+    h2 = session();
+    put_request(2, "GET", "/", 1);
+    CHECK(feed(h2) < 0);
+    expect_goaway("even stream id", HTTP_H2_PROTOCOL_ERROR);
+    http_h2_free(h2);
+
+    /* 无法解码的头块 */
+    h2 = session();
+    put_frame(1, 0x05, 1, "\x80", 1);
+    CHECK(feed(h2) < 0);
+    expect_goaway("bad HPACK", HTTP_H2_COMPRESSION_ERROR);
+    http_h2_free(h2);
+
+    /* 连接窗口增量为 0 */
+    h2 = session();
+    put_frame(8, 0, 0, junk, 4);
+    CHECK(feed(h2) < 0);
+    expect_goaway("zero WINDOW_UPDATE", HTTP_H2_PROTOCOL_ERROR);
+    http_h2_free(h2);
+
+    /* 服务端不接受 PUSH_PROMISE */
+    h2 = session();
+    put_frame(5, 0x04, 1, junk, 4);
+    CHECK(feed(h2) < 0);
+    expect_goaway("PUSH_PROMISE", HTTP_H2_PROTOCOL_ERROR);
+    http_h2_free(h2);
+}
+
+/* 暂停的流缓存的数据占着连接窗口：缓存满一个连接窗口后客户端不能再发，交付后归还 */
+static void test_conn_window(void)
+{
+    static char chunk[16384];
+    const int nstreams = HTTP_H2_CONN_WINDOW / HTTP_H2_STREAM_WINDOW;
+    struct http_h2 *h2 = session();
+    struct frame f;
+    uint32_t credit = 0;
+
+    for (int i = 0; i < nstreams; i++) {
+        put_request(2 * i + 1, "POST", "/up", 0);
+    }
+    CHECK(feed(h2) == 0);
+    for (int i = 0; i < nstreams; i++) {
+        g_reqs[i].pause = 1;
+        put_frame(0, 0, 2 * i + 1, chunk, sizeof(chunk));
+    }
+    CHECK(feed(h2) == 0);
+    drain();
+
+    /* 每个流再填满流窗口：除首段外都缓存在引擎中 */
+    for (int i = 0; i < nstreams; i++) {
+        for (size_t n = sizeof(chunk); n < HTTP_H2_STREAM_WINDOW; n += sizeof(chunk)) {
+            put_frame(0, 0, 2 * i + 1, chunk, sizeof(chunk));
+        }
+        CHECK(feed(h2) == 0);
+    }
+    CHECK(g_rx_held >= (size_t)nstreams * (HTTP_H2_STREAM_WINDOW - sizeof(chunk)));
+    while (next_frame(&f)) {
+        if (f.type == 8 && f.id == 0) {
+            credit += get32(f.data);
+        }
+    }
+    drain();
+    CHECK(credit == 0);
+
+    /* 已交付的部分攒到半个窗口才归还：再多一个帧就超出连接窗口 */
+    put_request(2 * nstreams + 1, "POST", "/up", 0);
+    for (uint32_t n = 0; n <= credit; n += sizeof(chunk)) {
+        put_frame(0, 0, 2 * nstreams + 1, chunk, sizeof(chunk));
+    }
+    CHECK(feed(h2) < 0);
+    expect_goaway("connection window", HTTP_H2_FLOW_CONTROL_ERROR);
+    http_h2_free(h2);
+    CHECK(g_rx_held == 0);
+
+    /* 恢复交付后归还连接窗口 */
+    h2 = session();
+    credit = 0;
+    for (int i = 0; i < nstreams; i++) {
+        put_request(2 * i + 1, "POST", "/up", 0);
+    }
+    CHECK(feed(h2) == 0);
+    for (int i = 0; i < nstreams; i++) {
+        g_reqs[i].pause = 1;
+        for (size_t n = 0; n < HTTP_H2_STREAM_WINDOW; n += sizeof(chunk)) {
+            put_frame(0, 0, 2 * i + 1, chunk, sizeof(chunk));
+        }
+        CHECK(feed(h2) == 0);
+    }
+    drain();
+    for (int i = 0; i < nstreams; i++) {
+        g_reqs[i].pause = 0;
+        http_h2_stream_resume(g_reqs[i].st);
+    }
+    http_h2_pump(h2);
+    CHECK(g_rx_held == 0);
+    while (next_frame(&f)) {
+        if (f.type == 8 && f.id == 0) {
+            credit += get32(f.data);
+        }
+    }
+    drain();
+    CHECK(credit >= HTTP_H2_CONN_WINDOW / 2);
+    http_h2_free(h2);
+}
+
+/* 客户端重置流：回调 close，之后不再发出这个流的帧 */
+static void test_reset(void)
+{
+    static char body[100000];
+    struct http_h2 *h2 = session();
+    struct frame f;
+    int later = 0;
+
+    put_request(1, "GET", "/a", 1);
+    CHECK(feed(h2) == 0);
+    respond(&g_reqs[0], body, sizeof(body), 0);
+    http_h2_pump(h2);
+    drain();
+    put_u32(3, 1, HTTP_H2_CANCEL);
+    put_u32(8, 0, 100000);
+    CHECK(feed(h2) == 0);
+    CHECK(g_reqs[0].closed && http_h2_active(h2) == 0);
+    while (next_frame(&f)) {
+        later += f.id == 1;
+    }
+    drain();
+    CHECK(later == 0);
+
+    /* 调用方重置：发出 RST_STREAM 后回调 close */
+    put_request(3, "GET", "/b", 1);
+    CHECK(feed(h2) == 0);
+    http_h2_stream_reset(g_reqs[1].st, HTTP_H2_INTERNAL_ERROR);
+    CHECK(!g_reqs[1].closed);
+    http_h2_pump(h2);
+    CHECK(next_frame(&f) && f.type == 3 && f.id == 3 && get32(f.data) == HTTP_H2_INTERNAL_ERROR);
+    CHECK(g_reqs[1].closed);
+    drain();
+    http_h2_free(h2);
+}
+
+/* 帧可以在任意位置切开送入 */
+static void test_split_input(void)
+{
+    struct http_h2 *h2 = http_h2_new(&g_ops, NULL);
+    unsigned char buf[512];
+    size_t len;
+
+    g_nreqs = 0;
+    memcpy(g_in, HTTP_H2_PREFACE, HTTP_H2_PREFACE_LEN);
+    g_in_len = HTTP_H2_PREFACE_LEN;
+    put_frame(4, 0, 0, NULL, 0);
+    put_request(1, "POST", "/split", 0);
+    put_frame(0, 1, 1, "abcdef", 6);
+    len = g_in_len;
+    memcpy(buf, g_in, len);
+    g_in_len = 0;
+    for (size_t i = 0; i < len; i++) {
+        CHECK(http_h2_input(h2, (const char *)buf + i, 1) == 0);
+    }
+    CHECK(g_nreqs == 1 && g_reqs[0].body == 6 && g_reqs[0].ended);
+    CHECK_STR(g_reqs[0].path, "/split");
+    drain();
+    http_h2_free(h2);
+}
+
+int main(void)
+{
+    test_handshake();
+    test_streams();
+    test_send_window();
+    test_recv_pause();
+    test_reset();
+    test_rapid_reset();
+    test_refuse();
+    test_errors();
+    test_conn_window();
+    test_split_input();
+    TEST_DONE();
+}
@@ -0,0 +1,179 @@
+/* HPACK 解码与编码：RFC 7541 附录 C 的示例、错误输入、编码结果回解 */
+
+#include "test_util.h"
+#include "http_hpack.h"
+
+/* 解出的请求头拼成 "name: value\n" */
+struct fields {
+    char buf[4096];
+    size_t len;
+};
+
+static void emit(void *ctx, const char *name, size_t name_len,
+                 const char *value, size_t value_len)
+{
+    struct fields *f = ctx;
+
+    f->len += snprintf(f->buf + f->len, sizeof(f->buf) - f->len, "%.*s: %.*s\n",
+                       (int)name_len, name, (int)value_len, value);
+}
+
+/* 解码一个头块，返回拼接结果；解码失败返回 NULL */
+static const char *decode(struct http_hpack *hp, const char *hex)
+{
+    static struct fields f;
+    unsigned char in[1024];
+    size_t len = test_unhex(hex, in, sizeof(in));
+
+    f.len = 0;
+    f.buf[0] = '\0';
+    if (http_hpack_decode(hp, in, len, emit, &f) < 0) {
+        return NULL;
+    }
+    return f.buf;
+}
+
+#define REQ1 ":method: GET\n:scheme: http\n:path: /\n:authority: www.example.com\n"
+#define REQ2 REQ1 "cache-control: no-cache\n"
+#define REQ3 ":method: GET\n:scheme: https\n:path: /index.html\n:authority: www.example.com\n" \
+             "custom-key: custom-value\n"
+
+#define RSP1 ":status: 302\ncache-control: private\ndate: Mon, 21 Oct 2013 20:13:21 GMT\n" \
+             "location: https://www.example.com\n"
+#define RSP2 ":status: 307\ncache-control: private\ndate: Mon, 21 Oct 2013 20:13:21 GMT\n" \
+             "location: https://www.example.com\n"
+#define RSP3 ":status: 200\ncache-control: private\ndate: Mon, 21 Oct 2013 20:13:22 GMT\n" \
+             "location: https://www.example.com\ncontent-encoding: gzip\n" \
+             "set-cookie: foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1\n"
+
+/* C.2：单个字段的各种表示 */
+static void test_c2(void)
+{
+    struct http_hpack hp;
+
+    http_hpack_init(&hp);
+    CHECK_STR(decode(&hp, "400a 6375 7374 6f6d 2d6b 6579 0d63 7573 746f 6d2d 6865 6164 6572"),
+              "custom-key: custom-header\n");
+    CHECK(hp.count == 1 && hp.size == 55);
+    http_hpack_free(&hp);
+
+    http_hpack_init(&hp);
+    CHECK_STR(decode(&hp, "040c 2f73 616d 706c 652f 7061 7468"), ":path: /sample/path\n");
+    CHECK(hp.count == 0 && hp.size == 0);
+    CHECK_STR(decode(&hp, "1008 7061 7373 776f 7264 0673 6563 7265 74"), "password: secret\n");
+    CHECK(hp.count == 0);
+    CHECK_STR(decode(&hp, "82"), ":method: GET\n");
+    http_hpack_free(&hp);
+}
+
+/* C.3 / C.4：同一连接上的三个请求（动态表跨头块保留），不带与带 Huffman */
+static void test_c3_c4(void)
+{
+    struct http_hpack hp;
+
+    http_hpack_init(&hp);
+    CHECK_STR(decode(&hp, "8286 8441 0f77 7777 2e65 7861 6d70 6c65 2e63 6f6d"), REQ1);
+    CHECK(hp.size == 57);
+    CHECK_STR(decode(&hp, "8286 84be 5808 6e6f 2d63 6163 6865"), REQ2);
+    CHECK(hp.size == 110);
+    CHECK_STR(decode(&hp, "8287 85bf 400a 6375 7374 6f6d 2d6b 6579 0c63 7573 746f 6d2d 7661 6c75 65"),
+              REQ3);
+    CHECK(hp.count == 3 && hp.size == 164);
+    http_hpack_free(&hp);
+
+    http_hpack_init(&hp);
+    CHECK_STR(decode(&hp, "8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff"), REQ1);
+    CHECK(hp.size == 57);
+    CHECK_STR(decode(&hp, "8286 84be 5886 a8eb 1064 9cbf"), REQ2);
+    CHECK(hp.size == 110);
+    CHECK_STR(decode(&hp, "8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf"), REQ3);
+    CHECK(hp.count == 3 && hp.size == 164);
+    http_hpack_free(&hp);
+}
+
+/* C.5 / C.6：动态表上限 256 字节，第二、三个头块触发淘汰 */
+static void test_c5_c6(void)
+{
+    struct http_hpack hp;
+
+    http_hpack_init(&hp);
+    hp.max_size = 256;
+    CHECK_STR(decode(&hp, "4803 3330 3258 0770 7269 7661 7465 611d 4d6f 6e2c 2032 3120 4f63 7420"
+                          "3230 3133 2032 303a 3133 3a32 3120 474d 546e 1768 7474 7073 3a2f 2f77"
+                          "7777 2e65 7861 6d70 6c65 2e63 6f6d"), RSP1);
+    CHECK(hp.count == 4 && hp.size == 222);
+    CHECK_STR(decode(&hp, "4803 3330 37c1 c0bf"), RSP2);
+    CHECK(hp.count == 4 && hp.size == 222);
+    CHECK_STR(decode(&hp, "88c1 611d 4d6f 6e2c 2032 3120 4f63 7420 3230 3133 2032 303a 3133 3a32"
+                          "3220 474d 54c0 5a04 677a 6970 7738 666f 6f3d 4153 444a 4b48 514b 425a"
+                          "584f 5157 454f 5049 5541 5851 5745 4f49 553b 206d 6178 2d61 6765 3d33"
+                          "3630 303b 2076 6572 7369 6f6e 3d31"), RSP3);
+    CHECK(hp.count == 3 && hp.size == 215);
+    http_hpack_free(&hp);
+
+    http_hpack_init(&hp);
+    hp.max_size = 256;
+    CHECK_STR(decode(&hp, "4882 6402 5885 aec3 771a 4b61 96d0 7abe 9410 54d4 44a8 2005 9504 0b81"
+                          "66e0 82a6 2d1b ff6e 919d 29ad 1718 63c7 8f0b 97c8 e9ae 82ae 43d3"), RSP1);
+    CHECK(hp.count == 4 && hp.size == 222);
+    CHECK_STR(decode(&hp, "4883 640e ffc1 c0bf"), RSP2);
+    CHECK(hp.count == 4 && hp.size == 222);
+    CHECK_STR(decode(&hp, "88c1 6196 d07a be94 1054 d444 a820 0595 040b 8166 e084 a62d 1bff c05a"
+                          "839b d9ab 77ad 94e7 821d d7f2 e6c7 b335 dfdf cd5b 3960 d5af 2708 7f36"
+                          "72c1 ab27 0fb5 291f 9587 3160 65c0 03ed 4ee5 b106 3d50 07"), RSP3);
+    CHECK(hp.count == 3 && hp.size == 215);
+    http_hpack_free(&hp);
+}
+
+/* 格式错误（COMPRESSION_ERROR） */
+static void test_errors(void)
+{
+    struct http_hpack hp;
+
+    http_hpack_init(&hp);
+    CHECK(decode(&hp, "80") == NULL);                   /* 索引 0 */
+    CHECK(decode(&hp, "be") == NULL);                   /* 动态表为空时的索引 62 */
+    CHECK(decode(&hp, "ff") == NULL);                   /* 整数未结束 */
+    CHECK(decode(&hp, "040c 2f73") == NULL);            /* 字符串超出头块 */
+    CHECK(decode(&hp, "0481 ff") == NULL);              /* Huffman 填充超过 7 位 */
+    CHECK(decode(&hp, "3fe2 1f") == NULL);              /* 动态表大小更新超过上限（4096） */
+    CHECK(decode(&hp, "82 20") == NULL);                /* 大小更新不在头块开头 */
+    CHECK_STR(decode(&hp, "20 82"), ":method: GET\n");  /* 头块开头的大小更新（置 0） */
+    http_hpack_free(&hp);
+}
+
+/* 编码：状态码、名称在静态表中的字段、字面量名称（转为小写），结果可被解码 */
+static void test_encode(void)
+{
+    struct http_hpack hp;
+    unsigned char out[256];
+    size_t n = 0;
+    struct fields f = { .len = 0 };
+
+    n += http_hpack_encode_status(out + n, sizeof(out) - n, 200);
+    CHECK(n == 1 && out[0] == 0x88);
+    n += http_hpack_encode_status(out + n, sizeof(out) - n, 418);
+    n += http_hpack_encode_field(out + n, sizeof(out) - n, "Content-Type", 12, "text/plain", 10);
+    n += http_hpack_encode_field(out + n, sizeof(out) - n, "X-Request-Id", 12, "Ab", 2);
+
+    http_hpack_init(&hp);
+    CHECK(http_hpack_decode(&hp, out, n, emit, &f) == 0);
+    f.buf[f.len] = '\0';
+    CHECK_STR(f.buf, ":status: 200\n:status: 418\ncontent-type: text/plain\nx-request-id: Ab\n");
+    CHECK(hp.count == 0);                               /* 响应头不进动态表 */
+    http_hpack_free(&hp);
+
+    /* 空间不足 */
+    CHECK(http_hpack_encode_field(out, 4, "x-long", 6, "value", 5) == 0);
+    CHECK(http_hpack_encode_status(out, 0, 200) == 0);
+}
+
+int main(void)
+{
+    test_c2();
+    test_c3_c4();
+    test_c5_c6();
+    test_errors();
+    test_encode();
+    TEST_DONE();
+}
@@ -0,0 +1,244 @@
+/* HTTP/2 请求流：http.c 把请求头映射为请求（http_h2_header 等是内部函数，直接包含 http.c），
+ * 用内存中的 ops 驱动 session，检查格式错误的请求被重置而 session 不受影响 */
+
+/* http.c 定义 _GNU_SOURCE，须在其它系统头之前 */
+#include "http.c"
+#include "test_util.h"
+
+/* 发出的帧 */
+struct frame {
+    int type;
+    uint32_t id;
+    uint32_t code;              /* RST_STREAM / GOAWAY 的错误码 */
+};
+
+static struct frame g_frames[256];
+static int g_nframes;
+static unsigned char g_out[1 << 20];
+static size_t g_out_len;
+
+static void t_send(void *ctx, struct iovec *iov, int iovcnt)
+{
+    for (int i = 0; i < iovcnt; i++) {
+        memcpy(g_out + g_out_len, iov[i].iov_base, iov[i].iov_len);
+        g_out_len += iov[i].iov_len;
+    }
+}
+
+static size_t t_tx_pending(void *ctx)
+{
+    return 0;
+}
+
+/* 把已发出的字节拆成帧 */
+static void collect(void)
+{
+    size_t pos = 0;
+
+    g_nframes = 0;
+    while (pos + 9 <= g_out_len && g_nframes < 256) {
+        const unsigned char *p = g_out + pos;
+        size_t len = (size_t)p[0] << 16 | p[1] << 8 | p[2];
+        struct frame *f = &g_frames[g_nframes++];
+
+        f->type = p[3];
+        f->id = ((uint32_t)p[5] << 24 | p[6] << 16 | p[7] << 8 | p[8]) & 0x7fffffff;
+        f->code = 0;
+        if (f->type == 3 && len >= 4) {
+            f->code = (uint32_t)p[9] << 24 | p[10] << 16 | p[11] << 8 | p[12];
+        } else if (f->type == 7 && len >= 8) {
+            f->code = (uint32_t)p[13] << 24 | p[14] << 16 | p[15] << 8 | p[16];
+        }
+        pos += 9 + len;
+    }
+    g_out_len = 0;
+}
+
+/* 流 id 上发出的第一个 type 帧，没有返回 NULL */
+static struct frame *find(int type, uint32_t id)
+{
+    for (int i = 0; i < g_nframes; i++) {
+        if (g_frames[i].type == type && g_frames[i].id == id) {
+            return &g_frames[i];
+        }
+    }
+    return NULL;
+}
+
+static int h_complete(struct http_conn *conn)
+{
+    http_set_response(conn, 200, "text/plain", HTTP_STATIC_BODY("ok"));
+    return 0;
+}
+
+static http_body_handler_t g_handler = {
+    .on_complete = h_complete,
+};
+
+static struct http_h2_ops g_ops;
+static struct http_conn g_parent;
+
+static void put_frame(unsigned char *buf, size_t *n, int type, int flags, uint32_t id,
+                      const void *payload, size_t len)
+{
+    unsigned char *p = buf + *n;
+
+    p[0] = len >> 16;
+    p[1] = len >> 8;
+    p[2] = len;
+    p[3] = type;
+    p[4] = flags;
+    p[5] = id >> 24;
+    p[6] = id >> 16;
+    p[7] = id >> 8;
+    p[8] = id;
+    if (len) {
+        memcpy(p + 9, payload, len);
+    }
+    *n += 9 + len;
+}
+
+static struct http_h2 *session(void)
+{
+    unsigned char buf[64];
+    size_t n = HTTP_H2_PREFACE_LEN;
+    struct http_h2 *h2 = http_h2_new(&g_ops, &g_parent);
+
+    memcpy(buf, HTTP_H2_PREFACE, HTTP_H2_PREFACE_LEN);
+    put_frame(buf, &n, 4, 0, 0, NULL, 0);
+    CHECK(http_h2_input(h2, (const char *)buf, n) == 0);
+    g_out_len = 0;
+    return h2;
+}
+
+/* 发一个只有请求头的请求（END_STREAM），fields 为名/值交替、NULL 结尾 */
+static void request(struct http_h2 *h2, uint32_t id, const char **fields)
+{
+    static unsigned char buf[8192];
+    uint8_t block[4096];
+    size_t len = 0, n = 0;
+
+    for (; *fields; fields += 2) {
+        len += http_hpack_encode_field(block + len, sizeof(block) - len,
+                                       fields[0], strlen(fields[0]),
+                                       fields[1], strlen(fields[1]));
+    }
+    put_frame(buf, &n, 1, 0x5, id, block, len);
+    CHECK(http_h2_input(h2, (const char *)buf, n) == 0);
+    http_h2_pump(h2);
+    collect();
+}
+
+/* 请求被重置为 PROTOCOL_ERROR，没有响应 */
+static int malformed(uint32_t id)
+{
+    struct frame *rst = find(3, id);
+
+    return rst && rst->code == HTTP_H2_PROTOCOL_ERROR && !find(1, id);
+}
+
+/* 请求得到响应 */
+static int answered(uint32_t id)
+{
+    return find(1, id) && !find(3, id);
+}
+
+static void test_method(void)
+{
+    struct http_h2 *h2 = session();
+    const char *get[] = {":method", "GET", ":scheme", "https", ":path", "/", NULL};
+    const char *foo[] = {":method", "FOO", ":scheme", "https", ":path", "/", NULL};
+    const char *lower[] = {":method", "get", ":scheme", "https", ":path", "/", NULL};
+    const char *query[] = {":method", "QUERY", ":scheme", "https", ":path", "/", NULL};
+    const char *empty[] = {":method", "", ":scheme", "https", ":path", "/", NULL};
+    const char *pri[] = {":method", "PRI", ":scheme", "https", ":path", "/", NULL};
+    struct http_conn conn;
+
+    /* 未知方法（含 llhttp 表外的名字）直接拒绝 */
+    memset(&conn, 0, sizeof(conn));
+    CHECK(http_h2_header(&conn, ":method", 7, "FOO", 3) < 0);
+    CHECK(http_h2_header(&conn, ":method", 7, "get", 3) < 0);
+    CHECK(http_h2_header(&conn, ":method", 7, "QUERY", 5) < 0);
+    CHECK(http_h2_header(&conn, ":method", 7, "FLUSH", 5) == 0);
+    CHECK(conn.parser.method == HTTP_METHOD_COUNT - 1);
+
+    request(h2, 1, foo);
+    CHECK(malformed(1));
+    request(h2, 3, lower);
+    CHECK(malformed(3));
+    request(h2, 5, query);
+    CHECK(malformed(5));
+    request(h2, 7, empty);
+    CHECK(malformed(7));
+    request(h2, 9, pri);
+    CHECK(malformed(9));
+
+    /* 只重置了流，session 照常处理之后的请求 */
+    request(h2, 11, get);
+    CHECK(answered(11));
+    CHECK(!find(7, 0));
+    http_h2_free(h2);
+}
+
+/* RFC 9113 8.2：连接级请求头、te 不是 trailers、值中含 NUL / CR / LF、缺少 :scheme */
+static void test_malformed(void)
+{
+    struct http_h2 *h2 = session();
+    const char *conn_hdr[] = {":method", "GET", ":scheme", "https", ":path", "/",
+                              "connection", "keep-alive", NULL};
+    const char *keep_alive[] = {":method", "GET", ":scheme", "https", ":path", "/",
+                                "keep-alive", "timeout=5", NULL};
+    const char *te_chunked[] = {":method", "POST", ":scheme", "https", ":path", "/",
+                                "transfer-encoding", "chunked", NULL};
+    const char *upgrade[] = {":method", "GET", ":scheme", "https", ":path", "/",
+                             "upgrade", "websocket", NULL};
+    const char *te_gzip[] = {":method", "GET", ":scheme", "https", ":path", "/",
+                             "te", "gzip", NULL};
+    const char *te_trailers[] = {":method", "GET", ":scheme", "https", ":path", "/",
+                                 "te", "trailers", NULL};
+    const char *crlf[] = {":method", "GET", ":scheme", "https", ":path", "/",
+                          "x-a", "1\r\nx-b: 2", NULL};
+    const char *lf_path[] = {":method", "GET", ":scheme", "https", ":path", "/a\nb", NULL};
+    const char *no_scheme[] = {":method", "GET", ":path", "/", ":authority", "x", NULL};
+    struct http_conn conn;
+
+    /* NUL 无法经由 C 字符串编码，直接调用 */
+    memset(&conn, 0, sizeof(conn));
+    CHECK(http_h2_header(&conn, "x-a", 3, "a\0b", 3) < 0);
+    CHECK(http_h2_header(&conn, "x-a", 3, "a b", 3) == 0);
+    http_arena_destroy(&conn.arena);
+
+    request(h2, 1, conn_hdr);
+    CHECK(malformed(1));
+    request(h2, 3, keep_alive);
+    CHECK(malformed(3));
+    request(h2, 5, te_chunked);
+    CHECK(malformed(5));
+    request(h2, 7, upgrade);
+    CHECK(malformed(7));
+    request(h2, 9, te_gzip);
+    CHECK(malformed(9));
+    request(h2, 11, crlf);
+    CHECK(malformed(11));
+    request(h2, 13, lf_path);
+    CHECK(malformed(13));
+    request(h2, 15, no_scheme);
+    CHECK(malformed(15));
+
+    request(h2, 17, te_trailers);
+    CHECK(answered(17));
+    CHECK(!find(7, 0));
+    http_h2_free(h2);
+}
+
+int main(void)
+{
+    g_ops = g_h2_ops;
+    g_ops.send = t_send;
+    g_ops.tx_pending = t_tx_pending;
+    g_body_handler = &g_handler;
+
+    test_method();
+    test_malformed();
+    TEST_DONE();
+}
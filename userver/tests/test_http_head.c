@@ -0,0 +1,91 @@
+/* HTTP/1.1 与 HTTP/2 响应头生成：http_format_head 等是 http.c 的内部函数，直接包含 http.c；
+ * 检查无 body 状态码不带长度、超出 tx_buf 的附加响应头不被丢弃 */
+
+/* http.c 定义 _GNU_SOURCE，须在其它系统头之前 */
+#include "http.c"
+#include "test_util.h"
+
+/* 生成 HTTP/1.1 头部，返回以 '\0' 结尾的副本 */
+static char *head(struct http_conn *conn, int status, long long content_len)
+{
+    static char out[1 << 17];
+    const char *p;
+    size_t len;
+
+    conn->status_code = status;
+    len = http_format_head(conn, "text/plain", content_len, &p);
+    CHECK(len < sizeof(out));
+    memcpy(out, p, len);
+    out[len] = '\0';
+    return out;
+}
+
+static void test_length(void)
+{
+    struct http_conn conn;
+
+    memset(&conn, 0, sizeof(conn));
+    conn.keep_alive = 1;
+
+    CHECK(strstr(head(&conn, 200, 2), "\r\nContent-Length: 2\r\n") != NULL);
+    CHECK(strstr(head(&conn, 200, 0), "\r\nContent-Length: 0\r\n") != NULL);
+    CHECK(strstr(head(&conn, 200, HTTP_LENGTH_CHUNKED), "\r\nTransfer-Encoding: chunked\r\n"));
+
+    /* 1xx、204、304 不带 Content-Length，也不分块 */
+    CHECK(strncmp(head(&conn, 204, 0), "HTTP/1.1 204 ", 13) == 0);
+    CHECK(!strstr(head(&conn, 204, 0), "Content-Length"));
+    CHECK(!strstr(head(&conn, 204, HTTP_LENGTH_CHUNKED), "Transfer-Encoding"));
+    CHECK(!strstr(head(&conn, 100, 0), "Content-Length"));
+    CHECK(!strstr(head(&conn, 101, 0), "Content-Length"));
+    CHECK(!strstr(head(&conn, 304, 10), "Content-Length"));
+    CHECK(strstr(head(&conn, 204, 0), "\r\nConnection: keep-alive\r\n\r\n") != NULL);
+
+    http_arena_destroy(&conn.arena);
+}
+
+/* 附加响应头合计超过 tx_buf：改用 arena 中的缓冲区，全部发出 */
+static void test_large(void)
+{
+    struct http_conn conn;
+    char value[1024];
+    char name[16];
+    const char *p;
+    char *out;
+    size_t len;
+
+    memset(&conn, 0, sizeof(conn));
+    memset(value, 'v', sizeof(value) - 1);
+    value[sizeof(value) - 1] = '\0';
+    for (int i = 0; i < 40; i++) {
+        snprintf(name, sizeof(name), "X-H%d", i);
+        CHECK(http_add_header(&conn, name, value) == 0);
+    }
+    CHECK(conn.response_headers_len > sizeof(tx_buf));
+
+    out = head(&conn, 200, 5);
+    CHECK(strstr(out, "\r\nX-H0: vvv") != NULL);
+    CHECK(strstr(out, "\r\nX-H39: vvv") != NULL);
+    CHECK(strstr(out, "vvv\r\nConnection: close\r\n\r\n") != NULL);
+    CHECK(strlen(out) > conn.response_headers_len);
+
+    /* HTTP/2：同样不丢弃，值按字面量原样编码 */
+    conn.status_code = 204;
+    len = http_h2_format_head(&conn, "text/plain", 0, &p);
+    CHECK(p != tx_buf && len > sizeof(tx_buf));
+    CHECK(memmem(p, len, "x-h39", 5) != NULL);
+    CHECK(memmem(p, len, value, sizeof(value) - 1) != NULL);
+    CHECK(!memmem(p, len, "content-length", 14));
+
+    /* 小的头部仍写在 tx_buf 中 */
+    conn.response_headers_len = 0;
+    CHECK(http_format_head(&conn, NULL, 0, &p) > 0 && p == tx_buf);
+
+    http_arena_destroy(&conn.arena);
+}
+
+int main(void)
+{
+    test_length();
+    test_large();
+    TEST_DONE();
+}
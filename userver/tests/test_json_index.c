@@ -0,0 +1,159 @@
+/* JSON 结构索引（json-buffer）测试
+ * - stage 1 实现 scalar / sse2 / avx2 各跑一遍（CPU 不支持的跳过）
+ * - 语料 y_ 接受且构建的对象与 json_tokener 的结果相等，n_ 拒绝；前面补空白让 token 落在 64 字节块的不同位置
+ * - 对语料逐字节替换得到的变体，与 tape 解析器（json-lazy）的接受 / 拒绝结果一致 */
+#include "test_util.h"
+#include "json_corpus.h"
+#include "http_json_index.h"
+#include "http_json_tape.h"
+
+/* 解析 text[0, len)：返回 0 接受，HTTP_JSON_INDEX_* 拒绝
+ * want 非 NULL 时把构建的对象与之比较（key 引用 buf，须在释放 buf 之前比较），结果写入 *equal */
+static int index_run(const char *text, size_t len, json_object *want, int *equal)
+{
+    http_arena_t arena = { 0 };
+    http_json_index_t idx;
+    json_object *obj = NULL;
+    char *buf = malloc(len + 1);
+    int ret;
+
+    memcpy(buf, text, len);
+    buf[len] = '\0';
+    ret = http_json_index_build(&idx, &arena, buf, len);
+    if (ret == 0) {
+        ret = http_json_index_parse(&idx, buf, len, &obj);
+    }
+    if (ret == 0 && equal) {
+        *equal = json_object_equal(obj, want);
+        if (!*equal) {
+            fprintf(stderr, "    got  %s\n", json_object_to_json_string_ext(obj, JSON_C_TO_STRING_PLAIN));
+            fprintf(stderr, "    want %s\n", json_object_to_json_string_ext(want, JSON_C_TO_STRING_PLAIN));
+        }
+    }
+    if (obj) {
+        json_object_put(obj);
+    }
+    free(buf);
+    http_arena_destroy(&arena);
+    return ret;
+}
+
+static int tape_accepts(const char *text, size_t len)
+{
+    http_arena_t arena = { 0 };
+    http_json_tape_t t;
+    int ret = http_tape_init(&t, &arena, len, len + 1);
+
+    if (ret == 0) ret = http_tape_feed(&t, text, len);
+    if (ret == 0) ret = http_tape_finish(&t);
+    http_arena_destroy(&arena);
+    return ret == 0;
+}
+
+static void check_case(const struct json_case *c)
+{
+    size_t len = c->len ? c->len : strlen(c->text);
+    char *text = malloc(len + 80);
+
+    /* 与 json-c 自己的解析结果比较（只用于 y_，json_tokener 对 n_ 较宽松） */
+    json_object *want = c->name[0] == 'y' ? json_tokener_parse(c->text) : NULL;
+
+    for (size_t shift = 0; shift < 72; shift += c->name[0] == 'i' ? 71 : 1) {
+        int equal = 1;
+        int ret;
+
+        memset(text, ' ', shift);
+        memcpy(text + shift, c->text, len);
+        ret = index_run(text, len + shift, want, c->name[0] == 'y' ? &equal : NULL);
+        if (c->name[0] == 'i') {
+            continue;
+        }
+
+        g_test_checks++;
+        if ((ret == 0) != (c->name[0] == 'y') || !equal) {
+            fprintf(stderr, "%s [%s, +%zu]: %s\n", c->name, http_json_index_impl(), shift,
+                    ret != 0 ? "rejected" : equal ? "accepted" : "accepted, object differs");
+            g_test_failures++;
+        } else if (ret != 0) {
+            CHECK(ret == HTTP_JSON_INDEX_EINVAL);
+        }
+    }
+    if (want) {
+        json_object_put(want);
+    }
+    free(text);
+}
+
+/* 纯 ASCII 的单字节替换：两个解析器都严格按 RFC 8259，结果必须一致 */
+static void check_mutations(const struct json_case *c)
+{
+    static const char repl[] = "[]{},:\"\\ 0123456789.eE+-tfnrul\t\na";
+    size_t len = c->len ? c->len : strlen(c->text);
+    char *text;
+
+    /* tape 不校验 UTF-8：含非 ASCII 字节的用例替换后可能只有索引拒绝，跳过 */
+    for (size_t i = 0; i < len; i++) {
+        if ((unsigned char)c->text[i] >= 0x80) {
+            return;
+        }
+    }
+
+    text = malloc(len + 1);
+    for (size_t i = 0; i < len; i++) {
+        for (size_t k = 0; k < sizeof(repl) - 1; k++) {
+            int a, b;
+
+            memcpy(text, c->text, len);
+            text[len] = '\0';
+            text[i] = repl[k];
+            if (strspn(text, " \t\r\n") >= len) {
+                continue;       /* 只有空白：tape 视为没有文档，索引按空文档拒绝 */
+            }
+            a = index_run(text, len, NULL, NULL) == 0;
+            b = tape_accepts(text, len);
+            g_test_checks++;
+            if (a != b) {
+                fprintf(stderr, "[%s] \"%.*s\": index %s, tape %s\n", http_json_index_impl(),
+                        (int)len, text, a ? "accepts" : "rejects", b ? "accepts" : "rejects");
+                g_test_failures++;
+            }
+        }
+    }
+    free(text);
+}
+
+static void test_limits(void)
+{
+    char buf[2 * (HTTP_JSON_INDEX_MAX_DEPTH + 1)];
+    size_t len;
+
+    len = json_corpus_nested(buf, HTTP_JSON_INDEX_MAX_DEPTH);
+    CHECK(index_run(buf, len, NULL, NULL) == 0);
+    len = json_corpus_nested(buf, HTTP_JSON_INDEX_MAX_DEPTH + 1);
+    CHECK(index_run(buf, len, NULL, NULL) == HTTP_JSON_INDEX_EINVAL);
+    CHECK(index_run("", 0, NULL, NULL) == HTTP_JSON_INDEX_EINVAL);
+    CHECK(index_run(" \r\n", 3, NULL, NULL) == HTTP_JSON_INDEX_EINVAL);
+}
+
+int main(void)
+{
+    static const char *impls[] = { "scalar", "sse2", "avx2" };
+
+    for (size_t k = 0; k < sizeof(impls) / sizeof(impls[0]); k++) {
+        if (http_json_index_select(impls[k]) < 0) {
+            printf("%s: not supported, skipped\n", impls[k]);
+            continue;
+        }
+        CHECK_STR(http_json_index_impl(), impls[k]);
+
+        for (size_t i = 0; i < JSON_CORPUS_COUNT; i++) {
+            check_case(&g_json_corpus[i]);
+            if (g_json_corpus[i].name[0] != 'i') {
+                check_mutations(&g_json_corpus[i]);
+            }
+        }
+        test_limits();
+    }
+
+    TEST_DONE();
+}
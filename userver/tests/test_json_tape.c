@@ -0,0 +1,199 @@
+/* JSON tape（json-lazy）测试
+ * - 语料 y_ 接受、n_ 拒绝；整段、每个切分点两片、逐字节喂入的结果一致，tape 条目相同
+ * - 嵌套上限、body 上限、只有空白的 body
+ * - 按路径取值与重复 key */
+#include "test_util.h"
+#include "json_corpus.h"
+#include "http_json_tape.h"
+
+#define TEST_MAX_BODY (1024 * 1024)
+
+/* 按 chunks[] 分片喂入，返回 0 接受 / -1 拒绝；t 在 arena 中，由调用方销毁 */
+static int tape_run(http_json_tape_t *t, http_arena_t *arena, const char *text, size_t len,
+                    const size_t *chunks, int nchunks)
+{
+    size_t off = 0;
+
+    if (http_tape_init(t, arena, len, TEST_MAX_BODY) < 0) {
+        return -1;
+    }
+    for (int i = 0; i < nchunks; i++) {
+        if (http_tape_feed(t, text + off, chunks[i]) < 0) {
+            return -1;
+        }
+        off += chunks[i];
+    }
+    return http_tape_finish(t);
+}
+
+static int tape_same(const http_json_tape_t *a, const http_json_tape_t *b)
+{
+    if (a->count != b->count) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < a->count; i++) {
+        const http_tape_entry_t *x = &a->tape[i], *y = &b->tape[i];
+
+        if (x->type != y->type || x->depth != y->depth || x->has_key != y->has_key ||
+            (x->has_key && (x->key_off != y->key_off || x->key_len != y->key_len)) ||
+            x->off != y->off || x->len != y->len || x->end != y->end) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void check_case(const struct json_case *c)
+{
+    size_t len = c->len ? c->len : strlen(c->text);
+    size_t chunks[1024];
+    http_arena_t arena = { 0 };
+    http_json_tape_t whole, part;
+    int want = c->name[0] == 'y' ? 0 : -1;
+    int got;
+
+    chunks[0] = len;
+    got = tape_run(&whole, &arena, c->text, len, chunks, 1);
+    if (c->name[0] == 'i') {
+        http_arena_destroy(&arena);
+        return;
+    }
+    g_test_checks++;
+    if (got != want) {
+        fprintf(stderr, "%s: whole body %s (%s)\n", c->name, got ? "rejected" : "accepted",
+                whole.error ? whole.error : "no error");
+        g_test_failures++;
+    }
+    if (got == 0) {
+        /* 根值原文去掉首尾空白后即整个 body */
+        size_t start = 0, end = len;
+
+        while (start < end && strchr(" \t\r\n", c->text[start])) start++;
+        while (end > start && strchr(" \t\r\n", c->text[end - 1])) end--;
+        CHECK(whole.count > 0 && whole.tape[0].off == start && whole.tape[0].len == end - start);
+        CHECK(whole.tape[0].end == whole.count);
+    }
+
+    /* 两片：每个切分点 */
+    for (size_t cut = 1; cut < len; cut++) {
+        http_arena_t a = { 0 };
+        int r;
+
+        chunks[0] = cut;
+        chunks[1] = len - cut;
+        r = tape_run(&part, &a, c->text, len, chunks, 2);
+        g_test_checks++;
+        if (r != got || (r == 0 && !tape_same(&whole, &part))) {
+            fprintf(stderr, "%s: split at %zu differs from whole body\n", c->name, cut);
+            g_test_failures++;
+        }
+        http_arena_destroy(&a);
+    }
+
+    /* 逐字节 */
+    if (len > 1 && len <= sizeof(chunks) / sizeof(chunks[0])) {
+        http_arena_t a = { 0 };
+        int r;
+
+        for (size_t i = 0; i < len; i++) {
+            chunks[i] = 1;
+        }
+        r = tape_run(&part, &a, c->text, len, chunks, (int)len);
+        g_test_checks++;
+        if (r != got || (r == 0 && !tape_same(&whole, &part))) {
+            fprintf(stderr, "%s: byte-by-byte differs from whole body\n", c->name);
+            g_test_failures++;
+        }
+        http_arena_destroy(&a);
+    }
+
+    http_arena_destroy(&arena);
+}
+
+/* 按路径取值，比较值原文；want 为 NULL 表示应找不到 */
+static void check_lookup(const http_json_tape_t *t, const char *path, const char *want)
+{
+    int idx = http_tape_lookup(t, path);
+    char got[256] = "";
+
+    if (idx >= 0) {
+        size_t len;
+        const char *raw = http_tape_raw(t, idx, &len);
+
+        snprintf(got, sizeof(got), "%.*s", (int)len, raw);
+    }
+    if (!want) {
+        g_test_checks++;
+        if (idx >= 0) {
+            fprintf(stderr, "lookup \"%s\": got %s, want not found\n", path, got);
+            g_test_failures++;
+        }
+        return;
+    }
+    CHECK_STR(idx >= 0 ? got : NULL, want);
+}
+
+static void test_lookup(void)
+{
+    static const char doc[] =
+        "{\"user\":{\"name\":\"a\",\"tags\":[\"x\",\"y\",{\"k\":[1,2,[3]]}]},"
+        "\"n\":-1.5e3,\"dup\":1,\"esc\\\"key\":true,\"dup\":[null]}";
+    http_arena_t arena = { 0 };
+    http_json_tape_t t;
+    size_t chunks[1] = { sizeof(doc) - 1 };
+
+    CHECK(tape_run(&t, &arena, doc, sizeof(doc) - 1, chunks, 1) == 0);
+    check_lookup(&t, "", doc);
+    check_lookup(&t, "user.name", "\"a\"");
+    check_lookup(&t, "user.tags.1", "\"y\"");
+    check_lookup(&t, "user.tags.2.k.2.0", "3");
+    check_lookup(&t, "user.tags.2.k", "[1,2,[3]]");
+    check_lookup(&t, "n", "-1.5e3");
+    check_lookup(&t, "dup", "[null]");
+    check_lookup(&t, "esc\\\"key", "true");
+    check_lookup(&t, "user.tags.3", NULL);
+    check_lookup(&t, "user.tags.x", NULL);
+    check_lookup(&t, "user.name.x", NULL);
+    check_lookup(&t, "missing", NULL);
+    http_arena_destroy(&arena);
+}
+
+static void test_limits(void)
+{
+    char buf[2 * (HTTP_TAPE_MAX_DEPTH + 1)];
+    size_t chunks[1];
+    http_arena_t arena = { 0 };
+    http_json_tape_t t;
+
+    /* 嵌套上限 */
+    chunks[0] = json_corpus_nested(buf, HTTP_TAPE_MAX_DEPTH);
+    CHECK(tape_run(&t, &arena, buf, chunks[0], chunks, 1) == 0);
+    chunks[0] = json_corpus_nested(buf, HTTP_TAPE_MAX_DEPTH + 1);
+    CHECK(tape_run(&t, &arena, buf, chunks[0], chunks, 1) < 0);
+
+    /* 只有空白的 body 视为没有文档 */
+    chunks[0] = 3;
+    CHECK(tape_run(&t, &arena, " \r\n", 3, chunks, 1) == 0 && t.count == 0);
+    CHECK(tape_run(&t, &arena, "", 0, chunks, 0) == 0 && t.count == 0);
+
+    /* body 上限 */
+    CHECK(http_tape_init(&t, &arena, 0, 8) == 0);
+    CHECK(http_tape_feed(&t, "[1,2,", 5) == 0);
+    CHECK(http_tape_feed(&t, "3,4]", 4) < 0);
+    CHECK(t.error != NULL);
+    CHECK(http_tape_feed(&t, "]", 1) < 0);
+    CHECK(http_tape_finish(&t) < 0);
+
+    http_arena_destroy(&arena);
+}
+
+int main(void)
+{
+    for (size_t i = 0; i < JSON_CORPUS_COUNT; i++) {
+        check_case(&g_json_corpus[i]);
+    }
+    test_lookup();
+    test_limits();
+
+    TEST_DONE();
+}
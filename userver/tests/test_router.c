@@ -0,0 +1,78 @@
+/* 路由表：方法列表解析、精确/前缀匹配、405 的 Allow */
+
+#include "test_util.h"
+#include "http_router.h"
+
+/* http_router.c 只从 http.c 引用 http_add_header：记下 405 生成的 Allow */
+static char g_allow[1024];
+
+int http_add_header(struct http_conn *conn, const char *name, const char *value)
+{
+    snprintf(g_allow, sizeof(g_allow), "%s", value);
+    return 0;
+}
+
+static http_body_handler_t h_api;
+static http_body_handler_t h_static;
+
+static void test_parse_methods(void)
+{
+    uint64_t m;
+
+    CHECK(http_router_parse_methods("GET,POST", &m) == 0);
+    CHECK(m == (HTTP_ROUTE_METHOD(HTTP_GET) | HTTP_ROUTE_METHOD(HTTP_POST)));
+    CHECK(http_router_parse_methods("get,Head", &m) == 0);
+    CHECK(m == (HTTP_ROUTE_METHOD(HTTP_GET) | HTTP_ROUTE_METHOD(HTTP_HEAD)));
+    CHECK(http_router_parse_methods("FLUSH", &m) == 0);
+    CHECK(m == HTTP_ROUTE_METHOD(HTTP_METHOD_COUNT - 1));
+    CHECK(http_router_parse_methods("", &m) == 0 && m == HTTP_ROUTE_ANY);
+
+    /* 未知方法、空元素都报错，不能查到 llhttp 表外 */
+    CHECK(http_router_parse_methods("GTE", &m) < 0);
+    CHECK(http_router_parse_methods("GET,,POST", &m) < 0);
+    CHECK(http_router_parse_methods(",GET", &m) < 0);
+    CHECK(http_router_parse_methods("GETX", &m) < 0);
+    CHECK(http_router_parse_methods("QUERY", &m) < 0);
+
+    CHECK_STR(http_method_name(HTTP_GET), "GET");
+    CHECK_STR(http_method_name(HTTP_METHOD_COUNT - 1), "FLUSH");
+    CHECK(http_method_name(HTTP_METHOD_COUNT) == NULL);
+    CHECK(http_method_name(-1) == NULL);
+}
+
+static void test_match(void)
+{
+    http_router_t *r = http_router_new();
+    struct http_conn conn;
+    http_body_handler_t *h;
+    uint64_t allow;
+    void *ctx;
+
+    CHECK(http_router_add(r, HTTP_ROUTE_METHOD(HTTP_POST), "/api/json", &h_api, NULL) == 0);
+    CHECK(http_router_add(r, HTTP_ROUTE_METHOD(HTTP_GET) | HTTP_ROUTE_METHOD(HTTP_HEAD),
+                          "/static/*", &h_static, NULL) == 0);
+    CHECK(http_router_compile(r) == 0);
+
+    CHECK(http_router_match(r, HTTP_POST, "/api/json", 9, &ctx, &allow) == &h_api);
+    CHECK(http_router_match(r, HTTP_GET, "/static/a.css?v=1", 17, &ctx, &allow) == &h_static);
+
+    h = http_router_match(r, HTTP_GET, "/nope", 5, &ctx, &allow);
+    CHECK(h != &h_api && h != &h_static && allow == 0);
+
+    /* 路径命中、方法不符：405，Allow 按方法编号列出 */
+    h = http_router_match(r, HTTP_DELETE, "/static/x", 9, &ctx, &allow);
+    CHECK(h != &h_static && allow != 0);
+    memset(&conn, 0, sizeof(conn));
+    conn.route_allow = allow;
+    CHECK(h->on_complete(&conn) == 0);
+    CHECK_STR(g_allow, "GET, HEAD");
+
+    http_router_free(r);
+}
+
+int main(void)
+{
+    test_parse_methods();
+    test_match();
+    TEST_DONE();
+}
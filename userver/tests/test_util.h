@@ -0,0 +1,60 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 单元测试的公共宏：CHECK 失败时打印位置并计数，main 以 TEST_DONE() 结束，有失败时返回非 0 */
+
+static int g_test_failures = 0;
+static int g_test_checks = 0;
+
+#define CHECK(cond) do { \
+    g_test_checks++; \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        g_test_failures++; \
+    } \
+} while (0)
+
+#define CHECK_STR(got, want) do { \
+    const char *got_ = (got); \
+    const char *want_ = (want); \
+    g_test_checks++; \
+    if (!got_ || strcmp(got_, want_) != 0) { \
+        fprintf(stderr, "%s:%d: %s\n    got:  \"%s\"\n    want: \"%s\"\n", \
+                __FILE__, __LINE__, #got, got_ ? got_ : "(null)", want_); \
+        g_test_failures++; \
+    } \
+} while (0)
+
+#define TEST_DONE() do { \
+    printf("%s: %d checks, %d failed\n", __FILE__, g_test_checks, g_test_failures); \
+    return g_test_failures ? 1 : 0; \
+} while (0)
+
+/* 十六进制串（可含空格）转为字节，返回长度 */
+static inline size_t test_unhex(const char *hex, unsigned char *out, size_t size)
+{
+    size_t n = 0;
+    int hi = -1;
+
+    for (; *hex; hex++) {
+        int v;
+
+        if (*hex >= '0' && *hex <= '9') v = *hex - '0';
+        else if (*hex >= 'a' && *hex <= 'f') v = *hex - 'a' + 10;
+        else if (*hex >= 'A' && *hex <= 'F') v = *hex - 'A' + 10;
+        else continue;
+        if (hi < 0) {
+            hi = v;
+        } else if (n < size) {
+            out[n++] = (unsigned char)(hi << 4 | v);
+            hi = -1;
+        }
+    }
+    return n;
+}
+
+#endif // TEST_UTIL_H